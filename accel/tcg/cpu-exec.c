@@ -409,7 +409,7 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
         tb = tb_gen_code(cpu, pc, cs_base, flags, cf_mask);
         mmap_unlock();
         /* We add the TB in the virtual pc hash table for the fast lookup */
-        atomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_hash_func(pc)], tb);
+        tb_jmp_cache_insert(cpu, pc, tb);
     }
 #ifndef CONFIG_USER_ONLY
     /* We don't take care of direct jumps when address mapping changes in
@@ -621,6 +621,14 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
     ret = cpu_tb_exec(cpu, tb);
     tb = (TranslationBlock *)(ret & ~TB_EXIT_MASK);
     *tb_exit = ret & TB_EXIT_MASK;
+    if (*tb_exit == TB_EXIT_HOT) {
+        /* The TB did not start; swap it for a superblock and go again */
+        *last_tb = NULL;
+        mmap_lock();
+        tb_promote(cpu, tb);
+        mmap_unlock();
+        return;
+    }
     if (*tb_exit != TB_EXIT_REQUESTED) {
         *last_tb = tb;
         return;
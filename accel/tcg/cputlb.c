@@ -74,11 +74,86 @@ QEMU_BUILD_BUG_ON(sizeof(target_ulong) > sizeof(run_on_cpu_data));
 QEMU_BUILD_BUG_ON(NB_MMU_MODES > 16);
 #define ALL_MMUIDX_BITS ((1 << NB_MMU_MODES) - 1)
 
+/* A victim tlb set must not take entries from more than one index.  */
+QEMU_BUILD_BUG_ON(CPU_VTLB_BITS_MAX > CPU_TLB_DYN_MIN_BITS);
+
+unsigned int tlb_victim_bits = CPU_VTLB_BITS_DEFAULT;
+
 static inline size_t sizeof_tlb(CPUArchState *env, uintptr_t mmu_idx)
 {
     return env_tlb(env)->f[mmu_idx].mask + (1 << CPU_TLB_ENTRY_BITS);
 }
 
+static inline size_t vtlb_n_entries(const CPUTLBDesc *desc)
+{
+    return (desc->vmask + 1) * CPU_VTLB_WAYS;
+}
+
+/* The first entry of the victim tlb set for main tlb index @index */
+static inline size_t vtlb_set(const CPUTLBDesc *desc, size_t index)
+{
+    return (index & desc->vmask) * CPU_VTLB_WAYS;
+}
+
+/*
+ * Whether @te is counted in the reverse map.  TLB_NOTDIRTY comes and goes
+ * while the entry is in the tlb, so it does not matter here.
+ */
+static inline bool tlb_entry_writes_ram(const CPUTLBEntry *te)
+{
+    return !(te->addr_write & (TLB_INVALID_MASK | TLB_MMIO));
+}
+
+static inline uint32_t *tlb_rmap_bucket(CPUTLBDesc *desc, uintptr_t host)
+{
+    return &desc->rmap[(host >> TARGET_PAGE_BITS) & (CPU_TLB_RMAP_SIZE - 1)];
+}
+
+/* Account for @te entering (@n = 1) or leaving (@n = -1) the tlb */
+static inline void tlb_rmap_update(CPUTLBDesc *desc, const CPUTLBEntry *te,
+                                   int n)
+{
+    if (tlb_entry_writes_ram(te)) {
+        uint32_t *b = tlb_rmap_bucket(desc, (te->addr_write & TARGET_PAGE_MASK)
+                                            + te->addend);
+        atomic_set(b, *b + n);
+    }
+}
+
+/* Whether @desc may hold entries writing to host memory [@start, +@length) */
+static bool tlb_rmap_may_map(CPUTLBDesc *desc, uintptr_t start,
+                             uintptr_t length)
+{
+    uintptr_t ofs;
+    int i;
+
+    if (length < (uintptr_t)CPU_TLB_RMAP_SIZE << TARGET_PAGE_BITS) {
+        for (ofs = 0; ofs < length; ofs += TARGET_PAGE_SIZE) {
+            if (atomic_read(tlb_rmap_bucket(desc, start + ofs))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    for (i = 0; i < CPU_TLB_RMAP_SIZE; i++) {
+        if (atomic_read(&desc->rmap[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tlb_large_reset(CPUTLBDesc *desc)
+{
+    int i;
+
+    for (i = 0; i < CPU_TLB_LARGE_SIZE; i++) {
+        desc->large[i].vaddr = -1;
+        desc->large[i].mask = 0;
+    }
+    desc->lindex = 0;
+}
+
 static void tlb_window_reset(CPUTLBDesc *desc, int64_t ns,
                              size_t max_entries)
 {
@@ -99,6 +174,13 @@ static void tlb_dyn_init(CPUArchState *env)
         env_tlb(env)->f[i].mask = (n_entries - 1) << CPU_TLB_ENTRY_BITS;
         env_tlb(env)->f[i].table = g_new(CPUTLBEntry, n_entries);
         env_tlb(env)->d[i].iotlb = g_new(CPUIOTLBEntry, n_entries);
+
+        desc->vmask = (1 << tlb_victim_bits) - 1;
+        desc->vtable = g_new(CPUTLBEntry, vtlb_n_entries(desc));
+        desc->viotlb = g_new(CPUIOTLBEntry, vtlb_n_entries(desc));
+        memset(desc->vtable, -1, vtlb_n_entries(desc) * sizeof(CPUTLBEntry));
+        memset(desc->rmap, 0, sizeof(desc->rmap));
+        tlb_large_reset(desc);
     }
 }
 
@@ -283,14 +365,30 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+size_t tlb_large_fill_count(void)
+{
+    CPUState *cpu;
+    size_t count = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUArchState *env = cpu->env_ptr;
+
+        count += atomic_read(&env_tlb(env)->c.large_fill_count);
+    }
+    return count;
+}
+
 static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx)
 {
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+
     tlb_table_flush_by_mmuidx(env, mmu_idx);
-    env_tlb(env)->d[mmu_idx].large_page_addr = -1;
-    env_tlb(env)->d[mmu_idx].large_page_mask = -1;
-    env_tlb(env)->d[mmu_idx].vindex = 0;
-    memset(env_tlb(env)->d[mmu_idx].vtable, -1,
-           sizeof(env_tlb(env)->d[0].vtable));
+    desc->large_page_addr = -1;
+    desc->large_page_mask = -1;
+    desc->vindex = 0;
+    memset(desc->vtable, -1, vtlb_n_entries(desc) * sizeof(CPUTLBEntry));
+    memset(desc->rmap, 0, sizeof(desc->rmap));
+    tlb_large_reset(desc);
 }
 
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
@@ -398,10 +496,12 @@ static inline bool tlb_entry_is_empty(const CPUTLBEntry *te)
 }
 
 /* Called with tlb_c.lock held */
-static inline bool tlb_flush_entry_locked(CPUTLBEntry *tlb_entry,
+static inline bool tlb_flush_entry_locked(CPUTLBDesc *desc,
+                                          CPUTLBEntry *tlb_entry,
                                           target_ulong page)
 {
     if (tlb_hit_page_anyprot(tlb_entry, page)) {
+        tlb_rmap_update(desc, tlb_entry, -1);
         memset(tlb_entry, -1, sizeof(*tlb_entry));
         return true;
     }
@@ -413,11 +513,12 @@ static inline void tlb_flush_vtlb_page_locked(CPUArchState *env, int mmu_idx,
                                               target_ulong page)
 {
     CPUTLBDesc *d = &env_tlb(env)->d[mmu_idx];
-    int k;
+    size_t set = vtlb_set(d, tlb_index(env, mmu_idx, page));
+    size_t k;
 
     assert_cpu_is_self(env_cpu(env));
-    for (k = 0; k < CPU_VTLB_SIZE; k++) {
-        if (tlb_flush_entry_locked(&d->vtable[k], page)) {
+    for (k = set; k < set + CPU_VTLB_WAYS; k++) {
+        if (tlb_flush_entry_locked(d, &d->vtable[k], page)) {
             tlb_n_used_entries_dec(env, mmu_idx);
         }
     }
@@ -436,7 +537,8 @@ static void tlb_flush_page_locked(CPUArchState *env, int midx,
                   midx, lp_addr, lp_mask);
         tlb_flush_one_mmuidx_locked(env, midx);
     } else {
-        if (tlb_flush_entry_locked(tlb_entry(env, midx, page), page)) {
+        if (tlb_flush_entry_locked(&env_tlb(env)->d[midx],
+                                   tlb_entry(env, midx, page), page)) {
             tlb_n_used_entries_dec(env, midx);
         }
         tlb_flush_vtlb_page_locked(env, midx, page);
@@ -540,6 +642,192 @@ void tlb_flush_page_all_cpus_synced(CPUState *src, target_ulong addr)
     tlb_flush_page_by_mmuidx_all_cpus_synced(src, addr, ALL_MMUIDX_BITS);
 }
 
+/*
+ * Ranged and batched flushes: any number of page ranges travel to each
+ * vCPU as one work item, instead of one per page.
+ */
+typedef struct TLBFlushRange {
+    target_ulong addr;
+    target_ulong len;
+} TLBFlushRange;
+
+typedef struct TLBFlushRangeData {
+    uint16_t idxmap;
+    unsigned int nr;
+    TLBFlushRange r[];
+} TLBFlushRangeData;
+
+/*
+ * Past this many pages, clearing the whole jump cache is cheaper than
+ * clearing the sets of each page.
+ */
+#define TLB_FLUSH_RANGE_JMP_CACHE_PAGES 64
+
+static void tlb_flush_range_by_mmuidx_async_work(CPUState *cpu,
+                                                 run_on_cpu_data data)
+{
+    CPUArchState *env = cpu->env_ptr;
+    TLBFlushRangeData *d = data.host_ptr;
+    target_ulong n_pages = 0, ofs;
+    size_t full = 0, elide = 0;
+    bool full_jmp_cache = false;
+    unsigned int i;
+    int mmu_idx;
+
+    assert_cpu_is_self(cpu);
+
+    for (i = 0; i < d->nr; i++) {
+        n_pages += d->r[i].len >> TARGET_PAGE_BITS;
+    }
+
+    tlb_debug("%u ranges, %" PRIu64 " pages, mmu_idx:0x%04" PRIx16 "\n",
+              d->nr, (uint64_t)n_pages, d->idxmap);
+
+    qemu_spin_lock(&env_tlb(env)->c.lock);
+    for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
+        if (!(d->idxmap & (1 << mmu_idx))) {
+            continue;
+        }
+        if (!(env_tlb(env)->c.dirty & (1 << mmu_idx))) {
+            /* Nothing has been entered since the last full flush */
+            elide++;
+            continue;
+        }
+        /*
+         * Flushing most of the TLB page by page costs more than
+         * refilling it, so flush the whole MMU index instead.
+         */
+        if (n_pages > tlb_n_entries(env, mmu_idx) / 2) {
+            tlb_flush_one_mmuidx_locked(env, mmu_idx);
+            env_tlb(env)->c.dirty &= ~(1 << mmu_idx);
+            full_jmp_cache = true;
+            full++;
+            continue;
+        }
+        for (i = 0; i < d->nr; i++) {
+            for (ofs = 0; ofs < d->r[i].len; ofs += TARGET_PAGE_SIZE) {
+                tlb_flush_page_locked(env, mmu_idx, d->r[i].addr + ofs);
+            }
+        }
+    }
+    qemu_spin_unlock(&env_tlb(env)->c.lock);
+
+    if (full_jmp_cache || n_pages > TLB_FLUSH_RANGE_JMP_CACHE_PAGES) {
+        cpu_tb_jmp_cache_clear(cpu);
+    } else {
+        for (i = 0; i < d->nr; i++) {
+            for (ofs = 0; ofs < d->r[i].len; ofs += TARGET_PAGE_SIZE) {
+                tb_flush_jmp_cache(cpu, d->r[i].addr + ofs);
+            }
+        }
+    }
+
+    if (full) {
+        atomic_set(&env_tlb(env)->c.part_flush_count,
+                   env_tlb(env)->c.part_flush_count + full);
+    }
+    if (elide) {
+        atomic_set(&env_tlb(env)->c.elide_flush_count,
+                   env_tlb(env)->c.elide_flush_count + elide);
+    }
+    g_free(d);
+}
+
+/* Page-align @nr ranges, and return the work item for a single vCPU */
+static TLBFlushRangeData *tlb_flush_range_data(const TLBFlushRange *r,
+                                               unsigned int nr,
+                                               uint16_t idxmap)
+{
+    TLBFlushRangeData *d = g_malloc(sizeof(*d) + nr * sizeof(d->r[0]));
+    unsigned int i;
+
+    d->idxmap = idxmap;
+    d->nr = nr;
+    for (i = 0; i < nr; i++) {
+        target_ulong ofs = r[i].addr & ~TARGET_PAGE_MASK;
+
+        d->r[i].addr = r[i].addr & TARGET_PAGE_MASK;
+        d->r[i].len = ROUND_UP(r[i].len + ofs, TARGET_PAGE_SIZE);
+    }
+    return d;
+}
+
+static void tlb_flush_ranges_all_cpus(CPUState *src_cpu,
+                                      const TLBFlushRange *r, unsigned int nr,
+                                      uint16_t idxmap, bool synced)
+{
+    const run_on_cpu_func fn = tlb_flush_range_by_mmuidx_async_work;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (cpu != src_cpu) {
+            async_run_on_cpu(cpu, fn, RUN_ON_CPU_HOST_PTR(
+                                 tlb_flush_range_data(r, nr, idxmap)));
+        }
+    }
+    if (synced) {
+        async_safe_run_on_cpu(src_cpu, fn, RUN_ON_CPU_HOST_PTR(
+                                  tlb_flush_range_data(r, nr, idxmap)));
+    } else {
+        fn(src_cpu, RUN_ON_CPU_HOST_PTR(tlb_flush_range_data(r, nr, idxmap)));
+    }
+}
+
+void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                               target_ulong len, uint16_t idxmap)
+{
+    const TLBFlushRange r = { .addr = addr, .len = len };
+    TLBFlushRangeData *d = tlb_flush_range_data(&r, 1, idxmap);
+
+    tlb_debug("addr: " TARGET_FMT_lx " len: " TARGET_FMT_lx
+              " mmu_idx:%" PRIx16 "\n", addr, len, idxmap);
+
+    if (!qemu_cpu_is_self(cpu)) {
+        async_run_on_cpu(cpu, tlb_flush_range_by_mmuidx_async_work,
+                         RUN_ON_CPU_HOST_PTR(d));
+    } else {
+        tlb_flush_range_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_PTR(d));
+    }
+}
+
+void tlb_flush_range(CPUState *cpu, target_ulong addr, target_ulong len)
+{
+    tlb_flush_range_by_mmuidx(cpu, addr, len, ALL_MMUIDX_BITS);
+}
+
+void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu, target_ulong addr,
+                                        target_ulong len, uint16_t idxmap)
+{
+    const TLBFlushRange r = { .addr = addr, .len = len };
+
+    tlb_flush_ranges_all_cpus(src_cpu, &r, 1, idxmap, false);
+}
+
+void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
+                                               target_ulong addr,
+                                               target_ulong len,
+                                               uint16_t idxmap)
+{
+    const TLBFlushRange r = { .addr = addr, .len = len };
+
+    tlb_flush_ranges_all_cpus(src_cpu, &r, 1, idxmap, true);
+}
+
+void tlb_flush_pages_all_cpus_synced(CPUState *src_cpu,
+                                     const target_ulong *pages,
+                                     unsigned int nr)
+{
+    TLBFlushRange *r = g_new(TLBFlushRange, nr);
+    unsigned int i;
+
+    for (i = 0; i < nr; i++) {
+        r[i].addr = pages[i];
+        r[i].len = TARGET_PAGE_SIZE;
+    }
+    tlb_flush_ranges_all_cpus(src_cpu, r, nr, ALL_MMUIDX_BITS, true);
+    g_free(r);
+}
+
 /* update the TLBs so that writes to code in the virtual page 'addr'
    can be detected */
 void tlb_protect_code(ram_addr_t ram_addr)
@@ -604,6 +892,14 @@ static inline void copy_tlb_helper_locked(CPUTLBEntry *d, const CPUTLBEntry *s)
  * the target vCPU).
  * We must take tlb_c.lock to avoid racing with another vCPU update. The only
  * thing actually updated is the target TLB entry ->addr_write flags.
+ *
+ * Most calls are for a page or a few, such as tlb_protect_code() on every
+ * newly translated page, and most MMU modes of most vCPUs do not map them.
+ * The reverse map lets us skip those without scanning the TLB.  It must
+ * be read under the lock: tlb_set_page_with_attrs() checks the dirty
+ * bitmap and accounts for the new entry in the same critical section, so
+ * a fill either comes after us and sees the cleared bitmap, or before us
+ * and shows up in the reverse map.
  */
 void tlb_reset_dirty(CPUState *cpu, ram_addr_t start1, ram_addr_t length)
 {
@@ -612,22 +908,30 @@ void tlb_reset_dirty(CPUState *cpu, ram_addr_t start1, ram_addr_t length)
     int mmu_idx;
 
     env = cpu->env_ptr;
-    qemu_spin_lock(&env_tlb(env)->c.lock);
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
         unsigned int i;
-        unsigned int n = tlb_n_entries(env, mmu_idx);
+        unsigned int n;
+
+        qemu_spin_lock(&env_tlb(env)->c.lock);
+        if (!tlb_rmap_may_map(&env_tlb(env)->d[mmu_idx], start1, length)) {
+            qemu_spin_unlock(&env_tlb(env)->c.lock);
+            continue;
+        }
+
+        n = tlb_n_entries(env, mmu_idx);
 
         for (i = 0; i < n; i++) {
             tlb_reset_dirty_range_locked(&env_tlb(env)->f[mmu_idx].table[i],
                                          start1, length);
         }
 
-        for (i = 0; i < CPU_VTLB_SIZE; i++) {
+        n = vtlb_n_entries(&env_tlb(env)->d[mmu_idx]);
+        for (i = 0; i < n; i++) {
             tlb_reset_dirty_range_locked(&env_tlb(env)->d[mmu_idx].vtable[i],
                                          start1, length);
         }
+        qemu_spin_unlock(&env_tlb(env)->c.lock);
     }
-    qemu_spin_unlock(&env_tlb(env)->c.lock);
 }
 
 /* Called with tlb_c.lock held */
@@ -655,9 +959,12 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
     }
 
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
-        int k;
-        for (k = 0; k < CPU_VTLB_SIZE; k++) {
-            tlb_set_dirty1_locked(&env_tlb(env)->d[mmu_idx].vtable[k], vaddr);
+        CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+        size_t set = vtlb_set(desc, tlb_index(env, mmu_idx, vaddr));
+        size_t k;
+
+        for (k = set; k < set + CPU_VTLB_WAYS; k++) {
+            tlb_set_dirty1_locked(&desc->vtable[k], vaddr);
         }
     }
     qemu_spin_unlock(&env_tlb(env)->c.lock);
@@ -687,9 +994,48 @@ static void tlb_add_large_page(CPUArchState *env, int mmu_idx,
     env_tlb(env)->d[mmu_idx].large_page_mask = lp_mask;
 }
 
+#ifdef TARGET_LINEAR_LARGE_PAGES
+/*
+ * Remember how the large page of @size bytes around @vaddr is mapped,
+ * so that tlb_fill_large() can enter its other pages into the tlb.
+ *
+ * Only targets that define TARGET_LINEAR_LARGE_PAGES get here: their
+ * tlb_fill must report as @size a single, virtually and physically
+ * contiguous mapping with uniform attributes and protection.  Others may
+ * report e.g. the size of a stage 2 block that contains a smaller stage 1
+ * page, which is fine for flushing but not for translating.
+ */
+static void tlb_remember_large_page(CPUArchState *env, int mmu_idx,
+                                    target_ulong vaddr, hwaddr paddr,
+                                    MemTxAttrs attrs, int prot,
+                                    target_ulong size)
+{
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    target_ulong mask = ~(size - 1);
+    CPUTLBLargeEntry *e = NULL;
+    int i;
+
+    for (i = 0; i < CPU_TLB_LARGE_SIZE; i++) {
+        if (desc->large[i].vaddr == (vaddr & mask) &&
+            desc->large[i].mask == mask) {
+            e = &desc->large[i];
+            break;
+        }
+    }
+    if (!e) {
+        e = &desc->large[desc->lindex++ % CPU_TLB_LARGE_SIZE];
+    }
+    e->vaddr = vaddr & mask;
+    e->mask = mask;
+    e->paddr = paddr - (vaddr & (size - 1));
+    e->attrs = attrs;
+    e->prot = prot;
+}
+#endif
+
 /* Add a new TLB entry. At most one entry for a given virtual address
  * is permitted. Only a single TARGET_PAGE_SIZE region is mapped, the
- * supplied size is only used by tlb_flush_page.
+ * supplied size is only used by tlb_flush_page and tlb_fill_large.
  *
  * Called from TCG-generated code, which is under an RCU read-side
  * critical section.
@@ -713,14 +1059,18 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
 
     assert_cpu_is_self(cpu);
 
+    vaddr_page = vaddr & TARGET_PAGE_MASK;
+    paddr_page = paddr & TARGET_PAGE_MASK;
     if (size <= TARGET_PAGE_SIZE) {
         sz = TARGET_PAGE_SIZE;
     } else {
         tlb_add_large_page(env, mmu_idx, vaddr, size);
+#ifdef TARGET_LINEAR_LARGE_PAGES
+        tlb_remember_large_page(env, mmu_idx, vaddr_page, paddr_page,
+                                attrs, prot, size);
+#endif
         sz = size;
     }
-    vaddr_page = vaddr & TARGET_PAGE_MASK;
-    paddr_page = paddr & TARGET_PAGE_MASK;
 
     section = address_space_translate_for_iotlb(cpu, asidx, paddr_page,
                                                 &xlat, &sz, attrs, &prot);
@@ -775,13 +1125,17 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
      * different page; otherwise just overwrite the stale data.
      */
     if (!tlb_hit_page_anyprot(te, vaddr_page) && !tlb_entry_is_empty(te)) {
-        unsigned vidx = desc->vindex++ % CPU_VTLB_SIZE;
+        size_t vidx = vtlb_set(desc, index) + desc->vindex++ % CPU_VTLB_WAYS;
         CPUTLBEntry *tv = &desc->vtable[vidx];
 
         /* Evict the old entry into the victim tlb.  */
+        tlb_rmap_update(desc, tv, -1);
         copy_tlb_helper_locked(tv, te);
         desc->viotlb[vidx] = desc->iotlb[index];
         tlb_n_used_entries_dec(env, mmu_idx);
+    } else {
+        /* The stale entry, if any, is overwritten below.  */
+        tlb_rmap_update(desc, te, -1);
     }
 
     /* refill the tlb */
@@ -799,6 +1153,7 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
      */
     desc->iotlb[index].addr = iotlb - vaddr_page;
     desc->iotlb[index].attrs = attrs;
+    desc->iotlb[index].section = NULL;
 
     /* Now calculate the new entry */
     tn.addend = addend - vaddr_page;
@@ -832,6 +1187,7 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
         }
     }
 
+    tlb_rmap_update(desc, &tn, 1);
     copy_tlb_helper_locked(te, &tn);
     tlb_n_used_entries_inc(env, mmu_idx);
     qemu_spin_unlock(&tlb->c.lock);
@@ -860,6 +1216,46 @@ static inline ram_addr_t qemu_ram_addr_from_host_nofail(void *ptr)
     return ram_addr;
 }
 
+/*
+ * If @addr lies in a large page that the target has recently entered into
+ * the tlb, and the mapping allows @access_type, enter the page of @addr
+ * the same way and return true.  This saves a guest page table walk for
+ * every TARGET_PAGE_SIZE of a large page but the first.
+ *
+ * The mapping cannot be stale, since invalidating any page in a large
+ * page flushes the whole MMU mode (see tlb_flush_page_locked()), and with
+ * it the large page entries.  Checking @access_type against the saved
+ * protection lets the target see the accesses it has to handle, such as
+ * the first write to a page that is not yet marked dirty.
+ */
+static bool tlb_fill_large(CPUState *cpu, target_ulong addr,
+                           MMUAccessType access_type, int mmu_idx)
+{
+#ifdef TARGET_LINEAR_LARGE_PAGES
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    int need = (access_type == MMU_DATA_STORE ? PAGE_WRITE :
+                access_type == MMU_INST_FETCH ? PAGE_EXEC : PAGE_READ);
+    int i;
+
+    for (i = 0; i < CPU_TLB_LARGE_SIZE; i++) {
+        CPUTLBLargeEntry *e = &desc->large[i];
+
+        if ((addr & e->mask) == e->vaddr && (e->prot & need)) {
+            tlb_set_page_with_attrs(cpu, addr & TARGET_PAGE_MASK,
+                                    e->paddr + (addr & ~e->mask &
+                                                TARGET_PAGE_MASK),
+                                    e->attrs, e->prot, mmu_idx,
+                                    -e->mask);
+            atomic_set(&env_tlb(env)->c.large_fill_count,
+                       env_tlb(env)->c.large_fill_count + 1);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
 /*
  * Note: tlb_fill() can trigger a resize of the TLB. This means that all of the
  * caller's prior references to the TLB table (e.g. CPUTLBEntry pointers) must
@@ -871,6 +1267,10 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
     CPUClass *cc = CPU_GET_CLASS(cpu);
     bool ok;
 
+    if (tlb_fill_large(cpu, addr, access_type, mmu_idx)) {
+        return;
+    }
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
@@ -879,6 +1279,29 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
     assert(ok);
 }
 
+/*
+ * Resolve the section of an MMIO access, caching it and the dispatch
+ * decisions for its region in the iotlb entry.  The cached section stays
+ * valid as long as the entry: a new dispatch map always comes with a
+ * tlb_flush, which this vCPU runs before leaving the RCU critical
+ * section that keeps the old map alive.
+ */
+static MemoryRegionSection *io_section(CPUState *cpu,
+                                       CPUIOTLBEntry *iotlbentry)
+{
+    MemoryRegionSection *section = iotlbentry->section;
+
+    if (unlikely(!section)) {
+        section = iotlb_to_section(cpu, iotlbentry->addr, iotlbentry->attrs);
+        iotlbentry->direct_read =
+            memory_region_direct_access_sizes(section->mr, false);
+        iotlbentry->direct_write =
+            memory_region_direct_access_sizes(section->mr, true);
+        iotlbentry->section = section;
+    }
+    return section;
+}
+
 static uint64_t io_readx(CPUArchState *env, CPUIOTLBEntry *iotlbentry,
                          int mmu_idx, target_ulong addr, uintptr_t retaddr,
                          MMUAccessType access_type, int size)
@@ -891,7 +1314,7 @@ static uint64_t io_readx(CPUArchState *env, CPUIOTLBEntry *iotlbentry,
     bool locked = false;
     MemTxResult r;
 
-    section = iotlb_to_section(cpu, iotlbentry->addr, iotlbentry->attrs);
+    section = io_section(cpu, iotlbentry);
     mr = section->mr;
     mr_offset = (iotlbentry->addr & TARGET_PAGE_MASK) + addr;
     cpu->mem_io_pc = retaddr;
@@ -906,8 +1329,13 @@ static uint64_t io_readx(CPUArchState *env, CPUIOTLBEntry *iotlbentry,
         qemu_mutex_lock_iothread();
         locked = true;
     }
-    r = memory_region_dispatch_read(mr, mr_offset,
-                                    &val, size, iotlbentry->attrs);
+    if (iotlbentry->direct_read & size) {
+        r = memory_region_dispatch_read_direct(mr, mr_offset,
+                                               &val, size, iotlbentry->attrs);
+    } else {
+        r = memory_region_dispatch_read(mr, mr_offset,
+                                        &val, size, iotlbentry->attrs);
+    }
     if (r != MEMTX_OK) {
         hwaddr physaddr = mr_offset +
             section->offset_within_address_space -
@@ -934,7 +1362,7 @@ static void io_writex(CPUArchState *env, CPUIOTLBEntry *iotlbentry,
     bool locked = false;
     MemTxResult r;
 
-    section = iotlb_to_section(cpu, iotlbentry->addr, iotlbentry->attrs);
+    section = io_section(cpu, iotlbentry);
     mr = section->mr;
     mr_offset = (iotlbentry->addr & TARGET_PAGE_MASK) + addr;
     if (mr != &io_mem_rom && mr != &io_mem_notdirty && !cpu->can_do_io) {
@@ -947,8 +1375,13 @@ static void io_writex(CPUArchState *env, CPUIOTLBEntry *iotlbentry,
         qemu_mutex_lock_iothread();
         locked = true;
     }
-    r = memory_region_dispatch_write(mr, mr_offset,
-                                     val, size, iotlbentry->attrs);
+    if (iotlbentry->direct_write & size) {
+        r = memory_region_dispatch_write_direct(mr, mr_offset,
+                                                val, size, iotlbentry->attrs);
+    } else {
+        r = memory_region_dispatch_write(mr, mr_offset,
+                                         val, size, iotlbentry->attrs);
+    }
     if (r != MEMTX_OK) {
         hwaddr physaddr = mr_offset +
             section->offset_within_address_space -
@@ -977,10 +1410,11 @@ static inline target_ulong tlb_read_ofs(CPUTLBEntry *entry, size_t ofs)
 static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
                            size_t elt_ofs, target_ulong page)
 {
+    size_t set = vtlb_set(&env_tlb(env)->d[mmu_idx], index);
     size_t vidx;
 
     assert_cpu_is_self(env_cpu(env));
-    for (vidx = 0; vidx < CPU_VTLB_SIZE; ++vidx) {
+    for (vidx = set; vidx < set + CPU_VTLB_WAYS; ++vidx) {
         CPUTLBEntry *vtlb = &env_tlb(env)->d[mmu_idx].vtable[vidx];
         target_ulong cmp;
 
@@ -0,0 +1,196 @@
+/*
+ * Background translation threads
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * With "-accel tcg,thread=multi,translation-threads=N", a vCPU that finds
+ * a TB hot does not retranslate it as a superblock by itself.  It only
+ * runs the guest front end, which has to fetch code through its own TLB,
+ * hands the resulting ops over to one of N background threads, and goes
+ * back to running the TB it already has.  The background thread, which
+ * owns a TCG context and code_gen_buffer region like any vCPU thread,
+ * optimizes the ops and generates host code for them, then swaps the new
+ * TB in for the old one unless the latter has been invalidated, or the
+ * guest code has changed, in the meantime.
+ *
+ * Since the expensive optimization passes now run off the vCPU threads,
+ * first-time translation skips value numbering (see tcg_gen_code()).
+ *
+ * A tb_flush() invalidates every TB, including those referenced by the
+ * pending jobs, and resets every code_gen_buffer region; tb_async_pause()
+ * keeps the background threads out of the way while it runs.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu-common.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
+#include "sysemu/tcg.h"
+#include "tcg.h"
+#include "tb-async.h"
+
+/* Past this many pending jobs, hot TBs stay as they are for a while */
+#define TB_ASYNC_MAX_JOBS 256
+
+typedef struct TBAsyncThread {
+    QemuThread thread;
+    QemuMutex busy; /* held while running a job */
+} TBAsyncThread;
+
+static struct {
+    QemuMutex lock;
+    QemuCond cond;
+    QSIMPLEQ_HEAD(, TBAsyncJob) jobs;
+    unsigned int nb_jobs;
+    unsigned int nb_threads;
+    TBAsyncThread *threads;
+} tb_async;
+
+/*
+ * The job being filled in by this vCPU; kept around if the front end
+ * longjmps out on a guest exception.
+ */
+static __thread TBAsyncJob *tb_async_spare;
+
+bool tb_async_enabled(void)
+{
+    return tb_async.nb_threads != 0;
+}
+
+TBAsyncJob *tb_async_job_get(void)
+{
+    if (!tb_async_spare) {
+        tb_async_spare = g_new0(TBAsyncJob, 1);
+    }
+    return tb_async_spare;
+}
+
+static void tb_async_job_free(TBAsyncJob *job)
+{
+    tcg_ops_release(&job->ops);
+    g_free(job->guest);
+    g_free(job);
+}
+
+/* Called with tb_async.lock held */
+static TBAsyncJob *tb_async_pop(void)
+{
+    TBAsyncJob *job = QSIMPLEQ_FIRST(&tb_async.jobs);
+
+    if (job) {
+        QSIMPLEQ_REMOVE_HEAD(&tb_async.jobs, next);
+        tb_async.nb_jobs--;
+    }
+    return job;
+}
+
+void tb_async_queue(TBAsyncJob *job)
+{
+    g_assert(job == tb_async_spare);
+    tb_async_spare = NULL;
+
+    qemu_mutex_lock(&tb_async.lock);
+    if (unlikely(tb_async.nb_jobs >= TB_ASYNC_MAX_JOBS)) {
+        qemu_mutex_unlock(&tb_async.lock);
+        atomic_set(&job->orig->hot_count, tb_hot_threshold);
+        tb_async_job_free(job);
+        return;
+    }
+    QSIMPLEQ_INSERT_TAIL(&tb_async.jobs, job, next);
+    tb_async.nb_jobs++;
+    qemu_cond_signal(&tb_async.cond);
+    qemu_mutex_unlock(&tb_async.lock);
+}
+
+static void *tb_async_thread_fn(void *arg)
+{
+    TBAsyncThread *t = arg;
+
+    rcu_register_thread();
+    tcg_register_thread();
+
+    for (;;) {
+        TBAsyncJob *job;
+
+        qemu_mutex_lock(&tb_async.lock);
+        while (QSIMPLEQ_EMPTY(&tb_async.jobs)) {
+            qemu_cond_wait(&tb_async.cond, &tb_async.lock);
+        }
+        qemu_mutex_unlock(&tb_async.lock);
+
+        /* A flush may have emptied the queue while we took @busy */
+        qemu_mutex_lock(&t->busy);
+        qemu_mutex_lock(&tb_async.lock);
+        job = tb_async_pop();
+        qemu_mutex_unlock(&tb_async.lock);
+        if (job) {
+            tb_gen_code_async(job);
+            tb_async_job_free(job);
+        }
+        qemu_mutex_unlock(&t->busy);
+    }
+    return NULL;
+}
+
+/*
+ * Wait for the background threads to finish their current job, and drop
+ * the pending ones.  Called from do_tb_flush() with all vCPUs stopped.
+ */
+void tb_async_pause(void)
+{
+    TBAsyncJob *job;
+    unsigned int i;
+
+    if (!tb_async_enabled()) {
+        return;
+    }
+    for (i = 0; i < tb_async.nb_threads; i++) {
+        qemu_mutex_lock(&tb_async.threads[i].busy);
+    }
+    qemu_mutex_lock(&tb_async.lock);
+    while ((job = tb_async_pop())) {
+        tb_async_job_free(job);
+    }
+    qemu_mutex_unlock(&tb_async.lock);
+}
+
+void tb_async_resume(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < tb_async.nb_threads; i++) {
+        qemu_mutex_unlock(&tb_async.threads[i].busy);
+    }
+}
+
+/*
+ * Start the background translation threads.  Called once, after
+ * tcg_region_init() and before the vCPU threads are created.
+ */
+void tcg_tb_async_init(unsigned int nb_threads)
+{
+    unsigned int i;
+
+    if (!nb_threads) {
+        return;
+    }
+    qemu_mutex_init(&tb_async.lock);
+    qemu_cond_init(&tb_async.cond);
+    QSIMPLEQ_INIT(&tb_async.jobs);
+    tb_async.threads = g_new0(TBAsyncThread, nb_threads);
+    for (i = 0; i < nb_threads; i++) {
+        TBAsyncThread *t = &tb_async.threads[i];
+        char name[16];
+
+        qemu_mutex_init(&t->busy);
+        snprintf(name, sizeof(name), "TCG xlate %u", i);
+        qemu_thread_create(&t->thread, name, tb_async_thread_fn, t,
+                           QEMU_THREAD_DETACHED);
+    }
+    tb_async.nb_threads = nb_threads;
+}
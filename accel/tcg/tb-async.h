@@ -0,0 +1,33 @@
+/*
+ * Background translation threads
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef TB_ASYNC_H
+#define TB_ASYNC_H
+
+#include "exec/exec-all.h"
+#include "tcg.h"
+
+typedef struct TBAsyncJob {
+    TranslationBlock *orig;   /* the TB to be replaced */
+    TranslationBlock draft;   /* key, size and icount of the new TB */
+    TCGOpStream ops;
+    tb_page_addr_t phys_pc;
+    uint8_t *guest;           /* guest code at phys_pc, before translation */
+    QSIMPLEQ_ENTRY(TBAsyncJob) next;
+} TBAsyncJob;
+
+/* tb-async.c */
+bool tb_async_enabled(void);
+TBAsyncJob *tb_async_job_get(void);
+void tb_async_queue(TBAsyncJob *job);
+void tb_async_pause(void);
+void tb_async_resume(void);
+
+/* translate-all.c */
+void tb_gen_code_async(TBAsyncJob *job);
+
+#endif /* TB_ASYNC_H */
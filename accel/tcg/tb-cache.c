@@ -0,0 +1,488 @@
+/*
+ * Persistent translation block cache
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * The TB cache saves the translated code of the live TBs when the VM shuts
+ * down, and puts it back into code_gen_buffer when the next run starts.
+ *
+ * Host code is not relocatable: it calls helpers, the prologue and other
+ * TBs with pc-relative branches, and exit_tb embeds the address of its TB.
+ * We therefore only reuse a cache file when code_gen_buffer, the prologue
+ * and the QEMU binary are exactly where they were when the file was saved
+ * (which in practice requires running with ASLR disabled), and restore
+ * each TB at its original address.  TBs whose code embeds other host
+ * pointers (see tcg_const_ptr) are flagged CF_NOPERSIST and never saved.
+ *
+ * Restored TBs are dormant: they are not in the TB hash table nor in the
+ * page descriptors, since at this point guest memory has not even been
+ * loaded.  When tb_gen_code() is asked to translate a block, it first
+ * looks for a dormant TB with the same key and, if the guest code it was
+ * translated from is byte-for-byte identical to the current contents of
+ * guest memory, links that TB instead of translating it again.
+ *
+ * The cache is also keyed on the command line, since some translations
+ * depend on CPU configuration that is not part of the TB flags.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu-common.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/ram_addr.h"
+#include "exec/tb-hash.h"
+#include "qemu/error-report.h"
+#include "qemu/qht.h"
+#include "qemu/rcu.h"
+#include "sysemu/cpus.h"
+#include "sysemu/tcg.h"
+#include "hw/boards.h"
+#include "tcg.h"
+#include "translate-all.h"
+#include "trace.h"
+
+#define TB_CACHE_MAGIC      0x3143425447434d51ULL /* "QMCGTBC1" */
+#define TB_CACHE_VERSION    1
+
+typedef struct TBCacheHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t id_size;
+    uint64_t nb_entries;
+    /* followed by the TBCacheId blob, padded to 8 bytes */
+} TBCacheHeader;
+
+/* Everything the saved host code depends on, compared byte-for-byte */
+typedef struct TBCacheId {
+    char target[16];
+    uint64_t exe_dev;
+    uint64_t exe_ino;
+    uint64_t exe_size;
+    uint64_t exe_mtime;
+    uint64_t text;
+    uint64_t code_gen_prologue;
+    uint64_t code_gen_buffer;
+    uint64_t code_gen_buffer_size;
+    uint32_t tb_struct_size;
+    uint32_t page_bits;
+    uint32_t mttcg;
+    uint32_t max_cpus;
+    uint32_t prologue_size;
+    uint32_t cmdline_size;
+    /* followed by the prologue and the command line */
+} TBCacheId;
+
+typedef struct TBCacheEntry {
+    uint64_t pc;
+    uint64_t cs_base;
+    uint64_t page_addr[2];
+    uint32_t flags;
+    uint32_t cflags;
+    uint32_t trace_vcpu_dstate;
+    uint16_t size;          /* bytes of guest code */
+    uint16_t reserved;
+    uint64_t offset;        /* of the TB from code_gen_buffer */
+    uint64_t host_size;     /* TB, host code and search data */
+    /*
+     * followed by the guest code, padded to 8 bytes, and by the host
+     * bytes (also padded to 8 bytes)
+     */
+} TBCacheEntry;
+
+struct tb_cache_desc {
+    CPUArchState *env;
+    target_ulong pc;
+    target_ulong cs_base;
+    uint32_t flags;
+    uint32_t cf_mask;
+    uint32_t trace_vcpu_dstate;
+    tb_page_addr_t phys_page1;
+};
+
+/* dormant TBs, indexed like tb_ctx.htable */
+static struct qht tb_cache_htable;
+static void *tb_cache_map;
+static size_t tb_cache_map_size;
+
+static inline size_t tb_cache_entry_size(const TBCacheEntry *e)
+{
+    return sizeof(*e) + ROUND_UP(e->size, 8) + ROUND_UP(e->host_size, 8);
+}
+
+static inline const uint8_t *tb_cache_entry_host(const TBCacheEntry *e)
+{
+    return (const uint8_t *)(e + 1) + ROUND_UP(e->size, 8);
+}
+
+static inline uint32_t tb_cache_entry_hash(const TBCacheEntry *e)
+{
+    tb_page_addr_t phys_pc = e->page_addr[0] | (e->pc & ~TARGET_PAGE_MASK);
+
+    return tb_hash_func(phys_pc, e->pc, e->flags, e->cflags & CF_HASH_MASK,
+                        e->trace_vcpu_dstate);
+}
+
+static bool tb_cache_cmp(const void *ap, const void *bp)
+{
+    const TBCacheEntry *a = ap;
+    const TBCacheEntry *b = bp;
+
+    return a->pc == b->pc &&
+        a->cs_base == b->cs_base &&
+        a->flags == b->flags &&
+        (a->cflags & CF_HASH_MASK) == (b->cflags & CF_HASH_MASK) &&
+        a->trace_vcpu_dstate == b->trace_vcpu_dstate &&
+        a->page_addr[0] == b->page_addr[0] &&
+        a->page_addr[1] == b->page_addr[1];
+}
+
+static bool tb_cache_lookup_cmp(const void *p, const void *d)
+{
+    const TBCacheEntry *e = p;
+    const struct tb_cache_desc *desc = d;
+
+    if (e->pc == desc->pc &&
+        e->page_addr[0] == desc->phys_page1 &&
+        e->cs_base == desc->cs_base &&
+        e->flags == desc->flags &&
+        e->trace_vcpu_dstate == desc->trace_vcpu_dstate &&
+        (e->cflags & CF_HASH_MASK) == desc->cf_mask) {
+        tb_page_addr_t phys_page2;
+        target_ulong virt_page2;
+
+        /* check next page if needed */
+        if (e->page_addr[1] == (uint64_t)-1) {
+            return true;
+        }
+        virt_page2 = (desc->pc & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE;
+        phys_page2 = get_page_addr_code(desc->env, virt_page2);
+        if (e->page_addr[1] == phys_page2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Compare the guest code that @e was translated from with guest memory */
+static bool tb_cache_entry_valid(const TBCacheEntry *e)
+{
+    const uint8_t *code = (const uint8_t *)(e + 1);
+    size_t offset = e->pc & ~TARGET_PAGE_MASK;
+    size_t len = MIN(e->size, TARGET_PAGE_SIZE - offset);
+    bool ret;
+
+    rcu_read_lock();
+    ret = !memcmp(qemu_map_ram_ptr(NULL, e->page_addr[0] + offset), code, len);
+    if (ret && len < e->size) {
+        ret = !memcmp(qemu_map_ram_ptr(NULL, e->page_addr[1]), code + len,
+                      e->size - len);
+    }
+    rcu_read_unlock();
+    return ret;
+}
+
+/*
+ * Look for a dormant TB that can be used for the given block of guest code.
+ * On success, the TB is removed from the cache and returned; the caller
+ * must initialize its jumps and link it.
+ */
+TranslationBlock *tb_cache_lookup(CPUState *cpu, target_ulong pc,
+                                  target_ulong cs_base, uint32_t flags,
+                                  uint32_t cflags, tb_page_addr_t phys_pc)
+{
+    struct tb_cache_desc desc;
+    TBCacheEntry *e;
+    TranslationBlock *tb;
+    uint32_t h;
+
+    if (likely(!atomic_read(&tb_cache_map))) {
+        return NULL;
+    }
+
+    desc.env = cpu->env_ptr;
+    desc.pc = pc;
+    desc.cs_base = cs_base;
+    desc.flags = flags;
+    desc.cf_mask = cflags & CF_HASH_MASK;
+    desc.trace_vcpu_dstate = *cpu->trace_dstate;
+    desc.phys_page1 = phys_pc & TARGET_PAGE_MASK;
+    h = tb_hash_func(phys_pc, pc, flags, desc.cf_mask, desc.trace_vcpu_dstate);
+    e = qht_lookup_custom(&tb_cache_htable, &desc, h, tb_cache_lookup_cmp);
+    if (e == NULL || !tb_cache_entry_valid(e)) {
+        return NULL;
+    }
+    /* another vCPU might be adopting the same TB */
+    if (!qht_remove(&tb_cache_htable, e, h)) {
+        return NULL;
+    }
+
+    tb = (void *)tcg_init_ctx.code_gen_buffer + e->offset;
+    tb->orig_tb = NULL;
+    trace_tb_cache_hit(tb, pc);
+    return tb;
+}
+
+/* Forget about the dormant TBs; call from a safe-work context */
+void tb_cache_reset(void)
+{
+    if (tb_cache_map) {
+        qht_destroy(&tb_cache_htable);
+        munmap(tb_cache_map, tb_cache_map_size);
+        atomic_set(&tb_cache_map, NULL);
+    }
+}
+
+static GByteArray *tb_cache_id(Error **errp)
+{
+    MachineState *ms = MACHINE(qdev_get_machine());
+    const uint8_t *prologue = tcg_init_ctx.code_gen_prologue;
+    const uint8_t *buffer = tcg_init_ctx.code_gen_buffer;
+    GByteArray *blob;
+    TBCacheId id;
+    struct stat st;
+    gchar *cmdline;
+    gsize cmdline_size;
+    GError *err = NULL;
+
+    if (stat("/proc/self/exe", &st) < 0) {
+        error_setg_errno(errp, errno, "cannot identify the QEMU binary");
+        return NULL;
+    }
+    if (!g_file_get_contents("/proc/self/cmdline", &cmdline, &cmdline_size,
+                             &err)) {
+        error_setg(errp, "cannot read the command line: %s", err->message);
+        g_error_free(err);
+        return NULL;
+    }
+
+    memset(&id, 0, sizeof(id));
+    pstrcpy(id.target, sizeof(id.target), TARGET_NAME);
+    id.exe_dev = st.st_dev;
+    id.exe_ino = st.st_ino;
+    id.exe_size = st.st_size;
+    id.exe_mtime = st.st_mtime;
+    id.text = (uintptr_t)tb_gen_code;
+    id.code_gen_prologue = (uintptr_t)prologue;
+    id.code_gen_buffer = (uintptr_t)buffer;
+    id.code_gen_buffer_size = tcg_init_ctx.code_gen_buffer_size;
+    id.tb_struct_size = sizeof(TranslationBlock);
+    id.page_bits = TARGET_PAGE_BITS;
+    id.mttcg = qemu_tcg_mttcg_enabled();
+    id.max_cpus = ms->smp.max_cpus;
+    id.prologue_size = buffer - prologue;
+    id.cmdline_size = cmdline_size;
+
+    blob = g_byte_array_new();
+    g_byte_array_append(blob, (const guint8 *)&id, sizeof(id));
+    g_byte_array_append(blob, prologue, id.prologue_size);
+    g_byte_array_append(blob, (const guint8 *)cmdline, cmdline_size);
+    g_free(cmdline);
+    return blob;
+}
+
+/*
+ * Restore the TBs saved in @path.  Must be called after tcg_region_init()
+ * and before any TCG thread is registered.
+ */
+void tcg_tb_cache_load(const char *path)
+{
+    const TBCacheHeader *hdr;
+    const uint8_t *p, *end;
+    void *buf = tcg_init_ctx.code_gen_buffer;
+    void *used = buf;
+    GByteArray *id;
+    Error *err = NULL;
+    struct stat st;
+    uint64_t i;
+    int fd;
+
+    if (!path) {
+        return;
+    }
+
+    fd = qemu_open(path, O_RDONLY);
+    if (fd < 0) {
+        /* first run: there is nothing to load yet */
+        if (errno != ENOENT) {
+            warn_report("TB cache: cannot open %s: %s", path, strerror(errno));
+        }
+        return;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(*hdr)) {
+        warn_report("TB cache: %s is truncated", path);
+        qemu_close(fd);
+        return;
+    }
+    tb_cache_map_size = st.st_size;
+    tb_cache_map = mmap(NULL, tb_cache_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    qemu_close(fd);
+    if (tb_cache_map == MAP_FAILED) {
+        warn_report("TB cache: cannot map %s: %s", path, strerror(errno));
+        tb_cache_map = NULL;
+        return;
+    }
+
+    id = tb_cache_id(&err);
+    if (!id) {
+        warn_report_err(err);
+        goto fail;
+    }
+
+    hdr = tb_cache_map;
+    p = (const uint8_t *)(hdr + 1);
+    end = tb_cache_map + tb_cache_map_size;
+    if (hdr->magic != TB_CACHE_MAGIC || hdr->version != TB_CACHE_VERSION ||
+        hdr->id_size != id->len || p + ROUND_UP(id->len, 8) > end ||
+        memcmp(p, id->data, id->len)) {
+        /* saved by another binary or with another configuration */
+        trace_tb_cache_stale(path);
+        g_byte_array_free(id, true);
+        goto fail;
+    }
+    p += ROUND_UP(id->len, 8);
+    g_byte_array_free(id, true);
+
+    qht_init(&tb_cache_htable, tb_cache_cmp, hdr->nb_entries,
+             QHT_MODE_AUTO_RESIZE);
+    for (i = 0; i < hdr->nb_entries; i++) {
+        const TBCacheEntry *e = (const TBCacheEntry *)p;
+        void *existing;
+
+        if (p + sizeof(*e) > end || p + tb_cache_entry_size(e) > end ||
+            e->offset + e->host_size > tcg_init_ctx.code_gen_buffer_size) {
+            warn_report("TB cache: %s is corrupted", path);
+            qht_destroy(&tb_cache_htable);
+            goto fail;
+        }
+        memcpy(buf + e->offset, tb_cache_entry_host(e), e->host_size);
+        used = MAX(used, buf + e->offset + e->host_size);
+        qht_insert(&tb_cache_htable, (void *)e, tb_cache_entry_hash(e),
+                   &existing);
+        p += tb_cache_entry_size(e);
+    }
+
+    flush_icache_range((uintptr_t)buf, (uintptr_t)used);
+    tcg_region_reserve((void *)ROUND_UP((uintptr_t)used, CODE_GEN_ALIGN));
+    trace_tb_cache_load(path, hdr->nb_entries, used - buf);
+    return;
+
+ fail:
+    munmap(tb_cache_map, tb_cache_map_size);
+    tb_cache_map = NULL;
+}
+
+struct tb_cache_save_state {
+    FILE *f;
+    uint64_t nb_entries;
+    bool err;
+};
+
+static gboolean tb_cache_save_one(gpointer key, gpointer value, gpointer data)
+{
+    static const uint8_t zero[8];
+    struct tb_cache_save_state *s = data;
+    const TranslationBlock *tb = value;
+    const uint8_t *host = (const uint8_t *)tb;
+    size_t offset = tb->pc & ~TARGET_PAGE_MASK;
+    size_t len = MIN(tb->size, TARGET_PAGE_SIZE - offset);
+    TBCacheEntry e;
+
+    /* hot code is not restored, it would not fit in the regions */
+    if ((tb_cflags(tb) & (CF_NOCACHE | CF_INVALID | CF_NOPERSIST)) ||
+        tb->page_addr[0] == -1 || tcg_hot_contains(tb)) {
+        return false;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.pc = tb->pc;
+    e.cs_base = tb->cs_base;
+    e.page_addr[0] = tb->page_addr[0];
+    e.page_addr[1] = tb->page_addr[1];
+    e.flags = tb->flags;
+    e.cflags = tb->cflags;
+    e.trace_vcpu_dstate = tb->trace_vcpu_dstate;
+    e.size = tb->size;
+    e.offset = host - (const uint8_t *)tcg_init_ctx.code_gen_buffer;
+    e.host_size = tb->tc.ptr + tb->tc.size + tb_search_size(tb) - host;
+
+    fwrite(&e, sizeof(e), 1, s->f);
+    fwrite(qemu_map_ram_ptr(NULL, tb->page_addr[0] + offset), len, 1, s->f);
+    if (len < tb->size) {
+        fwrite(qemu_map_ram_ptr(NULL, tb->page_addr[1]), tb->size - len, 1,
+               s->f);
+    }
+    fwrite(zero, ROUND_UP(e.size, 8) - e.size, 1, s->f);
+    fwrite(host, e.host_size, 1, s->f);
+    fwrite(zero, ROUND_UP(e.host_size, 8) - e.host_size, 1, s->f);
+
+    s->nb_entries++;
+    s->err = ferror(s->f);
+    return s->err;
+}
+
+/*
+ * Save the live TBs to @path.  The vCPUs must be stopped.
+ */
+void tcg_tb_cache_save(const char *path)
+{
+    static const uint8_t zero[8];
+    struct tb_cache_save_state s = { };
+    TBCacheHeader hdr = { };
+    GByteArray *id;
+    Error *err = NULL;
+    char *tmp;
+    int fd;
+
+    if (!path) {
+        return;
+    }
+
+    id = tb_cache_id(&err);
+    if (!id) {
+        warn_report_err(err);
+        return;
+    }
+
+    tmp = g_strdup_printf("%s.XXXXXX", path);
+    fd = g_mkstemp(tmp);
+    if (fd < 0 || !(s.f = fdopen(fd, "wb"))) {
+        warn_report("TB cache: cannot create %s: %s", tmp, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        goto out;
+    }
+
+    hdr.magic = TB_CACHE_MAGIC;
+    hdr.version = TB_CACHE_VERSION;
+    hdr.id_size = id->len;
+    fwrite(&hdr, sizeof(hdr), 1, s.f);
+    fwrite(id->data, id->len, 1, s.f);
+    fwrite(zero, ROUND_UP(id->len, 8) - id->len, 1, s.f);
+
+    rcu_read_lock();
+    tcg_tb_foreach(tb_cache_save_one, &s);
+    rcu_read_unlock();
+
+    /* now that we know how many TBs were saved, update the header */
+    hdr.nb_entries = s.nb_entries;
+    rewind(s.f);
+    fwrite(&hdr, sizeof(hdr), 1, s.f);
+
+    s.err |= ferror(s.f);
+    s.err |= fclose(s.f) != 0;
+    if (s.err || rename(tmp, path) < 0) {
+        warn_report("TB cache: cannot write %s: %s", path, strerror(errno));
+        unlink(tmp);
+        goto out;
+    }
+    trace_tb_cache_save(path, s.nb_entries);
+
+ out:
+    g_free(tmp);
+    g_byte_array_free(id, true);
+}
@@ -0,0 +1,205 @@
+/*
+ * Per guest PC translation and execution profile
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * With "-accel tcg,profile=on", or after "tcg-profile-set enable=true",
+ * tb_gen_code() keeps a TBProfile for every guest PC it translates,
+ * with the time spent translating it, how many TCG ops the front end
+ * emitted and how many were left after optimization, and how much host
+ * code came out.  The translated code itself increments the execution
+ * counter of its profile on entry, so profiles are never freed: a reset
+ * only zeroes them.  The counter is updated without atomics, so with
+ * MTTCG it may lose a few increments.
+ *
+ * Independently, "-accel tcg,perf-map=on" appends a line for every TB
+ * to /tmp/perf-<pid>.map, which is where perf(1) looks for the symbols
+ * of JIT-generated code.  The file must not exist yet.  Entries are never retired, so samples taken
+ * after a code buffer flush may be attributed to the wrong guest PC.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu-common.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/tb-profile.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "sysemu/cpus.h"
+#include "sysemu/tcg.h"
+#include "tcg.h"
+#include "translate-all.h"
+
+bool tb_profile_enabled;
+bool tb_perf_map_enabled;
+
+static QemuMutex tb_profile_lock;
+static GHashTable *tb_profiles;
+static FILE *tb_perf_map;
+
+static void __attribute__((__constructor__)) tb_profile_init(void)
+{
+    qemu_mutex_init(&tb_profile_lock);
+    tb_profiles = g_hash_table_new(g_int64_hash, g_int64_equal);
+}
+
+/*
+ * Return the profile that the next translation of @pc should update,
+ * or NULL if profiling is off.
+ */
+TBProfile *tb_profile_lookup(target_ulong pc)
+{
+    uint64_t key = pc;
+    TBProfile *p;
+
+    if (!atomic_read(&tb_profile_enabled)) {
+        return NULL;
+    }
+    qemu_mutex_lock(&tb_profile_lock);
+    p = g_hash_table_lookup(tb_profiles, &key);
+    if (!p) {
+        p = g_new0(TBProfile, 1);
+        p->pc = pc;
+        g_hash_table_insert(tb_profiles, &p->pc, p);
+    }
+    qemu_mutex_unlock(&tb_profile_lock);
+    return p;
+}
+
+/* Account for the translation of @tb, which took @ns nanoseconds */
+void tb_profile_add(TCGContext *s, const TranslationBlock *tb, int64_t ns)
+{
+    TBProfile *p = s->tb_profile;
+
+    qemu_mutex_lock(&tb_profile_lock);
+    p->translations++;
+    p->translate_ns += ns;
+    p->size = tb->size;
+    p->host_size = tb->tc.size;
+    p->ops_in = s->gen_ops_in;
+    p->ops_out = s->gen_ops_out;
+    qemu_mutex_unlock(&tb_profile_lock);
+}
+
+/* Describe the host code of @tb in the perf map */
+void tb_perf_map_add(const TranslationBlock *tb)
+{
+    qemu_mutex_lock(&tb_profile_lock);
+    if (!tb_perf_map) {
+        char *path = g_strdup_printf("/tmp/perf-%d.map", getpid());
+        int fd;
+
+        /*
+         * perf only looks in /tmp, which anyone can write to: never reuse
+         * a file or follow a symlink that is already there.  O_EXCL also
+         * fails on a dangling symlink.
+         */
+        fd = qemu_open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0) {
+            tb_perf_map = fdopen(fd, "w");
+            if (!tb_perf_map) {
+                qemu_close(fd);
+            }
+        }
+        if (!tb_perf_map) {
+            warn_report("Could not create %s: %s", path, strerror(errno));
+            atomic_set(&tb_perf_map_enabled, false);
+        }
+        g_free(path);
+    }
+    if (tb_perf_map) {
+        fprintf(tb_perf_map, "%" PRIxPTR " %zx qemu-tb:0x" TARGET_FMT_lx "\n",
+                (uintptr_t)tb->tc.ptr, tb->tc.size, tb->pc);
+        fflush(tb_perf_map);
+    }
+    qemu_mutex_unlock(&tb_profile_lock);
+}
+
+static void tb_profile_zero(gpointer key, gpointer value, gpointer opaque)
+{
+    TBProfile *p = value;
+
+    atomic_set__nocheck(&p->executions, 0);
+    p->translations = 0;
+    p->translate_ns = 0;
+}
+
+void qmp_tcg_profile_set(bool enable, Error **errp)
+{
+    if (!tcg_enabled()) {
+        error_setg(errp, "TCG is not in use");
+        return;
+    }
+    if (enable) {
+        qemu_mutex_lock(&tb_profile_lock);
+        g_hash_table_foreach(tb_profiles, tb_profile_zero, NULL);
+        qemu_mutex_unlock(&tb_profile_lock);
+    }
+    if (enable != atomic_read(&tb_profile_enabled)) {
+        atomic_set(&tb_profile_enabled, enable);
+        /* Retranslate everything, with or without execution counters */
+        if (first_cpu) {
+            tb_flush(first_cpu);
+        }
+    }
+}
+
+static gint tb_profile_cmp(gconstpointer a, gconstpointer b)
+{
+    const TBProfile *pa = *(const TBProfile **)a;
+    const TBProfile *pb = *(const TBProfile **)b;
+    uint64_t ea = atomic_read__nocheck(&pa->executions);
+    uint64_t eb = atomic_read__nocheck(&pb->executions);
+
+    return ea < eb ? 1 : ea > eb ? -1 : 0;
+}
+
+TcgProfileEntryList *qmp_query_tcg_profile(bool has_limit, int64_t limit,
+                                           Error **errp)
+{
+    TcgProfileEntryList *head = NULL, **tail = &head;
+    GPtrArray *all;
+    GHashTableIter iter;
+    gpointer value;
+    guint i;
+
+    if (has_limit && limit < 0) {
+        error_setg(errp, "Parameter 'limit' must not be negative");
+        return NULL;
+    }
+
+    qemu_mutex_lock(&tb_profile_lock);
+    all = g_ptr_array_sized_new(g_hash_table_size(tb_profiles));
+    g_hash_table_iter_init(&iter, tb_profiles);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        g_ptr_array_add(all, value);
+    }
+    g_ptr_array_sort(all, tb_profile_cmp);
+
+    for (i = 0; i < all->len && (!has_limit || i < limit); i++) {
+        const TBProfile *p = g_ptr_array_index(all, i);
+        TcgProfileEntry *e = g_new0(TcgProfileEntry, 1);
+
+        e->pc = p->pc;
+        e->size = p->size;
+        e->host_size = p->host_size;
+        e->translations = p->translations;
+        e->translation_time = p->translate_ns;
+        e->ops_in = p->ops_in;
+        e->ops_out = p->ops_out;
+        e->executions = atomic_read__nocheck(&p->executions);
+
+        *tail = g_new0(TcgProfileEntryList, 1);
+        (*tail)->value = e;
+        tail = &(*tail)->next;
+    }
+    qemu_mutex_unlock(&tb_profile_lock);
+
+    g_ptr_array_free(all, true);
+    return head;
+}
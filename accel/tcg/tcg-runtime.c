@@ -144,16 +144,37 @@ uint64_t HELPER(ctpop_i64)(uint64_t arg)
     return ctpop64(arg);
 }
 
-void *HELPER(lookup_tb_ptr)(CPUArchState *env)
+/*
+ * @site is the slot of the indirect branch target cache for the branch
+ * being executed.  Indirect branches mostly go where they went the last
+ * time, so check that before looking up the jump cache.  The TB in the
+ * slot is validated like a jump cache entry; an invalidated TB fails the
+ * check on CF_INVALID.
+ */
+void *HELPER(lookup_tb_ptr)(CPUArchState *env, uint32_t site)
 {
     CPUState *cpu = env_cpu(env);
+    TBJmpCache *jc = cpu->tb_jmp_cache;
+    TBIBTCEntry *e;
     TranslationBlock *tb;
     target_ulong cs_base, pc;
-    uint32_t flags;
-
-    tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, curr_cflags());
-    if (tb == NULL) {
-        return tcg_ctx->code_gen_epilogue;
+    uint32_t flags, cf_mask;
+
+    cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
+    cf_mask = tb_lookup_cf_mask(cpu, curr_cflags());
+
+    e = &jc->ibtc[site];
+    tb = e->gen == jc->ibtc_gen ? atomic_rcu_read(&e->tb) : NULL;
+    if (likely(tb_lookup_match(tb, cpu, pc, cs_base, flags, cf_mask))) {
+        atomic_set(&jc->ibtc_hits, jc->ibtc_hits + 1);
+    } else {
+        tb = tb_lookup__pc(cpu, pc, cs_base, flags, cf_mask);
+        if (tb == NULL) {
+            return tcg_ctx->code_gen_epilogue;
+        }
+        atomic_set(&e->tb, tb);
+        e->gen = jc->ibtc_gen;
+        jc->ibtc_pages |= tb_ibtc_page_bit(tb->pc);
     }
     qemu_log_mask_and_addr(CPU_LOG_EXEC, pc,
                            "Chain %d: %p ["
@@ -44,10 +44,12 @@
 #endif
 #else
 #include "exec/ram_addr.h"
+#include "tb-async.h"
 #endif
 
 #include "exec/cputlb.h"
 #include "exec/tb-hash.h"
+#include "exec/tb-lookup.h"
 #include "translate-all.h"
 #include "qemu/bitmap.h"
 #include "qemu/error-report.h"
@@ -214,6 +216,10 @@ TCGContext tcg_init_ctx;
 __thread TCGContext *tcg_ctx;
 TBContext tb_ctx;
 bool parallel_cpus;
+/* executions after which a TB is retranslated as a superblock, or 0 */
+unsigned int tb_hot_threshold;
+/* log2 of the number of sets in the jump cache of each vCPU */
+unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS_DEFAULT;
 
 static void page_table_config_init(void)
 {
@@ -325,6 +331,22 @@ static int encode_search(TranslationBlock *tb, uint8_t *block)
     return p - block;
 }
 
+/* Return the number of bytes of search data that encode_search() placed
+   after the host code of TB.  */
+size_t tb_search_size(const TranslationBlock *tb)
+{
+    uint8_t *start = tb->tc.ptr + tb->tc.size;
+    uint8_t *p = start;
+    int i, j;
+
+    for (i = 0; i < tb->icount; ++i) {
+        for (j = 0; j < TARGET_INSN_START_WORDS + 1; ++j) {
+            decode_sleb128(&p);
+        }
+    }
+    return p - start;
+}
+
 /* The cpu state corresponding to 'searched_pc' is restored.
  * When reset_icount is true, current TB will be interrupted and
  * icount should be recalculated.
@@ -1156,6 +1178,14 @@ void tcg_exec_init(unsigned long tb_size)
 #endif
 }
 
+void tb_jmp_cache_init(CPUState *cpu)
+{
+    cpu->tb_jmp_cache = g_malloc0(sizeof(TBJmpCache) +
+                                  (sizeof(TranslationBlock *) *
+                                   TB_JMP_CACHE_WAYS << tb_jmp_cache_bits));
+    cpu->tb_jmp_cache->bits = tb_jmp_cache_bits;
+}
+
 /*
  * Allocate a new translation block. Flush the translation buffer if
  * too many translation blocks or too much generated code.
@@ -1228,16 +1258,46 @@ static gboolean tb_host_size_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
-/* flush all the translation blocks */
-static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
+static void tb_relink(TranslationBlock *tb);
+
+static gboolean tb_hot_collect(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+    GPtrArray *hot = data;
+
+    if (!(tb_cflags(tb) & CF_INVALID)) {
+        g_ptr_array_add(hot, tb);
+    }
+    return false;
+}
+
+/*
+ * Flush all the translation blocks, except for those in the hot code area
+ * if @keep_hot.  The latter is only correct when the flush is due to the
+ * code buffer filling up.
+ */
+static void tb_flush__common(unsigned int tb_flush_count, bool keep_hot)
 {
+    CPUState *cpu;
+    GPtrArray *hot = NULL;
+    unsigned int i;
+
     mmap_lock();
     /* If it is already been done on request of another CPU,
-     * just retry.
+     * just retry.  A pending full flush is never satisfied by one that
+     * kept the hot code, though, whatever the count says.
      */
-    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
+    if (atomic_read(&tb_ctx.tb_flush_full)) {
+        keep_hot = false;
+    } else if (tb_ctx.tb_flush_count != tb_flush_count) {
         goto done;
     }
+    if (!keep_hot) {
+        atomic_set(&tb_ctx.tb_flush_full, false);
+    }
+#ifdef CONFIG_SOFTMMU
+    tb_async_pause();
+#endif
 
     if (DEBUG_TB_FLUSH_GATE) {
         size_t nb_tbs = tcg_nb_tbs();
@@ -1252,27 +1312,68 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
         cpu_tb_jmp_cache_clear(cpu);
     }
 
+    if (keep_hot && !tcg_hot_full()) {
+        hot = g_ptr_array_new();
+        tcg_hot_tb_foreach(tb_hot_collect, hot);
+    }
+
     qht_reset_size(&tb_ctx.htable, CODE_GEN_HTABLE_SIZE);
     page_flush_tb();
+#ifdef CONFIG_SOFTMMU
+    tb_cache_reset();
+#endif
 
     tcg_region_reset_all();
+    if (hot) {
+        for (i = 0; i < hot->len; i++) {
+            tb_relink(g_ptr_array_index(hot, i));
+        }
+        atomic_set(&tb_ctx.tb_hot_kept, tb_ctx.tb_hot_kept + hot->len);
+        g_ptr_array_free(hot, true);
+    } else {
+        tcg_hot_reset();
+    }
     /* XXX: flush processor icache at this point if cache flush is
        expensive */
     atomic_mb_set(&tb_ctx.tb_flush_count, tb_ctx.tb_flush_count + 1);
+#ifdef CONFIG_SOFTMMU
+    tb_async_resume();
+#endif
 
 done:
     mmap_unlock();
 }
 
+static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    tb_flush__common(tb_flush_count.host_int, false);
+}
+
+static void do_tb_flush_cold(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    tb_flush__common(tb_flush_count.host_int, true);
+}
+
 void tb_flush(CPUState *cpu)
 {
     if (tcg_enabled()) {
         unsigned tb_flush_count = atomic_mb_read(&tb_ctx.tb_flush_count);
+
+        atomic_mb_set(&tb_ctx.tb_flush_full, true);
         async_safe_run_on_cpu(cpu, do_tb_flush,
                               RUN_ON_CPU_HOST_INT(tb_flush_count));
     }
 }
 
+/* Make room in a full code buffer, keeping the hot code */
+static void tb_flush_cold(CPUState *cpu)
+{
+    unsigned tb_flush_count = atomic_mb_read(&tb_ctx.tb_flush_count);
+
+    async_safe_run_on_cpu(cpu, do_tb_flush_cold,
+                          RUN_ON_CPU_HOST_INT(tb_flush_count));
+}
+
 /*
  * Formerly ifdef DEBUG_TB_CHECK. These debug functions are user-mode-only,
  * so in order to prevent bit rot we compile them unconditionally in user-mode,
@@ -1431,6 +1532,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     PageDesc *p;
     uint32_t h;
     tb_page_addr_t phys_pc;
+    int i;
 
     assert_memory_lock();
 
@@ -1461,10 +1563,18 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    h = tb_jmp_cache_hash_func(tb->pc);
     CPU_FOREACH(cpu) {
-        if (atomic_read(&cpu->tb_jmp_cache[h]) == tb) {
-            atomic_set(&cpu->tb_jmp_cache[h], NULL);
+        TBJmpCache *jc = atomic_rcu_read(&cpu->tb_jmp_cache);
+        TranslationBlock **set;
+
+        if (!jc) {
+            continue;
+        }
+        set = tb_jmp_cache_set(jc, tb->pc);
+        for (i = 0; i < TB_JMP_CACHE_WAYS; i++) {
+            if (atomic_read(&set[i]) == tb) {
+                atomic_set(&set[i], NULL);
+            }
         }
     }
 
@@ -1666,6 +1776,48 @@ tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
     return tb;
 }
 
+static void tb_init_jumps(TranslationBlock *tb)
+{
+    /* init jump list */
+    qemu_spin_init(&tb->jmp_lock);
+    tb->jmp_list_head = (uintptr_t)NULL;
+    tb->jmp_list_next[0] = (uintptr_t)NULL;
+    tb->jmp_list_next[1] = (uintptr_t)NULL;
+    tb->jmp_dest[0] = (uintptr_t)NULL;
+    tb->jmp_dest[1] = (uintptr_t)NULL;
+
+    /* init original jump addresses which have been set during tcg_gen_code() */
+    if (tb->jmp_reset_offset[0] != TB_JMP_RESET_OFFSET_INVALID) {
+        tb_reset_jump(tb, 0);
+    }
+    if (tb->jmp_reset_offset[1] != TB_JMP_RESET_OFFSET_INVALID) {
+        tb_reset_jump(tb, 1);
+    }
+}
+
+/*
+ * Put @tb, a TB in the hot code area that tb_flush() kept, back into the
+ * hash table and the page descriptors.  The TBs it was chained to are gone.
+ */
+static void tb_relink(TranslationBlock *tb)
+{
+    tb_page_addr_t phys_pc = tb->page_addr[0] + (tb->pc & ~TARGET_PAGE_MASK);
+
+    tb_init_jumps(tb);
+    tb_link_page(tb, phys_pc, tb->page_addr[1]);
+}
+
+/* Return the physical address of the second page of TB, or -1 if none */
+static tb_page_addr_t tb_phys_page2(CPUArchState *env, TranslationBlock *tb)
+{
+    target_ulong virt_page2 = (tb->pc + tb->size - 1) & TARGET_PAGE_MASK;
+
+    if ((tb->pc & TARGET_PAGE_MASK) != virt_page2) {
+        return get_page_addr_code(env, virt_page2);
+    }
+    return -1;
+}
+
 /* Called with mmap_lock held for user mode emulation.  */
 TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
@@ -1674,9 +1826,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     CPUArchState *env = cpu->env_ptr;
     TranslationBlock *tb, *existing_tb;
     tb_page_addr_t phys_pc, phys_page2;
-    target_ulong virt_page2;
     tcg_insn_unit *gen_code_buf;
     int gen_code_size, search_size, max_insns;
+#ifdef CONFIG_SOFTMMU
+    int64_t prof_start = 0;
+#endif
 #ifdef CONFIG_PROFILER
     TCGProfile *prof = &tcg_ctx->prof;
     int64_t ti;
@@ -1694,6 +1848,26 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     cflags &= ~CF_CLUSTER_MASK;
     cflags |= cpu->cluster_index << CF_CLUSTER_SHIFT;
 
+#ifdef CONFIG_SOFTMMU
+    /* reuse the code saved by a previous run, if it is still valid */
+    if (!(cflags & (CF_NOCACHE | CF_SUPERBLOCK)) &&
+        !cpu->singlestep_enabled && !singlestep) {
+        tb = tb_cache_lookup(cpu, pc, cs_base, flags, cflags, phys_pc);
+        if (tb) {
+            tb->hot_count = tb_hot_threshold;
+            tb_init_jumps(tb);
+            existing_tb = tb_link_page(tb, phys_pc, tb_phys_page2(env, tb));
+            if (likely(existing_tb == tb)) {
+                tcg_tb_insert(tb);
+                if (atomic_read(&tb_perf_map_enabled)) {
+                    tb_perf_map_add(tb);
+                }
+            }
+            return existing_tb;
+        }
+    }
+#endif
+
     max_insns = cflags & CF_COUNT_MASK;
     if (max_insns == 0) {
         max_insns = CF_COUNT_MASK;
@@ -1705,11 +1879,19 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         max_insns = 1;
     }
 
+    /* Superblocks are hot by definition, keep them together */
+    tcg_code_select(tcg_ctx, cflags & CF_SUPERBLOCK);
+
  buffer_overflow:
     tb = tb_alloc(pc);
     if (unlikely(!tb)) {
+        if (tcg_ctx->code_hot) {
+            /* the hot code area is full, fall back to the regions */
+            tcg_code_select(tcg_ctx, false);
+            goto buffer_overflow;
+        }
         /* flush must be done */
-        tb_flush(cpu);
+        tb_flush_cold(cpu);
         mmap_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
@@ -1723,7 +1905,15 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->flags = flags;
     tb->cflags = cflags;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    tb->hot_count = tb_hot_threshold;
     tcg_ctx->tb_cflags = cflags;
+    tcg_ctx->gen_tb_pc = pc;
+#ifdef CONFIG_SOFTMMU
+    tcg_ctx->tb_profile = tb_profile_lookup(pc);
+    if (tcg_ctx->tb_profile) {
+        prof_start = get_clock();
+    }
+#endif
  tb_overflow:
 
 #ifdef CONFIG_PROFILER
@@ -1737,6 +1927,9 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tcg_ctx->cpu = env_cpu(env);
     gen_intermediate_code(cpu, tb, max_insns);
     tcg_ctx->cpu = NULL;
+    if (tcg_ctx->tb_host_ptr) {
+        tb->cflags |= CF_NOPERSIST;
+    }
 
     trace_translate_block(tb, tb->pc, tb->tc.ptr);
 
@@ -1798,6 +1991,12 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     }
     tb->tc.size = gen_code_size;
 
+#ifdef CONFIG_SOFTMMU
+    if (tcg_ctx->tb_profile) {
+        tb_profile_add(tcg_ctx, tb, get_clock() - prof_start);
+    }
+#endif
+
 #ifdef CONFIG_PROFILER
     atomic_set(&prof->code_time, prof->code_time + profile_getclock() - ti);
     atomic_set(&prof->code_in_len, prof->code_in_len + tb->size);
@@ -1841,28 +2040,10 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         ROUND_UP((uintptr_t)gen_code_buf + gen_code_size + search_size,
                  CODE_GEN_ALIGN));
 
-    /* init jump list */
-    qemu_spin_init(&tb->jmp_lock);
-    tb->jmp_list_head = (uintptr_t)NULL;
-    tb->jmp_list_next[0] = (uintptr_t)NULL;
-    tb->jmp_list_next[1] = (uintptr_t)NULL;
-    tb->jmp_dest[0] = (uintptr_t)NULL;
-    tb->jmp_dest[1] = (uintptr_t)NULL;
-
-    /* init original jump addresses which have been set during tcg_gen_code() */
-    if (tb->jmp_reset_offset[0] != TB_JMP_RESET_OFFSET_INVALID) {
-        tb_reset_jump(tb, 0);
-    }
-    if (tb->jmp_reset_offset[1] != TB_JMP_RESET_OFFSET_INVALID) {
-        tb_reset_jump(tb, 1);
-    }
+    tb_init_jumps(tb);
 
     /* check next page if needed */
-    virt_page2 = (pc + tb->size - 1) & TARGET_PAGE_MASK;
-    phys_page2 = -1;
-    if ((pc & TARGET_PAGE_MASK) != virt_page2) {
-        phys_page2 = get_page_addr_code(env, virt_page2);
-    }
+    phys_page2 = tb_phys_page2(env, tb);
     /*
      * No explicit memory barrier is required -- tb_link_page() makes the
      * TB visible in a consistent state.
@@ -1877,9 +2058,260 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         return existing_tb;
     }
     tcg_tb_insert(tb);
+#ifdef CONFIG_SOFTMMU
+    if (atomic_read(&tb_perf_map_enabled)) {
+        tb_perf_map_add(tb);
+    }
+#endif
     return tb;
 }
 
+#ifdef CONFIG_SOFTMMU
+/*
+ * Hand the promotion of @orig over to the background translation threads.
+ * Only the front end runs here, because it fetches guest code through
+ * this vCPU's TLB; @orig keeps running meanwhile, with its execution
+ * counter parked so that it does not exit again.  The counter is parked
+ * only once translation has succeeded, as the front end may longjmp out
+ * on a guest exception; until then other vCPUs may translate @orig too,
+ * and only the first one to finish queues a job.
+ *
+ * Returns false if @orig must be promoted synchronously instead.
+ */
+static bool tb_promote_async(CPUState *cpu, TranslationBlock *orig)
+{
+    target_ulong ofs = orig->pc & ~TARGET_PAGE_MASK;
+    TBAsyncJob *job;
+    TranslationBlock *tb;
+
+    if (orig->page_addr[1] != -1 ||
+        orig->trace_vcpu_dstate != *cpu->trace_dstate ||
+        cpu->singlestep_enabled || singlestep) {
+        return false;
+    }
+
+    /*
+     * Take the snapshot of guest code before translating it, so that a
+     * concurrent write makes tb_link_replace() give up on the result.
+     */
+    job = tb_async_job_get();
+    job->orig = orig;
+    job->phys_pc = orig->page_addr[0] + ofs;
+    g_free(job->guest);
+    job->guest = g_memdup(qemu_map_ram_ptr(NULL, job->phys_pc),
+                          TARGET_PAGE_SIZE - ofs);
+
+    tb = &job->draft;
+    tb->pc = orig->pc;
+    tb->cs_base = orig->cs_base;
+    tb->flags = orig->flags;
+    tb->cflags = (tb_cflags(orig) & CF_HASH_MASK) | CF_SUPERBLOCK;
+    tb->trace_vcpu_dstate = orig->trace_vcpu_dstate;
+    tcg_ctx->tb_cflags = tb->cflags;
+    tcg_ctx->gen_tb_pc = tb->pc;
+    tcg_ctx->tb_profile = tb_profile_lookup(tb->pc);
+
+    tcg_func_start(tcg_ctx);
+    tcg_ctx->cpu = cpu;
+    gen_intermediate_code(cpu, tb, TCG_MAX_INSNS);
+    tcg_ctx->cpu = NULL;
+
+    if (ofs + tb->size > TARGET_PAGE_SIZE) {
+        return false;
+    }
+    /* Only one vCPU gets to queue a job for @orig; the job is kept */
+    if (atomic_xchg(&orig->hot_count, INT32_MAX) > 0) {
+        return true;
+    }
+    trace_tb_promote_async(orig, orig->pc);
+    tcg_ops_detach(tcg_ctx, &job->ops);
+    tb_async_queue(job);
+    return true;
+}
+
+/*
+ * Link @tb in place of @job->orig, unless @job->orig has been invalidated
+ * or the guest code has changed since @job was queued.
+ */
+static bool tb_link_replace(TranslationBlock *tb, TBAsyncJob *job)
+{
+    TranslationBlock *orig = job->orig;
+    void *existing_tb = NULL;
+    PageDesc *p;
+    uint32_t h;
+    bool ok;
+
+    page_lock_pair(&p, job->phys_pc, NULL, -1, 1);
+
+    rcu_read_lock();
+    ok = !(tb_cflags(orig) & CF_INVALID) &&
+         !memcmp(job->guest, qemu_map_ram_ptr(NULL, job->phys_pc), tb->size);
+    rcu_read_unlock();
+    if (!ok) {
+        page_unlock(p);
+        return false;
+    }
+
+    do_tb_phys_invalidate(orig, true);
+    tb_page_add(p, tb, 0, job->phys_pc & TARGET_PAGE_MASK);
+    tb->page_addr[1] = -1;
+
+    h = tb_hash_func(job->phys_pc, tb->pc, tb->flags,
+                     tb->cflags & CF_HASH_MASK, tb->trace_vcpu_dstate);
+    qht_insert(&tb_ctx.htable, tb, h, &existing_tb);
+    if (unlikely(existing_tb)) {
+        tb_page_remove(p, tb);
+        invalidate_page_bitmap(p);
+        ok = false;
+    }
+    page_unlock(p);
+    return ok;
+}
+
+/* Give back the code buffer space taken by the TB whose code is at @buf */
+static void tb_async_unalloc(TCGContext *s, tcg_insn_unit *buf)
+{
+    uintptr_t orig_aligned = (uintptr_t)buf;
+
+    orig_aligned -= ROUND_UP(sizeof(TranslationBlock), qemu_icache_linesize);
+    atomic_set(&s->code_gen_ptr, (void *)orig_aligned);
+}
+
+/*
+ * Generate code for @job on a background translation thread, and link it
+ * in place of the TB it was queued for.
+ */
+void tb_gen_code_async(TBAsyncJob *job)
+{
+    TCGContext *s = tcg_ctx;
+    TranslationBlock *orig = job->orig;
+    TranslationBlock *tb;
+    tcg_insn_unit *gen_code_buf;
+    int gen_code_size, search_size;
+    int64_t prof_start = 0;
+
+    tcg_code_select(s, true);
+    tb = tb_alloc(job->draft.pc);
+    if (unlikely(!tb) && s->code_hot) {
+        tcg_code_select(s, false);
+        tb = tb_alloc(job->draft.pc);
+    }
+    if (unlikely(!tb)) {
+        /* Leave it to the vCPUs to flush the code buffer */
+        goto retry;
+    }
+
+    gen_code_buf = s->code_gen_ptr;
+    tb->tc.ptr = gen_code_buf;
+    tb->pc = job->draft.pc;
+    tb->cs_base = job->draft.cs_base;
+    tb->flags = job->draft.flags;
+    tb->cflags = job->draft.cflags;
+    tb->trace_vcpu_dstate = job->draft.trace_vcpu_dstate;
+    tb->size = job->draft.size;
+    tb->icount = job->draft.icount;
+    tb->hot_count = 0;
+    if (job->ops.tb_host_ptr) {
+        tb->cflags |= CF_NOPERSIST;
+    }
+    s->tb_cflags = tb->cflags;
+    /* Only the back end's share of the translation time is accounted */
+    s->tb_profile = tb_profile_lookup(tb->pc);
+    if (s->tb_profile) {
+        prof_start = get_clock();
+    }
+
+    tcg_func_start(s);
+    tcg_ops_attach(s, &job->ops, &job->draft, tb);
+
+    trace_translate_block(tb, tb->pc, tb->tc.ptr);
+
+    tb->jmp_reset_offset[0] = TB_JMP_RESET_OFFSET_INVALID;
+    tb->jmp_reset_offset[1] = TB_JMP_RESET_OFFSET_INVALID;
+    s->tb_jmp_reset_offset = tb->jmp_reset_offset;
+    if (TCG_TARGET_HAS_direct_jump) {
+        s->tb_jmp_insn_offset = tb->jmp_target_arg;
+        s->tb_jmp_target_addr = NULL;
+    } else {
+        s->tb_jmp_insn_offset = NULL;
+        s->tb_jmp_target_addr = tb->jmp_target_arg;
+    }
+
+    gen_code_size = tcg_gen_code(s, tb);
+    if (unlikely(gen_code_size < 0)) {
+        /*
+         * The ops have been consumed, so we cannot move on to a new
+         * region and try again as tb_gen_code() does.  If the superblock
+         * is simply too large, keep running @orig for good.
+         */
+        tb_async_unalloc(s, gen_code_buf);
+        if (gen_code_size == -1) {
+            goto retry;
+        }
+        trace_tb_async_drop(orig, orig->pc);
+        return;
+    }
+    search_size = encode_search(tb, (void *)gen_code_buf + gen_code_size);
+    if (unlikely(search_size < 0)) {
+        tb_async_unalloc(s, gen_code_buf);
+        goto retry;
+    }
+    tb->tc.size = gen_code_size;
+    if (s->tb_profile) {
+        tb_profile_add(s, tb, get_clock() - prof_start);
+    }
+
+    atomic_set(&s->code_gen_ptr, (void *)
+        ROUND_UP((uintptr_t)gen_code_buf + gen_code_size + search_size,
+                 CODE_GEN_ALIGN));
+
+    tb_init_jumps(tb);
+
+    if (unlikely(!tb_link_replace(tb, job))) {
+        tb_async_unalloc(s, gen_code_buf);
+        trace_tb_async_drop(orig, orig->pc);
+        return;
+    }
+    tcg_tb_insert(tb);
+    if (atomic_read(&tb_perf_map_enabled)) {
+        tb_perf_map_add(tb);
+    }
+    trace_tb_async_link(tb, orig, tb->pc);
+    return;
+
+ retry:
+    trace_tb_async_drop(orig, orig->pc);
+    atomic_set(&orig->hot_count, tb_hot_threshold);
+}
+#endif
+
+/*
+ * Replace @tb, which has just run tb_hot_threshold times, with a
+ * superblock translated from the same guest state.  The front end may
+ * then continue translation past branches, so that globals stay in host
+ * registers across the internal edges of the hot path.
+ *
+ * Called with mmap_lock held for user mode emulation.
+ */
+void tb_promote(CPUState *cpu, TranslationBlock *tb)
+{
+    uint32_t cflags = tb_cflags(tb);
+
+    /* Another vCPU may have beaten us to it */
+    if (cflags & CF_INVALID) {
+        return;
+    }
+#ifdef CONFIG_SOFTMMU
+    if (tb_async_enabled() && tb_promote_async(cpu, tb)) {
+        return;
+    }
+#endif
+    trace_tb_promote(tb, tb->pc);
+    tb_phys_invalidate(tb, -1);
+    tb_gen_code(cpu, tb->pc, tb->cs_base, tb->flags,
+                (cflags & CF_HASH_MASK) | CF_SUPERBLOCK);
+}
+
 /*
  * @p must be non-NULL.
  * user-mode: call with mmap_lock held.
@@ -2237,21 +2669,40 @@ void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr)
     cpu_loop_exit_noexc(cpu);
 }
 
-static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
+static void tb_jmp_cache_clear_page(TBJmpCache *jc, target_ulong page_addr)
 {
-    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr);
+    unsigned int bits = jc->bits;
+    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr, bits);
 
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
-        atomic_set(&cpu->tb_jmp_cache[i0 + i], NULL);
+    for (i = 0; i < TB_JMP_PAGE_SIZE(bits) * TB_JMP_CACHE_WAYS; i++) {
+        atomic_set(&jc->entries[i0 * TB_JMP_CACHE_WAYS + i], NULL);
     }
 }
 
 void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
 {
+    TBJmpCache *jc = cpu->tb_jmp_cache;
+    target_ulong start = addr - TARGET_PAGE_SIZE;
+    unsigned int i;
+
     /* Discard jump cache entries for any tb which might potentially
        overlap the flushed page.  */
-    tb_jmp_cache_clear_page(cpu, addr - TARGET_PAGE_SIZE);
-    tb_jmp_cache_clear_page(cpu, addr);
+    tb_jmp_cache_clear_page(jc, start);
+    tb_jmp_cache_clear_page(jc, addr);
+
+    /*
+     * The indirect branch target cache is not indexed by the target PC,
+     * so move to a new generation if it may hold such a tb.
+     */
+    if (jc->ibtc_pages & (tb_ibtc_page_bit(start) | tb_ibtc_page_bit(addr))) {
+        jc->ibtc_pages = 0;
+        if (unlikely(++jc->ibtc_gen == 0)) {
+            /* Do not let entries of the previous round come back */
+            for (i = 0; i < TB_IBTC_SIZE; i++) {
+                atomic_set(&jc->ibtc[i].tb, NULL);
+            }
+        }
+    }
 }
 
 static void print_qht_statistics(struct qht_stats hst)
@@ -2328,7 +2779,11 @@ void dump_exec_info(void)
 {
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
+    TCGOptStats ost;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t hot_size, hot_capacity;
+    size_t jmp_cache_hits, jmp_cache_misses, ibtc_hits;
+    CPUState *cpu;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -2341,6 +2796,10 @@ void dump_exec_info(void)
      */
     qemu_printf("gen code size       %zu/%zu\n",
                 tcg_code_size(), tcg_code_capacity());
+    tcg_hot_usage(&hot_size, &hot_capacity);
+    if (hot_capacity) {
+        qemu_printf("hot code size       %zu/%zu\n", hot_size, hot_capacity);
+    }
     qemu_printf("TB count            %zu\n", nb_tbs);
     qemu_printf("TB avg target size  %zu max=%zu bytes\n",
                 nb_tbs ? tst.target_size / nb_tbs : 0,
@@ -2363,13 +2822,44 @@ void dump_exec_info(void)
     qemu_printf("\nStatistics:\n");
     qemu_printf("TB flush count      %u\n",
                 atomic_read(&tb_ctx.tb_flush_count));
+    if (hot_capacity) {
+        qemu_printf("TB kept on flush    %zu\n",
+                    atomic_read(&tb_ctx.tb_hot_kept));
+    }
     qemu_printf("TB invalidate count %zu\n",
                 tcg_tb_phys_invalidate_count());
 
+    jmp_cache_hits = jmp_cache_misses = ibtc_hits = 0;
+    CPU_FOREACH(cpu) {
+        TBJmpCache *jc = atomic_rcu_read(&cpu->tb_jmp_cache);
+
+        if (!jc) {
+            continue;
+        }
+        jmp_cache_hits += atomic_read(&jc->hits);
+        jmp_cache_misses += atomic_read(&jc->misses);
+        ibtc_hits += atomic_read(&jc->ibtc_hits);
+    }
+    qemu_printf("jump cache hits     %zu\n", jmp_cache_hits);
+    qemu_printf("jump cache misses   %zu\n", jmp_cache_misses);
+    qemu_printf("ind. branch hits    %zu\n", ibtc_hits);
+
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+    qemu_printf("TLB huge page fills %zu\n", tlb_large_fill_count());
+
+    tcg_opt_stats(&ost);
+    qemu_printf("\nTCG ops per pass:\n");
+    qemu_printf("front end           %zu\n", ost.ops_in);
+    qemu_printf("optimize            %zu\n", ost.ops_optimize);
+    qemu_printf("gvn                 %zu%s\n", ost.ops_gvn,
+                tcg_gvn_enabled ? "" : " (disabled)");
+    qemu_printf("  redundant exprs   %zu\n", ost.gvn_cse);
+    qemu_printf("  forwarded loads   %zu\n", ost.gvn_loads);
+    qemu_printf("  removed stores    %zu\n", ost.gvn_stores);
+    qemu_printf("liveness            %zu\n", ost.ops_liveness);
     tcg_dump_info();
 }
 
@@ -20,6 +20,7 @@
 #define TRANSLATE_ALL_H
 
 #include "exec/exec-all.h"
+#include "exec/tb-profile.h"
 
 
 /* translate-all.c */
@@ -31,6 +32,19 @@ void tb_invalidate_phys_page_fast(struct page_collection *pages,
 void tb_invalidate_phys_page_range(tb_page_addr_t start, tb_page_addr_t end,
                                    int is_cpu_write_access);
 void tb_check_watchpoint(CPUState *cpu);
+size_t tb_search_size(const TranslationBlock *tb);
+
+/* tb-cache.c */
+TranslationBlock *tb_cache_lookup(CPUState *cpu, target_ulong pc,
+                                  target_ulong cs_base, uint32_t flags,
+                                  uint32_t cflags, tb_page_addr_t phys_pc);
+void tb_cache_reset(void);
+
+/* tb-profile.c */
+TBProfile *tb_profile_lookup(target_ulong pc);
+void tb_profile_add(struct TCGContext *s, const TranslationBlock *tb,
+                    int64_t ns);
+void tb_perf_map_add(const TranslationBlock *tb);
 
 #ifdef CONFIG_USER_ONLY
 int page_unprotect(target_ulong address, uintptr_t pc);
@@ -42,6 +42,8 @@
 #include "sysemu/hvf.h"
 #include "sysemu/whpx.h"
 #include "exec/exec-all.h"
+#include "exec/cputlb.h"
+#include "exec/tb-profile.h"
 
 #include "qemu/thread.h"
 #include "sysemu/cpus.h"
@@ -159,6 +161,10 @@ typedef struct TimersState {
 
 static TimersState timers_state;
 bool mttcg_enabled;
+/* file for the persistent TB cache, see accel/tcg/tb-cache.c */
+static char *tcg_tb_cache_path;
+/* superblock-threshold implied by translation-threads and hot-code-size */
+#define TCG_DEFAULT_HOT_THRESHOLD 1000
 
 /*
  * We default to false if we know other options have been enabled
@@ -205,6 +211,47 @@ static bool default_mttcg_enabled(void)
 void qemu_tcg_configure(QemuOpts *opts, Error **errp)
 {
     const char *t = qemu_opt_get(opts, "thread");
+    const char *tb_cache = qemu_opt_get(opts, "tb-cache");
+    uint64_t hot = qemu_opt_get_number(opts, "superblock-threshold", 0);
+    uint64_t threads = qemu_opt_get_number(opts, "translation-threads", 0);
+    uint64_t hot_size = qemu_opt_get_size(opts, "hot-code-size", 0);
+    uint64_t jc_bits = qemu_opt_get_number(opts, "jmp-cache-bits",
+                                           TB_JMP_CACHE_BITS_DEFAULT);
+    uint64_t vtlb_bits = qemu_opt_get_number(opts, "victim-tlb-bits",
+                                             CPU_VTLB_BITS_DEFAULT);
+
+    tcg_gvn_enabled = qemu_opt_get_bool(opts, "gvn", true);
+    tb_profile_enabled = qemu_opt_get_bool(opts, "profile", false);
+    tb_perf_map_enabled = qemu_opt_get_bool(opts, "perf-map", false);
+    if (tb_cache) {
+        g_free(tcg_tb_cache_path);
+        tcg_tb_cache_path = g_strdup(tb_cache);
+    }
+    if (jc_bits < TB_JMP_CACHE_BITS_MIN || jc_bits > TB_JMP_CACHE_BITS_MAX) {
+        error_setg(errp, "jmp-cache-bits must be between %d and %d",
+                   TB_JMP_CACHE_BITS_MIN, TB_JMP_CACHE_BITS_MAX);
+        return;
+    }
+    tb_jmp_cache_bits = jc_bits;
+    if (vtlb_bits > CPU_VTLB_BITS_MAX) {
+        error_setg(errp, "victim-tlb-bits must be at most %d",
+                   CPU_VTLB_BITS_MAX);
+        return;
+    }
+    tlb_victim_bits = vtlb_bits;
+    if (hot) {
+#ifdef TARGET_SUPPORTS_SUPERBLOCKS
+        if (hot > INT32_MAX) {
+            error_setg(errp, "superblock-threshold must be at most %d",
+                       INT32_MAX);
+            return;
+        }
+        tb_hot_threshold = hot;
+#else
+        warn_report("Guest does not support superblocks, "
+                    "ignoring superblock-threshold");
+#endif
+    }
     if (t) {
         if (strcmp(t, "multi") == 0) {
             if (TCG_OVERSIZED_GUEST) {
@@ -231,6 +278,41 @@ void qemu_tcg_configure(QemuOpts *opts, Error **errp)
     } else {
         mttcg_enabled = default_mttcg_enabled();
     }
+#ifndef TARGET_SUPPORTS_SUPERBLOCKS
+    /* Both only serve superblocks, do not run the promotion machinery */
+    if (threads) {
+        warn_report("Guest does not support superblocks, "
+                    "ignoring translation-threads");
+        threads = 0;
+    }
+    if (hot_size) {
+        warn_report("Guest does not support superblocks, "
+                    "ignoring hot-code-size");
+        hot_size = 0;
+    }
+#endif
+    if (threads) {
+        if (threads > TCG_MAX_TRANSLATION_THREADS) {
+            error_setg(errp, "translation-threads must be at most %d",
+                       TCG_MAX_TRANSLATION_THREADS);
+            return;
+        }
+        if (!mttcg_enabled) {
+            warn_report("translation-threads requires thread=multi, "
+                        "ignoring");
+            return;
+        }
+        tcg_translation_threads = threads;
+        if (!tb_hot_threshold) {
+            tb_hot_threshold = TCG_DEFAULT_HOT_THRESHOLD;
+        }
+    }
+    if (hot_size) {
+        tcg_hot_area_size = hot_size;
+        if (!tb_hot_threshold) {
+            tb_hot_threshold = TCG_DEFAULT_HOT_THRESHOLD;
+        }
+    }
 }
 
 /* The current number of executed instructions is based on what we
@@ -773,19 +855,30 @@ static const VMStateDescription vmstate_timers = {
     }
 };
 
+/* The percentage @cpu sleeps for, the larger of global and per-vcpu one */
+static int cpu_throttle_vcpu_effective(CPUState *cpu)
+{
+    return MAX(cpu_throttle_get_percentage(),
+               atomic_read(&cpu->throttle_percentage));
+}
+
+/*
+ * The timer ticks every CPU_THROTTLE_TIMESLICE_NS / (1 - pct) for the
+ * most throttled vcpu, passed here as @opaque, and each vcpu sleeps for
+ * its own percentage of that period.
+ */
 static void cpu_throttle_thread(CPUState *cpu, run_on_cpu_data opaque)
 {
     double pct;
-    double throttle_ratio;
     long sleeptime_ns;
 
-    if (!cpu_throttle_get_percentage()) {
+    if (!cpu_throttle_vcpu_effective(cpu)) {
+        atomic_set(&cpu->throttle_thread_scheduled, 0);
         return;
     }
 
-    pct = (double)cpu_throttle_get_percentage()/100;
-    throttle_ratio = pct / (1 - pct);
-    sleeptime_ns = (long)(throttle_ratio * CPU_THROTTLE_TIMESLICE_NS);
+    pct = (double)cpu_throttle_vcpu_effective(cpu)/100;
+    sleeptime_ns = (long)(pct * opaque.host_ulong);
 
     qemu_mutex_unlock_iothread();
     g_usleep(sleeptime_ns / 1000); /* Convert ns to us for usleep call */
@@ -797,21 +890,32 @@ static void cpu_throttle_timer_tick(void *opaque)
 {
     CPUState *cpu;
     double pct;
+    unsigned long period_ns;
+    int max_pct = 0;
+
+    CPU_FOREACH(cpu) {
+        max_pct = MAX(max_pct, cpu_throttle_vcpu_effective(cpu));
+    }
 
     /* Stop the timer if needed */
-    if (!cpu_throttle_get_percentage()) {
+    if (!max_pct) {
         return;
     }
+
+    pct = (double)max_pct/100;
+    period_ns = CPU_THROTTLE_TIMESLICE_NS / (1-pct);
     CPU_FOREACH(cpu) {
+        if (!cpu_throttle_vcpu_effective(cpu)) {
+            continue;
+        }
         if (!atomic_xchg(&cpu->throttle_thread_scheduled, 1)) {
             async_run_on_cpu(cpu, cpu_throttle_thread,
-                             RUN_ON_CPU_NULL);
+                             RUN_ON_CPU_HOST_ULONG(period_ns));
         }
     }
 
-    pct = (double)cpu_throttle_get_percentage()/100;
     timer_mod(throttle_timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL_RT) +
-                                   CPU_THROTTLE_TIMESLICE_NS / (1-pct));
+                                   period_ns);
 }
 
 void cpu_throttle_set(int new_throttle_pct)
@@ -828,12 +932,27 @@ void cpu_throttle_set(int new_throttle_pct)
 
 void cpu_throttle_stop(void)
 {
+    CPUState *cpu;
+
     atomic_set(&throttle_percentage, 0);
+    CPU_FOREACH(cpu) {
+        atomic_set(&cpu->throttle_percentage, 0);
+    }
 }
 
 bool cpu_throttle_active(void)
 {
-    return (cpu_throttle_get_percentage() != 0);
+    CPUState *cpu;
+
+    if (cpu_throttle_get_percentage()) {
+        return true;
+    }
+    CPU_FOREACH(cpu) {
+        if (atomic_read(&cpu->throttle_percentage)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 int cpu_throttle_get_percentage(void)
@@ -841,6 +960,26 @@ int cpu_throttle_get_percentage(void)
     return atomic_read(&throttle_percentage);
 }
 
+void cpu_throttle_set_vcpu(CPUState *cpu, int new_throttle_pct)
+{
+    if (new_throttle_pct) {
+        new_throttle_pct = MIN(new_throttle_pct, CPU_THROTTLE_PCT_MAX);
+        new_throttle_pct = MAX(new_throttle_pct, CPU_THROTTLE_PCT_MIN);
+    }
+
+    atomic_set(&cpu->throttle_percentage, new_throttle_pct);
+
+    if (new_throttle_pct) {
+        timer_mod(throttle_timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL_RT) +
+                                           CPU_THROTTLE_TIMESLICE_NS);
+    }
+}
+
+int cpu_throttle_get_vcpu_percentage(CPUState *cpu)
+{
+    return atomic_read(&cpu->throttle_percentage);
+}
+
 void cpu_ticks_init(void)
 {
     seqlock_init(&timers_state.vm_clock_seqlock);
@@ -1092,7 +1231,12 @@ static int do_vm_stop(RunState state, bool send_stop)
  */
 int vm_shutdown(void)
 {
-    return do_vm_stop(RUN_STATE_SHUTDOWN, false);
+    int ret = do_vm_stop(RUN_STATE_SHUTDOWN, false);
+
+    if (tcg_enabled()) {
+        tcg_tb_cache_save(tcg_tb_cache_path);
+    }
+    return ret;
 }
 
 static bool cpu_can_run(CPUState *cpu)
@@ -1958,6 +2102,8 @@ static void qemu_tcg_init_vcpu(CPUState *cpu)
     if (!tcg_region_inited) {
         tcg_region_inited = 1;
         tcg_region_init();
+        tcg_tb_cache_load(tcg_tb_cache_path);
+        tcg_tb_async_init(tcg_translation_threads);
     }
 
     if (qemu_tcg_mttcg_enabled() || !single_tcg_cpu_thread) {
@@ -921,8 +921,13 @@ AddressSpace *cpu_get_address_space(CPUState *cpu, int asidx)
 void cpu_exec_unrealizefn(CPUState *cpu)
 {
     CPUClass *cc = CPU_GET_CLASS(cpu);
+    TBJmpCache *jc = cpu->tb_jmp_cache;
 
     cpu_list_remove(cpu);
+    if (jc) {
+        atomic_set(&cpu->tb_jmp_cache, NULL);
+        g_free_rcu(jc, rcu);
+    }
 
     if (cc->vmsd != NULL) {
         vmstate_unregister(NULL, cc->vmsd, cpu);
@@ -966,6 +971,10 @@ void cpu_exec_realizefn(CPUState *cpu, Error **errp)
     CPUClass *cc = CPU_GET_CLASS(cpu);
     static bool tcg_target_initialized;
 
+    /* Other threads may look at the jump cache as soon as it is listed */
+    if (tcg_enabled()) {
+        tb_jmp_cache_init(cpu);
+    }
     cpu_list_add(cpu);
 
     if (tcg_enabled() && !tcg_target_initialized) {
@@ -2761,6 +2770,16 @@ void memory_notdirty_write_complete(NotDirtyInfo *ndi)
         ndi->pages = NULL;
     }
 
+    /* Account the write that first dirties a page during dirty logging
+     * to the vcpu doing it; see CPUState::dirty_pages.
+     */
+    if (global_dirty_log &&
+        !cpu_physical_memory_get_dirty_flag(ndi->ram_addr,
+                                            DIRTY_MEMORY_MIGRATION)) {
+        atomic_set__nocheck(&ndi->cpu->dirty_pages,
+                            ndi->cpu->dirty_pages + 1);
+    }
+
     /* Set both VGA and migration bits for simplicity and to remove
      * the notdirty callback faster.
      */
@@ -3034,6 +3053,12 @@ static subpage_t *subpage_init(FlatView *fv, hwaddr base)
     memory_region_init_io(&mmio->iomem, NULL, &subpage_ops, mmio,
                           NULL, TARGET_PAGE_SIZE);
     mmio->iomem.subpage = true;
+    /*
+     * flatview_read/write take the BQL or the device lock for the region
+     * that is actually accessed, so that regions smaller than a page may
+     * run without the BQL too.
+     */
+    memory_region_clear_global_locking(&mmio->iomem);
 #if defined(DEBUG_SUBPAGE)
     printf("%s: %p base " TARGET_FMT_plx " len %08x\n", __func__,
            mmio, base, TARGET_PAGE_SIZE);
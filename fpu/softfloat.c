@@ -136,6 +136,7 @@ this code that are retained.
         }                                                               \
     }
 
+GEN_INPUT_FLUSH__NOCHECK(float16_input_flush__nocheck, float16)
 GEN_INPUT_FLUSH__NOCHECK(float32_input_flush__nocheck, float32)
 GEN_INPUT_FLUSH__NOCHECK(float64_input_flush__nocheck, float64)
 #undef GEN_INPUT_FLUSH__NOCHECK
@@ -149,6 +150,7 @@ GEN_INPUT_FLUSH__NOCHECK(float64_input_flush__nocheck, float64)
         soft_t ## _input_flush__nocheck(a, s);          \
     }
 
+GEN_INPUT_FLUSH1(float16_input_flush1, float16)
 GEN_INPUT_FLUSH1(float32_input_flush1, float32)
 GEN_INPUT_FLUSH1(float64_input_flush1, float64)
 #undef GEN_INPUT_FLUSH1
@@ -163,6 +165,7 @@ GEN_INPUT_FLUSH1(float64_input_flush1, float64)
         soft_t ## _input_flush__nocheck(b, s);                          \
     }
 
+GEN_INPUT_FLUSH2(float16_input_flush2, float16)
 GEN_INPUT_FLUSH2(float32_input_flush2, float32)
 GEN_INPUT_FLUSH2(float64_input_flush2, float64)
 #undef GEN_INPUT_FLUSH2
@@ -414,6 +417,172 @@ float64_gen2(float64 xa, float64 xb, float_status *s,
     return soft(ua.s, ub.s, s);
 }
 
+/*
+ * The host has no half-precision type, but float represents every float16
+ * exactly and has more than twice its precision plus two bits.  Computing
+ * an addition, subtraction, multiplication, division or square root in
+ * float and then rounding to float16 thus gives the correctly rounded
+ * result; see Figueroa, "When is double rounding innocuous?", 1995.
+ */
+typedef bool (*f16_check_fn)(float16 a, float16 b);
+typedef float16 (*soft_f16_op2_fn)(float16 a, float16 b, float_status *s);
+
+static inline bool f16_is_zon2(float16 a, float16 b)
+{
+    return float16_is_zero_or_normal(a) && float16_is_zero_or_normal(b);
+}
+
+/* Widen @a, which must be zero or normal, to float */
+static inline float f16_to_hard(float16 a)
+{
+    uint32_t x = float16_val(a);
+    union_float32 r;
+
+    r.s = make_float32((x & 0x8000) << 16);
+    if (x & 0x7fff) {
+        r.s = make_float32(float32_val(r.s) + ((x & 0x7fff) << 13) +
+                           ((127 - 15) << 23));
+    }
+    return r.h;
+}
+
+/*
+ * Round @f to float16, ties to even.  Fail unless the result is zero or
+ * normal, so that softfloat gets to raise underflow and overflow.
+ */
+static inline bool hard_to_f16(float f, float16 *r)
+{
+    union_float32 u;
+    uint32_t sign, abs;
+
+    u.h = f;
+    sign = (float32_val(u.s) >> 16) & 0x8000;
+    abs = float32_val(u.s) & 0x7fffffff;
+    if (abs == 0) {
+        *r = make_float16(sign);
+        return true;
+    }
+    /* The float16 normals are [2^-14, 2^16) before rounding */
+    if (abs < ((127 - 14) << 23) || abs >= ((127 + 16) << 23)) {
+        return false;
+    }
+    abs += 0xfff + ((abs >> 13) & 1);
+    abs = (abs >> 13) - ((127 - 15) << 10);
+    if (abs >= 0x7c00) {
+        return false;
+    }
+    *r = make_float16(sign | abs);
+    return true;
+}
+
+static inline float16
+float16_gen2(float16 a, float16 b, float_status *s,
+             hard_f32_op2_fn hard, soft_f16_op2_fn soft, f16_check_fn pre)
+{
+    float16 r;
+
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+
+    float16_input_flush2(&a, &b, s);
+    if (unlikely(!pre(a, b))) {
+        goto soft;
+    }
+    if (likely(hard_to_f16(hard(f16_to_hard(a), f16_to_hard(b)), &r))) {
+        return r;
+    }
+
+ soft:
+    return soft(a, b, s);
+}
+
+/*
+ * Round @x, which is zero or normal, to an integer with a rounding mode
+ * that C99 provides.  Unlike the other hardfloat paths this one does not
+ * rely on the guest having set inexact already: it is cheap to check.
+ * Fail if the result is outside [@lo, @hi), leaving it to softfloat to
+ * saturate it and raise invalid.
+ */
+static inline bool hard_round_to_int(double x, int rmode, double lo, double hi,
+                                     double *r, float_status *s)
+{
+    double t;
+
+    if (QEMU_NO_HARDFLOAT) {
+        return false;
+    }
+    switch (rmode) {
+    case float_round_nearest_even:
+        /* The host rounds to nearest even, see can_use_fpu() */
+        t = rint(x);
+        break;
+    case float_round_to_zero:
+        t = trunc(x);
+        break;
+    case float_round_down:
+        t = floor(x);
+        break;
+    case float_round_up:
+        t = ceil(x);
+        break;
+    default:
+        return false;
+    }
+    if (unlikely(!(t >= lo && t < hi))) {
+        return false;
+    }
+    if (t != x) {
+        s->float_exception_flags |= float_flag_inexact;
+    }
+    *r = t;
+    return true;
+}
+
+static inline bool f32_to_int_hard(float32 a, int rmode, int scale,
+                                   double lo, double hi, double *r,
+                                   float_status *s)
+{
+    union_float32 ua;
+
+    ua.s = a;
+    if (scale) {
+        return false;
+    }
+    float32_input_flush1(&ua.s, s);
+    return likely(float32_is_zero_or_normal(ua.s)) &&
+           hard_round_to_int(ua.h, rmode, lo, hi, r, s);
+}
+
+static inline bool f64_to_int_hard(float64 a, int rmode, int scale,
+                                   double lo, double hi, double *r,
+                                   float_status *s)
+{
+    union_float64 ua;
+
+    ua.s = a;
+    if (scale) {
+        return false;
+    }
+    float64_input_flush1(&ua.s, s);
+    return likely(float64_is_zero_or_normal(ua.s)) &&
+           hard_round_to_int(ua.h, rmode, lo, hi, r, s);
+}
+
+/*
+ * Whether the host can convert an integer of magnitude @mag to a format
+ * with @bits of precision: always if that is exact, otherwise only when
+ * the host rounding matches and inexact is already set.
+ */
+static inline bool hard_from_int_ok(uint64_t mag, int bits, int scale,
+                                    float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT || scale) {
+        return false;
+    }
+    return mag <= (1ull << bits) || can_use_fpu(s);
+}
+
 /*----------------------------------------------------------------------------
 | Returns the fraction bits of the half-precision floating-point value `a'.
 *----------------------------------------------------------------------------*/
@@ -1055,22 +1224,24 @@ static FloatParts addsub_floats(FloatParts a, FloatParts b, bool subtract,
  * IEC/IEEE Standard for Binary Floating-Point Arithmetic.
  */
 
-float16 QEMU_FLATTEN float16_add(float16 a, float16 b, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_addsub(float16 a, float16 b, bool subtract, float_status *status)
 {
     FloatParts pa = float16_unpack_canonical(a, status);
     FloatParts pb = float16_unpack_canonical(b, status);
-    FloatParts pr = addsub_floats(pa, pb, false, status);
+    FloatParts pr = addsub_floats(pa, pb, subtract, status);
 
     return float16_round_pack_canonical(pr, status);
 }
 
-float16 QEMU_FLATTEN float16_sub(float16 a, float16 b, float_status *status)
+static inline float16 soft_f16_add(float16 a, float16 b, float_status *status)
 {
-    FloatParts pa = float16_unpack_canonical(a, status);
-    FloatParts pb = float16_unpack_canonical(b, status);
-    FloatParts pr = addsub_floats(pa, pb, true, status);
+    return soft_f16_addsub(a, b, false, status);
+}
 
-    return float16_round_pack_canonical(pr, status);
+static inline float16 soft_f16_sub(float16 a, float16 b, float_status *status)
+{
+    return soft_f16_addsub(a, b, true, status);
 }
 
 static float32 QEMU_SOFTFLOAT_ATTR
@@ -1188,6 +1359,18 @@ float64_sub(float64 a, float64 b, float_status *s)
     return float64_addsub(a, b, s, hard_f64_sub, soft_f64_sub);
 }
 
+float16 QEMU_FLATTEN
+float16_add(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_add, soft_f16_add, f16_is_zon2);
+}
+
+float16 QEMU_FLATTEN
+float16_sub(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_sub, soft_f16_sub, f16_is_zon2);
+}
+
 /*
  * Returns the result of multiplying the floating-point values `a' and
  * `b'. The operation is performed according to the IEC/IEEE Standard
@@ -1237,7 +1420,8 @@ static FloatParts mul_floats(FloatParts a, FloatParts b, float_status *s)
     g_assert_not_reached();
 }
 
-float16 QEMU_FLATTEN float16_mul(float16 a, float16 b, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_mul(float16 a, float16 b, float_status *status)
 {
     FloatParts pa = float16_unpack_canonical(a, status);
     FloatParts pb = float16_unpack_canonical(b, status);
@@ -1314,6 +1498,12 @@ float64_mul(float64 a, float64 b, float_status *s)
                         f64_is_zon2, NULL, f64_mul_fast_test, f64_mul_fast_op);
 }
 
+float16 QEMU_FLATTEN
+float16_mul(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_mul, soft_f16_mul, f16_is_zon2);
+}
+
 /*
  * Returns the result of multiplying the floating-point values `a' and
  * `b' then adding 'c', with no intermediate rounding step after the
@@ -1775,7 +1965,8 @@ static FloatParts div_floats(FloatParts a, FloatParts b, float_status *s)
     g_assert_not_reached();
 }
 
-float16 float16_div(float16 a, float16 b, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_div(float16 a, float16 b, float_status *status)
 {
     FloatParts pa = float16_unpack_canonical(a, status);
     FloatParts pb = float16_unpack_canonical(b, status);
@@ -1832,6 +2023,11 @@ static bool f64_div_pre(union_float64 a, union_float64 b)
     return float64_is_zero_or_normal(a.s) && float64_is_normal(b.s);
 }
 
+static bool f16_div_pre(float16 a, float16 b)
+{
+    return float16_is_zero_or_normal(a) && float16_is_normal(b);
+}
+
 static bool f32_div_post(union_float32 a, union_float32 b)
 {
     if (QEMU_HARDFLOAT_2F32_USE_FP) {
@@ -1862,6 +2058,12 @@ float64_div(float64 a, float64 b, float_status *s)
                         f64_div_pre, f64_div_post, NULL, NULL);
 }
 
+float16 QEMU_FLATTEN
+float16_div(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_div, soft_f16_div, f16_div_pre);
+}
+
 /*
  * Float to Float conversions
  *
@@ -1917,8 +2119,20 @@ static FloatParts float_to_float(FloatParts a, const FloatFmt *dstf,
 float32 float16_to_float32(float16 a, bool ieee, float_status *s)
 {
     const FloatFmt *fmt16 = ieee ? &float16_params : &float16_params_ahp;
-    FloatParts p = float16a_unpack_canonical(a, s, fmt16);
-    FloatParts pr = float_to_float(p, &float32_params, s);
+    FloatParts p, pr;
+
+    if (likely(ieee) && !QEMU_NO_HARDFLOAT) {
+        float16_input_flush1(&a, s);
+        if (likely(float16_is_zero_or_normal(a))) {
+            union_float32 ur;
+
+            ur.h = f16_to_hard(a);
+            return ur.s;
+        }
+    }
+
+    p = float16a_unpack_canonical(a, s, fmt16);
+    pr = float_to_float(p, &float32_params, s);
     return float32_round_pack_canonical(pr, s);
 }
 
@@ -1933,18 +2147,55 @@ float64 float16_to_float64(float16 a, bool ieee, float_status *s)
 float16 float32_to_float16(float32 a, bool ieee, float_status *s)
 {
     const FloatFmt *fmt16 = ieee ? &float16_params : &float16_params_ahp;
-    FloatParts p = float32_unpack_canonical(a, s);
-    FloatParts pr = float_to_float(p, fmt16, s);
+    FloatParts p, pr;
+
+    if (likely(ieee) && can_use_fpu(s)) {
+        union_float32 ua;
+        float16 r;
+
+        ua.s = a;
+        float32_input_flush1(&ua.s, s);
+        if (likely(float32_is_zero_or_normal(ua.s)) &&
+            likely(hard_to_f16(ua.h, &r))) {
+            return r;
+        }
+        a = ua.s;
+    }
+
+    p = float32_unpack_canonical(a, s);
+    pr = float_to_float(p, fmt16, s);
     return float16a_round_pack_canonical(pr, s, fmt16);
 }
 
-float64 float32_to_float64(float32 a, float_status *s)
+static float64 QEMU_SOFTFLOAT_ATTR
+soft_float32_to_float64(float32 a, float_status *s)
 {
     FloatParts p = float32_unpack_canonical(a, s);
     FloatParts pr = float_to_float(p, &float64_params, s);
     return float64_round_pack_canonical(pr, s);
 }
 
+float64 float32_to_float64(float32 a, float_status *s)
+{
+    union_float32 ua;
+    union_float64 ur;
+
+    ua.s = a;
+    if (QEMU_NO_HARDFLOAT) {
+        goto soft;
+    }
+
+    /* Widening is exact, so it never raises a flag for zeros and normals */
+    float32_input_flush1(&ua.s, s);
+    if (likely(float32_is_zero_or_normal(ua.s))) {
+        ur.h = ua.h;
+        return ur.s;
+    }
+
+ soft:
+    return soft_float32_to_float64(ua.s, s);
+}
+
 float16 float64_to_float16(float64 a, bool ieee, float_status *s)
 {
     const FloatFmt *fmt16 = ieee ? &float16_params : &float16_params_ahp;
@@ -1953,13 +2204,40 @@ float16 float64_to_float16(float64 a, bool ieee, float_status *s)
     return float16a_round_pack_canonical(pr, s, fmt16);
 }
 
-float32 float64_to_float32(float64 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_float64_to_float32(float64 a, float_status *s)
 {
     FloatParts p = float64_unpack_canonical(a, s);
     FloatParts pr = float_to_float(p, &float32_params, s);
     return float32_round_pack_canonical(pr, s);
 }
 
+float32 float64_to_float32(float64 a, float_status *s)
+{
+    union_float64 ua;
+    union_float32 ur;
+
+    ua.s = a;
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+
+    float64_input_flush1(&ua.s, s);
+    if (unlikely(!float64_is_zero_or_normal(ua.s))) {
+        goto soft;
+    }
+    ur.h = ua.h;
+    if (unlikely(f32_is_inf(ur))) {
+        s->float_exception_flags |= float_flag_overflow;
+    } else if (unlikely(fabsf(ur.h) <= FLT_MIN) && !float64_is_zero(ua.s)) {
+        goto soft;
+    }
+    return ur.s;
+
+ soft:
+    return soft_float64_to_float32(ua.s, s);
+}
+
 /*
  * Rounds the floating-point value `a' to an integer, and returns the
  * result as a floating-point value. The operation is performed
@@ -2077,15 +2355,41 @@ float16 float16_round_to_int(float16 a, float_status *s)
 
 float32 float32_round_to_int(float32 a, float_status *s)
 {
-    FloatParts pa = float32_unpack_canonical(a, s);
-    FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
+    union_float32 ua;
+    FloatParts pa, pr;
+    double r;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (likely(float32_is_zero_or_normal(ua.s)) &&
+        hard_round_to_int(ua.h, s->float_rounding_mode, -INFINITY, INFINITY,
+                          &r, s)) {
+        ua.h = r;
+        return ua.s;
+    }
+
+    pa = float32_unpack_canonical(ua.s, s);
+    pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float32_round_pack_canonical(pr, s);
 }
 
 float64 float64_round_to_int(float64 a, float_status *s)
 {
-    FloatParts pa = float64_unpack_canonical(a, s);
-    FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
+    union_float64 ua;
+    FloatParts pa, pr;
+    double r;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (likely(float64_is_zero_or_normal(ua.s)) &&
+        hard_round_to_int(ua.h, s->float_rounding_mode, -INFINITY, INFINITY,
+                          &r, s)) {
+        ua.h = r;
+        return ua.s;
+    }
+
+    pa = float64_unpack_canonical(ua.s, s);
+    pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float64_round_pack_canonical(pr, s);
 }
 
@@ -2170,6 +2474,12 @@ int64_t float16_to_int64_scalbn(float16 a, int rmode, int scale,
 int16_t float32_to_int16_scalbn(float32 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, INT16_MIN, -(double)INT16_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float32_unpack_canonical(a, s),
                                  rmode, scale, INT16_MIN, INT16_MAX, s);
 }
@@ -2177,6 +2487,12 @@ int16_t float32_to_int16_scalbn(float32 a, int rmode, int scale,
 int32_t float32_to_int32_scalbn(float32 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, INT32_MIN, -(double)INT32_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float32_unpack_canonical(a, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -2184,6 +2500,12 @@ int32_t float32_to_int32_scalbn(float32 a, int rmode, int scale,
 int64_t float32_to_int64_scalbn(float32 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, INT64_MIN, -(double)INT64_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float32_unpack_canonical(a, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -2191,6 +2513,12 @@ int64_t float32_to_int64_scalbn(float32 a, int rmode, int scale,
 int16_t float64_to_int16_scalbn(float64 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, INT16_MIN, -(double)INT16_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float64_unpack_canonical(a, s),
                                  rmode, scale, INT16_MIN, INT16_MAX, s);
 }
@@ -2198,6 +2526,12 @@ int16_t float64_to_int16_scalbn(float64 a, int rmode, int scale,
 int32_t float64_to_int32_scalbn(float64 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, INT32_MIN, -(double)INT32_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float64_unpack_canonical(a, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -2205,6 +2539,12 @@ int32_t float64_to_int32_scalbn(float64 a, int rmode, int scale,
 int64_t float64_to_int64_scalbn(float64 a, int rmode, int scale,
                                 float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, INT64_MIN, -(double)INT64_MIN,
+                        &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float64_unpack_canonical(a, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -2382,6 +2722,11 @@ uint64_t float16_to_uint64_scalbn(float16 a, int rmode, int scale,
 uint16_t float32_to_uint16_scalbn(float32 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, 0, UINT16_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float32_unpack_canonical(a, s),
                                   rmode, scale, UINT16_MAX, s);
 }
@@ -2389,6 +2734,11 @@ uint16_t float32_to_uint16_scalbn(float32 a, int rmode, int scale,
 uint32_t float32_to_uint32_scalbn(float32 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, 0, UINT32_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float32_unpack_canonical(a, s),
                                   rmode, scale, UINT32_MAX, s);
 }
@@ -2396,6 +2746,11 @@ uint32_t float32_to_uint32_scalbn(float32 a, int rmode, int scale,
 uint64_t float32_to_uint64_scalbn(float32 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f32_to_int_hard(a, rmode, scale, 0, UINT64_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float32_unpack_canonical(a, s),
                                   rmode, scale, UINT64_MAX, s);
 }
@@ -2403,6 +2758,11 @@ uint64_t float32_to_uint64_scalbn(float32 a, int rmode, int scale,
 uint16_t float64_to_uint16_scalbn(float64 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, 0, UINT16_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float64_unpack_canonical(a, s),
                                   rmode, scale, UINT16_MAX, s);
 }
@@ -2410,6 +2770,11 @@ uint16_t float64_to_uint16_scalbn(float64 a, int rmode, int scale,
 uint32_t float64_to_uint32_scalbn(float64 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, 0, UINT32_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float64_unpack_canonical(a, s),
                                   rmode, scale, UINT32_MAX, s);
 }
@@ -2417,6 +2782,11 @@ uint32_t float64_to_uint32_scalbn(float64 a, int rmode, int scale,
 uint64_t float64_to_uint64_scalbn(float64 a, int rmode, int scale,
                                   float_status *s)
 {
+    double r;
+
+    if (f64_to_int_hard(a, rmode, scale, 0, UINT64_MAX + 1.0, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float64_unpack_canonical(a, s),
                                   rmode, scale, UINT64_MAX, s);
 }
@@ -2577,7 +2947,15 @@ float16 int16_to_float16(int16_t a, float_status *status)
 
 float32 int64_to_float32_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    union_float32 ur;
+    FloatParts pa;
+
+    if (hard_from_int_ok(a < 0 ? -(uint64_t)a : a, 24, scale, status)) {
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2608,7 +2986,15 @@ float32 int16_to_float32(int16_t a, float_status *status)
 
 float64 int64_to_float64_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    union_float64 ur;
+    FloatParts pa;
+
+    if (hard_from_int_ok(a < 0 ? -(uint64_t)a : a, 53, scale, status)) {
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2702,7 +3088,15 @@ float16 uint16_to_float16(uint16_t a, float_status *status)
 
 float32 uint64_to_float32_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    union_float32 ur;
+    FloatParts pa;
+
+    if (hard_from_int_ok(a, 24, scale, status)) {
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2733,7 +3127,15 @@ float32 uint16_to_float32(uint16_t a, float_status *status)
 
 float64 uint64_to_float64_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    union_float64 ur;
+    FloatParts pa;
+
+    if (hard_from_int_ok(a, 53, scale, status)) {
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2849,9 +3251,10 @@ static FloatParts minmax_floats(FloatParts a, FloatParts b, bool ismin,
     }
 }
 
-#define MINMAX(sz, name, ismin, isiee, ismag)                           \
-float ## sz float ## sz ## _ ## name(float ## sz a, float ## sz b,      \
-                                     float_status *s)                   \
+#define SOFT_MINMAX(name, attr, sz)                                     \
+static float ## sz attr                                                 \
+name(float ## sz a, float ## sz b, bool ismin, bool isiee, bool ismag,  \
+     float_status *s)                                                   \
 {                                                                       \
     FloatParts pa = float ## sz ## _unpack_canonical(a, s);             \
     FloatParts pb = float ## sz ## _unpack_canonical(b, s);             \
@@ -2860,6 +3263,91 @@ float ## sz float ## sz ## _ ## name(float ## sz a, float ## sz b,      \
     return float ## sz ## _round_pack_canonical(pr, s);                 \
 }
 
+/* float16 has no hardfloat version, so its soft one is called directly */
+SOFT_MINMAX(f16_minmax, QEMU_FLATTEN, 16)
+SOFT_MINMAX(soft_f32_minmax, QEMU_SOFTFLOAT_ATTR, 32)
+SOFT_MINMAX(soft_f64_minmax, QEMU_SOFTFLOAT_ATTR, 64)
+
+#undef SOFT_MINMAX
+
+/*
+ * Without NaNs, and unless both inputs are zeros whose signs may differ,
+ * all flavours of min and max come down to a host comparison.  Denormals
+ * are left to softfloat, since its result is subject to flush_to_zero.
+ */
+static float32 QEMU_FLATTEN
+f32_minmax(float32 a, float32 b, bool ismin, bool isiee, bool ismag,
+           float_status *s)
+{
+    union_float32 ua, ub;
+
+    ua.s = a;
+    ub.s = b;
+
+    if (QEMU_NO_HARDFLOAT) {
+        goto soft;
+    }
+
+    float32_input_flush2(&ua.s, &ub.s, s);
+    if (likely((float32_is_zero_or_normal(ua.s) ||
+                float32_is_infinity(ua.s)) &&
+               (float32_is_zero_or_normal(ub.s) ||
+                float32_is_infinity(ub.s)) &&
+               !(float32_is_zero(ua.s) && float32_is_zero(ub.s)))) {
+        float fa = ua.h;
+        float fb = ub.h;
+
+        if (ismag && fabsf(fa) != fabsf(fb)) {
+            fa = fabsf(fa);
+            fb = fabsf(fb);
+        }
+        return (fa < fb) ^ ismin ? ub.s : ua.s;
+    }
+
+ soft:
+    return soft_f32_minmax(ua.s, ub.s, ismin, isiee, ismag, s);
+}
+
+static float64 QEMU_FLATTEN
+f64_minmax(float64 a, float64 b, bool ismin, bool isiee, bool ismag,
+           float_status *s)
+{
+    union_float64 ua, ub;
+
+    ua.s = a;
+    ub.s = b;
+
+    if (QEMU_NO_HARDFLOAT) {
+        goto soft;
+    }
+
+    float64_input_flush2(&ua.s, &ub.s, s);
+    if (likely((float64_is_zero_or_normal(ua.s) ||
+                float64_is_infinity(ua.s)) &&
+               (float64_is_zero_or_normal(ub.s) ||
+                float64_is_infinity(ub.s)) &&
+               !(float64_is_zero(ua.s) && float64_is_zero(ub.s)))) {
+        double da = ua.h;
+        double db = ub.h;
+
+        if (ismag && fabs(da) != fabs(db)) {
+            da = fabs(da);
+            db = fabs(db);
+        }
+        return (da < db) ^ ismin ? ub.s : ua.s;
+    }
+
+ soft:
+    return soft_f64_minmax(ua.s, ub.s, ismin, isiee, ismag, s);
+}
+
+#define MINMAX(sz, name, ismin, isiee, ismag)                           \
+float ## sz float ## sz ## _ ## name(float ## sz a, float ## sz b,      \
+                                     float_status *s)                   \
+{                                                                       \
+    return f ## sz ## _minmax(a, b, ismin, isiee, ismag, s);            \
+}
+
 MINMAX(16, min, true, false, false)
 MINMAX(16, minnum, true, true, false)
 MINMAX(16, minnummag, true, true, true)
@@ -3156,7 +3644,8 @@ static FloatParts sqrt_float(FloatParts a, float_status *s, const FloatFmt *p)
     return a;
 }
 
-float16 QEMU_FLATTEN float16_sqrt(float16 a, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_sqrt(float16 a, float_status *status)
 {
     FloatParts pa = float16_unpack_canonical(a, status);
     FloatParts pr = sqrt_float(pa, status, &float16_params);
@@ -3233,6 +3722,26 @@ float64 QEMU_FLATTEN float64_sqrt(float64 xa, float_status *s)
     return soft_f64_sqrt(ua.s, s);
 }
 
+float16 QEMU_FLATTEN float16_sqrt(float16 a, float_status *s)
+{
+    float16 r;
+
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+
+    float16_input_flush1(&a, s);
+    if (unlikely(!float16_is_zero_or_normal(a) || float16_is_neg(a))) {
+        goto soft;
+    }
+    if (likely(hard_to_f16(sqrtf(f16_to_hard(a)), &r))) {
+        return r;
+    }
+
+ soft:
+    return soft_f16_sqrt(a, s);
+}
+
 /*----------------------------------------------------------------------------
 | The pattern for a default generated NaN.
 *----------------------------------------------------------------------------*/
@@ -29,6 +29,7 @@
 #include "qapi/error.h"
 #include "qemu/timer.h"
 #include "qemu/error-report.h"
+#include "qemu/main-loop.h"
 #include "trace.h"
 
 //#define DEBUG_SERIAL
@@ -105,7 +106,7 @@ do { fprintf(stderr, "serial: " fmt , ## __VA_ARGS__); } while (0)
 do {} while (0)
 #endif
 
-static void serial_receive1(void *opaque, const uint8_t *buf, int size);
+static void serial_receive(SerialState *s, const uint8_t *buf, int size);
 static void serial_xmit(SerialState *s);
 
 static inline void recv_fifo_put(SerialState *s, uint8_t chr)
@@ -225,12 +226,24 @@ static void serial_update_msl(SerialState *s)
     }
 }
 
+static void serial_update_msl_cb(void *opaque)
+{
+    SerialState *s = opaque;
+
+    qemu_mutex_lock(&s->lock);
+    serial_update_msl(s);
+    qemu_mutex_unlock(&s->lock);
+}
+
 static gboolean serial_watch_cb(GIOChannel *chan, GIOCondition cond,
                                 void *opaque)
 {
     SerialState *s = opaque;
+
+    qemu_mutex_lock(&s->lock);
     s->watch_tag = 0;
     serial_xmit(s);
+    qemu_mutex_unlock(&s->lock);
     return FALSE;
 }
 
@@ -259,7 +272,7 @@ static void serial_xmit(SerialState *s)
 
         if (s->mcr & UART_MCR_LOOP) {
             /* in loopback mode, say that we just received a char */
-            serial_receive1(s, &s->tsr, 1);
+            serial_receive(s, &s->tsr, 1);
         } else {
             int rc = qemu_chr_fe_write(&s->chr, &s->tsr, 1);
 
@@ -334,11 +347,9 @@ static void serial_update_tiocm(SerialState *s)
     qemu_chr_fe_ioctl(&s->chr, CHR_IOCTL_SERIAL_SET_TIOCM, &flags);
 }
 
-static void serial_ioport_write(void *opaque, hwaddr addr, uint64_t val,
-                                unsigned size)
+static void serial_write(SerialState *s, hwaddr addr, uint64_t val,
+                         unsigned size)
 {
-    SerialState *s = opaque;
-
     addr &= 7;
     trace_serial_ioport_write(addr, val);
     switch(addr) {
@@ -475,9 +486,8 @@ static void serial_ioport_write(void *opaque, hwaddr addr, uint64_t val,
     }
 }
 
-static uint64_t serial_ioport_read(void *opaque, hwaddr addr, unsigned size)
+static uint64_t serial_read(SerialState *s, hwaddr addr, unsigned size)
 {
-    SerialState *s = opaque;
     uint32_t ret;
 
     addr &= 7;
@@ -503,7 +513,7 @@ static uint64_t serial_ioport_read(void *opaque, hwaddr addr, unsigned size)
             serial_update_irq(s);
             if (!(s->mcr & UART_MCR_LOOP)) {
                 /* in loopback mode, don't receive any data */
-                qemu_chr_fe_accept_input(&s->chr);
+                qemu_bh_schedule(s->accept_input_bh);
             }
         }
         break;
@@ -561,6 +571,38 @@ static uint64_t serial_ioport_read(void *opaque, hwaddr addr, unsigned size)
     return ret;
 }
 
+static void serial_ioport_write(void *opaque, hwaddr addr, uint64_t val,
+                                unsigned size)
+{
+    SerialState *s = opaque;
+
+    qemu_mutex_lock(&s->lock);
+    serial_write(s, addr, val, size);
+    qemu_mutex_unlock(&s->lock);
+}
+
+static uint64_t serial_ioport_read(void *opaque, hwaddr addr, unsigned size)
+{
+    SerialState *s = opaque;
+    uint64_t ret;
+
+    qemu_mutex_lock(&s->lock);
+    ret = serial_read(s, addr, size);
+    qemu_mutex_unlock(&s->lock);
+    return ret;
+}
+
+/*
+ * The chardev front-end may call back into serial_receive1 and needs the
+ * BQL, so let the main loop tell it that there is room for more input.
+ */
+static void serial_accept_input(void *opaque)
+{
+    SerialState *s = opaque;
+
+    qemu_chr_fe_accept_input(&s->chr);
+}
+
 static int serial_can_receive(SerialState *s)
 {
     if(s->fcr & UART_FCR_FE) {
@@ -594,25 +636,27 @@ static void serial_receive_break(SerialState *s)
 /* There's data in recv_fifo and s->rbr has not been read for 4 char transmit times */
 static void fifo_timeout_int (void *opaque) {
     SerialState *s = opaque;
+    qemu_mutex_lock(&s->lock);
     if (s->recv_fifo.num) {
         s->timeout_ipending = 1;
         serial_update_irq(s);
     }
+    qemu_mutex_unlock(&s->lock);
 }
 
 static int serial_can_receive1(void *opaque)
 {
     SerialState *s = opaque;
-    return serial_can_receive(s);
+    int ret;
+
+    qemu_mutex_lock(&s->lock);
+    ret = serial_can_receive(s);
+    qemu_mutex_unlock(&s->lock);
+    return ret;
 }
 
-static void serial_receive1(void *opaque, const uint8_t *buf, int size)
+static void serial_receive(SerialState *s, const uint8_t *buf, int size)
 {
-    SerialState *s = opaque;
-
-    if (s->wakeup) {
-        qemu_system_wakeup_request(QEMU_WAKEUP_REASON_OTHER, NULL);
-    }
     if(s->fcr & UART_FCR_FE) {
         int i;
         for (i = 0; i < size; i++) {
@@ -630,12 +674,27 @@ static void serial_receive1(void *opaque, const uint8_t *buf, int size)
     serial_update_irq(s);
 }
 
+static void serial_receive1(void *opaque, const uint8_t *buf, int size)
+{
+    SerialState *s = opaque;
+
+    if (s->wakeup) {
+        qemu_system_wakeup_request(QEMU_WAKEUP_REASON_OTHER, NULL);
+    }
+    qemu_mutex_lock(&s->lock);
+    serial_receive(s, buf, size);
+    qemu_mutex_unlock(&s->lock);
+}
+
 static void serial_event(void *opaque, int event)
 {
     SerialState *s = opaque;
     DPRINTF("event %x\n", event);
-    if (event == CHR_EVENT_BREAK)
+    if (event == CHR_EVENT_BREAK) {
+        qemu_mutex_lock(&s->lock);
         serial_receive_break(s);
+        qemu_mutex_unlock(&s->lock);
+    }
 }
 
 static int serial_pre_save(void *opaque)
@@ -865,6 +924,7 @@ static void serial_reset(void *opaque)
 {
     SerialState *s = opaque;
 
+    qemu_mutex_lock(&s->lock);
     if (s->watch_tag > 0) {
         g_source_remove(s->watch_tag);
         s->watch_tag = 0;
@@ -899,6 +959,7 @@ static void serial_reset(void *opaque)
 
     serial_update_msl(s);
     s->msr &= ~UART_MSR_ANY_DELTA;
+    qemu_mutex_unlock(&s->lock);
 }
 
 static int serial_be_change(void *opaque)
@@ -908,6 +969,7 @@ static int serial_be_change(void *opaque)
     qemu_chr_fe_set_handlers(&s->chr, serial_can_receive1, serial_receive1,
                              serial_event, serial_be_change, s, NULL, true);
 
+    qemu_mutex_lock(&s->lock);
     serial_update_parameters(s);
 
     qemu_chr_fe_ioctl(&s->chr, CHR_IOCTL_SERIAL_SET_BREAK,
@@ -925,13 +987,18 @@ static int serial_be_change(void *opaque)
         s->watch_tag = qemu_chr_fe_add_watch(&s->chr, G_IO_OUT | G_IO_HUP,
                                              serial_watch_cb, s);
     }
+    qemu_mutex_unlock(&s->lock);
 
     return 0;
 }
 
 void serial_realize_core(SerialState *s, Error **errp)
 {
-    s->modem_status_poll = timer_new_ns(QEMU_CLOCK_VIRTUAL, (QEMUTimerCB *) serial_update_msl, s);
+    qemu_mutex_init(&s->lock);
+    s->accept_input_bh = qemu_bh_new(serial_accept_input, s);
+
+    s->modem_status_poll = timer_new_ns(QEMU_CLOCK_VIRTUAL,
+                                        serial_update_msl_cb, s);
 
     s->fifo_timeout_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, (QEMUTimerCB *) fifo_timeout_int, s);
     qemu_register_reset(serial_reset, s);
@@ -957,13 +1024,23 @@ void serial_exit_core(SerialState *s)
     fifo8_destroy(&s->xmit_fifo);
 
     qemu_unregister_reset(serial_reset, s);
+
+    qemu_bh_delete(s->accept_input_bh);
+    qemu_mutex_destroy(&s->lock);
 }
 
 /* Change the main reference oscillator frequency. */
 void serial_set_frequency(SerialState *s, uint32_t frequency)
 {
+    qemu_mutex_lock(&s->lock);
     s->baudbase = frequency;
     serial_update_parameters(s);
+    qemu_mutex_unlock(&s->lock);
+}
+
+void serial_set_lockless(SerialState *s)
+{
+    memory_region_clear_global_locking(&s->io);
 }
 
 const MemoryRegionOps serial_io_ops = {
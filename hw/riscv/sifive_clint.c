@@ -83,7 +83,7 @@ static uint64_t sifive_clint_read(void *opaque, hwaddr addr, unsigned size)
         if (!env) {
             error_report("clint: invalid timecmp hartid: %zu", hartid);
         } else if ((addr & 0x3) == 0) {
-            return (env->mip & MIP_MSIP) > 0;
+            return (atomic_read(&env->mip) & MIP_MSIP) > 0;
         } else {
             error_report("clint: invalid read: %08x", (uint32_t)addr);
             return 0;
@@ -197,6 +197,13 @@ static void sifive_clint_realize(DeviceState *dev, Error **errp)
     SiFiveCLINTState *s = SIFIVE_CLINT(dev);
     memory_region_init_io(&s->mmio, OBJECT(dev), &sifive_clint_ops, s,
                           TYPE_SIFIVE_CLINT, s->aperture_size);
+    /*
+     * Timer and IPI accesses are the hottest MMIO of SMP guests, keep
+     * them off the BQL: riscv_cpu_update_mip and timer_mod are thread
+     * safe, and the timer callback does not touch the device state.
+     */
+    qemu_mutex_init(&s->lock);
+    memory_region_set_lock(&s->mmio, &s->lock);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->mmio);
 }
 
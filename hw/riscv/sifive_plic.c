@@ -163,14 +163,18 @@ static void sifive_plic_update(SiFivePLICState *plic)
 
 void sifive_plic_raise_irq(SiFivePLICState *plic, uint32_t irq)
 {
+    qemu_mutex_lock(&plic->lock);
     sifive_plic_set_pending(plic, irq, true);
     sifive_plic_update(plic);
+    qemu_mutex_unlock(&plic->lock);
 }
 
 void sifive_plic_lower_irq(SiFivePLICState *plic, uint32_t irq)
 {
+    qemu_mutex_lock(&plic->lock);
     sifive_plic_set_pending(plic, irq, false);
     sifive_plic_update(plic);
+    qemu_mutex_unlock(&plic->lock);
 }
 
 static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
@@ -434,8 +438,10 @@ static void sifive_plic_irq_request(void *opaque, int irq, int level)
     if (RISCV_DEBUG_PLIC) {
         qemu_log("sifive_plic_irq_request: irq=%d level=%d\n", irq, level);
     }
+    qemu_mutex_lock(&plic->lock);
     sifive_plic_set_pending(plic, irq, level > 0);
     sifive_plic_update(plic);
+    qemu_mutex_unlock(&plic->lock);
 }
 
 static void sifive_plic_realize(DeviceState *dev, Error **errp)
@@ -447,6 +453,13 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
 
     memory_region_init_io(&plic->mmio, OBJECT(dev), &sifive_plic_ops, plic,
                           TYPE_SIFIVE_PLIC, plic->aperture_size);
+    /*
+     * Claims and completions need not wait for the BQL.  Interrupt
+     * sources call in with their own lock or the BQL held, and the
+     * PLIC only calls out to riscv_cpu_update_mip, which takes no lock.
+     */
+    qemu_mutex_init(&plic->lock);
+    memory_region_set_lock(&plic->mmio, &plic->lock);
     parse_hart_config(plic);
     plic->bitfield_words = (plic->num_sources + 31) >> 5;
     plic->source_priority = g_new0(uint32_t, plic->num_sources);
@@ -18,6 +18,7 @@
 
 #include "qemu/osdep.h"
 #include "qapi/error.h"
+#include "qemu/main-loop.h"
 #include "hw/sysbus.h"
 #include "chardev/char.h"
 #include "chardev/char-fe.h"
@@ -73,7 +74,7 @@ uart_read(void *opaque, hwaddr addr, unsigned int size)
             r = s->rx_fifo[0];
             memmove(s->rx_fifo, s->rx_fifo + 1, s->rx_fifo_len - 1);
             s->rx_fifo_len--;
-            qemu_chr_fe_accept_input(&s->chr);
+            qemu_bh_schedule(s->accept_input_bh);
             update_irq(s);
             return r;
         }
@@ -139,25 +140,41 @@ static const MemoryRegionOps uart_ops = {
     }
 };
 
+/*
+ * The chardev front-end may call back into uart_rx and needs the BQL,
+ * so let the main loop tell it that the FIFO has room again.
+ */
+static void uart_accept_input(void *opaque)
+{
+    SiFiveUARTState *s = opaque;
+
+    qemu_chr_fe_accept_input(&s->chr);
+}
+
 static void uart_rx(void *opaque, const uint8_t *buf, int size)
 {
     SiFiveUARTState *s = opaque;
 
+    qemu_mutex_lock(&s->lock);
     /* Got a byte.  */
     if (s->rx_fifo_len >= sizeof(s->rx_fifo)) {
         printf("WARNING: UART dropped char.\n");
-        return;
+    } else {
+        s->rx_fifo[s->rx_fifo_len++] = *buf;
+        update_irq(s);
     }
-    s->rx_fifo[s->rx_fifo_len++] = *buf;
-
-    update_irq(s);
+    qemu_mutex_unlock(&s->lock);
 }
 
 static int uart_can_rx(void *opaque)
 {
     SiFiveUARTState *s = opaque;
+    int ret;
 
-    return s->rx_fifo_len < sizeof(s->rx_fifo);
+    qemu_mutex_lock(&s->lock);
+    ret = s->rx_fifo_len < sizeof(s->rx_fifo);
+    qemu_mutex_unlock(&s->lock);
+    return ret;
 }
 
 static void uart_event(void *opaque, int event)
@@ -182,11 +199,15 @@ SiFiveUARTState *sifive_uart_create(MemoryRegion *address_space, hwaddr base,
 {
     SiFiveUARTState *s = g_malloc0(sizeof(SiFiveUARTState));
     s->irq = irq;
+    qemu_mutex_init(&s->lock);
+    s->accept_input_bh = qemu_bh_new(uart_accept_input, s);
     qemu_chr_fe_init(&s->chr, chr, &error_abort);
     qemu_chr_fe_set_handlers(&s->chr, uart_can_rx, uart_rx, uart_event,
         uart_be_change, s, NULL, true);
     memory_region_init_io(&s->mmio, NULL, &uart_ops, s,
                           TYPE_SIFIVE_UART, SIFIVE_UART_MAX);
+    /* Console output must not serialize the vCPUs on the BQL */
+    memory_region_set_lock(&s->mmio, &s->lock);
     memory_region_add_subregion(address_space, base, &s->mmio);
     return s;
 }
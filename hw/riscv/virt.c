@@ -374,6 +374,7 @@ static void riscv_virt_board_init(MachineState *machine)
     MemoryRegion *system_memory = get_system_memory();
     MemoryRegion *main_mem = g_new(MemoryRegion, 1);
     MemoryRegion *mask_rom = g_new(MemoryRegion, 1);
+    SerialState *uart;
     char *plic_hart_config;
     size_t plic_hart_config_len;
     int i;
@@ -500,9 +501,11 @@ static void riscv_virt_board_init(MachineState *machine)
                          memmap[VIRT_PCIE_PIO].base,
                          DEVICE(s->plic), true);
 
-    serial_mm_init(system_memory, memmap[VIRT_UART0].base,
+    uart = serial_mm_init(system_memory, memmap[VIRT_UART0].base,
         0, qdev_get_gpio_in(DEVICE(s->plic), UART0_IRQ), 399193,
         serial_hd(0), DEVICE_LITTLE_ENDIAN);
+    /* The PLIC has its own lock, the UART need not take the BQL */
+    serial_set_lockless(uart);
 
     g_free(plic_hart_config);
 }
@@ -29,6 +29,7 @@
 #include "hw/virtio/virtio-bus.h"
 #include "qemu/error-report.h"
 #include "qemu/log.h"
+#include "qemu/main-loop.h"
 #include "trace.h"
 
 /* QOM macros */
@@ -54,6 +55,7 @@ typedef struct {
     /* Generic */
     SysBusDevice parent_obj;
     MemoryRegion iomem;
+    MemoryRegion notify;
     qemu_irq irq;
     /* Guest accessible state needing migration and reset */
     uint32_t host_features_sel;
@@ -62,11 +64,20 @@ typedef struct {
     /* virtio-bus */
     VirtioBusState bus;
     bool format_transport_address;
+    bool ioeventfd;
 } VirtIOMMIOProxy;
 
 static bool virtio_mmio_ioeventfd_enabled(DeviceState *d)
 {
-    return kvm_eventfds_enabled();
+    VirtIOMMIOProxy *proxy = VIRTIO_MMIO(d);
+
+    /*
+     * Without KVM, writes to QueueNotify are matched against the eventfds
+     * by the memory core.  This still hands the notification over to the
+     * main loop or an iothread, instead of processing the queue in the
+     * vCPU under the BQL.
+     */
+    return proxy->ioeventfd && (kvm_eventfds_enabled() || !kvm_enabled());
 }
 
 static int virtio_mmio_ioeventfd_assign(DeviceState *d,
@@ -76,11 +87,9 @@ static int virtio_mmio_ioeventfd_assign(DeviceState *d,
     VirtIOMMIOProxy *proxy = VIRTIO_MMIO(d);
 
     if (assign) {
-        memory_region_add_eventfd(&proxy->iomem, VIRTIO_MMIO_QUEUE_NOTIFY, 4,
-                                  true, n, notifier);
+        memory_region_add_eventfd(&proxy->notify, 0, 4, true, n, notifier);
     } else {
-        memory_region_del_eventfd(&proxy->iomem, VIRTIO_MMIO_QUEUE_NOTIFY, 4,
-                                  true, n, notifier);
+        memory_region_del_eventfd(&proxy->notify, 0, 4, true, n, notifier);
     }
     return 0;
 }
@@ -316,6 +325,47 @@ static const MemoryRegionOps virtio_mem_ops = {
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
+/*
+ * QueueNotify lives in its own region, which does not take the BQL, so
+ * that writes matched by an ioeventfd complete without it.  Everything
+ * else is forwarded to the main register file, under the BQL.
+ */
+static uint64_t virtio_mmio_notify_read(void *opaque, hwaddr offset,
+                                        unsigned size)
+{
+    bool locked = qemu_mutex_iothread_locked();
+    uint64_t ret;
+
+    if (!locked) {
+        qemu_mutex_lock_iothread();
+    }
+    ret = virtio_mmio_read(opaque, VIRTIO_MMIO_QUEUE_NOTIFY + offset, size);
+    if (!locked) {
+        qemu_mutex_unlock_iothread();
+    }
+    return ret;
+}
+
+static void virtio_mmio_notify_write(void *opaque, hwaddr offset,
+                                     uint64_t value, unsigned size)
+{
+    bool locked = qemu_mutex_iothread_locked();
+
+    if (!locked) {
+        qemu_mutex_lock_iothread();
+    }
+    virtio_mmio_write(opaque, VIRTIO_MMIO_QUEUE_NOTIFY + offset, value, size);
+    if (!locked) {
+        qemu_mutex_unlock_iothread();
+    }
+}
+
+static const MemoryRegionOps virtio_mmio_notify_ops = {
+    .read = virtio_mmio_notify_read,
+    .write = virtio_mmio_notify_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
 static void virtio_mmio_update_irq(DeviceState *opaque, uint16_t vector)
 {
     VirtIOMMIOProxy *proxy = VIRTIO_MMIO(opaque);
@@ -425,6 +475,7 @@ assign_error:
 static Property virtio_mmio_properties[] = {
     DEFINE_PROP_BOOL("format_transport_address", VirtIOMMIOProxy,
                      format_transport_address, true),
+    DEFINE_PROP_BOOL("ioeventfd", VirtIOMMIOProxy, ioeventfd, true),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -438,6 +489,12 @@ static void virtio_mmio_realizefn(DeviceState *d, Error **errp)
     sysbus_init_irq(sbd, &proxy->irq);
     memory_region_init_io(&proxy->iomem, OBJECT(d), &virtio_mem_ops, proxy,
                           TYPE_VIRTIO_MMIO, 0x200);
+    memory_region_init_io(&proxy->notify, OBJECT(d), &virtio_mmio_notify_ops,
+                          proxy, TYPE_VIRTIO_MMIO "-notify", 4);
+    memory_region_clear_global_locking(&proxy->notify);
+    memory_region_add_subregion_overlap(&proxy->iomem,
+                                        VIRTIO_MMIO_QUEUE_NOTIFY,
+                                        &proxy->notify, 1);
     sysbus_init_mmio(sbd, &proxy->iomem);
 }
 
@@ -80,8 +80,22 @@ typedef uint64_t target_ulong;
 
 #if !defined(CONFIG_USER_ONLY) && defined(CONFIG_TCG)
 
-/* use a fully associative victim tlb of 8 entries */
-#define CPU_VTLB_SIZE 8
+/*
+ * The victim tlb is made of 2^n sets of CPU_VTLB_WAYS entries, where n is
+ * set with "-accel tcg,victim-tlb-bits".  Entries evicted from the main
+ * tlb at index i go to set i mod 2^n.  n cannot exceed CPU_TLB_DYN_MIN_BITS,
+ * so that this does not change when the main tlb is resized.
+ */
+#define CPU_VTLB_WAYS 8
+#define CPU_VTLB_BITS_DEFAULT 2
+#define CPU_VTLB_BITS_MAX 6
+
+/* The number of large pages remembered per MMU mode, see tlb_fill_large() */
+#define CPU_TLB_LARGE_SIZE 4
+
+/* The number of buckets in the reverse map of each MMU mode */
+#define CPU_TLB_RMAP_BITS 8
+#define CPU_TLB_RMAP_SIZE (1 << CPU_TLB_RMAP_BITS)
 
 #if HOST_LONG_BITS == 32 && TARGET_LONG_BITS == 32
 #define CPU_TLB_ENTRY_BITS 4
@@ -147,8 +161,32 @@ typedef struct CPUIOTLBEntry {
      */
     hwaddr addr;
     MemTxAttrs attrs;
+    /*
+     * MMIO dispatch cache, filled in by the first io_readx()/io_writex()
+     * through this entry: the section @addr refers to, and the access
+     * sizes that can call the MemoryRegionOps callbacks directly (see
+     * memory_region_direct_access_sizes()).  @section is NULL until then.
+     */
+    MemoryRegionSection *section;
+    uint8_t direct_read;
+    uint8_t direct_write;
 } CPUIOTLBEntry;
 
+/*
+ * A page larger than TARGET_PAGE_SIZE, as returned by the target's
+ * tlb_fill.  The main tlb only holds TARGET_PAGE_SIZE entries, but the
+ * other pages in the same large page can then be entered without going
+ * through another guest page table walk.  The entry matches if
+ * (addr & mask) == vaddr.
+ */
+typedef struct CPUTLBLargeEntry {
+    target_ulong vaddr;
+    target_ulong mask;
+    hwaddr paddr;
+    MemTxAttrs attrs;
+    int prot;
+} CPUTLBLargeEntry;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
@@ -167,11 +205,23 @@ typedef struct CPUTLBDesc {
     /* maximum number of entries observed in the window */
     size_t window_max_entries;
     size_t n_used_entries;
-    /* The next index to use in the tlb victim table.  */
+    /* The next way to use in the tlb victim table.  */
     size_t vindex;
+    /* The number of sets in the tlb victim table, minus one.  */
+    size_t vmask;
     /* The tlb victim table, in two parts.  */
-    CPUTLBEntry vtable[CPU_VTLB_SIZE];
-    CPUIOTLBEntry viotlb[CPU_VTLB_SIZE];
+    CPUTLBEntry *vtable;
+    CPUIOTLBEntry *viotlb;
+    /* Large pages recently entered into the tlb, and the next to replace */
+    CPUTLBLargeEntry large[CPU_TLB_LARGE_SIZE];
+    size_t lindex;
+    /*
+     * The number of entries in the tlb and victim tlb that can write
+     * directly to RAM, by hash of the host page they write to.  Lets
+     * tlb_reset_dirty() skip the MMU modes that cannot map its range.
+     * Updated with tlb_c.lock held, read without.
+     */
+    uint32_t rmap[CPU_TLB_RMAP_SIZE];
     /* The iotlb.  */
     CPUIOTLBEntry *iotlb;
 } CPUTLBDesc;
@@ -207,6 +257,7 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t large_fill_count;
 } CPUTLBCommon;
 
 /*
@@ -24,5 +24,9 @@
 void tlb_protect_code(ram_addr_t ram_addr);
 void tlb_unprotect_code(ram_addr_t ram_addr);
 void tlb_flush_counts(size_t *full, size_t *part, size_t *elide);
+size_t tlb_large_fill_count(void);
+
+/* log2 of the number of sets in the victim tlb, see CPU_VTLB_WAYS */
+extern unsigned int tlb_victim_bits;
 #endif
 #endif
@@ -66,6 +66,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
                               uint32_t flags,
                               int cflags);
+void tb_promote(CPUState *cpu, TranslationBlock *tb);
 
 void QEMU_NORETURN cpu_loop_exit(CPUState *cpu);
 void QEMU_NORETURN cpu_loop_exit_restore(CPUState *cpu, uintptr_t pc);
@@ -225,6 +226,67 @@ void tlb_flush_by_mmuidx_all_cpus(CPUState *cpu, uint16_t idxmap);
  * depend on when the guests translation ends the TB.
  */
 void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *cpu, uint16_t idxmap);
+/**
+ * tlb_flush_range_by_mmuidx:
+ * @cpu: CPU whose TLB should be flushed
+ * @addr: virtual address of the start of the range
+ * @len: length of the range in bytes
+ * @idxmap: bitmap of MMU indexes to flush
+ *
+ * Flush the pages overlapping [@addr, @addr + @len) from the TLB of
+ * the specified CPU, for the specified MMU indexes.  When the range
+ * covers a large part of the TLB of an MMU index, that MMU index is
+ * flushed entirely instead.
+ */
+void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                               target_ulong len, uint16_t idxmap);
+/**
+ * tlb_flush_range:
+ * @cpu: CPU whose TLB should be flushed
+ * @addr: virtual address of the start of the range
+ * @len: length of the range in bytes
+ *
+ * Like tlb_flush_range_by_mmuidx, for all MMU indexes.
+ */
+void tlb_flush_range(CPUState *cpu, target_ulong addr, target_ulong len);
+/**
+ * tlb_flush_range_by_mmuidx_all_cpus:
+ * @cpu: Originating CPU of the flush
+ * @addr: virtual address of the start of the range
+ * @len: length of the range in bytes
+ * @idxmap: bitmap of MMU indexes to flush
+ *
+ * Like tlb_flush_range_by_mmuidx, on all CPUs.  Each CPU gets a
+ * single work item for the whole range.
+ */
+void tlb_flush_range_by_mmuidx_all_cpus(CPUState *cpu, target_ulong addr,
+                                        target_ulong len, uint16_t idxmap);
+/**
+ * tlb_flush_range_by_mmuidx_all_cpus_synced:
+ * @cpu: Originating CPU of the flush
+ * @addr: virtual address of the start of the range
+ * @len: length of the range in bytes
+ * @idxmap: bitmap of MMU indexes to flush
+ *
+ * Like tlb_flush_range_by_mmuidx_all_cpus, except the source vCPUs work
+ * is scheduled as safe work, like tlb_flush_page_by_mmuidx_all_cpus_synced.
+ */
+void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
+                                               target_ulong addr,
+                                               target_ulong len,
+                                               uint16_t idxmap);
+/**
+ * tlb_flush_pages_all_cpus_synced:
+ * @cpu: Originating CPU of the flush
+ * @pages: virtual addresses of the pages to be flushed
+ * @nr: number of elements in @pages
+ *
+ * Flush @nr pages from the TLB of all CPUs, for all MMU indexes, like
+ * as many calls to tlb_flush_page_all_cpus_synced but with a single
+ * work item per CPU.
+ */
+void tlb_flush_pages_all_cpus_synced(CPUState *cpu, const target_ulong *pages,
+                                     unsigned int nr);
 /**
  * tlb_set_page_with_attrs:
  * @cpu: CPU to add this TLB entry for
@@ -310,6 +372,31 @@ static inline void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *cpu,
                                                        uint16_t idxmap)
 {
 }
+static inline void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                                             target_ulong len, uint16_t idxmap)
+{
+}
+static inline void tlb_flush_range(CPUState *cpu, target_ulong addr,
+                                   target_ulong len)
+{
+}
+static inline void tlb_flush_range_by_mmuidx_all_cpus(CPUState *cpu,
+                                                      target_ulong addr,
+                                                      target_ulong len,
+                                                      uint16_t idxmap)
+{
+}
+static inline void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
+                                                             target_ulong addr,
+                                                             target_ulong len,
+                                                             uint16_t idxmap)
+{
+}
+static inline void tlb_flush_pages_all_cpus_synced(CPUState *cpu,
+                                                   const target_ulong *pages,
+                                                   unsigned int nr)
+{
+}
 #endif
 
 #define CODE_GEN_ALIGN           16 /* must be >= of the size of a icache line */
@@ -350,6 +437,8 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT  0x00020000
 #define CF_INVALID     0x00040000 /* TB is stale. Set with @jmp_lock held */
 #define CF_PARALLEL    0x00080000 /* Generate code for a parallel context */
+#define CF_NOPERSIST   0x00100000 /* Code is only valid in this process */
+#define CF_SUPERBLOCK  0x00200000 /* Hot code, translate across branches */
 #define CF_CLUSTER_MASK 0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 /* cflags' mask for hashing/comparison */
@@ -359,6 +448,12 @@ struct TranslationBlock {
     /* Per-vCPU dynamic tracing state used to generate this TB */
     uint32_t trace_vcpu_dstate;
 
+    /* Executions left before the TB is retranslated as a superblock.
+     * Decremented by the generated code without atomics, so it is only
+     * approximate when several vCPUs run the same TB.
+     */
+    int32_t hot_count;
+
     struct tb_tc tc;
 
     /* original tb when cflags has CF_NOCACHE */
@@ -406,6 +501,8 @@ struct TranslationBlock {
 };
 
 extern bool parallel_cpus;
+extern unsigned int tb_hot_threshold;
+extern unsigned int tb_jmp_cache_bits;
 
 /* Hide the atomic_read to make code a little easier on the eyes */
 static inline uint32_t tb_cflags(const TranslationBlock *tb)
@@ -428,6 +525,7 @@ void tb_invalidate_phys_range(target_ulong start, target_ulong end);
 void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr, MemTxAttrs attrs);
 #endif
 void tb_flush(CPUState *cpu);
+void tb_jmp_cache_init(CPUState *cpu);
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, uint32_t flags,
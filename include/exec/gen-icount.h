@@ -1,6 +1,7 @@
 #ifndef GEN_ICOUNT_H
 #define GEN_ICOUNT_H
 
+#include "exec/tb-profile.h"
 #include "qemu/timer.h"
 
 /* Helpers for instruction counting code generation.  */
@@ -43,6 +44,40 @@ static inline void gen_tb_start(TranslationBlock *tb)
     }
 
     tcg_temp_free_i32(count);
+
+    if (tcg_ctx->tb_profile) {
+        TCGv_ptr ptr = tcg_temp_new_ptr();
+        TCGv_i64 n = tcg_temp_new_i64();
+
+        /* Profiles are never freed, but they are not where they were in
+         * the previous run either, so this TB must not be persisted.  */
+        tcg_ctx->tb_host_ptr = true;
+        tcg_gen_movi_ptr(ptr, (uintptr_t)tcg_ctx->tb_profile);
+        tcg_gen_ld_i64(n, ptr, offsetof(TBProfile, executions));
+        tcg_gen_addi_i64(n, n, 1);
+        tcg_gen_st_i64(n, ptr, offsetof(TBProfile, executions));
+        tcg_temp_free_i64(n);
+        tcg_temp_free_ptr(ptr);
+    }
+
+    if (tb_hot_threshold &&
+        !(tb_cflags(tb) & (CF_COUNT_MASK | CF_NOCACHE | CF_USE_ICOUNT |
+                            CF_SUPERBLOCK))) {
+        TCGv_ptr ptr = tcg_temp_new_ptr();
+        TCGv_i32 hot = tcg_temp_new_i32();
+
+        /* Count executions until the TB is hot, see tb_promote().  The TB
+         * sits in the code buffer, so its address is as stable as that of
+         * the code itself.  */
+        tcg_ctx->tb_hot_label = gen_new_label();
+        tcg_gen_movi_ptr(ptr, (uintptr_t)tb);
+        tcg_gen_ld_i32(hot, ptr, offsetof(TranslationBlock, hot_count));
+        tcg_gen_subi_i32(hot, hot, 1);
+        tcg_gen_st_i32(hot, ptr, offsetof(TranslationBlock, hot_count));
+        tcg_gen_brcondi_i32(TCG_COND_LE, hot, 0, tcg_ctx->tb_hot_label);
+        tcg_temp_free_i32(hot);
+        tcg_temp_free_ptr(ptr);
+    }
 }
 
 static inline void gen_tb_end(TranslationBlock *tb, int num_insns)
@@ -55,6 +90,11 @@ static inline void gen_tb_end(TranslationBlock *tb, int num_insns)
 
     gen_set_label(tcg_ctx->exitreq_label);
     tcg_gen_exit_tb(tb, TB_EXIT_REQUESTED);
+
+    if (tcg_ctx->tb_hot_label) {
+        gen_set_label(tcg_ctx->tb_hot_label);
+        tcg_gen_exit_tb(tb, TB_EXIT_HOT);
+    }
 }
 
 static inline void gen_io_start(void)
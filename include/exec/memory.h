@@ -368,6 +368,7 @@ struct MemoryRegion {
 
     const MemoryRegionOps *ops;
     void *opaque;
+    QemuMutex *lock;
     MemoryRegion *container;
     Int128 size;
     hwaddr addr;
@@ -1475,6 +1476,27 @@ void memory_region_clear_flush_coalesced(MemoryRegion *mr);
  */
 void memory_region_clear_global_locking(MemoryRegion *mr);
 
+/**
+ * memory_region_set_lock: Declares that accesses to the memory region are
+ *                         serialized by a device lock instead of the QEMU
+ *                         global lock.
+ *
+ * The read and write callbacks of @mr are called with @lock held, and the
+ * global lock is no longer taken for them (see
+ * memory_region_clear_global_locking()).  The device model must take @lock
+ * in its other entry points, such as timers, chardev handlers and GPIO
+ * inputs, which run under the global lock.
+ *
+ * @lock thus nests inside the global lock: code running with @lock held
+ * must not take the global lock.  It may take the lock of another device,
+ * for example to raise an interrupt line, as long as the lock order
+ * between devices is always the same.
+ *
+ * @mr: the memory region to be updated.
+ * @lock: the lock serializing accesses to @mr.
+ */
+void memory_region_set_lock(MemoryRegion *mr, QemuMutex *lock);
+
 /**
  * memory_region_add_eventfd: Request an eventfd to be triggered when a word
  *                            is written to a location.
@@ -1755,6 +1777,56 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
                                          unsigned size,
                                          MemTxAttrs attrs);
 
+/**
+ * memory_region_direct_access_sizes: return the access sizes, in bytes
+ * and ORed together, for which memory_region_dispatch_read_direct() or
+ * memory_region_dispatch_write_direct() can be used on @mr.
+ *
+ * Those are the sizes that the region's callbacks implement without
+ * splitting, if no #MemoryRegionOps.valid.accepts callback needs to
+ * be consulted.  The result only depends on @mr's ops and type, so
+ * callers may compute it once and cache it.
+ *
+ * @mr: #MemoryRegion to access
+ * @is_write: whether the accesses are writes
+ */
+unsigned memory_region_direct_access_sizes(MemoryRegion *mr, bool is_write);
+
+/**
+ * memory_region_dispatch_read_direct: like memory_region_dispatch_read(),
+ * but for a @size in memory_region_direct_access_sizes(@mr, false).
+ *
+ * The region's read callback is called directly, skipping the access
+ * validation and splitting of memory_region_dispatch_read().
+ *
+ * @mr: #MemoryRegion to access
+ * @addr: address within that region
+ * @pval: pointer to uint64_t which the data is written to
+ * @size: size of the access in bytes
+ * @attrs: memory transaction attributes to use for the access
+ */
+MemTxResult memory_region_dispatch_read_direct(MemoryRegion *mr,
+                                               hwaddr addr,
+                                               uint64_t *pval,
+                                               unsigned size,
+                                               MemTxAttrs attrs);
+
+/**
+ * memory_region_dispatch_write_direct: like memory_region_dispatch_write(),
+ * but for a @size in memory_region_direct_access_sizes(@mr, true).
+ *
+ * @mr: #MemoryRegion to access
+ * @addr: address within that region
+ * @data: data to write
+ * @size: size of the access in bytes
+ * @attrs: memory transaction attributes to use for the access
+ */
+MemTxResult memory_region_dispatch_write_direct(MemoryRegion *mr,
+                                                hwaddr addr,
+                                                uint64_t data,
+                                                unsigned size,
+                                                MemTxAttrs attrs);
+
 /**
  * address_space_init: initializes an address space
  *
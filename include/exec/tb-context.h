@@ -32,9 +32,12 @@ typedef struct TBContext TBContext;
 struct TBContext {
 
     struct qht htable;
+    /* a tb_flush() is queued, so the next flush must not keep hot code */
+    bool tb_flush_full;
 
     /* statistics */
     unsigned tb_flush_count;
+    size_t tb_hot_kept; /* TBs kept in the hot code area by tb_flush */
 };
 
 extern TBContext tb_ctx;
@@ -22,41 +22,58 @@
 
 #include "qemu/xxhash.h"
 
+/*
+ * The jump cache hash functions return a set number; @bits is the
+ * number of set bits of the cache, see TBJmpCache.
+ */
 #ifdef CONFIG_SOFTMMU
 
 /* Only the bottom TB_JMP_PAGE_BITS of the jump cache hash bits vary for
    addresses on the same page.  The top bits are the same.  This allows
    TLB invalidation to quickly clear a subset of the hash table.  */
-#define TB_JMP_PAGE_BITS (TB_JMP_CACHE_BITS / 2)
-#define TB_JMP_PAGE_SIZE (1 << TB_JMP_PAGE_BITS)
-#define TB_JMP_ADDR_MASK (TB_JMP_PAGE_SIZE - 1)
-#define TB_JMP_PAGE_MASK (TB_JMP_CACHE_SIZE - TB_JMP_PAGE_SIZE)
+#define TB_JMP_PAGE_BITS(bits) ((bits) / 2)
+#define TB_JMP_PAGE_SIZE(bits) (1u << TB_JMP_PAGE_BITS(bits))
+#define TB_JMP_ADDR_MASK(bits) (TB_JMP_PAGE_SIZE(bits) - 1)
+#define TB_JMP_PAGE_MASK(bits) ((1u << (bits)) - TB_JMP_PAGE_SIZE(bits))
 
-static inline unsigned int tb_jmp_cache_hash_page(target_ulong pc)
+static inline unsigned int tb_jmp_cache_hash_page(target_ulong pc,
+                                                  unsigned int bits)
 {
+    unsigned int shift = TARGET_PAGE_BITS - TB_JMP_PAGE_BITS(bits);
     target_ulong tmp;
-    tmp = pc ^ (pc >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS));
-    return (tmp >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS)) & TB_JMP_PAGE_MASK;
+
+    tmp = pc ^ (pc >> shift);
+    return (tmp >> shift) & TB_JMP_PAGE_MASK(bits);
 }
 
-static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc)
+static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc,
+                                                  unsigned int bits)
 {
+    unsigned int shift = TARGET_PAGE_BITS - TB_JMP_PAGE_BITS(bits);
     target_ulong tmp;
-    tmp = pc ^ (pc >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS));
-    return (((tmp >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS)) & TB_JMP_PAGE_MASK)
-           | (tmp & TB_JMP_ADDR_MASK));
+
+    tmp = pc ^ (pc >> shift);
+    return (((tmp >> shift) & TB_JMP_PAGE_MASK(bits))
+           | (tmp & TB_JMP_ADDR_MASK(bits)));
 }
 
 #else
 
 /* In user-mode we can get better hashing because we do not have a TLB */
-static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc)
+static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc,
+                                                  unsigned int bits)
 {
-    return (pc ^ (pc >> TB_JMP_CACHE_BITS)) & (TB_JMP_CACHE_SIZE - 1);
+    return (pc ^ (pc >> bits)) & ((1u << bits) - 1);
 }
 
 #endif /* CONFIG_SOFTMMU */
 
+/* The bit of TBJmpCache.ibtc_pages for the page of @pc */
+static inline uint64_t tb_ibtc_page_bit(target_ulong pc)
+{
+    return 1ull << ((pc >> TARGET_PAGE_BITS) & 63);
+}
+
 static inline
 uint32_t tb_hash_func(tb_page_addr_t phys_pc, target_ulong pc, uint32_t flags,
                       uint32_t cf_mask, uint32_t trace_vcpu_dstate)
@@ -16,36 +16,95 @@
 #include "exec/exec-all.h"
 #include "exec/tb-hash.h"
 
+static inline bool tb_lookup_match(const TranslationBlock *tb, CPUState *cpu,
+                                   target_ulong pc, target_ulong cs_base,
+                                   uint32_t flags, uint32_t cf_mask)
+{
+    return tb &&
+           tb->pc == pc &&
+           tb->cs_base == cs_base &&
+           tb->flags == flags &&
+           tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+           (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask;
+}
+
+static inline uint32_t tb_lookup_cf_mask(CPUState *cpu, uint32_t cf_mask)
+{
+    cf_mask &= ~CF_CLUSTER_MASK;
+    return cf_mask | (cpu->cluster_index << CF_CLUSTER_SHIFT);
+}
+
+static inline TranslationBlock **tb_jmp_cache_set(TBJmpCache *jc,
+                                                  target_ulong pc)
+{
+    return &jc->entries[tb_jmp_cache_hash_func(pc, jc->bits) *
+                        TB_JMP_CACHE_WAYS];
+}
+
+/*
+ * Make @tb the most recently used entry of the set of @pc, moving down
+ * the entries before way @n.  Only the vCPU thread moves entries; other
+ * threads may clear them concurrently, in which case we might put back
+ * a TB that is being invalidated.  This is harmless because lookups
+ * ignore TBs with CF_INVALID, which is set before the jump caches are
+ * cleared, and TBs are only freed by tb_flush, which runs when all vCPUs
+ * are stopped and clears the whole cache.
+ */
+static inline void tb_jmp_cache_promote(TranslationBlock **set,
+                                        TranslationBlock *tb, int n)
+{
+    for (; n > 0; n--) {
+        atomic_set(&set[n], atomic_read(&set[n - 1]));
+    }
+    atomic_set(&set[0], tb);
+}
+
+static inline void tb_jmp_cache_insert(CPUState *cpu, target_ulong pc,
+                                       TranslationBlock *tb)
+{
+    tb_jmp_cache_promote(tb_jmp_cache_set(cpu->tb_jmp_cache, pc), tb,
+                         TB_JMP_CACHE_WAYS - 1);
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *
-tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
-                     uint32_t *flags, uint32_t cf_mask)
+tb_lookup__pc(CPUState *cpu, target_ulong pc, target_ulong cs_base,
+              uint32_t flags, uint32_t cf_mask)
 {
-    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+    TBJmpCache *jc = cpu->tb_jmp_cache;
+    TranslationBlock **set = tb_jmp_cache_set(jc, pc);
     TranslationBlock *tb;
-    uint32_t hash;
+    int i;
 
-    cpu_get_tb_cpu_state(env, pc, cs_base, flags);
-    hash = tb_jmp_cache_hash_func(*pc);
-    tb = atomic_rcu_read(&cpu->tb_jmp_cache[hash]);
-
-    cf_mask &= ~CF_CLUSTER_MASK;
-    cf_mask |= cpu->cluster_index << CF_CLUSTER_SHIFT;
-
-    if (likely(tb &&
-               tb->pc == *pc &&
-               tb->cs_base == *cs_base &&
-               tb->flags == *flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
-        return tb;
+    for (i = 0; i < TB_JMP_CACHE_WAYS; i++) {
+        tb = atomic_rcu_read(&set[i]);
+        if (likely(tb_lookup_match(tb, cpu, pc, cs_base, flags, cf_mask))) {
+            if (i) {
+                tb_jmp_cache_promote(set, tb, i);
+            }
+            atomic_set(&jc->hits, jc->hits + 1);
+            return tb;
+        }
     }
-    tb = tb_htable_lookup(cpu, *pc, *cs_base, *flags, cf_mask);
+    atomic_set(&jc->misses, jc->misses + 1);
+    tb = tb_htable_lookup(cpu, pc, cs_base, flags, cf_mask);
     if (tb == NULL) {
         return NULL;
     }
-    atomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_jmp_cache_promote(set, tb, TB_JMP_CACHE_WAYS - 1);
     return tb;
 }
 
+/* Might cause an exception, so have a longjmp destination ready */
+static inline TranslationBlock *
+tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
+                     uint32_t *flags, uint32_t cf_mask)
+{
+    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+
+    cpu_get_tb_cpu_state(env, pc, cs_base, flags);
+    return tb_lookup__pc(cpu, *pc, *cs_base, *flags,
+                         tb_lookup_cf_mask(cpu, cf_mask));
+}
+
 #endif /* EXEC_TB_LOOKUP_H */
@@ -0,0 +1,31 @@
+/*
+ * Per guest PC translation and execution profile
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef EXEC_TB_PROFILE_H
+#define EXEC_TB_PROFILE_H
+
+/*
+ * What we know about the TBs translated from one guest PC.  The sizes and
+ * op counts are those of the latest translation, the rest accumulates.
+ */
+typedef struct TBProfile {
+    uint64_t pc;            /* hash table key */
+    uint64_t executions;    /* bumped by the translated code, not atomic */
+    uint64_t translations;
+    uint64_t translate_ns;
+    uint32_t size;          /* guest bytes */
+    uint32_t host_size;     /* host code bytes */
+    uint32_t ops_in;        /* TCG ops emitted by the front end */
+    uint32_t ops_out;       /* TCG ops left after optimization */
+} TBProfile;
+
+/* Whether new translations are profiled, see "-accel tcg,profile=on" */
+extern bool tb_profile_enabled;
+/* Whether translated code is described in /tmp/perf-<pid>.map */
+extern bool tb_perf_map_enabled;
+
+#endif /* EXEC_TB_PROFILE_H */
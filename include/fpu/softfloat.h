@@ -323,6 +323,21 @@ static inline int float16_is_zero_or_denormal(float16 a)
     return (float16_val(a) & 0x7c00) == 0;
 }
 
+static inline bool float16_is_normal(float16 a)
+{
+    return (((float16_val(a) >> 10) + 1) & 0x1f) >= 2;
+}
+
+static inline bool float16_is_denormal(float16 a)
+{
+    return float16_is_zero_or_denormal(a) && !float16_is_zero(a);
+}
+
+static inline bool float16_is_zero_or_normal(float16 a)
+{
+    return float16_is_normal(a) || float16_is_zero(a);
+}
+
 static inline float16 float16_abs(float16 a)
 {
     /* Note that abs does *not* handle NaN specially, nor does
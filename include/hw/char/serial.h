@@ -77,6 +77,13 @@ typedef struct SerialState {
 
     QEMUTimer *modem_status_poll;
     MemoryRegion io;
+
+    /*
+     * Serializes the register accesses with the chardev, timer and
+     * reset callbacks, which run under the BQL.  Nests inside the BQL.
+     */
+    QemuMutex lock;
+    QEMUBH *accept_input_bh;
 } SerialState;
 
 extern const VMStateDescription vmstate_serial;
@@ -86,6 +93,12 @@ void serial_realize_core(SerialState *s, Error **errp);
 void serial_exit_core(SerialState *s);
 void serial_set_frequency(SerialState *s, uint32_t frequency);
 
+/*
+ * Let the vCPUs access the registers without taking the BQL.  Only valid
+ * if the interrupt line of @s can be driven without holding the BQL.
+ */
+void serial_set_lockless(SerialState *s);
+
 /* legacy pre qom */
 SerialState *serial_init(int base, qemu_irq irq, int baudbase,
                          Chardev *chr, MemoryRegion *system_io);
@@ -31,6 +31,7 @@ typedef struct SiFiveCLINTState {
 
     /*< public >*/
     MemoryRegion mmio;
+    QemuMutex lock;     /* serializes timecmp updates */
     uint32_t num_harts;
     uint32_t sip_base;
     uint32_t timecmp_base;
@@ -47,6 +47,7 @@ typedef struct SiFivePLICState {
 
     /*< public >*/
     MemoryRegion mmio;
+    QemuMutex lock;
     uint32_t num_addrs;
     uint32_t bitfield_words;
     PLICAddr *addr_config;
@@ -58,6 +58,8 @@ typedef struct SiFiveUARTState {
     /*< public >*/
     qemu_irq irq;
     MemoryRegion mmio;
+    QemuMutex lock;
+    QEMUBH *accept_input_bh;
     CharBackend chr;
     uint8_t rx_fifo[8];
     unsigned int rx_fifo_len;
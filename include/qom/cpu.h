@@ -272,8 +272,48 @@ struct kvm_run;
 
 struct hax_vcpu_state;
 
-#define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+/*
+ * The jump cache maps guest virtual PCs to TBs.  It has 1 << bits sets
+ * of TB_JMP_CACHE_WAYS entries each, kept in most-recently-used order;
+ * the number of sets is set with "-accel tcg,jmp-cache-bits".
+ */
+#define TB_JMP_CACHE_BITS_DEFAULT 11
+#define TB_JMP_CACHE_BITS_MIN 6
+#define TB_JMP_CACHE_BITS_MAX 16
+#define TB_JMP_CACHE_WAYS 4
+
+/*
+ * The indirect branch target cache remembers the TB that each indirect
+ * branch went to last.  Every branch site gets its own slot when it is
+ * translated, round robin, so distinct sites only share a slot once
+ * TB_IBTC_SIZE more sites have been translated.
+ *
+ * An entry is valid if its generation is the current one.  Bumping the
+ * generation invalidates the whole cache, which a TLB flush of a page that
+ * a cached TB may start on does (see tb_flush_jmp_cache()); @ibtc_pages
+ * is a filter of those pages, so that most page flushes leave it alone.
+ */
+#define TB_IBTC_BITS 10
+#define TB_IBTC_SIZE (1 << TB_IBTC_BITS)
+
+typedef struct TBIBTCEntry {
+    struct TranslationBlock *tb;
+    uint32_t gen;
+} TBIBTCEntry;
+
+typedef struct TBJmpCache {
+    /* Freed after a grace period, as CPU_FOREACH readers may still see it */
+    struct rcu_head rcu;
+    unsigned int bits;
+    /* Only written by the vCPU thread */
+    size_t hits;
+    size_t misses;
+    size_t ibtc_hits;
+    uint32_t ibtc_gen;
+    uint64_t ibtc_pages;
+    TBIBTCEntry ibtc[TB_IBTC_SIZE];
+    struct TranslationBlock *entries[];
+} TBJmpCache;
 
 /* work queue */
 
@@ -393,8 +433,8 @@ struct CPUState {
     void *env_ptr; /* CPUArchState */
     IcountDecr *icount_decr_ptr;
 
-    /* Accessed in parallel; all accesses must be atomic */
-    struct TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    /* Entries are accessed in parallel; all accesses must be atomic */
+    TBJmpCache *tb_jmp_cache;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -444,6 +484,14 @@ struct CPUState {
      */
     bool throttle_thread_scheduled;
 
+    /* Throttle percentage of this vcpu alone, see cpu_throttle_set_vcpu */
+    int throttle_percentage;
+
+    /* Pages first dirtied by this vcpu while dirty logging is enabled;
+     * only counted by accelerators that trap those writes (TCG).
+     */
+    uint64_t dirty_pages;
+
     bool ignore_memory_transaction_failures;
 
     struct hax_vcpu_state *hax_vcpu;
@@ -467,10 +515,17 @@ extern __thread CPUState *current_cpu;
 
 static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
 {
+    TBJmpCache *jc = atomic_rcu_read(&cpu->tb_jmp_cache);
     unsigned int i;
 
-    for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
-        atomic_set(&cpu->tb_jmp_cache[i], NULL);
+    if (!jc) {
+        return;
+    }
+    for (i = 0; i < TB_JMP_CACHE_WAYS << jc->bits; i++) {
+        atomic_set(&jc->entries[i], NULL);
+    }
+    for (i = 0; i < TB_IBTC_SIZE; i++) {
+        atomic_set(&jc->ibtc[i].tb, NULL);
     }
 }
 
@@ -852,6 +907,27 @@ bool cpu_throttle_active(void);
  */
 int cpu_throttle_get_percentage(void);
 
+/**
+ * cpu_throttle_set_vcpu:
+ * @cpu: The vcpu to throttle.
+ * @new_throttle_pct: Percent of sleep time. Valid range is 1 to 99,
+ * 0 stops throttling @cpu alone.
+ *
+ * Throttles @cpu like cpu_throttle_set does for all vcpus.  The vcpu
+ * sleeps for the larger of @new_throttle_pct and the percentage set by
+ * cpu_throttle_set.  cpu_throttle_stop also stops per-vcpu throttling.
+ */
+void cpu_throttle_set_vcpu(CPUState *cpu, int new_throttle_pct);
+
+/**
+ * cpu_throttle_get_vcpu_percentage:
+ * @cpu: The vcpu to query.
+ *
+ * Returns: The throttle percentage set with cpu_throttle_set_vcpu for
+ * @cpu, or 0 if it is not throttled on its own.
+ */
+int cpu_throttle_get_vcpu_percentage(CPUState *cpu);
+
 #ifndef CONFIG_USER_ONLY
 
 typedef void (*CPUInterruptHandler)(CPUState *, int);
@@ -10,6 +10,9 @@
 
 extern bool tcg_allowed;
 void tcg_exec_init(unsigned long tb_size);
+void tcg_tb_cache_load(const char *path);
+void tcg_tb_cache_save(const char *path);
+void tcg_tb_async_init(unsigned int nb_threads);
 #ifdef CONFIG_TCG
 #define tcg_enabled() (tcg_allowed)
 #else
@@ -22,6 +22,7 @@
 #include "qemu/bitops.h"
 #include "qemu/error-report.h"
 #include "qemu/qemu-print.h"
+#include "qemu/timer.h"
 #include "qom/object.h"
 #include "trace-root.h"
 
@@ -48,6 +49,12 @@ static QTAILQ_HEAD(, AddressSpace) address_spaces
 
 static GHashTable *flat_views;
 
+/* Cumulative topology update statistics, reported by tracing.  */
+static uint64_t flatview_commits;
+static uint64_t flatview_rendered;
+static uint64_t flatview_reused;
+static uint64_t flatview_rebuild_ns;
+
 typedef struct AddrRange AddrRange;
 
 /*
@@ -729,9 +736,8 @@ static MemoryRegion *memory_region_get_flatview_root(MemoryRegion *mr)
 }
 
 /* Render a memory topology into a list of disjoint absolute ranges. */
-static FlatView *generate_memory_topology(MemoryRegion *mr)
+static FlatView *render_memory_topology(MemoryRegion *mr)
 {
-    int i;
     FlatView *view;
 
     view = flatview_new(mr);
@@ -743,6 +749,13 @@ static FlatView *generate_memory_topology(MemoryRegion *mr)
     }
     flatview_simplify(view);
 
+    return view;
+}
+
+static void flatview_build_dispatch(FlatView *view)
+{
+    int i;
+
     view->dispatch = address_space_dispatch_new(view);
     for (i = 0; i < view->nr; i++) {
         MemoryRegionSection mrs =
@@ -750,11 +763,40 @@ static FlatView *generate_memory_topology(MemoryRegion *mr)
         flatview_add_to_dispatch(view, &mrs);
     }
     address_space_dispatch_compact(view->dispatch);
+}
+
+static FlatView *generate_memory_topology(MemoryRegion *mr)
+{
+    FlatView *view = render_memory_topology(mr);
+
+    flatview_build_dispatch(view);
     g_hash_table_replace(flat_views, mr, view);
 
     return view;
 }
 
+/*
+ * Two views are interchangeable if they have the same ranges with the
+ * same attributes, including the dirty logging mask.  Listeners would
+ * see nothing but region_nop when switching from one to the other, and
+ * the dispatch tree of one can serve lookups for the other.
+ */
+static bool flatview_equal(FlatView *a, FlatView *b)
+{
+    unsigned i;
+
+    if (a->root != b->root || a->nr != b->nr) {
+        return false;
+    }
+    for (i = 0; i < a->nr; i++) {
+        if (!flatrange_equal(&a->ranges[i], &b->ranges[i])
+            || a->ranges[i].dirty_log_mask != b->ranges[i].dirty_log_mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static void address_space_add_del_ioeventfds(AddressSpace *as,
                                              MemoryRegionIoeventfd *fds_new,
                                              unsigned fds_new_nb,
@@ -985,28 +1027,66 @@ static void flatviews_init(void)
     }
 }
 
+/*
+ * Re-render all unique FVs.  A view whose ranges come out identical to
+ * the ones it had before the transaction is kept as is, together with
+ * its dispatch tree, so that a change to one part of the machine (say,
+ * a PCI BAR) does not rebuild the dispatch of every other address space.
+ * The dispatch tree is read locklessly under RCU, so it is never updated
+ * in place; a view that did change gets a fresh one.
+ */
 static void flatviews_reset(void)
 {
+    GHashTable *old_views = flat_views;
     AddressSpace *as;
 
-    if (flat_views) {
-        g_hash_table_unref(flat_views);
-        flat_views = NULL;
-    }
+    flat_views = NULL;
     flatviews_init();
 
-    /* Render unique FVs */
     QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
         MemoryRegion *physmr = memory_region_get_flatview_root(as->root);
+        FlatView *view, *old_view;
 
         if (g_hash_table_lookup(flat_views, physmr)) {
             continue;
         }
 
-        generate_memory_topology(physmr);
+        view = render_memory_topology(physmr);
+        old_view = old_views ? g_hash_table_lookup(old_views, physmr) : NULL;
+        if (old_view && flatview_equal(old_view, view)) {
+            /* Never published, so there is no need to wait for RCU.  */
+            flatview_destroy(view);
+            flatview_ref(old_view);
+            g_hash_table_replace(flat_views, physmr, old_view);
+            flatview_reused++;
+            continue;
+        }
+
+        flatview_build_dispatch(view);
+        g_hash_table_replace(flat_views, physmr, view);
+        flatview_rendered++;
+    }
+
+    if (old_views) {
+        g_hash_table_unref(old_views);
     }
 }
 
+static bool flatviews_changed(void)
+{
+    AddressSpace *as;
+
+    QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
+        MemoryRegion *physmr = memory_region_get_flatview_root(as->root);
+
+        if (address_space_to_flatview(as) !=
+            g_hash_table_lookup(flat_views, physmr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void address_space_set_flatview(AddressSpace *as)
 {
     FlatView *old_view = address_space_to_flatview(as);
@@ -1016,6 +1096,13 @@ static void address_space_set_flatview(AddressSpace *as)
     assert(new_view);
 
     if (old_view == new_view) {
+        /*
+         * Listeners that rebuild their state from scratch between begin
+         * and commit (e.g. vhost) still need to hear about every range.
+         */
+        if (!QTAILQ_EMPTY(&as->listeners)) {
+            address_space_update_topology_pass(as, old_view, new_view, true);
+        }
         return;
     }
 
@@ -1079,17 +1166,32 @@ void memory_region_transaction_commit(void)
     --memory_region_transaction_depth;
     if (!memory_region_transaction_depth) {
         if (memory_region_update_pending) {
-            flatviews_reset();
+            int64_t start = get_clock();
 
-            MEMORY_LISTENER_CALL_GLOBAL(begin, Forward);
+            flatviews_reset();
+            flatview_commits++;
+            if (flatviews_changed()) {
+                MEMORY_LISTENER_CALL_GLOBAL(begin, Forward);
 
-            QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
-                address_space_set_flatview(as);
-                address_space_update_ioeventfds(as);
+                QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
+                    address_space_set_flatview(as);
+                    address_space_update_ioeventfds(as);
+                }
+                MEMORY_LISTENER_CALL_GLOBAL(commit, Forward);
+            } else {
+                /* Every view was reused, there is nothing to tell. */
+                QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
+                    address_space_update_ioeventfds(as);
+                }
             }
             memory_region_update_pending = false;
             ioeventfd_update_pending = false;
-            MEMORY_LISTENER_CALL_GLOBAL(commit, Forward);
+
+            flatview_rebuild_ns += get_clock() - start;
+            trace_memory_region_transaction_commit(flatview_commits,
+                                                   flatview_rendered,
+                                                   flatview_reused,
+                                                   flatview_rebuild_ns);
         } else if (ioeventfd_update_pending) {
             QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
                 address_space_update_ioeventfds(as);
@@ -1447,7 +1549,13 @@ MemTxResult memory_region_dispatch_read(MemoryRegion *mr,
         return MEMTX_DECODE_ERROR;
     }
 
+    if (mr->lock) {
+        qemu_mutex_lock(mr->lock);
+    }
     r = memory_region_dispatch_read1(mr, addr, pval, size, attrs);
+    if (mr->lock) {
+        qemu_mutex_unlock(mr->lock);
+    }
     adjust_endianness(mr, pval, size);
     return r;
 }
@@ -1484,6 +1592,8 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
                                          unsigned size,
                                          MemTxAttrs attrs)
 {
+    MemTxResult r;
+
     if (!memory_region_access_valid(mr, addr, size, true, attrs)) {
         unassigned_mem_write(mr, addr, data, size);
         return MEMTX_DECODE_ERROR;
@@ -1496,20 +1606,111 @@ MemTxResult memory_region_dispatch_write(MemoryRegion *mr,
         return MEMTX_OK;
     }
 
+    if (mr->lock) {
+        qemu_mutex_lock(mr->lock);
+    }
     if (mr->ops->write) {
-        return access_with_adjusted_size(addr, &data, size,
-                                         mr->ops->impl.min_access_size,
-                                         mr->ops->impl.max_access_size,
-                                         memory_region_write_accessor, mr,
-                                         attrs);
+        r = access_with_adjusted_size(addr, &data, size,
+                                      mr->ops->impl.min_access_size,
+                                      mr->ops->impl.max_access_size,
+                                      memory_region_write_accessor, mr,
+                                      attrs);
     } else {
-        return
-            access_with_adjusted_size(addr, &data, size,
+        r = access_with_adjusted_size(addr, &data, size,
                                       mr->ops->impl.min_access_size,
                                       mr->ops->impl.max_access_size,
                                       memory_region_write_with_attrs_accessor,
                                       mr, attrs);
     }
+    if (mr->lock) {
+        qemu_mutex_unlock(mr->lock);
+    }
+    return r;
+}
+
+unsigned memory_region_direct_access_sizes(MemoryRegion *mr, bool is_write)
+{
+    const MemoryRegionOps *ops = mr->ops;
+    unsigned access_size_min = ops->impl.min_access_size ?: 1;
+    unsigned access_size_max = ops->impl.max_access_size ?: 4;
+    unsigned sizes = 0;
+    unsigned size;
+
+    /*
+     * Subpages and io_mem_notdirty are traced unconditionally by the
+     * accessors, keep them on the slow path.
+     */
+    if (ops->valid.accepts || mr->subpage || mr == &io_mem_notdirty) {
+        return 0;
+    }
+    if (is_write ? !ops->write && !ops->write_with_attrs
+                 : !ops->read && !ops->read_with_attrs) {
+        return 0;
+    }
+    for (size = access_size_min; size <= MIN(access_size_max, 8); size <<= 1) {
+        sizes |= size;
+    }
+    return sizes;
+}
+
+MemTxResult memory_region_dispatch_read_direct(MemoryRegion *mr,
+                                               hwaddr addr,
+                                               uint64_t *pval,
+                                               unsigned size,
+                                               MemTxAttrs attrs)
+{
+    uint64_t tmp = 0;
+    MemTxResult r = MEMTX_OK;
+
+    if (unlikely(TRACE_MEMORY_REGION_OPS_READ_ENABLED ||
+                 (!mr->ops->valid.unaligned && (addr & (size - 1))))) {
+        return memory_region_dispatch_read(mr, addr, pval, size, attrs);
+    }
+
+    if (mr->lock) {
+        qemu_mutex_lock(mr->lock);
+    }
+    if (mr->ops->read) {
+        tmp = mr->ops->read(mr->opaque, addr, size);
+    } else {
+        r = mr->ops->read_with_attrs(mr->opaque, addr, &tmp, size, attrs);
+    }
+    if (mr->lock) {
+        qemu_mutex_unlock(mr->lock);
+    }
+    *pval = tmp & MAKE_64BIT_MASK(0, size * 8);
+    adjust_endianness(mr, pval, size);
+    return r;
+}
+
+MemTxResult memory_region_dispatch_write_direct(MemoryRegion *mr,
+                                                hwaddr addr,
+                                                uint64_t data,
+                                                unsigned size,
+                                                MemTxAttrs attrs)
+{
+    MemTxResult r = MEMTX_OK;
+
+    /* ioeventfds can be added without remapping, so check them here */
+    if (unlikely(TRACE_MEMORY_REGION_OPS_WRITE_ENABLED || mr->ioeventfd_nb ||
+                 (!mr->ops->valid.unaligned && (addr & (size - 1))))) {
+        return memory_region_dispatch_write(mr, addr, data, size, attrs);
+    }
+
+    adjust_endianness(mr, &data, size);
+    data &= MAKE_64BIT_MASK(0, size * 8);
+    if (mr->lock) {
+        qemu_mutex_lock(mr->lock);
+    }
+    if (mr->ops->write) {
+        mr->ops->write(mr->opaque, addr, data, size);
+    } else {
+        r = mr->ops->write_with_attrs(mr->opaque, addr, data, size, attrs);
+    }
+    if (mr->lock) {
+        qemu_mutex_unlock(mr->lock);
+    }
+    return r;
 }
 
 void memory_region_init_io(MemoryRegion *mr,
@@ -2309,6 +2510,12 @@ void memory_region_clear_global_locking(MemoryRegion *mr)
     mr->global_locking = false;
 }
 
+void memory_region_set_lock(MemoryRegion *mr, QemuMutex *lock)
+{
+    mr->lock = lock;
+    mr->global_locking = false;
+}
+
 static bool userspace_eventfd_warning;
 
 void memory_region_add_eventfd(MemoryRegion *mr,
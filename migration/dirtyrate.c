@@ -0,0 +1,437 @@
+/*
+ * Dirty page rate measurement
+ *
+ * Estimates how fast the guest dirties its memory without migrating it,
+ * either by hashing a sample of the guest pages or with dirty logging.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <zlib.h>
+#include "cpu.h"
+#include "qemu/cutils.h"
+#include "qemu/main-loop.h"
+#include "qemu/rcu_queue.h"
+#include "qemu/units.h"
+#include "qapi/error.h"
+#include "qapi/clone-visitor.h"
+#include "qapi/qapi-commands-migration.h"
+#include "qapi/qapi-visit-migration.h"
+#include "exec/memory.h"
+#include "exec/ram_addr.h"
+#include "migration/blocker.h"
+#include "sysemu/tcg.h"
+#include "trace.h"
+
+#define DIRTYRATE_MIN_CALC_TIME         1
+#define DIRTYRATE_MAX_CALC_TIME         60
+#define DIRTYRATE_DEFAULT_SAMPLE_PAGES  512
+#define DIRTYRATE_MAX_SAMPLE_PAGES      65536
+
+#define RAMBLOCK_FOREACH_MIGRATABLE(block)             \
+    INTERNAL_RAMBLOCK_FOREACH(block)                   \
+        if (!qemu_ram_is_migratable(block)) {} else
+
+/* The pages sampled in a RAMBlock */
+typedef struct {
+    char idstr[256];
+    /* used_length of the block when it was sampled */
+    ram_addr_t used_length;
+    unsigned int nr_pages;
+    ram_addr_t *offsets;
+    uint32_t *hashes;
+} DirtyRateSample;
+
+typedef struct {
+    DirtyRateMeasureMode mode;
+    int64_t calc_time;
+    int64_t sample_pages;
+} DirtyRateConfig;
+
+/*
+ * State of the last measurement.  It is only accessed with the iothread
+ * lock held, by the QMP commands and by the measuring thread.
+ */
+static struct {
+    DirtyRateStatus status;
+    DirtyRateMeasureMode mode;
+    int64_t start_time;
+    int64_t calc_time;
+    int64_t dirty_rate;
+    DirtyRateVcpuList *vcpu_dirty_rate;
+    /* blocks migration while dirty logging is used for the measurement */
+    Error *blocker;
+} dirty_rate_state;
+
+/* Turn a number of bytes dirtied in @elapsed_ms into MB/s */
+static int64_t dirtyrate_mbps(uint64_t bytes, int64_t elapsed_ms)
+{
+    return bytes * 1000 / MAX(elapsed_ms, 1) / MiB;
+}
+
+/* Called with the iothread lock held */
+static void dirtyrate_publish(int64_t dirty_rate,
+                              DirtyRateVcpuList *vcpu_dirty_rate)
+{
+    dirty_rate_state.dirty_rate = dirty_rate;
+    qapi_free_DirtyRateVcpuList(dirty_rate_state.vcpu_dirty_rate);
+    dirty_rate_state.vcpu_dirty_rate = vcpu_dirty_rate;
+    dirty_rate_state.status = DIRTY_RATE_STATUS_MEASURED;
+}
+
+static uint32_t dirtyrate_page_hash(RAMBlock *block, ram_addr_t offset)
+{
+    return crc32(0, ramblock_ptr(block, offset), TARGET_PAGE_SIZE);
+}
+
+/* Called with RCU critical section */
+static GArray *dirtyrate_sample_pages(int64_t sample_pages)
+{
+    GArray *samples = g_array_new(false, true, sizeof(DirtyRateSample));
+    RAMBlock *block;
+
+    RAMBLOCK_FOREACH_MIGRATABLE(block) {
+        uint64_t pages = block->used_length >> TARGET_PAGE_BITS;
+        DirtyRateSample sample;
+        unsigned int i;
+
+        if (!pages) {
+            continue;
+        }
+
+        pstrcpy(sample.idstr, sizeof(sample.idstr), block->idstr);
+        sample.used_length = block->used_length;
+        sample.nr_pages = MIN(pages,
+                              MAX(1, (block->used_length * sample_pages) >> 30));
+        sample.offsets = g_new(ram_addr_t, sample.nr_pages);
+        sample.hashes = g_new(uint32_t, sample.nr_pages);
+
+        for (i = 0; i < sample.nr_pages; i++) {
+            uint64_t page = (((uint64_t)g_random_int() << 32) |
+                             g_random_int()) % pages;
+
+            sample.offsets[i] = page << TARGET_PAGE_BITS;
+            sample.hashes[i] = dirtyrate_page_hash(block, sample.offsets[i]);
+        }
+        g_array_append_val(samples, sample);
+    }
+
+    return samples;
+}
+
+/*
+ * Returns an estimate of the bytes whose content changed since @samples
+ * was taken.  Blocks that went away or shrank in the meantime are not
+ * accounted.
+ *
+ * Called with RCU critical section
+ */
+static uint64_t dirtyrate_compare_pages(GArray *samples)
+{
+    uint64_t dirty_bytes = 0;
+    unsigned int i, j;
+
+    for (i = 0; i < samples->len; i++) {
+        DirtyRateSample *sample = &g_array_index(samples, DirtyRateSample, i);
+        RAMBlock *block = qemu_ram_block_by_name(sample->idstr);
+        uint64_t changed = 0;
+
+        if (!block || block->used_length < sample->used_length) {
+            continue;
+        }
+
+        for (j = 0; j < sample->nr_pages; j++) {
+            if (dirtyrate_page_hash(block, sample->offsets[j]) !=
+                sample->hashes[j]) {
+                changed++;
+            }
+        }
+        dirty_bytes += changed * sample->used_length / sample->nr_pages;
+    }
+
+    return dirty_bytes;
+}
+
+static void dirtyrate_free_samples(GArray *samples)
+{
+    unsigned int i;
+
+    for (i = 0; i < samples->len; i++) {
+        DirtyRateSample *sample = &g_array_index(samples, DirtyRateSample, i);
+
+        g_free(sample->offsets);
+        g_free(sample->hashes);
+    }
+    g_array_free(samples, true);
+}
+
+static void dirtyrate_measure_page_sampling(DirtyRateConfig *config)
+{
+    GArray *samples;
+    uint64_t dirty_bytes;
+    int64_t start_ms, elapsed_ms;
+    int64_t dirty_rate;
+
+    rcu_read_lock();
+    start_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    samples = dirtyrate_sample_pages(config->sample_pages);
+    rcu_read_unlock();
+
+    g_usleep(config->calc_time * G_USEC_PER_SEC);
+
+    rcu_read_lock();
+    dirty_bytes = dirtyrate_compare_pages(samples);
+    elapsed_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) - start_ms;
+    rcu_read_unlock();
+
+    dirtyrate_free_samples(samples);
+
+    dirty_rate = dirtyrate_mbps(dirty_bytes, elapsed_ms);
+    trace_dirtyrate_measured("page-sampling", dirty_rate, elapsed_ms);
+
+    qemu_mutex_lock_iothread();
+    dirtyrate_publish(dirty_rate, NULL);
+    qemu_mutex_unlock_iothread();
+}
+
+/* Called with RCU critical section */
+static uint64_t dirtyrate_count_dirty_log(void)
+{
+    DirtyMemoryBlocks *blocks;
+    RAMBlock *block;
+    uint64_t count = 0;
+
+    blocks = atomic_rcu_read(&ram_list.dirty_memory[DIRTY_MEMORY_MIGRATION]);
+
+    RAMBLOCK_FOREACH_MIGRATABLE(block) {
+        unsigned long page = block->offset >> TARGET_PAGE_BITS;
+        unsigned long end = page + (block->used_length >> TARGET_PAGE_BITS);
+
+        while (page < end) {
+            unsigned long idx = page / DIRTY_MEMORY_BLOCK_SIZE;
+            unsigned long offset = page % DIRTY_MEMORY_BLOCK_SIZE;
+            unsigned long num = MIN(end - page,
+                                    DIRTY_MEMORY_BLOCK_SIZE - offset);
+
+            count += bitmap_count_one_with_offset(blocks->blocks[idx],
+                                                  offset, num);
+            page += num;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Returns the CPUState::dirty_pages counter of each vcpu indexed by
+ * cpu_index, and the size of the array in @nr_vcpus.
+ *
+ * Called with the iothread lock held
+ */
+static uint64_t *dirtyrate_vcpu_dirty_pages(int *nr_vcpus)
+{
+    uint64_t *dirty_pages;
+    CPUState *cpu;
+    int nr = 0;
+
+    CPU_FOREACH(cpu) {
+        nr = MAX(nr, cpu->cpu_index + 1);
+    }
+    dirty_pages = g_new0(uint64_t, nr);
+    *nr_vcpus = nr;
+
+    CPU_FOREACH(cpu) {
+        dirty_pages[cpu->cpu_index] = atomic_read__nocheck(&cpu->dirty_pages);
+    }
+
+    return dirty_pages;
+}
+
+/*
+ * Builds the per-vcpu dirty rates from the counters saved at the start
+ * of the measurement.  vcpus plugged in the meantime count from zero.
+ *
+ * Called with the iothread lock held
+ */
+static DirtyRateVcpuList *dirtyrate_vcpu_list(uint64_t *start_pages,
+                                              int nr_start_pages,
+                                              int64_t elapsed_ms)
+{
+    DirtyRateVcpuList *list = NULL, **tail = &list;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        DirtyRateVcpuList *entry = g_new0(DirtyRateVcpuList, 1);
+        uint64_t pages = atomic_read__nocheck(&cpu->dirty_pages);
+        int i = cpu->cpu_index;
+
+        if (i < nr_start_pages && pages >= start_pages[i]) {
+            pages -= start_pages[i];
+        }
+
+        entry->value = g_new0(DirtyRateVcpu, 1);
+        entry->value->id = cpu->cpu_index;
+        entry->value->dirty_rate = dirtyrate_mbps(pages * TARGET_PAGE_SIZE,
+                                                  elapsed_ms);
+        *tail = entry;
+        tail = &entry->next;
+    }
+
+    return list;
+}
+
+static void dirtyrate_measure_dirty_log(DirtyRateConfig *config)
+{
+    DirtyRateVcpuList *vcpu_dirty_rate = NULL;
+    uint64_t *start_pages;
+    int nr_start_pages;
+    uint64_t dirty_pages;
+    int64_t start_ms, elapsed_ms;
+    int64_t dirty_rate;
+    RAMBlock *block;
+
+    qemu_mutex_lock_iothread();
+    memory_global_dirty_log_start();
+
+    /*
+     * Pages start out dirty for the migration client; clean them so that
+     * only the pages written from now on are counted.  This also makes
+     * TCG trap the first write to each page again.
+     */
+    rcu_read_lock();
+    RAMBLOCK_FOREACH_MIGRATABLE(block) {
+        cpu_physical_memory_test_and_clear_dirty(block->offset,
+                                                 block->used_length,
+                                                 DIRTY_MEMORY_MIGRATION);
+    }
+    rcu_read_unlock();
+
+    start_pages = dirtyrate_vcpu_dirty_pages(&nr_start_pages);
+    start_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    qemu_mutex_unlock_iothread();
+
+    g_usleep(config->calc_time * G_USEC_PER_SEC);
+
+    qemu_mutex_lock_iothread();
+    memory_global_dirty_log_sync();
+    elapsed_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) - start_ms;
+
+    rcu_read_lock();
+    dirty_pages = dirtyrate_count_dirty_log();
+    rcu_read_unlock();
+
+    /* Only TCG tells which vcpu dirtied a page */
+    if (tcg_enabled()) {
+        vcpu_dirty_rate = dirtyrate_vcpu_list(start_pages, nr_start_pages,
+                                              elapsed_ms);
+    }
+    g_free(start_pages);
+
+    memory_global_dirty_log_stop();
+    migrate_del_blocker(dirty_rate_state.blocker);
+    error_free(dirty_rate_state.blocker);
+    dirty_rate_state.blocker = NULL;
+
+    dirty_rate = dirtyrate_mbps(dirty_pages * TARGET_PAGE_SIZE, elapsed_ms);
+    trace_dirtyrate_measured("dirty-log", dirty_rate, elapsed_ms);
+    dirtyrate_publish(dirty_rate, vcpu_dirty_rate);
+    qemu_mutex_unlock_iothread();
+}
+
+static void *dirtyrate_thread(void *opaque)
+{
+    DirtyRateConfig *config = opaque;
+
+    rcu_register_thread();
+
+    if (config->mode == DIRTY_RATE_MEASURE_MODE_DIRTY_LOG) {
+        dirtyrate_measure_dirty_log(config);
+    } else {
+        dirtyrate_measure_page_sampling(config);
+    }
+    g_free(config);
+
+    rcu_unregister_thread();
+
+    return NULL;
+}
+
+void qmp_calc_dirty_rate(int64_t calc_time, bool has_sample_pages,
+                         int64_t sample_pages, bool has_mode,
+                         DirtyRateMeasureMode mode, Error **errp)
+{
+    DirtyRateConfig *config;
+    QemuThread thread;
+
+    if (dirty_rate_state.status == DIRTY_RATE_STATUS_MEASURING) {
+        error_setg(errp, "The dirty rate is already being measured");
+        return;
+    }
+
+    if (calc_time < DIRTYRATE_MIN_CALC_TIME ||
+        calc_time > DIRTYRATE_MAX_CALC_TIME) {
+        error_setg(errp, "Parameter 'calc-time' expects a value between "
+                   "%d and %d seconds", DIRTYRATE_MIN_CALC_TIME,
+                   DIRTYRATE_MAX_CALC_TIME);
+        return;
+    }
+
+    if (!has_sample_pages) {
+        sample_pages = DIRTYRATE_DEFAULT_SAMPLE_PAGES;
+    } else if (sample_pages < 1 || sample_pages > DIRTYRATE_MAX_SAMPLE_PAGES) {
+        error_setg(errp, "Parameter 'sample-pages' expects a value between "
+                   "1 and %d", DIRTYRATE_MAX_SAMPLE_PAGES);
+        return;
+    }
+
+    if (!has_mode) {
+        mode = DIRTY_RATE_MEASURE_MODE_PAGE_SAMPLING;
+    }
+
+    if (mode == DIRTY_RATE_MEASURE_MODE_DIRTY_LOG) {
+        /* Migration relies on owning dirty logging, keep it out */
+        error_setg(&dirty_rate_state.blocker,
+                   "The dirty rate is being measured with dirty logging");
+        if (migrate_add_blocker(dirty_rate_state.blocker, errp) < 0) {
+            error_free(dirty_rate_state.blocker);
+            dirty_rate_state.blocker = NULL;
+            return;
+        }
+    }
+
+    dirty_rate_state.status = DIRTY_RATE_STATUS_MEASURING;
+    dirty_rate_state.mode = mode;
+    dirty_rate_state.start_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) / 1000;
+    dirty_rate_state.calc_time = calc_time;
+
+    config = g_new0(DirtyRateConfig, 1);
+    config->mode = mode;
+    config->calc_time = calc_time;
+    config->sample_pages = sample_pages;
+    qemu_thread_create(&thread, "dirtyrate", dirtyrate_thread, config,
+                       QEMU_THREAD_DETACHED);
+}
+
+DirtyRateInfo *qmp_query_dirty_rate(Error **errp)
+{
+    DirtyRateInfo *info = g_new0(DirtyRateInfo, 1);
+
+    info->status = dirty_rate_state.status;
+    info->start_time = dirty_rate_state.start_time;
+    info->calc_time = dirty_rate_state.calc_time;
+    info->mode = dirty_rate_state.mode;
+
+    if (dirty_rate_state.status == DIRTY_RATE_STATUS_MEASURED) {
+        info->has_dirty_rate = true;
+        info->dirty_rate = dirty_rate_state.dirty_rate;
+        if (dirty_rate_state.vcpu_dirty_rate) {
+            info->has_vcpu_dirty_rate = true;
+            info->vcpu_dirty_rate = QAPI_CLONE(DirtyRateVcpuList,
+                                               dirty_rate_state.vcpu_dirty_rate);
+        }
+    }
+
+    return info;
+}
@@ -259,6 +259,12 @@ struct MigrationState
      * (which is in 4M chunk).
      */
     uint8_t clear_bitmap_shift;
+
+    /*
+     * Number of threads, besides the migration thread, that sync the
+     * dirty bitmap of large RAMBlocks.  Zero syncs serially.
+     */
+    uint8_t dirty_sync_threads;
 };
 
 void migrate_set_state(int *state, int old_state, int new_state);
@@ -293,9 +299,14 @@ bool migrate_dirty_bitmaps(void);
 bool migrate_ignore_shared(void);
 
 bool migrate_auto_converge(void);
+bool migrate_dirty_vcpu_throttle(void);
 bool migrate_use_multifd(void);
 bool migrate_pause_before_switchover(void);
 int migrate_multifd_channels(void);
+MultiFDCompression migrate_multifd_compression(void);
+int migrate_multifd_zlib_level(void);
+int migrate_multifd_zstd_level(void);
+ZeroPageDetection migrate_zero_page_detection(void);
 
 int migrate_use_xbzrle(void);
 int64_t migrate_xbzrle_cache_size(void);
@@ -0,0 +1,234 @@
+/*
+ * Multifd zlib compression implementation
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <zlib.h>
+#include "qapi/error.h"
+#include "exec/target_page.h"
+#include "migration.h"
+#include "multifd.h"
+
+struct zlib_data {
+    /* stream for compression or decompression */
+    z_stream zs;
+    /* compressed buffer */
+    uint8_t *zbuff;
+    /* size of compressed buffer */
+    uint32_t zbuff_len;
+};
+
+/*
+ * A packet is compressed as a sequence of pages ending with a sync
+ * flush, so the receiver can decode it without waiting for more data.
+ * The stream itself spans the whole migration and keeps its history
+ * from one packet to the next.
+ */
+static uint32_t zlib_buff_len(void)
+{
+    uint32_t page_count = MULTIFD_PACKET_SIZE / qemu_target_page_size();
+
+    /* Incompressible data can grow a bit, be generous. */
+    return page_count * qemu_target_page_size() * 2;
+}
+
+static int zlib_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    struct zlib_data *z = g_new0(struct zlib_data, 1);
+    z_stream *zs = &z->zs;
+
+    zs->zalloc = Z_NULL;
+    zs->zfree = Z_NULL;
+    zs->opaque = Z_NULL;
+    if (deflateInit(zs, migrate_multifd_zlib_level()) != Z_OK) {
+        g_free(z);
+        error_setg(errp, "multifd %d: deflate init failed", p->id);
+        return -1;
+    }
+    z->zbuff_len = zlib_buff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->zbuff) {
+        deflateEnd(zs);
+        g_free(z);
+        error_setg(errp, "multifd %d: out of memory for zbuff", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+static void zlib_send_cleanup(MultiFDSendParams *p)
+{
+    struct zlib_data *z = p->data;
+
+    if (!z) {
+        return;
+    }
+    deflateEnd(&z->zs);
+    g_free(z->zbuff);
+    g_free(z);
+    p->data = NULL;
+}
+
+static int zlib_send_prepare(MultiFDSendParams *p, uint32_t used,
+                             Error **errp)
+{
+    struct iovec *iov = p->pages->iov;
+    struct zlib_data *z = p->data;
+    z_stream *zs = &z->zs;
+    uint32_t out_size = 0;
+    uint32_t i;
+    int ret;
+
+    for (i = 0; i < used; i++) {
+        uint32_t available = z->zbuff_len - out_size;
+        int flush = i == used - 1 ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+
+        zs->avail_in = iov[i].iov_len;
+        zs->next_in = iov[i].iov_base;
+
+        zs->avail_out = available;
+        zs->next_out = z->zbuff + out_size;
+
+        /*
+         * deflate() may need several calls to consume all input; keep
+         * going while it makes progress and there is room for output.
+         * Running out of room may leave part of the flush pending, so
+         * treat a full buffer as a failure too.
+         */
+        do {
+            ret = deflate(zs, flush);
+        } while (ret == Z_OK && zs->avail_in && zs->avail_out);
+        if (ret == Z_OK && (zs->avail_in || !zs->avail_out)) {
+            error_setg(errp, "multifd %d: deflate failed to compress all input",
+                       p->id);
+            return -1;
+        }
+        if (ret != Z_OK) {
+            error_setg(errp, "multifd %d: deflate returned %d instead of Z_OK",
+                       p->id, ret);
+            return -1;
+        }
+        out_size += available - zs->avail_out;
+    }
+    p->next_packet_size = out_size;
+
+    return 0;
+}
+
+static int zlib_send_write(MultiFDSendParams *p, uint32_t used, Error **errp)
+{
+    struct zlib_data *z = p->data;
+
+    return qio_channel_write_all(p->c, (void *)z->zbuff, p->next_packet_size,
+                                 errp);
+}
+
+static int zlib_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    struct zlib_data *z = g_new0(struct zlib_data, 1);
+    z_stream *zs = &z->zs;
+
+    zs->zalloc = Z_NULL;
+    zs->zfree = Z_NULL;
+    zs->opaque = Z_NULL;
+    zs->avail_in = 0;
+    zs->next_in = NULL;
+    if (inflateInit(zs) != Z_OK) {
+        g_free(z);
+        error_setg(errp, "multifd %d: inflate init failed", p->id);
+        return -1;
+    }
+    z->zbuff_len = zlib_buff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->zbuff) {
+        inflateEnd(zs);
+        g_free(z);
+        error_setg(errp, "multifd %d: out of memory for zbuff", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+static void zlib_recv_cleanup(MultiFDRecvParams *p)
+{
+    struct zlib_data *z = p->data;
+
+    if (!z) {
+        return;
+    }
+    inflateEnd(&z->zs);
+    g_free(z->zbuff);
+    g_free(z);
+    p->data = NULL;
+}
+
+static int zlib_recv_pages(MultiFDRecvParams *p, uint32_t used, Error **errp)
+{
+    struct zlib_data *z = p->data;
+    z_stream *zs = &z->zs;
+    uint32_t in_size = p->next_packet_size;
+    uint32_t expected_size = used * qemu_target_page_size();
+    uint32_t out_size = 0;
+    uint32_t i;
+    int ret;
+
+    if (in_size > z->zbuff_len) {
+        error_setg(errp, "multifd %d: compressed packet of %d bytes "
+                   "exceeds buffer size %d", p->id, in_size, z->zbuff_len);
+        return -1;
+    }
+
+    ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
+    if (ret != 0) {
+        return ret;
+    }
+
+    zs->avail_in = in_size;
+    zs->next_in = z->zbuff;
+
+    for (i = 0; i < used; i++) {
+        struct iovec *iov = &p->pages->iov[i];
+        int flush = i == used - 1 ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+
+        zs->avail_out = iov->iov_len;
+        zs->next_out = iov->iov_base;
+
+        do {
+            ret = inflate(zs, flush);
+        } while (ret == Z_OK && zs->avail_in && zs->avail_out);
+        if (ret == Z_OK && zs->avail_out) {
+            error_setg(errp, "multifd %d: inflate generated too few output",
+                       p->id);
+            return -1;
+        }
+        if (ret != Z_OK) {
+            error_setg(errp, "multifd %d: inflate returned %d instead of Z_OK",
+                       p->id, ret);
+            return -1;
+        }
+        out_size += iov->iov_len - zs->avail_out;
+    }
+
+    if (out_size != expected_size) {
+        error_setg(errp, "multifd %d: packet size received %d size expected %d",
+                   p->id, out_size, expected_size);
+        return -1;
+    }
+    return 0;
+}
+
+MultiFDMethods multifd_zlib_ops = {
+    .flag = MULTIFD_FLAG_ZLIB,
+    .send_setup = zlib_send_setup,
+    .send_cleanup = zlib_send_cleanup,
+    .send_prepare = zlib_send_prepare,
+    .send_write = zlib_send_write,
+    .recv_setup = zlib_recv_setup,
+    .recv_cleanup = zlib_recv_cleanup,
+    .recv_pages = zlib_recv_pages
+};
@@ -0,0 +1,252 @@
+/*
+ * Multifd zstd compression implementation
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <zstd.h>
+#include "qapi/error.h"
+#include "exec/target_page.h"
+#include "migration.h"
+#include "multifd.h"
+
+struct zstd_data {
+    /* stream for compression */
+    ZSTD_CStream *zcs;
+    /* stream for decompression */
+    ZSTD_DStream *zds;
+    /* buffers */
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    /* compressed buffer */
+    uint8_t *zbuff;
+    /* size of compressed buffer */
+    uint32_t zbuff_len;
+};
+
+/*
+ * As with zlib, every packet ends with a flush and the stream is kept
+ * for the whole migration, so later packets can refer back to data
+ * that the channel has already sent.
+ */
+static uint32_t zstd_buff_len(void)
+{
+    uint32_t page_count = MULTIFD_PACKET_SIZE / qemu_target_page_size();
+
+    return ZSTD_compressBound(page_count * qemu_target_page_size());
+}
+
+static int zstd_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    struct zstd_data *z = g_new0(struct zstd_data, 1);
+    int level = migrate_multifd_zstd_level();
+    size_t res;
+
+    z->zcs = ZSTD_createCStream();
+    if (!z->zcs) {
+        g_free(z);
+        error_setg(errp, "multifd %d: zstd createCStream failed", p->id);
+        return -1;
+    }
+
+    res = ZSTD_initCStream(z->zcs, level);
+    if (ZSTD_isError(res)) {
+        ZSTD_freeCStream(z->zcs);
+        g_free(z);
+        error_setg(errp, "multifd %d: initCStream failed with error %s",
+                   p->id, ZSTD_getErrorName(res));
+        return -1;
+    }
+    z->zbuff_len = zstd_buff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->zbuff) {
+        ZSTD_freeCStream(z->zcs);
+        g_free(z);
+        error_setg(errp, "multifd %d: out of memory for zbuff", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+static void zstd_send_cleanup(MultiFDSendParams *p)
+{
+    struct zstd_data *z = p->data;
+
+    if (!z) {
+        return;
+    }
+    ZSTD_freeCStream(z->zcs);
+    g_free(z->zbuff);
+    g_free(z);
+    p->data = NULL;
+}
+
+static int zstd_send_prepare(MultiFDSendParams *p, uint32_t used,
+                             Error **errp)
+{
+    struct iovec *iov = p->pages->iov;
+    struct zstd_data *z = p->data;
+    size_t ret;
+    uint32_t i;
+
+    z->out.dst = z->zbuff;
+    z->out.size = z->zbuff_len;
+    z->out.pos = 0;
+
+    for (i = 0; i < used; i++) {
+        ZSTD_EndDirective flush = i == used - 1 ? ZSTD_e_flush
+                                                : ZSTD_e_continue;
+
+        z->in.src = iov[i].iov_base;
+        z->in.size = iov[i].iov_len;
+        z->in.pos = 0;
+
+        /*
+         * Keep going while there is input left or, for the last page,
+         * while the flush is incomplete, as long as there is room for
+         * output.
+         */
+        do {
+            ret = ZSTD_compressStream2(z->zcs, &z->out, &z->in, flush);
+        } while (!ZSTD_isError(ret) && z->out.pos < z->out.size &&
+                 (z->in.pos < z->in.size ||
+                  (flush == ZSTD_e_flush && ret > 0)));
+        if (ZSTD_isError(ret)) {
+            error_setg(errp, "multifd %d: compressStream error %s",
+                       p->id, ZSTD_getErrorName(ret));
+            return -1;
+        }
+        if (z->in.pos < z->in.size || (flush == ZSTD_e_flush && ret > 0)) {
+            error_setg(errp, "multifd %d: compressStream buffer too small",
+                       p->id);
+            return -1;
+        }
+    }
+    p->next_packet_size = z->out.pos;
+
+    return 0;
+}
+
+static int zstd_send_write(MultiFDSendParams *p, uint32_t used, Error **errp)
+{
+    struct zstd_data *z = p->data;
+
+    return qio_channel_write_all(p->c, (void *)z->zbuff, p->next_packet_size,
+                                 errp);
+}
+
+static int zstd_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    struct zstd_data *z = g_new0(struct zstd_data, 1);
+    size_t ret;
+
+    z->zds = ZSTD_createDStream();
+    if (!z->zds) {
+        g_free(z);
+        error_setg(errp, "multifd %d: zstd createDStream failed", p->id);
+        return -1;
+    }
+
+    ret = ZSTD_initDStream(z->zds);
+    if (ZSTD_isError(ret)) {
+        ZSTD_freeDStream(z->zds);
+        g_free(z);
+        error_setg(errp, "multifd %d: initDStream failed with error %s",
+                   p->id, ZSTD_getErrorName(ret));
+        return -1;
+    }
+
+    z->zbuff_len = zstd_buff_len();
+    z->zbuff = g_try_malloc(z->zbuff_len);
+    if (!z->zbuff) {
+        ZSTD_freeDStream(z->zds);
+        g_free(z);
+        error_setg(errp, "multifd %d: out of memory for zbuff", p->id);
+        return -1;
+    }
+    p->data = z;
+    return 0;
+}
+
+static void zstd_recv_cleanup(MultiFDRecvParams *p)
+{
+    struct zstd_data *z = p->data;
+
+    if (!z) {
+        return;
+    }
+    ZSTD_freeDStream(z->zds);
+    g_free(z->zbuff);
+    g_free(z);
+    p->data = NULL;
+}
+
+static int zstd_recv_pages(MultiFDRecvParams *p, uint32_t used, Error **errp)
+{
+    struct zstd_data *z = p->data;
+    uint32_t in_size = p->next_packet_size;
+    uint32_t expected_size = used * qemu_target_page_size();
+    uint32_t out_size = 0;
+    size_t ret;
+    uint32_t i;
+
+    if (in_size > z->zbuff_len) {
+        error_setg(errp, "multifd %d: compressed packet of %d bytes "
+                   "exceeds buffer size %d", p->id, in_size, z->zbuff_len);
+        return -1;
+    }
+
+    ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
+    if (ret != 0) {
+        return -1;
+    }
+
+    z->in.src = z->zbuff;
+    z->in.size = in_size;
+    z->in.pos = 0;
+
+    for (i = 0; i < used; i++) {
+        struct iovec *iov = &p->pages->iov[i];
+
+        z->out.dst = iov->iov_base;
+        z->out.size = iov->iov_len;
+        z->out.pos = 0;
+
+        do {
+            ret = ZSTD_decompressStream(z->zds, &z->out, &z->in);
+        } while (!ZSTD_isError(ret) && z->in.pos < z->in.size &&
+                 z->out.pos < z->out.size);
+        if (ZSTD_isError(ret)) {
+            error_setg(errp, "multifd %d: decompressStream returned %s",
+                       p->id, ZSTD_getErrorName(ret));
+            return -1;
+        }
+        if (z->out.pos < z->out.size) {
+            error_setg(errp, "multifd %d: decompressStream generated "
+                       "too few output", p->id);
+            return -1;
+        }
+        out_size += z->out.pos;
+    }
+
+    if (out_size != expected_size) {
+        error_setg(errp, "multifd %d: packet size received %d size expected %d",
+                   p->id, out_size, expected_size);
+        return -1;
+    }
+    return 0;
+}
+
+MultiFDMethods multifd_zstd_ops = {
+    .flag = MULTIFD_FLAG_ZSTD,
+    .send_setup = zstd_send_setup,
+    .send_cleanup = zstd_send_cleanup,
+    .send_prepare = zstd_send_prepare,
+    .send_write = zstd_send_write,
+    .recv_setup = zstd_recv_setup,
+    .recv_cleanup = zstd_recv_cleanup,
+    .recv_pages = zstd_recv_pages
+};
@@ -0,0 +1,203 @@
+/*
+ * Multifd common definitions
+ *
+ * Split out of migration/ram.c.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_MIGRATION_MULTIFD_H
+#define QEMU_MIGRATION_MULTIFD_H
+
+#include "qapi/qapi-types-migration.h"
+#include "exec/cpu-common.h"
+#include "io/channel.h"
+#include "qemu/thread.h"
+
+#define MULTIFD_FLAG_SYNC (1 << 0)
+
+/* We reserve 4 bits for compression methods */
+#define MULTIFD_FLAG_COMPRESSION_MASK (0xf << 1)
+/* we need to be compatible. Before compression value was 0 */
+#define MULTIFD_FLAG_NOCOMP (0 << 1)
+#define MULTIFD_FLAG_ZLIB (1 << 1)
+#define MULTIFD_FLAG_ZSTD (2 << 1)
+
+/*
+ * The header is followed by a bitmap of the zero pages in the packet,
+ * one bit per page, least significant bit of the first byte first.
+ * Only the other pages are sent.
+ */
+#define MULTIFD_FLAG_ZERO_BITMAP (1 << 5)
+
+/* This value needs to be a multiple of qemu_target_page_size() */
+#define MULTIFD_PACKET_SIZE (512 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    unsigned char uuid[16]; /* QemuUUID */
+    uint8_t id;
+    uint8_t unused1[7];     /* Reserved for future use */
+    uint64_t unused2[4];    /* Reserved for future use */
+} __attribute__((packed)) MultiFDInit_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    /* maximum number of allocated pages */
+    uint32_t pages_alloc;
+    uint32_t pages_used;
+    /* size of the next packet that contains pages */
+    uint32_t next_packet_size;
+    uint64_t packet_num;
+    uint64_t unused[4];    /* Reserved for future use */
+    char ramblock[256];
+    uint64_t offset[];
+} __attribute__((packed)) MultiFDPacket_t;
+
+typedef struct {
+    /* number of used pages */
+    uint32_t used;
+    /* number of allocated pages */
+    uint32_t allocated;
+    /* global number of generated multifd packets */
+    uint64_t packet_num;
+    /* offset of each page */
+    ram_addr_t *offset;
+    /* pointer to each page */
+    struct iovec *iov;
+    RAMBlock *block;
+} MultiFDPages_t;
+
+typedef struct {
+    /* this fields are not changed once the thread is created */
+    /* channel number */
+    uint8_t id;
+    /* channel thread name */
+    char *name;
+    /* channel thread id */
+    QemuThread thread;
+    /* communication channel */
+    QIOChannel *c;
+    /* sem where to wait for more work */
+    QemuSemaphore sem;
+    /* this mutex protects the following parameters */
+    QemuMutex mutex;
+    /* is this channel thread running */
+    bool running;
+    /* should this thread finish */
+    bool quit;
+    /* thread has work to do */
+    int pending_job;
+    /* array of pages to sent */
+    MultiFDPages_t *pages;
+    /* packet allocated len */
+    uint32_t packet_len;
+    /* pointer to the packet */
+    MultiFDPacket_t *packet;
+    /* multifd flags for each packet */
+    uint32_t flags;
+    /* global number of generated multifd packets */
+    uint64_t packet_num;
+    /* bytes written since the migration thread last collected them */
+    uint64_t sent_bytes;
+    /* pages sent since the migration thread last collected them */
+    uint64_t sent_normal_pages;
+    /* zero pages found since the migration thread last collected them */
+    uint64_t sent_zero_pages;
+    /* thread local variables */
+    /* size of the next packet that contains pages */
+    uint32_t next_packet_size;
+    /* packets sent through this channel */
+    uint64_t num_packets;
+    /* pages sent through this channel */
+    uint64_t num_pages;
+    /* zero page bitmap of the packet being sent */
+    uint8_t *zero_bitmap;
+    /* compression method private data */
+    void *data;
+}  MultiFDSendParams;
+
+typedef struct {
+    /* this fields are not changed once the thread is created */
+    /* channel number */
+    uint8_t id;
+    /* channel thread name */
+    char *name;
+    /* channel thread id */
+    QemuThread thread;
+    /* communication channel */
+    QIOChannel *c;
+    /* this mutex protects the following parameters */
+    QemuMutex mutex;
+    /* is this channel thread running */
+    bool running;
+    /* array of pages to receive */
+    MultiFDPages_t *pages;
+    /* packet allocated len */
+    uint32_t packet_len;
+    /* pointer to the packet */
+    MultiFDPacket_t *packet;
+    /* multifd flags for each packet */
+    uint32_t flags;
+    /* global number of generated multifd packets */
+    uint64_t packet_num;
+    /* thread local variables */
+    /* size of the next packet that contains pages */
+    uint32_t next_packet_size;
+    /* packets sent through this channel */
+    uint64_t num_packets;
+    /* pages sent through this channel */
+    uint64_t num_pages;
+    /* syncs main thread and channels */
+    QemuSemaphore sem_sync;
+    /* zero page bitmap of the packet being received */
+    uint8_t *zero_bitmap;
+    /* size of zero_bitmap in bytes */
+    uint32_t zero_bitmap_len;
+    /* compression method private data */
+    void *data;
+} MultiFDRecvParams;
+
+/*
+ * A compression method for the multifd channels.  All hooks run in the
+ * channel thread except setup and cleanup, which run in the thread that
+ * sets up or tears down the channels; method state lives in p->data and
+ * so is private to one channel, which allows methods to keep a
+ * streaming context across packets.
+ */
+typedef struct {
+    /* MULTIFD_FLAG_* value identifying the method on the wire */
+    uint32_t flag;
+    /* Setup for sending side */
+    int (*send_setup)(MultiFDSendParams *p, Error **errp);
+    /* Cleanup for sending side, p->data may be NULL */
+    void (*send_cleanup)(MultiFDSendParams *p);
+    /*
+     * Prepare the @used pages in p->pages for sending, setting
+     * p->next_packet_size to the number of bytes that send_write
+     * will put on the wire
+     */
+    int (*send_prepare)(MultiFDSendParams *p, uint32_t used, Error **errp);
+    /* Write the data prepared by send_prepare */
+    int (*send_write)(MultiFDSendParams *p, uint32_t used, Error **errp);
+    /* Setup for receiving side */
+    int (*recv_setup)(MultiFDRecvParams *p, Error **errp);
+    /* Cleanup for receiving side, p->data may be NULL */
+    void (*recv_cleanup)(MultiFDRecvParams *p);
+    /*
+     * Read p->next_packet_size bytes and fill the @used pages in
+     * p->pages with them
+     */
+    int (*recv_pages)(MultiFDRecvParams *p, uint32_t used, Error **errp);
+} MultiFDMethods;
+
+extern MultiFDMethods multifd_zlib_ops;
+#ifdef CONFIG_ZSTD
+extern MultiFDMethods multifd_zstd_ops;
+#endif
+
+#endif
@@ -56,6 +56,7 @@
 #include "sysemu/sysemu.h"
 #include "qemu/uuid.h"
 #include "savevm.h"
+#include "multifd.h"
 #include "qemu/iov.h"
 
 /***********************************************************/
@@ -327,6 +328,12 @@ struct RAMState {
     uint64_t bytes_xfer_prev;
     /* number of dirty pages since start_time */
     uint64_t num_dirty_pages_period;
+    /* CPUState::dirty_pages of each vcpu at start_time, by cpu_index */
+    uint64_t *vcpu_dirty_pages_prev;
+    /* pages dirtied by each vcpu in the last period, by cpu_index */
+    uint64_t *vcpu_dirty_pages_period;
+    /* number of entries of the two arrays above */
+    int nr_vcpu_dirty_pages;
     /* xbzrle misses since the beginning of the period */
     uint64_t xbzrle_cache_miss_prev;
 
@@ -581,123 +588,6 @@ exit:
 #define MULTIFD_MAGIC 0x11223344U
 #define MULTIFD_VERSION 1
 
-#define MULTIFD_FLAG_SYNC (1 << 0)
-
-/* This value needs to be a multiple of qemu_target_page_size() */
-#define MULTIFD_PACKET_SIZE (512 * 1024)
-
-typedef struct {
-    uint32_t magic;
-    uint32_t version;
-    unsigned char uuid[16]; /* QemuUUID */
-    uint8_t id;
-    uint8_t unused1[7];     /* Reserved for future use */
-    uint64_t unused2[4];    /* Reserved for future use */
-} __attribute__((packed)) MultiFDInit_t;
-
-typedef struct {
-    uint32_t magic;
-    uint32_t version;
-    uint32_t flags;
-    /* maximum number of allocated pages */
-    uint32_t pages_alloc;
-    uint32_t pages_used;
-    /* size of the next packet that contains pages */
-    uint32_t next_packet_size;
-    uint64_t packet_num;
-    uint64_t unused[4];    /* Reserved for future use */
-    char ramblock[256];
-    uint64_t offset[];
-} __attribute__((packed)) MultiFDPacket_t;
-
-typedef struct {
-    /* number of used pages */
-    uint32_t used;
-    /* number of allocated pages */
-    uint32_t allocated;
-    /* global number of generated multifd packets */
-    uint64_t packet_num;
-    /* offset of each page */
-    ram_addr_t *offset;
-    /* pointer to each page */
-    struct iovec *iov;
-    RAMBlock *block;
-} MultiFDPages_t;
-
-typedef struct {
-    /* this fields are not changed once the thread is created */
-    /* channel number */
-    uint8_t id;
-    /* channel thread name */
-    char *name;
-    /* channel thread id */
-    QemuThread thread;
-    /* communication channel */
-    QIOChannel *c;
-    /* sem where to wait for more work */
-    QemuSemaphore sem;
-    /* this mutex protects the following parameters */
-    QemuMutex mutex;
-    /* is this channel thread running */
-    bool running;
-    /* should this thread finish */
-    bool quit;
-    /* thread has work to do */
-    int pending_job;
-    /* array of pages to sent */
-    MultiFDPages_t *pages;
-    /* packet allocated len */
-    uint32_t packet_len;
-    /* pointer to the packet */
-    MultiFDPacket_t *packet;
-    /* multifd flags for each packet */
-    uint32_t flags;
-    /* size of the next packet that contains pages */
-    uint32_t next_packet_size;
-    /* global number of generated multifd packets */
-    uint64_t packet_num;
-    /* thread local variables */
-    /* packets sent through this channel */
-    uint64_t num_packets;
-    /* pages sent through this channel */
-    uint64_t num_pages;
-}  MultiFDSendParams;
-
-typedef struct {
-    /* this fields are not changed once the thread is created */
-    /* channel number */
-    uint8_t id;
-    /* channel thread name */
-    char *name;
-    /* channel thread id */
-    QemuThread thread;
-    /* communication channel */
-    QIOChannel *c;
-    /* this mutex protects the following parameters */
-    QemuMutex mutex;
-    /* is this channel thread running */
-    bool running;
-    /* array of pages to receive */
-    MultiFDPages_t *pages;
-    /* packet allocated len */
-    uint32_t packet_len;
-    /* pointer to the packet */
-    MultiFDPacket_t *packet;
-    /* multifd flags for each packet */
-    uint32_t flags;
-    /* global number of generated multifd packets */
-    uint64_t packet_num;
-    /* thread local variables */
-    /* size of the next packet that contains pages */
-    uint32_t next_packet_size;
-    /* packets sent through this channel */
-    uint64_t num_packets;
-    /* pages sent through this channel */
-    uint64_t num_pages;
-    /* syncs main thread and channels */
-    QemuSemaphore sem_sync;
-} MultiFDRecvParams;
-
 static int multifd_send_initial_packet(MultiFDSendParams *p, Error **errp)
 {
     MultiFDInit_t msg;
@@ -784,7 +674,72 @@ static void multifd_pages_clear(MultiFDPages_t *pages)
     g_free(pages);
 }
 
-static void multifd_send_fill_packet(MultiFDSendParams *p)
+/* Multifd without compression */
+
+static int nocomp_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    return 0;
+}
+
+static void nocomp_send_cleanup(MultiFDSendParams *p)
+{
+}
+
+static int nocomp_send_prepare(MultiFDSendParams *p, uint32_t used,
+                               Error **errp)
+{
+    p->next_packet_size = used * qemu_target_page_size();
+    return 0;
+}
+
+static int nocomp_send_write(MultiFDSendParams *p, uint32_t used,
+                             Error **errp)
+{
+    return qio_channel_writev_all(p->c, p->pages->iov, used, errp);
+}
+
+static int nocomp_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    return 0;
+}
+
+static void nocomp_recv_cleanup(MultiFDRecvParams *p)
+{
+}
+
+static int nocomp_recv_pages(MultiFDRecvParams *p, uint32_t used,
+                             Error **errp)
+{
+    if (p->next_packet_size != used * qemu_target_page_size()) {
+        error_setg(errp, "multifd %d: packet size received %d "
+                   "size expected %d", p->id, p->next_packet_size,
+                   used * qemu_target_page_size());
+        return -1;
+    }
+    return qio_channel_readv_all(p->c, p->pages->iov, used, errp);
+}
+
+static MultiFDMethods multifd_nocomp_ops = {
+    .flag = MULTIFD_FLAG_NOCOMP,
+    .send_setup = nocomp_send_setup,
+    .send_cleanup = nocomp_send_cleanup,
+    .send_prepare = nocomp_send_prepare,
+    .send_write = nocomp_send_write,
+    .recv_setup = nocomp_recv_setup,
+    .recv_cleanup = nocomp_recv_cleanup,
+    .recv_pages = nocomp_recv_pages
+};
+
+static MultiFDMethods *multifd_ops[MULTIFD_COMPRESSION__MAX] = {
+    [MULTIFD_COMPRESSION_NONE] = &multifd_nocomp_ops,
+    [MULTIFD_COMPRESSION_ZLIB] = &multifd_zlib_ops,
+#ifdef CONFIG_ZSTD
+    [MULTIFD_COMPRESSION_ZSTD] = &multifd_zstd_ops,
+#endif
+};
+
+static void multifd_send_fill_packet(MultiFDSendParams *p, uint32_t flags,
+                                     uint64_t packet_num, uint32_t used)
 {
     MultiFDPacket_t *packet = p->packet;
     uint32_t page_max = MULTIFD_PACKET_SIZE / qemu_target_page_size();
@@ -792,21 +747,68 @@ static void multifd_send_fill_packet(MultiFDSendParams *p)
 
     packet->magic = cpu_to_be32(MULTIFD_MAGIC);
     packet->version = cpu_to_be32(MULTIFD_VERSION);
-    packet->flags = cpu_to_be32(p->flags);
+    packet->flags = cpu_to_be32(flags);
     packet->pages_alloc = cpu_to_be32(page_max);
-    packet->pages_used = cpu_to_be32(p->pages->used);
+    packet->pages_used = cpu_to_be32(used);
     packet->next_packet_size = cpu_to_be32(p->next_packet_size);
-    packet->packet_num = cpu_to_be64(p->packet_num);
+    packet->packet_num = cpu_to_be64(packet_num);
 
     if (p->pages->block) {
         strncpy(packet->ramblock, p->pages->block->idstr, 256);
     }
 
-    for (i = 0; i < p->pages->used; i++) {
+    for (i = 0; i < used; i++) {
         packet->offset[i] = cpu_to_be64(p->pages->offset[i]);
     }
 }
 
+/*
+ * Record the zero pages among the first @used ones in p->zero_bitmap
+ * and pack the iovecs of the others at the start of p->pages->iov, so
+ * that the compression method only sees pages it has to send.
+ *
+ * Returns the number of pages that are not zero.
+ */
+static uint32_t multifd_send_zero_scan(MultiFDSendParams *p, uint32_t used)
+{
+    struct iovec *iov = p->pages->iov;
+    uint32_t normal = 0;
+    uint32_t i;
+
+    memset(p->zero_bitmap, 0, DIV_ROUND_UP(used, 8));
+    for (i = 0; i < used; i++) {
+        if (buffer_is_zero(iov[i].iov_base, iov[i].iov_len)) {
+            p->zero_bitmap[i / 8] |= 1 << (i % 8);
+        } else {
+            iov[normal++] = iov[i];
+        }
+    }
+    return normal;
+}
+
+/*
+ * Counterpart of multifd_send_zero_scan: clear the zero pages, unless
+ * they are zero already, and pack the iovecs of the pages whose data
+ * follows.
+ *
+ * Returns the number of pages that are not zero.
+ */
+static uint32_t multifd_recv_zero_fill(MultiFDRecvParams *p, uint32_t used)
+{
+    struct iovec *iov = p->pages->iov;
+    uint32_t normal = 0;
+    uint32_t i;
+
+    for (i = 0; i < used; i++) {
+        if (p->zero_bitmap[i / 8] & (1 << (i % 8))) {
+            ram_handle_compressed(iov[i].iov_base, 0, iov[i].iov_len);
+        } else {
+            iov[normal++] = iov[i];
+        }
+    }
+    return normal;
+}
+
 static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
 {
     MultiFDPacket_t *packet = p->packet;
@@ -892,6 +894,10 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
 
 struct {
     MultiFDSendParams *params;
+    /* compression method used by the channels */
+    MultiFDMethods *ops;
+    /* the channels look for zero pages */
+    bool zero_page_detection;
     /* array of pages to sent */
     MultiFDPages_t *pages;
     /* syncs main thread and channels */
@@ -920,13 +926,24 @@ struct {
  * false.
  */
 
+/* Called with p->mutex held */
+static void multifd_send_collect_stats(MultiFDSendParams *p)
+{
+    ram_counters.multifd_bytes += p->sent_bytes;
+    ram_counters.transferred += p->sent_bytes;
+    ram_counters.normal += p->sent_normal_pages;
+    ram_counters.duplicate += p->sent_zero_pages;
+    p->sent_bytes = 0;
+    p->sent_normal_pages = 0;
+    p->sent_zero_pages = 0;
+}
+
 static void multifd_send_pages(void)
 {
     int i;
     static int next_channel;
     MultiFDSendParams *p = NULL; /* make happy gcc */
     MultiFDPages_t *pages = multifd_send_state->pages;
-    uint64_t transferred;
 
     qemu_sem_wait(&multifd_send_state->channels_ready);
     for (i = next_channel;; i = (i + 1) % migrate_multifd_channels()) {
@@ -946,9 +963,12 @@ static void multifd_send_pages(void)
     p->pages->block = NULL;
     multifd_send_state->pages = p->pages;
     p->pages = pages;
-    transferred = ((uint64_t) pages->used) * TARGET_PAGE_SIZE + p->packet_len;
-    ram_counters.multifd_bytes += transferred;
-    ram_counters.transferred += transferred;;
+    /*
+     * The size of a packet and the number of zero pages in it are only
+     * known once the channel has written it, so account what the
+     * channel reports for its previous packets.
+     */
+    multifd_send_collect_stats(p);
     qemu_mutex_unlock(&p->mutex);
     qemu_sem_post(&p->sem);
 }
@@ -1030,6 +1050,9 @@ void multifd_save_cleanup(void)
         p->packet_len = 0;
         g_free(p->packet);
         p->packet = NULL;
+        g_free(p->zero_bitmap);
+        p->zero_bitmap = NULL;
+        multifd_send_state->ops->send_cleanup(p);
     }
     qemu_sem_destroy(&multifd_send_state->channels_ready);
     qemu_sem_destroy(&multifd_send_state->sem_sync);
@@ -1070,6 +1093,13 @@ static void multifd_send_sync_main(void)
         trace_multifd_send_sync_main_wait(p->id);
         qemu_sem_wait(&multifd_send_state->sem_sync);
     }
+    for (i = 0; i < migrate_multifd_channels(); i++) {
+        MultiFDSendParams *p = &multifd_send_state->params[i];
+
+        qemu_mutex_lock(&p->mutex);
+        multifd_send_collect_stats(p);
+        qemu_mutex_unlock(&p->mutex);
+    }
     trace_multifd_send_sync_main(multifd_send_state->packet_num);
 }
 
@@ -1093,30 +1123,57 @@ static void *multifd_send_thread(void *opaque)
         qemu_mutex_lock(&p->mutex);
 
         if (p->pending_job) {
+            MultiFDMethods *ops = multifd_send_state->ops;
+            struct iovec iov[2];
+            unsigned int niov;
+            uint32_t normal;
             uint32_t used = p->pages->used;
             uint64_t packet_num = p->packet_num;
             uint32_t flags = p->flags;
 
-            p->next_packet_size = used * qemu_target_page_size();
-            multifd_send_fill_packet(p);
             p->flags = 0;
             p->num_packets++;
             p->num_pages += used;
             p->pages->used = 0;
             qemu_mutex_unlock(&p->mutex);
 
+            /*
+             * The pages belong to this channel until pending_job drops,
+             * so scan and compress them without holding the mutex; the
+             * migration thread takes it to look for an idle channel.
+             */
+            normal = used;
+            iov[0].iov_base = p->packet;
+            iov[0].iov_len = p->packet_len;
+            niov = 1;
+            if (used && multifd_send_state->zero_page_detection) {
+                normal = multifd_send_zero_scan(p, used);
+                flags |= MULTIFD_FLAG_ZERO_BITMAP;
+                iov[1].iov_base = p->zero_bitmap;
+                iov[1].iov_len = DIV_ROUND_UP(used, 8);
+                niov = 2;
+            }
+
+            p->next_packet_size = 0;
+            if (normal) {
+                ret = ops->send_prepare(p, normal, &local_err);
+                if (ret != 0) {
+                    break;
+                }
+                flags |= ops->flag;
+            }
+            multifd_send_fill_packet(p, flags, packet_num, used);
+
             trace_multifd_send(p->id, packet_num, used, flags,
                                p->next_packet_size);
 
-            ret = qio_channel_write_all(p->c, (void *)p->packet,
-                                        p->packet_len, &local_err);
+            ret = qio_channel_writev_all(p->c, iov, niov, &local_err);
             if (ret != 0) {
                 break;
             }
 
-            if (used) {
-                ret = qio_channel_writev_all(p->c, p->pages->iov,
-                                             used, &local_err);
+            if (normal) {
+                ret = ops->send_write(p, normal, &local_err);
                 if (ret != 0) {
                     break;
                 }
@@ -1124,6 +1181,9 @@ static void *multifd_send_thread(void *opaque)
 
             qemu_mutex_lock(&p->mutex);
             p->pending_job--;
+            p->sent_bytes += iov_size(iov, niov) + p->next_packet_size;
+            p->sent_normal_pages += normal;
+            p->sent_zero_pages += used - normal;
             qemu_mutex_unlock(&p->mutex);
 
             if (flags & MULTIFD_FLAG_SYNC) {
@@ -1185,6 +1245,9 @@ int multifd_save_setup(void)
     multifd_send_state = g_malloc0(sizeof(*multifd_send_state));
     multifd_send_state->params = g_new0(MultiFDSendParams, thread_count);
     multifd_send_state->pages = multifd_pages_init(page_count);
+    multifd_send_state->ops = multifd_ops[migrate_multifd_compression()];
+    multifd_send_state->zero_page_detection =
+        migrate_zero_page_detection() == ZERO_PAGE_DETECTION_MULTIFD;
     qemu_sem_init(&multifd_send_state->sem_sync, 0);
     qemu_sem_init(&multifd_send_state->channels_ready, 0);
 
@@ -1200,7 +1263,23 @@ int multifd_save_setup(void)
         p->packet_len = sizeof(MultiFDPacket_t)
                       + sizeof(ram_addr_t) * page_count;
         p->packet = g_malloc0(p->packet_len);
+        p->zero_bitmap = g_malloc0(DIV_ROUND_UP(page_count, 8));
         p->name = g_strdup_printf("multifdsend_%d", i);
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        MultiFDSendParams *p = &multifd_send_state->params[i];
+        Error *local_err = NULL;
+
+        if (multifd_send_state->ops->send_setup(p, &local_err)) {
+            error_report_err(local_err);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        MultiFDSendParams *p = &multifd_send_state->params[i];
+
         socket_send_channel_create(multifd_new_send_channel_async, p);
     }
     return 0;
@@ -1208,6 +1287,8 @@ int multifd_save_setup(void)
 
 struct {
     MultiFDRecvParams *params;
+    /* compression method used by the channels */
+    MultiFDMethods *ops;
     /* number of created threads */
     int count;
     /* syncs main thread and channels */
@@ -1269,6 +1350,10 @@ int multifd_load_cleanup(Error **errp)
         p->packet_len = 0;
         g_free(p->packet);
         p->packet = NULL;
+        g_free(p->zero_bitmap);
+        p->zero_bitmap = NULL;
+        p->zero_bitmap_len = 0;
+        multifd_recv_state->ops->recv_cleanup(p);
     }
     qemu_sem_destroy(&multifd_recv_state->sem_sync);
     g_free(multifd_recv_state->params);
@@ -1317,6 +1402,7 @@ static void *multifd_recv_thread(void *opaque)
 
     while (true) {
         uint32_t used;
+        uint32_t normal;
         uint32_t flags;
 
         ret = qio_channel_read_all_eof(p->c, (void *)p->packet,
@@ -1343,9 +1429,32 @@ static void *multifd_recv_thread(void *opaque)
         p->num_pages += used;
         qemu_mutex_unlock(&p->mutex);
 
-        if (used) {
-            ret = qio_channel_readv_all(p->c, p->pages->iov,
-                                        used, &local_err);
+        normal = used;
+        if (used && (flags & MULTIFD_FLAG_ZERO_BITMAP)) {
+            uint32_t len = DIV_ROUND_UP(used, 8);
+
+            if (len > p->zero_bitmap_len) {
+                p->zero_bitmap = g_realloc(p->zero_bitmap, len);
+                p->zero_bitmap_len = len;
+            }
+            ret = qio_channel_read_all(p->c, (void *)p->zero_bitmap, len,
+                                       &local_err);
+            if (ret != 0) {
+                break;
+            }
+            normal = multifd_recv_zero_fill(p, used);
+        }
+
+        if (normal) {
+            MultiFDMethods *ops = multifd_recv_state->ops;
+
+            if ((flags & MULTIFD_FLAG_COMPRESSION_MASK) != ops->flag) {
+                error_setg(&local_err, "multifd %d: flags received %x "
+                           "flags expected %x", p->id,
+                           flags & MULTIFD_FLAG_COMPRESSION_MASK, ops->flag);
+                break;
+            }
+            ret = ops->recv_pages(p, normal, &local_err);
             if (ret != 0) {
                 break;
             }
@@ -1382,6 +1491,7 @@ int multifd_load_setup(void)
     thread_count = migrate_multifd_channels();
     multifd_recv_state = g_malloc0(sizeof(*multifd_recv_state));
     multifd_recv_state->params = g_new0(MultiFDRecvParams, thread_count);
+    multifd_recv_state->ops = multifd_ops[migrate_multifd_compression()];
     atomic_set(&multifd_recv_state->count, 0);
     qemu_sem_init(&multifd_recv_state->sem_sync, 0);
 
@@ -1397,6 +1507,16 @@ int multifd_load_setup(void)
         p->packet = g_malloc0(p->packet_len);
         p->name = g_strdup_printf("multifdrecv_%d", i);
     }
+
+    for (i = 0; i < thread_count; i++) {
+        MultiFDRecvParams *p = &multifd_recv_state->params[i];
+        Error *local_err = NULL;
+
+        if (multifd_recv_state->ops->recv_setup(p, &local_err)) {
+            error_report_err(local_err);
+            return -1;
+        }
+    }
     return 0;
 }
 
@@ -1504,7 +1624,7 @@ static void mig_throttle_guest_down(void)
     int pct_max = s->parameters.max_cpu_throttle;
 
     /* We have not started throttling yet. Let's start it. */
-    if (!cpu_throttle_active()) {
+    if (!cpu_throttle_get_percentage()) {
         cpu_throttle_set(pct_initial);
     } else {
         /* Throttling already on, just increase the rate */
@@ -1513,6 +1633,100 @@ static void mig_throttle_guest_down(void)
     }
 }
 
+/**
+ * mig_throttle_dirty_vcpus: throttle down the vcpus dirtying memory
+ *
+ * Like mig_throttle_guest_down, but only for the vcpus that dirtied at
+ * least an even share of the pages in the last period, so that vcpus
+ * that hardly write to memory keep running at full speed.
+ *
+ * Returns false if the dirty-vcpu-throttle capability is off or the
+ * accelerator does not tell which vcpu dirtied the pages; the caller
+ * should throttle all vcpus then.
+ *
+ * @rs: current RAM state
+ * @vcpu_dirty_pages: pages dirtied by all vcpus in the last period
+ */
+static bool mig_throttle_dirty_vcpus(RAMState *rs, uint64_t vcpu_dirty_pages)
+{
+    MigrationState *s = migrate_get_current();
+    uint64_t pct_initial = s->parameters.cpu_throttle_initial;
+    uint64_t pct_icrement = s->parameters.cpu_throttle_increment;
+    int pct_max = s->parameters.max_cpu_throttle;
+    CPUState *cpu;
+    int nr_vcpus = 0;
+    int pct;
+
+    if (!migrate_dirty_vcpu_throttle() || !vcpu_dirty_pages) {
+        return false;
+    }
+
+    CPU_FOREACH(cpu) {
+        nr_vcpus++;
+    }
+
+    CPU_FOREACH(cpu) {
+        if (cpu->cpu_index >= rs->nr_vcpu_dirty_pages ||
+            rs->vcpu_dirty_pages_period[cpu->cpu_index] * nr_vcpus <
+            vcpu_dirty_pages) {
+            continue;
+        }
+
+        pct = cpu_throttle_get_vcpu_percentage(cpu);
+        if (!pct) {
+            pct = pct_initial;
+        } else {
+            pct = MIN(pct + pct_icrement, pct_max);
+        }
+        trace_migration_throttle_vcpu(cpu->cpu_index, pct);
+        cpu_throttle_set_vcpu(cpu, pct);
+    }
+
+    return true;
+}
+
+/**
+ * migration_update_vcpu_dirty_pages: account the pages dirtied by each vcpu
+ *
+ * Updates rs->vcpu_dirty_pages_period with the pages each vcpu dirtied
+ * since the last call.
+ *
+ * Returns the pages dirtied by all vcpus, which is zero when the
+ * accelerator does not count them (see CPUState::dirty_pages).
+ *
+ * @rs: current RAM state
+ */
+static uint64_t migration_update_vcpu_dirty_pages(RAMState *rs)
+{
+    CPUState *cpu;
+    uint64_t total = 0;
+
+    CPU_FOREACH(cpu) {
+        int i = cpu->cpu_index;
+        uint64_t dirty = atomic_read__nocheck(&cpu->dirty_pages);
+
+        if (i >= rs->nr_vcpu_dirty_pages) {
+            rs->vcpu_dirty_pages_prev = g_renew(uint64_t,
+                                                rs->vcpu_dirty_pages_prev,
+                                                i + 1);
+            rs->vcpu_dirty_pages_period = g_renew(uint64_t,
+                                                  rs->vcpu_dirty_pages_period,
+                                                  i + 1);
+            memset(rs->vcpu_dirty_pages_prev + rs->nr_vcpu_dirty_pages, 0,
+                   (i + 1 - rs->nr_vcpu_dirty_pages) * sizeof(uint64_t));
+            memset(rs->vcpu_dirty_pages_period + rs->nr_vcpu_dirty_pages, 0,
+                   (i + 1 - rs->nr_vcpu_dirty_pages) * sizeof(uint64_t));
+            rs->nr_vcpu_dirty_pages = i + 1;
+        }
+
+        rs->vcpu_dirty_pages_period[i] = dirty - rs->vcpu_dirty_pages_prev[i];
+        rs->vcpu_dirty_pages_prev[i] = dirty;
+        total += rs->vcpu_dirty_pages_period[i];
+    }
+
+    return total;
+}
+
 /**
  * xbzrle_cache_zero_page: insert a zero page in the XBZRLE cache
  *
@@ -1710,6 +1924,237 @@ static void migration_bitmap_sync_range(RAMState *rs, RAMBlock *rb,
                                               &rs->num_dirty_pages_period);
 }
 
+/* Parallel dirty bitmap sync */
+
+/*
+ * Number of guest pages in each piece of work handed to the sync
+ * threads.  It must be a multiple of BITS_PER_LONG, so that each chunk
+ * covers whole words of the migration bitmap and the threads never
+ * touch the same word.
+ */
+#define DIRTY_SYNC_CHUNK_PAGES (1 << 15)
+
+typedef struct {
+    RAMBlock *block;
+    ram_addr_t start;
+    ram_addr_t length;
+} DirtySyncChunk;
+
+typedef struct {
+    QemuThread thread;
+    /* sem where to wait for more work */
+    QemuSemaphore sem;
+    /* should this thread finish */
+    bool quit;
+    /* results of the last round, read by the migration thread */
+    uint64_t num_dirty;
+    uint64_t real_dirty;
+} DirtySyncParams;
+
+typedef struct {
+    int thread_count;
+    DirtySyncParams *params;
+    /* posted by each thread when it runs out of chunks */
+    QemuSemaphore done_sem;
+    /* the chunks of the current round */
+    DirtySyncChunk *chunks;
+    unsigned int nr_chunks;
+    unsigned int chunks_alloc;
+    /* next chunk to be claimed, shared by all threads */
+    unsigned int next_chunk;
+} DirtySyncState;
+
+static DirtySyncState *dirty_sync_state;
+
+/*
+ * Returns how much of @block, starting from its beginning, can be
+ * split into chunks for the sync threads.  Only blocks that take the
+ * word-at-a-time path of cpu_physical_memory_sync_dirty_bitmap() and
+ * defer the dirty log clear to clear_bmap are split, which keeps the
+ * threads away from any memory listener.
+ */
+static ram_addr_t dirty_sync_split_length(RAMBlock *block)
+{
+    ram_addr_t word_size = (ram_addr_t)BITS_PER_LONG << TARGET_PAGE_BITS;
+    ram_addr_t chunk_size = (ram_addr_t)DIRTY_SYNC_CHUNK_PAGES <<
+                            TARGET_PAGE_BITS;
+
+    if (!block->clear_bmap || block->offset & (word_size - 1) ||
+        block->used_length < 2 * chunk_size) {
+        return 0;
+    }
+    return QEMU_ALIGN_DOWN(block->used_length, word_size);
+}
+
+static void dirty_sync_add_chunk(RAMBlock *block, ram_addr_t start,
+                                 ram_addr_t length)
+{
+    DirtySyncChunk *chunk;
+
+    if (dirty_sync_state->nr_chunks == dirty_sync_state->chunks_alloc) {
+        dirty_sync_state->chunks_alloc =
+            MAX(16, dirty_sync_state->chunks_alloc * 2);
+        dirty_sync_state->chunks = g_renew(DirtySyncChunk,
+                                           dirty_sync_state->chunks,
+                                           dirty_sync_state->chunks_alloc);
+    }
+    chunk = &dirty_sync_state->chunks[dirty_sync_state->nr_chunks++];
+    chunk->block = block;
+    chunk->start = start;
+    chunk->length = length;
+}
+
+/* Called with RCU critical section */
+static void dirty_sync_run_chunks(uint64_t *num_dirty, uint64_t *real_dirty)
+{
+    unsigned int i;
+
+    while ((i = atomic_fetch_inc(&dirty_sync_state->next_chunk)) <
+           dirty_sync_state->nr_chunks) {
+        DirtySyncChunk *chunk = &dirty_sync_state->chunks[i];
+
+        *num_dirty += cpu_physical_memory_sync_dirty_bitmap(chunk->block,
+                                                            chunk->start,
+                                                            chunk->length,
+                                                            real_dirty);
+    }
+}
+
+static void *dirty_sync_thread(void *opaque)
+{
+    DirtySyncParams *p = opaque;
+
+    rcu_register_thread();
+
+    while (true) {
+        qemu_sem_wait(&p->sem);
+        if (atomic_read(&p->quit)) {
+            break;
+        }
+
+        p->num_dirty = 0;
+        p->real_dirty = 0;
+        rcu_read_lock();
+        dirty_sync_run_chunks(&p->num_dirty, &p->real_dirty);
+        rcu_read_unlock();
+        qemu_sem_post(&dirty_sync_state->done_sem);
+    }
+
+    rcu_unregister_thread();
+
+    return NULL;
+}
+
+static void dirty_sync_threads_cleanup(void)
+{
+    int i;
+
+    if (!dirty_sync_state) {
+        return;
+    }
+
+    for (i = 0; i < dirty_sync_state->thread_count; i++) {
+        DirtySyncParams *p = &dirty_sync_state->params[i];
+
+        atomic_set(&p->quit, true);
+        qemu_sem_post(&p->sem);
+        qemu_thread_join(&p->thread);
+        qemu_sem_destroy(&p->sem);
+    }
+    qemu_sem_destroy(&dirty_sync_state->done_sem);
+    g_free(dirty_sync_state->params);
+    g_free(dirty_sync_state->chunks);
+    g_free(dirty_sync_state);
+    dirty_sync_state = NULL;
+}
+
+static void dirty_sync_threads_setup(void)
+{
+    int thread_count = migrate_get_current()->dirty_sync_threads;
+    int i;
+
+    if (!thread_count) {
+        return;
+    }
+
+    dirty_sync_state = g_new0(DirtySyncState, 1);
+    dirty_sync_state->thread_count = thread_count;
+    dirty_sync_state->params = g_new0(DirtySyncParams, thread_count);
+    qemu_sem_init(&dirty_sync_state->done_sem, 0);
+    for (i = 0; i < thread_count; i++) {
+        DirtySyncParams *p = &dirty_sync_state->params[i];
+
+        qemu_sem_init(&p->sem, 0);
+        qemu_thread_create(&p->thread, "dirtysync", dirty_sync_thread, p,
+                           QEMU_THREAD_JOINABLE);
+    }
+}
+
+/*
+ * Sync the dirty log of every RAMBlock into the migration bitmap.
+ * Large blocks are cut into chunks that the sync threads and the
+ * migration thread pick up in parallel; the rest is done by the
+ * migration thread while the sync threads work.
+ *
+ * Called with RCU critical section and bitmap_mutex held
+ */
+static void migration_bitmap_sync_blocks(RAMState *rs)
+{
+    ram_addr_t chunk_size = (ram_addr_t)DIRTY_SYNC_CHUNK_PAGES <<
+                            TARGET_PAGE_BITS;
+    uint64_t num_dirty = 0, real_dirty = 0;
+    RAMBlock *block;
+    int i;
+
+    if (!dirty_sync_state) {
+        RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+            migration_bitmap_sync_range(rs, block, block->used_length);
+        }
+        return;
+    }
+
+    dirty_sync_state->nr_chunks = 0;
+    dirty_sync_state->next_chunk = 0;
+    RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+        ram_addr_t split = dirty_sync_split_length(block);
+        ram_addr_t start;
+
+        for (start = 0; start < split; start += chunk_size) {
+            dirty_sync_add_chunk(block, start, MIN(chunk_size, split - start));
+        }
+    }
+
+    if (dirty_sync_state->nr_chunks) {
+        for (i = 0; i < dirty_sync_state->thread_count; i++) {
+            qemu_sem_post(&dirty_sync_state->params[i].sem);
+        }
+    }
+
+    /* What is not split starts on a word boundary past the chunks */
+    RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+        ram_addr_t split = dirty_sync_split_length(block);
+
+        if (split < block->used_length) {
+            num_dirty += cpu_physical_memory_sync_dirty_bitmap(block, split,
+                             block->used_length - split, &real_dirty);
+        }
+    }
+
+    if (dirty_sync_state->nr_chunks) {
+        dirty_sync_run_chunks(&num_dirty, &real_dirty);
+        for (i = 0; i < dirty_sync_state->thread_count; i++) {
+            qemu_sem_wait(&dirty_sync_state->done_sem);
+        }
+        for (i = 0; i < dirty_sync_state->thread_count; i++) {
+            num_dirty += dirty_sync_state->params[i].num_dirty;
+            real_dirty += dirty_sync_state->params[i].real_dirty;
+        }
+    }
+
+    rs->migration_dirty_pages += num_dirty;
+    rs->num_dirty_pages_period += real_dirty;
+}
+
 /**
  * ram_pagesize_summary: calculate all the pagesizes of a VM
  *
@@ -1779,9 +2224,10 @@ static void migration_update_rates(RAMState *rs, int64_t end_time)
 
 static void migration_bitmap_sync(RAMState *rs)
 {
-    RAMBlock *block;
+    int64_t start_time;
     int64_t end_time;
     uint64_t bytes_xfer_now;
+    uint64_t vcpu_dirty_pages;
 
     ram_counters.dirty_sync_count++;
 
@@ -1790,24 +2236,27 @@ static void migration_bitmap_sync(RAMState *rs)
     }
 
     trace_migration_bitmap_sync_start();
+    start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
     memory_global_dirty_log_sync();
 
     qemu_mutex_lock(&rs->bitmap_mutex);
     rcu_read_lock();
-    RAMBLOCK_FOREACH_NOT_IGNORED(block) {
-        migration_bitmap_sync_range(rs, block, block->used_length);
-    }
+    migration_bitmap_sync_blocks(rs);
     ram_counters.remaining = ram_bytes_remaining();
     rcu_read_unlock();
     qemu_mutex_unlock(&rs->bitmap_mutex);
 
-    trace_migration_bitmap_sync_end(rs->num_dirty_pages_period);
+    ram_counters.dirty_sync_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME) -
+                                   start_time;
+    trace_migration_bitmap_sync_end(rs->num_dirty_pages_period,
+                                    ram_counters.dirty_sync_time);
 
     end_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 
     /* more than 1 second = 1000 millisecons */
     if (end_time > rs->time_last_bitmap_sync + 1000) {
         bytes_xfer_now = ram_counters.transferred;
+        vcpu_dirty_pages = migration_update_vcpu_dirty_pages(rs);
 
         /* During block migration the auto-converge logic incorrectly detects
          * that ram migration makes no progress. Avoid this by disabling the
@@ -1824,7 +2273,9 @@ static void migration_bitmap_sync(RAMState *rs)
                 (++rs->dirty_rate_high_cnt >= 2)) {
                     trace_migration_throttle();
                     rs->dirty_rate_high_cnt = 0;
-                    mig_throttle_guest_down();
+                    if (!mig_throttle_dirty_vcpus(rs, vcpu_dirty_pages)) {
+                        mig_throttle_guest_down();
+                    }
             }
         }
 
@@ -2033,8 +2484,8 @@ static int ram_save_page(RAMState *rs, PageSearchStatus *pss, bool last_stage)
 static int ram_save_multifd_page(RAMState *rs, RAMBlock *block,
                                  ram_addr_t offset)
 {
+    /* The channel accounts the page once it knows whether it is zero */
     multifd_queue_page(block, offset);
-    ram_counters.normal++;
 
     return 1;
 }
@@ -2483,7 +2934,13 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
 {
     RAMBlock *block = pss->block;
     ram_addr_t offset = pss->page << TARGET_PAGE_BITS;
-    int res;
+    /*
+     * do not use multifd for compression as the first page in the new
+     * block should be posted out before sending the compressed page
+     */
+    bool use_multifd = !save_page_use_compression(rs) &&
+                       migrate_use_multifd();
+    int res = -1;
 
     if (control_save_page(rs, block, offset, &res)) {
         return res;
@@ -2493,7 +2950,19 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
         return 1;
     }
 
-    res = save_zero_page(rs, block, offset);
+    switch (migrate_zero_page_detection()) {
+    case ZERO_PAGE_DETECTION_NONE:
+        break;
+    case ZERO_PAGE_DETECTION_MULTIFD:
+        if (use_multifd) {
+            /* The channel threads will do it */
+            break;
+        }
+        /* fall through */
+    default:
+        res = save_zero_page(rs, block, offset);
+        break;
+    }
     if (res > 0) {
         /* Must let xbzrle know, otherwise a previous (now 0'd) cached
          * page would be stale
@@ -2507,11 +2976,7 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
         return res;
     }
 
-    /*
-     * do not use multifd for compression as the first page in the new
-     * block should be posted out before sending the compressed page
-     */
-    if (!save_page_use_compression(rs) && migrate_use_multifd()) {
+    if (use_multifd) {
         return ram_save_multifd_page(rs, block, offset);
     }
 
@@ -2682,6 +3147,8 @@ static void ram_state_cleanup(RAMState **rsp)
         migration_page_queue_free(*rsp);
         qemu_mutex_destroy(&(*rsp)->bitmap_mutex);
         qemu_mutex_destroy(&(*rsp)->src_page_req_mutex);
+        g_free((*rsp)->vcpu_dirty_pages_prev);
+        g_free((*rsp)->vcpu_dirty_pages_period);
         g_free(*rsp);
         *rsp = NULL;
     }
@@ -2724,6 +3191,7 @@ static void ram_save_cleanup(void *opaque)
 
     xbzrle_cleanup();
     compress_threads_save_cleanup();
+    dirty_sync_threads_cleanup();
     ram_state_cleanup(rsp);
 }
 
@@ -3274,6 +3742,8 @@ static void ram_init_bitmaps(RAMState *rs)
     rcu_read_lock();
 
     ram_list_init_bitmaps();
+    /* Only account the pages the vcpus dirty from now on */
+    migration_update_vcpu_dirty_pages(rs);
     memory_global_dirty_log_start();
     migration_bitmap_sync_precopy(rs);
 
@@ -3403,11 +3873,13 @@ static int ram_save_setup(QEMUFile *f, void *opaque)
     if (compress_threads_save_setup()) {
         return -1;
     }
+    dirty_sync_threads_setup();
 
     /* migration has already setup the bitmap, reuse it. */
     if (!migration_in_colo_state()) {
         if (ram_init_all(rsp) != 0) {
             compress_threads_save_cleanup();
+            dirty_sync_threads_cleanup();
             return -1;
         }
     }
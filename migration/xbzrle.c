@@ -12,6 +12,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/host-utils.h"
 #include "xbzrle.h"
 
 /*
@@ -24,17 +25,14 @@
 
   length = uleb128 encoded integer
  */
-int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
-                         uint8_t *dst, int dlen)
+static int xbzrle_encode_int(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                             uint8_t *dst, int dlen)
 {
     uint32_t zrun_len = 0, nzrun_len = 0;
     int d = 0, i = 0;
     long res;
     uint8_t *nzrun_start = NULL;
 
-    g_assert(!(((uintptr_t)old_buf | (uintptr_t)new_buf | slen) %
-               sizeof(long)));
-
     while (i < slen) {
         /* overflow */
         if (d + 2 > dlen) {
@@ -126,6 +124,383 @@ int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
     return d;
 }
 
+#if defined(CONFIG_AVX2_OPT) || defined(__SSE2__)
+/*
+ * The vectorized encoders produce exactly the same output as
+ * xbzrle_encode_int.  They share the run-length loop below and only
+ * differ in how they find the end of a run of unchanged bytes (zrun)
+ * or of changed bytes (nzrun).  Both helpers return the index of the
+ * first byte at or after @i that ends the run, or @slen.
+ */
+typedef int (*xbzrle_find_fn)(const uint8_t *old_buf, const uint8_t *new_buf,
+                              int i, int slen);
+
+static inline __attribute__((always_inline)) int
+xbzrle_encode_vec(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                  uint8_t *dst, int dlen,
+                  xbzrle_find_fn find_zrun_end, xbzrle_find_fn find_nzrun_end)
+{
+    uint32_t zrun_len, nzrun_len;
+    int d = 0, i = 0, start;
+
+    while (i < slen) {
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        start = i;
+        i = find_zrun_end(old_buf, new_buf, i, slen);
+        zrun_len = i - start;
+
+        /* buffer unchanged */
+        if (zrun_len == slen) {
+            return 0;
+        }
+
+        /* skip last zero run */
+        if (i == slen) {
+            return d;
+        }
+
+        d += uleb128_encode_small(dst + d, zrun_len);
+
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        start = i;
+        i = find_nzrun_end(old_buf, new_buf, i, slen);
+        nzrun_len = i - start;
+
+        d += uleb128_encode_small(dst + d, nzrun_len);
+        /* overflow */
+        if (d + nzrun_len > dlen) {
+            return -1;
+        }
+        memcpy(dst + d, new_buf + start, nzrun_len);
+        d += nzrun_len;
+    }
+
+    return d;
+}
+
+/* Do not use push_options pragmas unnecessarily, because clang
+ * does not support them.
+ */
+#ifdef CONFIG_AVX2_OPT
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+#include <emmintrin.h>
+
+static inline int find_zrun_end_sse2(const uint8_t *old_buf,
+                                     const uint8_t *new_buf, int i, int slen)
+{
+    /* Most of a page is usually unchanged, skip 64 bytes at a time.  */
+    for (; i + 64 <= slen; i += 64) {
+        const __m128i *o = (const __m128i *)(old_buf + i);
+        const __m128i *n = (const __m128i *)(new_buf + i);
+        __m128i t = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(o),
+                                         _mm_loadu_si128(n)),
+                          _mm_cmpeq_epi8(_mm_loadu_si128(o + 1),
+                                         _mm_loadu_si128(n + 1))),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(o + 2),
+                                         _mm_loadu_si128(n + 2)),
+                          _mm_cmpeq_epi8(_mm_loadu_si128(o + 3),
+                                         _mm_loadu_si128(n + 3))));
+
+        if (_mm_movemask_epi8(t) != 0xFFFF) {
+            break;
+        }
+    }
+    for (; i + 16 <= slen; i += 16) {
+        __m128i o = _mm_loadu_si128((const __m128i *)(old_buf + i));
+        __m128i n = _mm_loadu_si128((const __m128i *)(new_buf + i));
+        uint32_t ne = ~_mm_movemask_epi8(_mm_cmpeq_epi8(o, n)) & 0xFFFF;
+
+        if (ne) {
+            return i + ctz32(ne);
+        }
+    }
+    while (i < slen && old_buf[i] == new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static inline int find_nzrun_end_sse2(const uint8_t *old_buf,
+                                      const uint8_t *new_buf, int i, int slen)
+{
+    for (; i + 16 <= slen; i += 16) {
+        __m128i o = _mm_loadu_si128((const __m128i *)(old_buf + i));
+        __m128i n = _mm_loadu_si128((const __m128i *)(new_buf + i));
+        uint32_t eq = _mm_movemask_epi8(_mm_cmpeq_epi8(o, n));
+
+        if (eq) {
+            return i + ctz32(eq);
+        }
+    }
+    while (i < slen && old_buf[i] != new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static int xbzrle_encode_sse2(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_vec(old_buf, new_buf, slen, dst, dlen,
+                             find_zrun_end_sse2, find_nzrun_end_sse2);
+}
+#ifdef CONFIG_AVX2_OPT
+#pragma GCC pop_options
+#endif
+
+#ifdef CONFIG_AVX2_OPT
+/* Note that due to restrictions/bugs wrt __builtin functions in gcc <= 4.8,
+ * the includes have to be within the corresponding push_options region, and
+ * therefore the regions themselves have to be ordered with increasing ISA.
+ */
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#include <immintrin.h>
+
+static inline int find_zrun_end_avx2(const uint8_t *old_buf,
+                                     const uint8_t *new_buf, int i, int slen)
+{
+    for (; i + 64 <= slen; i += 64) {
+        const __m256i *o = (const __m256i *)(old_buf + i);
+        const __m256i *n = (const __m256i *)(new_buf + i);
+        __m256i t = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(o), _mm256_loadu_si256(n)),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(o + 1),
+                              _mm256_loadu_si256(n + 1)));
+
+        if ((uint32_t)_mm256_movemask_epi8(t) != 0xFFFFFFFF) {
+            break;
+        }
+    }
+    for (; i + 32 <= slen; i += 32) {
+        __m256i o = _mm256_loadu_si256((const __m256i *)(old_buf + i));
+        __m256i n = _mm256_loadu_si256((const __m256i *)(new_buf + i));
+        uint32_t ne = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(o, n));
+
+        if (ne) {
+            return i + ctz32(ne);
+        }
+    }
+    while (i < slen && old_buf[i] == new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static inline int find_nzrun_end_avx2(const uint8_t *old_buf,
+                                      const uint8_t *new_buf, int i, int slen)
+{
+    for (; i + 32 <= slen; i += 32) {
+        __m256i o = _mm256_loadu_si256((const __m256i *)(old_buf + i));
+        __m256i n = _mm256_loadu_si256((const __m256i *)(new_buf + i));
+        uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(o, n));
+
+        if (eq) {
+            return i + ctz32(eq);
+        }
+    }
+    while (i < slen && old_buf[i] != new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static int xbzrle_encode_avx2(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_vec(old_buf, new_buf, slen, dst, dlen,
+                             find_zrun_end_avx2, find_nzrun_end_avx2);
+}
+#pragma GCC pop_options
+
+#ifdef CONFIG_AVX512BW_OPT
+#pragma GCC push_options
+#pragma GCC target("avx512bw")
+
+static inline int find_zrun_end_avx512bw(const uint8_t *old_buf,
+                                         const uint8_t *new_buf,
+                                         int i, int slen)
+{
+    for (; i + 128 <= slen; i += 128) {
+        __mmask64 ne = _mm512_cmpneq_epi8_mask(
+                           _mm512_loadu_si512(old_buf + i),
+                           _mm512_loadu_si512(new_buf + i)) |
+                       _mm512_cmpneq_epi8_mask(
+                           _mm512_loadu_si512(old_buf + i + 64),
+                           _mm512_loadu_si512(new_buf + i + 64));
+
+        if (ne) {
+            break;
+        }
+    }
+    for (; i + 64 <= slen; i += 64) {
+        __m512i o = _mm512_loadu_si512(old_buf + i);
+        __m512i n = _mm512_loadu_si512(new_buf + i);
+        uint64_t ne = _mm512_cmpneq_epi8_mask(o, n);
+
+        if (ne) {
+            return i + ctz64(ne);
+        }
+    }
+    while (i < slen && old_buf[i] == new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static inline int find_nzrun_end_avx512bw(const uint8_t *old_buf,
+                                          const uint8_t *new_buf,
+                                          int i, int slen)
+{
+    for (; i + 64 <= slen; i += 64) {
+        __m512i o = _mm512_loadu_si512(old_buf + i);
+        __m512i n = _mm512_loadu_si512(new_buf + i);
+        uint64_t eq = _mm512_cmpeq_epi8_mask(o, n);
+
+        if (eq) {
+            return i + ctz64(eq);
+        }
+    }
+    while (i < slen && old_buf[i] != new_buf[i]) {
+        i++;
+    }
+    return i;
+}
+
+static int xbzrle_encode_avx512bw(uint8_t *old_buf, uint8_t *new_buf,
+                                  int slen, uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_vec(old_buf, new_buf, slen, dst, dlen,
+                             find_zrun_end_avx512bw, find_nzrun_end_avx512bw);
+}
+#pragma GCC pop_options
+#endif /* CONFIG_AVX512BW_OPT */
+#endif /* CONFIG_AVX2_OPT */
+
+/* Note that for xbzrle_encode_next_accel, the most preferred
+ * ISA must have the least significant bit.
+ */
+#define CACHE_AVX512BW  1
+#define CACHE_AVX2      2
+#define CACHE_SSE2      4
+
+/* Make sure that these variables are appropriately initialized when
+ * SSE2 is enabled on the compiler command-line, but the compiler is
+ * too old to support CONFIG_AVX2_OPT.
+ */
+#ifdef CONFIG_AVX2_OPT
+# define INIT_CACHE 0
+# define INIT_ACCEL xbzrle_encode_int
+#else
+# ifndef __SSE2__
+#  error "ISA selection confusion"
+# endif
+# define INIT_CACHE CACHE_SSE2
+# define INIT_ACCEL xbzrle_encode_sse2
+#endif
+
+static unsigned cpuid_cache = INIT_CACHE;
+static int (*encode_accel)(uint8_t *, uint8_t *, int, uint8_t *, int) =
+    INIT_ACCEL;
+
+static void init_accel(unsigned cache)
+{
+    int (*fn)(uint8_t *, uint8_t *, int, uint8_t *, int) = xbzrle_encode_int;
+
+    if (cache & CACHE_SSE2) {
+        fn = xbzrle_encode_sse2;
+    }
+#ifdef CONFIG_AVX2_OPT
+    if (cache & CACHE_AVX2) {
+        fn = xbzrle_encode_avx2;
+    }
+#ifdef CONFIG_AVX512BW_OPT
+    if (cache & CACHE_AVX512BW) {
+        fn = xbzrle_encode_avx512bw;
+    }
+#endif
+#endif
+    encode_accel = fn;
+}
+
+#ifdef CONFIG_AVX2_OPT
+#include "qemu/cpuid.h"
+
+static void __attribute__((constructor)) init_cpuid_cache(void)
+{
+    int max = __get_cpuid_max(0, NULL);
+    int a, b, c, d;
+    unsigned cache = 0;
+
+    if (max >= 1) {
+        __cpuid(1, a, b, c, d);
+        if (d & bit_SSE2) {
+            cache |= CACHE_SSE2;
+        }
+
+        /* We must check that AVX is not just available, but usable.  */
+        if ((c & bit_OSXSAVE) && (c & bit_AVX) && max >= 7) {
+            int bv;
+            __asm("xgetbv" : "=a"(bv), "=d"(d) : "c"(0));
+            __cpuid_count(7, 0, a, b, c, d);
+            if ((bv & 6) == 6 && (b & bit_AVX2)) {
+                cache |= CACHE_AVX2;
+            }
+#ifdef CONFIG_AVX512BW_OPT
+            /* The opmask and ZMM state must be enabled by the OS too.  */
+            if ((bv & 0xe6) == 0xe6 && (b & bit_AVX512F) &&
+                (b & bit_AVX512BW)) {
+                cache |= CACHE_AVX512BW;
+            }
+#endif
+        }
+    }
+    cpuid_cache = cache;
+    init_accel(cache);
+}
+#endif /* CONFIG_AVX2_OPT */
+
+bool xbzrle_encode_next_accel(void)
+{
+    /* If no bits set, we just tested xbzrle_encode_int, and there
+       are no more acceleration options to test.  */
+    if (cpuid_cache == 0) {
+        return false;
+    }
+    /* Disable the accelerator we used before and select a new one.  */
+    cpuid_cache &= cpuid_cache - 1;
+    init_accel(cpuid_cache);
+    return true;
+}
+
+#else
+#define encode_accel  xbzrle_encode_int
+bool xbzrle_encode_next_accel(void)
+{
+    return false;
+}
+#endif
+
+int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                         uint8_t *dst, int dlen)
+{
+    g_assert(!(((uintptr_t)old_buf | (uintptr_t)new_buf | slen) %
+               sizeof(long)));
+
+    return encode_accel(old_buf, new_buf, slen, dst, dlen);
+}
+
 int xbzrle_decode_buffer(uint8_t *src, int slen, uint8_t *dst, int dlen)
 {
     int i = 0, d = 0;
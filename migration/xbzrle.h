@@ -18,4 +18,11 @@ int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
                          uint8_t *dst, int dlen);
 
 int xbzrle_decode_buffer(uint8_t *src, int slen, uint8_t *dst, int dlen);
+
+/*
+ * For testing: disable the encoder that was used so far and fall back to
+ * the next best one.  Returns false when the generic encoder was already
+ * in use.
+ */
+bool xbzrle_encode_next_accel(void);
 #endif
@@ -118,9 +118,23 @@ Select CPU model (@code{-cpu help} for list and additional feature selection)
 ETEXI
 
 DEF("accel", HAS_ARG, QEMU_OPTION_accel,
-    "-accel [accel=]accelerator[,thread=single|multi]\n"
+    "-accel [accel=]accelerator[,thread=single|multi][,tb-cache=file]\n"
+    "                [,superblock-threshold=n][,gvn=on|off]\n"
+    "                [,translation-threads=n][,hot-code-size=size]\n"
+    "                [,jmp-cache-bits=n]\n"
+    "                [,profile=on|off][,perf-map=on|off][,victim-tlb-bits=n]\n"
     "                select accelerator (kvm, xen, hax, hvf, whpx or tcg; use 'help' for a list)\n"
-    "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
+    "                thread=single|multi (enable multi-threaded TCG)\n"
+    "                tb-cache=file (keep translated code across runs)\n"
+    "                superblock-threshold=n (retranslate hot code as superblocks)\n"
+    "                gvn=on|off (remove redundant operations, default on)\n"
+    "                translation-threads=n (retranslate hot code in the background)\n"
+    "                hot-code-size=size (keep hot code across code buffer flushes)\n"
+    "                jmp-cache-bits=n (size of the per-vCPU TB lookup cache)\n"
+    "                profile=on|off (profile translated code, default off)\n"
+    "                perf-map=on|off (write symbols for perf, default off)\n"
+    "                victim-tlb-bits=n (size of the second level softmmu TLB)\n",
+    QEMU_ARCH_ALL)
 STEXI
 @item -accel @var{name}[,prop=@var{value}[,...]]
 @findex -accel
@@ -134,6 +148,65 @@ Controls number of TCG threads. When the TCG is multi-threaded there will be one
 thread per vCPU therefor taking advantage of additional host cores. The default
 is to enable multi-threading where both the back-end and front-ends support it and
 no incompatible TCG features have been enabled (e.g. icount/replay).
+@item tb-cache=@var{file}
+Save the code translated by TCG to @var{file} when QEMU exits, and reuse it
+when QEMU is started again with the same command line, for guest code whose
+contents have not changed in the meantime.  The saved code contains absolute
+host addresses, so it is only reused if the QEMU binary and its translation
+buffer are mapped at the same addresses as in the previous run; in practice
+this requires disabling address space layout randomization, for example with
+@code{setarch -R}.  Otherwise @var{file} is ignored and overwritten on exit.
+@item superblock-threshold=@var{n}
+Retranslate a block of guest code after it has been executed @var{n} times.
+The new translation follows the hot path through forward jumps and
+not-taken conditional branches, so that guest registers can stay in host
+registers for longer.  Currently only RISC-V guests form superblocks, and
+the option has no effect with @option{-icount}.  The default is 0, which
+disables retranslation.
+@item gvn=on|off
+Controls the TCG optimization pass that removes redundant computations,
+loads of CPU state that are already in a temporary and stores that are
+overwritten before being read.  The number of operations left after each
+pass is shown by the @code{info jit} monitor command.  The default is on.
+@item translation-threads=@var{n}
+Retranslate hot code on @var{n} background threads rather than on the vCPU
+threads, which keep running the existing translation in the meantime.  The
+vCPU threads then skip the more expensive optimizations when translating
+code for the first time.  This requires @option{thread=multi}, and implies
+@option{superblock-threshold=1000} unless a threshold is given.  The
+default is 0.
+@item hot-code-size=@var{size}
+Set aside @var{size} bytes of the translated code buffer for code that has
+been retranslated after getting hot, so that hot code is laid out
+contiguously.  When the rest of the buffer fills up, its contents are
+discarded but the hot code is kept, unless the hot area is itself nearly
+full.  This implies @option{superblock-threshold=1000} unless a threshold
+is given.  The area is at most half of the buffer, in multiples of 256
+KiB.  The default is 0, which disables the hot code area.
+@item jmp-cache-bits=@var{n}
+Set the size of the cache that each vCPU uses to find the translation of
+the guest code it jumps to, to 2^@var{n} sets of 4 entries.  Larger caches
+help guests that run a lot of different code through indirect branches,
+such as interpreters.  The hit rate is shown by the @code{info jit}
+monitor command.  @var{n} must be between 6 and 16; the default is 11.
+@item profile=on|off
+Controls whether TCG records, for each guest address it translates code
+from, how long the translation took, how many TCG ops it produced before
+and after optimization, how much host code it produced and how many
+times that code ran.  The profile is returned by the
+@code{query-tcg-profile} QMP command, and can also be started and stopped
+at run time with @code{tcg-profile-set}.  Counting executions slows down
+the guest a little.  The default is off.
+@item perf-map=on|off
+Controls whether TCG appends the address, size and guest address of each
+block of translated code to @file{/tmp/perf-<pid>.map}, so that
+@command{perf report} can tell which guest code the samples in translated
+code belong to.  The default is off.
+@item victim-tlb-bits=@var{n}
+Set the size of the victim TLB, which keeps the softmmu TLB entries
+evicted by conflicting ones, to 2^@var{n} sets of 8 entries.  Guests that
+touch a lot of memory at once may benefit from a larger victim TLB.
+@var{n} must be at most 6; the default is 2.
 @end table
 ETEXI
 
@@ -1811,7 +1811,7 @@ static inline void do_invalidate_BAT(CPUPPCState *env, target_ulong BATu,
                                      target_ulong mask)
 {
     CPUState *cs = env_cpu(env);
-    target_ulong base, end, page;
+    target_ulong base, end;
 
     base = BATu & ~0x0001FFFF;
     end = base + mask + 0x00020000;
@@ -1824,9 +1824,7 @@ static inline void do_invalidate_BAT(CPUPPCState *env, target_ulong BATu,
     }
     LOG_BATS("Flush BAT from " TARGET_FMT_lx " to " TARGET_FMT_lx " ("
              TARGET_FMT_lx ")\n", base, end, mask);
-    for (page = base; page != end; page += TARGET_PAGE_SIZE) {
-        tlb_flush_page(cs, page);
-    }
+    tlb_flush_range(cs, base, end - base);
     LOG_BATS("Flush done\n");
 }
 #endif
@@ -2426,7 +2424,7 @@ void helper_4xx_tlbwe_hi(CPUPPCState *env, target_ulong entry,
 {
     CPUState *cs = env_cpu(env);
     ppcemb_tlb_t *tlb;
-    target_ulong page, end;
+    target_ulong end;
 
     LOG_SWTLB("%s entry %d val " TARGET_FMT_lx "\n", __func__, (int)entry,
               val);
@@ -2437,9 +2435,7 @@ void helper_4xx_tlbwe_hi(CPUPPCState *env, target_ulong entry,
         end = tlb->EPN + tlb->size;
         LOG_SWTLB("%s: invalidate old TLB %d start " TARGET_FMT_lx " end "
                   TARGET_FMT_lx "\n", __func__, (int)entry, tlb->EPN, end);
-        for (page = tlb->EPN; page < end; page += TARGET_PAGE_SIZE) {
-            tlb_flush_page(cs, page);
-        }
+        tlb_flush_range(cs, tlb->EPN, tlb->size);
     }
     tlb->size = booke_tlb_to_page_size((val >> PPC4XX_TLBHI_SIZE_SHIFT)
                                        & PPC4XX_TLBHI_SIZE_MASK);
@@ -2477,9 +2473,7 @@ void helper_4xx_tlbwe_hi(CPUPPCState *env, target_ulong entry,
         end = tlb->EPN + tlb->size;
         LOG_SWTLB("%s: invalidate TLB %d start " TARGET_FMT_lx " end "
                   TARGET_FMT_lx "\n", __func__, (int)entry, tlb->EPN, end);
-        for (page = tlb->EPN; page < end; page += TARGET_PAGE_SIZE) {
-            tlb_flush_page(cs, page);
-        }
+        tlb_flush_range(cs, tlb->EPN, tlb->size);
     }
 }
 
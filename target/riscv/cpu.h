@@ -65,6 +65,7 @@
 #define RVF RV('F')
 #define RVD RV('D')
 #define RVC RV('C')
+#define RVV RV('V')
 #define RVS RV('S')
 #define RVU RV('U')
 
@@ -89,10 +90,27 @@ enum {
 
 #define MAX_RISCV_PMPS (16)
 
+/* Largest supported VLEN, in bits */
+#define RV_VLEN_MAX 256
+
 typedef struct CPURISCVState CPURISCVState;
 
 #include "pmp.h"
 
+/*
+ * Page walk cache: for each non-leaf level of the page table, a few
+ * direct-mapped entries remembering which next-level table the VA bits
+ * above that level select.  Sv57 has at most four non-leaf levels.
+ */
+#define RISCV_PWC_LEVELS  4
+#define RISCV_PWC_ENTRIES 8
+
+typedef struct RISCVPWCEntry {
+    target_ulong vpn;   /* addr >> (PGSHIFT + shift of the level) */
+    hwaddr base;        /* physical address of the next-level table */
+    bool valid;
+} RISCVPWCEntry;
+
 struct CPURISCVState {
     target_ulong gpr[32];
     uint64_t fpr[32]; /* assume both F and D extensions */
@@ -102,6 +120,14 @@ struct CPURISCVState {
 
     target_ulong frm;
 
+    /* Vector registers, v[n] starts at byte n * VLEN / 8 of vreg */
+    uint64_t vreg[32 * RV_VLEN_MAX / 64] QEMU_ALIGNED(16);
+    target_ulong vxrm;
+    target_ulong vxsat;
+    target_ulong vl;
+    target_ulong vstart;
+    target_ulong vtype;
+
     target_ulong badaddr;
 
     target_ulong priv_ver;
@@ -124,10 +150,11 @@ struct CPURISCVState {
     /*
      * CAUTION! Unlike the rest of this struct, mip is accessed asynchonously
      * by I/O threads. It should be read with atomic_read. It should be updated
-     * using riscv_cpu_update_mip with the iothread mutex held. The iothread
-     * mutex must be held because mip must be consistent with the CPU inturrept
-     * state. riscv_cpu_update_mip calls cpu_interrupt or cpu_reset_interrupt
-     * wuth the invariant that CPU_INTERRUPT_HARD is set iff mip is non-zero.
+     * using riscv_cpu_update_mip, which does not need the iothread mutex, so
+     * that interrupt controllers can run outside of it. mip must be
+     * consistent with the CPU interrupt state: riscv_cpu_update_mip schedules
+     * cpu_interrupt or cpu_reset_interrupt on the vCPU to maintain the
+     * invariant that CPU_INTERRUPT_HARD is set iff mip is non-zero.
      * mip is 32-bits to allow atomic_read on 32-bit hosts.
      */
     uint32_t mip;
@@ -165,6 +192,9 @@ struct CPURISCVState {
     /* physical memory protection */
     pmp_table_t pmp_state;
 
+    /* non-leaf PTEs of recent page walks, see get_physical_address() */
+    RISCVPWCEntry pwc[RISCV_PWC_LEVELS][RISCV_PWC_ENTRIES];
+
     /* True if in debugger mode.  */
     bool debugger;
 #endif
@@ -225,7 +255,9 @@ typedef struct RISCVCPU {
         bool ext_counters;
         bool ext_ifencei;
         bool ext_icsr;
+        bool ext_v;
 
+        uint16_t vlen;
         char *priv_spec;
         char *user_spec;
         bool mmu;
@@ -276,6 +308,7 @@ void riscv_cpu_list(void);
 int riscv_cpu_claim_interrupts(RISCVCPU *cpu, uint32_t interrupts);
 uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value);
 #define BOOL_TO_MASK(x) (-!!(x)) /* helper for riscv_cpu_update_mip value */
+void riscv_cpu_flush_pwc(CPURISCVState *env);
 #endif
 void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv);
 
@@ -288,7 +321,28 @@ target_ulong riscv_cpu_get_fflags(CPURISCVState *env);
 void riscv_cpu_set_fflags(CPURISCVState *env, target_ulong);
 
 #define TB_FLAGS_MMU_MASK   3
+#define TB_FLAGS_FRM_SHIFT  2
+#define TB_FLAGS_FRM_MASK   (7 << TB_FLAGS_FRM_SHIFT)
+#define TB_FLAGS_VILL       (1 << 5)
+#define TB_FLAGS_SEW_SHIFT  6
+#define TB_FLAGS_SEW_MASK   (3 << TB_FLAGS_SEW_SHIFT)
+#define TB_FLAGS_VL_EQ_VLMAX (1 << 8)
+#define TB_FLAGS_MSTATUS_VS MSTATUS_VS
 #define TB_FLAGS_MSTATUS_FS MSTATUS_FS
+#define TB_FLAGS_LMUL_SHIFT 15
+#define TB_FLAGS_LMUL_MASK  (7 << TB_FLAGS_LMUL_SHIFT)
+
+/*
+ * The number of elements in a register group for @vtype:
+ * VLMAX = LMUL * VLEN / SEW.  vtype must not have vill set.
+ */
+static inline uint32_t riscv_cpu_vlmax(RISCVCPU *cpu, target_ulong vtype)
+{
+    int sew = get_field(vtype, VTYPE_VSEW);
+    int lmul = sextract32(get_field(vtype, VTYPE_VLMUL), 0, 3);
+
+    return cpu->cfg.vlen >> (sew + 3 - lmul);
+}
 
 static inline void cpu_get_tb_cpu_state(CPURISCVState *env, target_ulong *pc,
                                         target_ulong *cs_base, uint32_t *flags)
@@ -296,10 +350,33 @@ static inline void cpu_get_tb_cpu_state(CPURISCVState *env, target_ulong *pc,
     *pc = env->pc;
     *cs_base = 0;
 #ifdef CONFIG_USER_ONLY
-    *flags = TB_FLAGS_MSTATUS_FS;
+    *flags = TB_FLAGS_MSTATUS_FS | TB_FLAGS_MSTATUS_VS;
 #else
-    *flags = cpu_mmu_index(env, 0) | (env->mstatus & MSTATUS_FS);
+    *flags = cpu_mmu_index(env, 0) |
+             (env->mstatus & (MSTATUS_FS | MSTATUS_VS));
 #endif
+    *flags |= env->frm << TB_FLAGS_FRM_SHIFT;
+
+    /*
+     * Vector instructions are translated for one SEW and LMUL, and can
+     * skip the vstart and tail handling when they know that they operate
+     * on the whole register group.
+     */
+    if (riscv_has_ext(env, RVV)) {
+        if (env->vtype & VTYPE_VILL) {
+            *flags |= TB_FLAGS_VILL;
+        } else {
+            RISCVCPU *cpu = container_of(env, RISCVCPU, env);
+
+            *flags |= get_field(env->vtype, VTYPE_VSEW) << TB_FLAGS_SEW_SHIFT;
+            *flags |= get_field(env->vtype, VTYPE_VLMUL) <<
+                      TB_FLAGS_LMUL_SHIFT;
+            if (env->vstart == 0 &&
+                env->vl == riscv_cpu_vlmax(cpu, env->vtype)) {
+                *flags |= TB_FLAGS_VL_EQ_VLMAX;
+            }
+        }
+    }
 }
 
 int riscv_csrrw(CPURISCVState *env, int csrno, target_ulong *ret_value,
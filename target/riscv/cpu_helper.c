@@ -82,29 +82,29 @@ int riscv_cpu_claim_interrupts(RISCVCPU *cpu, uint32_t interrupts)
     }
 }
 
-struct CpuAsyncInfo {
-    uint32_t new_mip;
-};
-
+/*
+ * CPU_INTERRUPT_HARD can only be changed with the BQL held, which the
+ * callers of riscv_cpu_update_mip need not hold: defer it to the vCPU.
+ * The work item looks at the value of mip when it runs rather than when
+ * it was queued, so that racing updates cannot leave CPU_INTERRUPT_HARD
+ * out of sync with mip, whatever the order of the work items.
+ */
 static void riscv_cpu_update_mip_irqs_async(CPUState *target_cpu_state,
                                             run_on_cpu_data data)
 {
-    struct CpuAsyncInfo *info = (struct CpuAsyncInfo *) data.host_ptr;
+    CPURISCVState *env = target_cpu_state->env_ptr;
 
-    if (info->new_mip) {
+    if (atomic_read(&env->mip)) {
         cpu_interrupt(target_cpu_state, CPU_INTERRUPT_HARD);
     } else {
         cpu_reset_interrupt(target_cpu_state, CPU_INTERRUPT_HARD);
     }
-
-    g_free(info);
 }
 
 uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value)
 {
     CPURISCVState *env = &cpu->env;
     CPUState *cs = CPU(cpu);
-    struct CpuAsyncInfo *info;
     uint32_t old, new, cmp = atomic_read(&env->mip);
 
     do {
@@ -113,11 +113,7 @@ uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value)
         cmp = atomic_cmpxchg(&env->mip, old, new);
     } while (old != cmp);
 
-    info = g_new(struct CpuAsyncInfo, 1);
-    info->new_mip = new;
-
-    async_run_on_cpu(cs, riscv_cpu_update_mip_irqs_async,
-                     RUN_ON_CPU_HOST_PTR(info));
+    async_run_on_cpu(cs, riscv_cpu_update_mip_irqs_async, RUN_ON_CPU_NULL);
 
     return old;
 }
@@ -144,17 +140,28 @@ void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv)
     env->load_res = -1;
 }
 
+void riscv_cpu_flush_pwc(CPURISCVState *env)
+{
+    memset(env->pwc, 0, sizeof(env->pwc));
+}
+
 /* get_physical_address - get the physical address for this virtual address
  *
  * Do a page table walk to obtain the physical address corresponding to a
  * virtual address. Returns 0 if the translation was successful
  *
+ * Non-leaf PTEs are looked up in, and added to, the page walk cache if
+ * use_pwc is set.  The cache is flushed whenever the QEMU TLB is, so it
+ * follows the same sfence.vma rules as a hardware walk cache.  Leaf PTEs
+ * are always read, as their A/D bits may need updating.
+ *
  * Adapted from Spike's mmu_t::translate and mmu_t::walk
  *
  */
 static int get_physical_address(CPURISCVState *env, hwaddr *physical,
-                                int *prot, target_ulong addr,
-                                int access_type, int mmu_idx)
+                                int *prot, target_ulong *page_size,
+                                target_ulong addr, int access_type,
+                                int mmu_idx, bool use_pwc)
 {
     /* NOTE: the env->pc value visible here will not be
      * correct, but the value visible to the exception handler
@@ -162,6 +169,8 @@ static int get_physical_address(CPURISCVState *env, hwaddr *physical,
 
     int mode = mmu_idx;
 
+    *page_size = TARGET_PAGE_SIZE;
+
     if (mode == PRV_M && access_type != MMU_INST_FETCH) {
         if (get_field(env->mstatus, MSTATUS_MPRV)) {
             mode = get_field(env->mstatus, MSTATUS_MPP);
@@ -228,13 +237,39 @@ static int get_physical_address(CPURISCVState *env, hwaddr *physical,
         return TRANSLATE_FAIL;
     }
 
-    int ptshift = (levels - 1) * ptidxbits;
+    target_ulong root = base;
+    int ptshift;
     int i;
 
 #if !TCG_OVERSIZED_GUEST
 restart:
 #endif
-    for (i = 0; i < levels; i++, ptshift -= ptidxbits) {
+    i = 0;
+    ptshift = (levels - 1) * ptidxbits;
+    base = root;
+
+    /*
+     * Skip the levels whose non-leaf PTEs are in the page walk cache,
+     * starting from the deepest one.
+     */
+    if (use_pwc) {
+        int j;
+
+        for (j = levels - 2; j >= 0; j--) {
+            int shift = (levels - 1 - j) * ptidxbits;
+            target_ulong vpn = addr >> (PGSHIFT + shift);
+            RISCVPWCEntry *e = &env->pwc[j][vpn % RISCV_PWC_ENTRIES];
+
+            if (e->valid && e->vpn == vpn) {
+                i = j + 1;
+                ptshift = shift - ptidxbits;
+                base = e->base;
+                break;
+            }
+        }
+    }
+
+    for (; i < levels; i++, ptshift -= ptidxbits) {
         target_ulong idx = (addr >> (PGSHIFT + ptshift)) &
                            ((1 << ptidxbits) - 1);
 
@@ -259,6 +294,14 @@ restart:
         } else if (!(pte & (PTE_R | PTE_W | PTE_X))) {
             /* Inner PTE, continue walking */
             base = ppn << PGSHIFT;
+            if (use_pwc && i < levels - 1) {
+                target_ulong vpn = addr >> (PGSHIFT + ptshift);
+                RISCVPWCEntry *e = &env->pwc[i][vpn % RISCV_PWC_ENTRIES];
+
+                e->vpn = vpn;
+                e->base = base;
+                e->valid = true;
+            }
         } else if ((pte & (PTE_R | PTE_W | PTE_X)) == PTE_W) {
             /* Reserved leaf PTE flags: PTE_W */
             return TRANSLATE_FAIL;
@@ -332,6 +375,7 @@ restart:
                benefit. */
             target_ulong vpn = addr >> PGSHIFT;
             *physical = (ppn | (vpn & ((1L << ptshift) - 1))) << PGSHIFT;
+            *page_size = (target_ulong)1 << (PGSHIFT + ptshift);
 
             /* set permissions on the TLB entry */
             if ((pte & PTE_R) || ((pte & PTE_X) && mxr)) {
@@ -383,10 +427,13 @@ hwaddr riscv_cpu_get_phys_page_debug(CPUState *cs, vaddr addr)
 {
     RISCVCPU *cpu = RISCV_CPU(cs);
     hwaddr phys_addr;
+    target_ulong page_size;
     int prot;
     int mmu_idx = cpu_mmu_index(&cpu->env, false);
 
-    if (get_physical_address(&cpu->env, &phys_addr, &prot, addr, 0, mmu_idx)) {
+    /* The debugger may run concurrently with the vCPU: leave its cache be */
+    if (get_physical_address(&cpu->env, &phys_addr, &prot, &page_size, addr,
+                             0, mmu_idx, false)) {
         return -1;
     }
     return phys_addr;
@@ -440,6 +487,7 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     RISCVCPU *cpu = RISCV_CPU(cs);
     CPURISCVState *env = &cpu->env;
     hwaddr pa = 0;
+    target_ulong page_size;
     int prot;
     bool pmp_violation = false;
     int ret = TRANSLATE_FAIL;
@@ -448,7 +496,8 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     qemu_log_mask(CPU_LOG_MMU, "%s ad %" VADDR_PRIx " rw %d mmu_idx %d\n",
                   __func__, address, access_type, mmu_idx);
 
-    ret = get_physical_address(env, &pa, &prot, address, access_type, mmu_idx);
+    ret = get_physical_address(env, &pa, &prot, &page_size, address,
+                               access_type, mmu_idx, true);
 
     if (mode == PRV_M && access_type != MMU_INST_FETCH) {
         if (get_field(env->mstatus, MSTATUS_MPRV)) {
@@ -469,8 +518,16 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
         pmp_violation = true;
     }
     if (ret == TRANSLATE_SUCCESS) {
+        /*
+         * PMP is only checked for the page being entered, so let the core
+         * reuse a superpage mapping for other pages only without PMP rules.
+         */
+        if (riscv_feature(env, RISCV_FEATURE_PMP) &&
+            env->pmp_state.num_rules) {
+            page_size = TARGET_PAGE_SIZE;
+        }
         tlb_set_page(cs, address & TARGET_PAGE_MASK, pa & TARGET_PAGE_MASK,
-                     prot, mmu_idx, TARGET_PAGE_SIZE);
+                     prot, mmu_idx, page_size);
         return true;
     } else if (probe) {
         return false;
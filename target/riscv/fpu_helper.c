@@ -49,36 +49,6 @@ void riscv_cpu_set_fflags(CPURISCVState *env, target_ulong hard)
     set_float_exception_flags(soft, &env->fp_status);
 }
 
-void helper_set_rounding_mode(CPURISCVState *env, uint32_t rm)
-{
-    int softrm;
-
-    if (rm == 7) {
-        rm = env->frm;
-    }
-    switch (rm) {
-    case 0:
-        softrm = float_round_nearest_even;
-        break;
-    case 1:
-        softrm = float_round_to_zero;
-        break;
-    case 2:
-        softrm = float_round_down;
-        break;
-    case 3:
-        softrm = float_round_up;
-        break;
-    case 4:
-        softrm = float_round_ties_away;
-        break;
-    default:
-        riscv_raise_exception(env, RISCV_EXCP_ILLEGAL_INST, GETPC());
-    }
-
-    set_float_rounding_mode(softrm, &env->fp_status);
-}
-
 uint64_t helper_fmadd_s(CPURISCVState *env, uint64_t frs1, uint64_t frs2,
                         uint64_t frs3)
 {
@@ -1,9 +1,6 @@
 /* Exceptions */
 DEF_HELPER_2(raise_exception, noreturn, env, i32)
 
-/* Floating Point - rounding mode */
-DEF_HELPER_FLAGS_2(set_rounding_mode, TCG_CALL_NO_WG, void, env, i32)
-
 /* Floating Point - fused */
 DEF_HELPER_FLAGS_4(fmadd_s, TCG_CALL_NO_RWG, i64, env, i64, i64, i64)
 DEF_HELPER_FLAGS_4(fmadd_d, TCG_CALL_NO_RWG, i64, env, i64, i64, i64)
@@ -76,3 +73,264 @@ DEF_HELPER_2(mret, tl, env, tl)
 DEF_HELPER_1(wfi, void, env)
 DEF_HELPER_1(tlb_flush, void, env)
 #endif
+
+/* Vector functions */
+DEF_HELPER_FLAGS_3(vsetvl, TCG_CALL_NO_RWG, tl, env, tl, tl)
+DEF_HELPER_FLAGS_5(vle_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vse_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlse_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vsse_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlxei_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsxei_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vlm_v, TCG_CALL_NO_WG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vsm_v, TCG_CALL_NO_WG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vlre_v, TCG_CALL_NO_WG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vsr_v, TCG_CALL_NO_WG, void, ptr, tl, env, i32)
+
+DEF_HELPER_FLAGS_6(vadd_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulh_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulhu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulhsu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vdivu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vdiv_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vremu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrem_vv, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmacc_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vnmsac_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmadd_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vnmsub_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vvm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulh_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulhu_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmulhsu_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vdivu_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vdiv_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vremu_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrem_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmacc_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vnmsac_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmadd_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vnmsub_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrsub_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgtu_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgt_vx, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vxm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vslideup_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vslidedown_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vslide1up_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vslide1down_vx, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vredsum_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredand_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredor_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredxor_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredminu_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredmin_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredmaxu_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vredmax_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmand_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmnand_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmandn_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmxor_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmor_mm, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmnor_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmorn_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmxnor_mm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vcpop_m, TCG_CALL_NO_RWG, tl, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vfirst_m, TCG_CALL_NO_RWG, tl, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vid_v, TCG_CALL_NO_RWG, void, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vfadd_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsub_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmul_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfdiv_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmin_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmax_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnj_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnjn_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnjx_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmacc_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmacc_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmsac_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmsac_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmadd_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmadd_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmsub_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmsub_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfeq_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfne_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmflt_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfle_vv, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfadd_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsub_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmul_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfdiv_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmin_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmax_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnj_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnjn_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfsgnjx_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmacc_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmacc_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmsac_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmsac_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmadd_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmadd_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmsub_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfnmsub_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfeq_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfne_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmflt_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfle_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfrsub_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfrdiv_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfgt_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmfge_vf, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfmerge_vfm, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, i64, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfredusum_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfredosum_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfredmin_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vfredmax_vs, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfsqrt_v, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_xu_f_v, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_x_f_v, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_f_xu_v, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_f_x_v, TCG_CALL_NO_RWG, void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_rtz_xu_f_v, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_5(vfcvt_rtz_x_f_v, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, env, i32)
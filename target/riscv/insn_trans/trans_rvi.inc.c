@@ -82,20 +82,39 @@ static bool gen_branch(DisasContext *ctx, arg_b *a, TCGCond cond)
 {
     TCGLabel *l = gen_new_label();
     TCGv source1, source2;
+    target_ulong dest = ctx->base.pc_next + a->imm;
     source1 = tcg_temp_new();
     source2 = tcg_temp_new();
     gen_get_gpr(source1, a->rs1);
     gen_get_gpr(source2, a->rs2);
 
+    /*
+     * In a superblock, predict forward branches as not taken: the taken
+     * side exit is emitted at the end of the TB, and translation goes on
+     * with the fallthrough.  The branch only syncs globals, so they can
+     * stay in host registers along the hot path.
+     */
+    if (superblock_follow(ctx, ctx->pc_succ_insn) && a->imm > 0 &&
+        ctx->nb_side_exits < MAX_SIDE_EXITS &&
+        (has_ext(ctx, RVC) || !(dest & 0x3))) {
+        ctx->side_exit[ctx->nb_side_exits].label = l;
+        ctx->side_exit[ctx->nb_side_exits].dest = dest;
+        ctx->nb_side_exits++;
+        tcg_gen_brcond_tl(cond, source1, source2, l);
+        tcg_temp_free(source1);
+        tcg_temp_free(source2);
+        return true;
+    }
+
     tcg_gen_brcond_tl(cond, source1, source2, l);
     gen_goto_tb(ctx, 1, ctx->pc_succ_insn);
     gen_set_label(l); /* branch taken */
 
-    if (!has_ext(ctx, RVC) && ((ctx->base.pc_next + a->imm) & 0x3)) {
+    if (!has_ext(ctx, RVC) && (dest & 0x3)) {
         /* misaligned */
         gen_exception_inst_addr_mis(ctx);
     } else {
-        gen_goto_tb(ctx, 0, ctx->base.pc_next + a->imm);
+        gen_goto_tb(ctx, 0, dest);
     }
     ctx->base.is_jmp = DISAS_NORETURN;
 
@@ -0,0 +1,1207 @@
+/*
+ * RISC-V translation routines for the RVV Standard Extension.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The vector state is part of the TB flags, so SEW and LMUL are known
+ * here.  When the TB also knows that vstart is 0 and vl is VLMAX, an
+ * unmasked element-wise integer op covers whole registers and is
+ * expanded inline with the generic vector ops.  Everything else calls
+ * a helper, which handles vstart, vl and the mask.
+ */
+
+typedef void GVecGen2iFn(unsigned, uint32_t, uint32_t, int64_t,
+                         uint32_t, uint32_t);
+typedef void GVecGen2sFn(unsigned, uint32_t, uint32_t, TCGv_i64,
+                         uint32_t, uint32_t);
+typedef void GVecGen3Fn(unsigned, uint32_t, uint32_t, uint32_t,
+                        uint32_t, uint32_t);
+
+typedef void gen_helper_opivx(TCGv_ptr, TCGv_ptr, TCGv, TCGv_ptr,
+                              TCGv_env, TCGv_i32);
+typedef void gen_helper_opfvf(TCGv_ptr, TCGv_ptr, TCGv_i64, TCGv_ptr,
+                              TCGv_env, TCGv_i32);
+
+static bool require_rvv(DisasContext *ctx)
+{
+    return has_ext(ctx, RVV) && ctx->mstatus_vs != 0;
+}
+
+/* Everything but the configuration and whole register moves needs vtype */
+static bool require_vtype(DisasContext *ctx)
+{
+    return require_rvv(ctx) && !ctx->vill;
+}
+
+/* SEW must be a floating point format we have */
+static bool require_rvf(DisasContext *ctx)
+{
+    if (ctx->mstatus_fs == 0) {
+        return false;
+    }
+    switch (ctx->sew) {
+    case MO_32:
+        return has_ext(ctx, RVF);
+    case MO_64:
+        return has_ext(ctx, RVD);
+    default:
+        return false;
+    }
+}
+
+/* A group of 2^lmul registers starts at a multiple of its size */
+static bool require_align(int reg, int lmul)
+{
+    return lmul <= 0 || extract32(reg, 0, lmul) == 0;
+}
+
+/* A masked instruction cannot write elements to v0, which holds the mask */
+static bool require_vm(int vm, int vd)
+{
+    return vm || vd != 0;
+}
+
+static uint32_t vreg_ofs(DisasContext *ctx, int reg)
+{
+    return offsetof(CPURISCVState, vreg) + reg * ctx->vlenb;
+}
+
+/* The offset of element 0 of a register, at the current SEW */
+static uint32_t vreg_elem0_ofs(DisasContext *ctx, int reg)
+{
+#ifdef HOST_WORDS_BIGENDIAN
+    return vreg_ofs(ctx, reg) + 8 - (1 << ctx->sew);
+#else
+    return vreg_ofs(ctx, reg);
+#endif
+}
+
+/* The bytes in a register group, VLMAX * SEW */
+static uint32_t vext_group_size(DisasContext *ctx)
+{
+    return ctx->lmul < 0 ? ctx->vlenb >> -ctx->lmul
+                         : ctx->vlenb << ctx->lmul;
+}
+
+static bool vext_use_gvec(DisasContext *ctx, int vm)
+{
+    return vm && ctx->vl_eq_vlmax && vext_group_size(ctx) >= 8;
+}
+
+static uint32_t vext_desc(DisasContext *ctx, int32_t data)
+{
+    return simd_desc(ctx->vlenb, ctx->vlenb, data);
+}
+
+/*
+ *** Configuration
+ */
+
+static bool do_vsetvl(DisasContext *ctx, int rd, int rs1, TCGv s2)
+{
+    TCGv s1, dst;
+
+    if (!require_rvv(ctx)) {
+        return false;
+    }
+
+    s1 = tcg_temp_new();
+    dst = tcg_temp_new();
+    if (rd == 0 && rs1 == 0) {
+        /* Keep vl, with a new vtype of the same SEW/LMUL ratio */
+        tcg_gen_ld_tl(s1, cpu_env, offsetof(CPURISCVState, vl));
+    } else if (rs1 == 0) {
+        /* Set vl to VLMAX */
+        tcg_gen_movi_tl(s1, -1);
+    } else {
+        gen_get_gpr(s1, rs1);
+    }
+    gen_helper_vsetvl(dst, cpu_env, s1, s2);
+    gen_set_gpr(rd, dst);
+    mark_vs_dirty(ctx);
+
+    /* The rest of the TB depends on the new vtype and vl */
+    tcg_gen_movi_tl(cpu_pc, ctx->pc_succ_insn);
+    lookup_and_goto_ptr(ctx);
+    ctx->base.is_jmp = DISAS_NORETURN;
+
+    tcg_temp_free(s1);
+    tcg_temp_free(dst);
+    return true;
+}
+
+static bool trans_vsetvl(DisasContext *ctx, arg_vsetvl *a)
+{
+    TCGv s2 = tcg_temp_new();
+    bool ret;
+
+    gen_get_gpr(s2, a->rs2);
+    ret = do_vsetvl(ctx, a->rd, a->rs1, s2);
+    tcg_temp_free(s2);
+    return ret;
+}
+
+static bool trans_vsetvli(DisasContext *ctx, arg_vsetvli *a)
+{
+    TCGv s2 = tcg_const_tl(a->zimm);
+    bool ret = do_vsetvl(ctx, a->rd, a->rs1, s2);
+
+    tcg_temp_free(s2);
+    return ret;
+}
+
+static bool trans_vsetivli(DisasContext *ctx, arg_vsetivli *a)
+{
+    TCGv s1, s2, dst;
+
+    if (!require_rvv(ctx)) {
+        return false;
+    }
+
+    /* rs1 holds the AVL itself */
+    s1 = tcg_const_tl(a->rs1);
+    s2 = tcg_const_tl(a->zimm);
+    dst = tcg_temp_new();
+    gen_helper_vsetvl(dst, cpu_env, s1, s2);
+    gen_set_gpr(a->rd, dst);
+    mark_vs_dirty(ctx);
+
+    tcg_gen_movi_tl(cpu_pc, ctx->pc_succ_insn);
+    lookup_and_goto_ptr(ctx);
+    ctx->base.is_jmp = DISAS_NORETURN;
+
+    tcg_temp_free(s1);
+    tcg_temp_free(s2);
+    tcg_temp_free(dst);
+    return true;
+}
+
+/*
+ *** Loads and stores
+ */
+
+/*
+ * A group of @nf fields of EMUL = 2^@emul registers each, starting at
+ * @vd: EMUL must be between 1/8 and 8, the fields must fit in 8
+ * registers and below v32, and each field must be aligned to EMUL.
+ */
+static bool vext_check_segment(int vd, int nf, int emul)
+{
+    int regs = emul > 0 ? 1 << emul : 1;
+
+    return emul >= -3 && emul <= 3 && nf * regs <= 8 &&
+           vd + nf * regs <= 32 && require_align(vd, emul);
+}
+
+static uint32_t vext_ldst_data(int vm, int nf, int eew)
+{
+    return (vm << VDATA_VM_SHIFT) | ((nf - 1) << VDATA_NF_SHIFT) |
+           (eew << VDATA_ESZ_SHIFT);
+}
+
+typedef void gen_helper_ldst_us(TCGv_ptr, TCGv_ptr, TCGv,
+                                TCGv_env, TCGv_i32);
+typedef void gen_helper_ldst_stride(TCGv_ptr, TCGv_ptr, TCGv, TCGv,
+                                    TCGv_env, TCGv_i32);
+typedef void gen_helper_ldst_index(TCGv_ptr, TCGv_ptr, TCGv, TCGv_ptr,
+                                   TCGv_env, TCGv_i32);
+typedef void gen_helper_ldst_whole(TCGv_ptr, TCGv, TCGv_env, TCGv_i32);
+
+/*
+ * Unit-stride and strided accesses, with the data elements of EEW
+ * 2^@eew bytes.  rs2 is the stride register, if @stride_fn is given.
+ */
+static bool do_ldst_stride(DisasContext *ctx, arg_rnfvm *a, int eew,
+                           bool is_load, gen_helper_ldst_us *us_fn,
+                           gen_helper_ldst_stride *stride_fn)
+{
+    TCGv_ptr dest, mask;
+    TCGv base;
+    TCGv_i32 desc;
+
+    if (!require_vtype(ctx) || (is_load && !require_vm(a->vm, a->rd)) ||
+        !vext_check_segment(a->rd, a->nf, eew - ctx->sew + ctx->lmul)) {
+        return false;
+    }
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    base = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(ctx, vext_ldst_data(a->vm, a->nf, eew)));
+
+    gen_get_gpr(base, a->rs1);
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, a->rd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    if (stride_fn) {
+        TCGv stride = tcg_temp_new();
+
+        gen_get_gpr(stride, a->rs2);
+        stride_fn(dest, mask, base, stride, cpu_env, desc);
+        tcg_temp_free(stride);
+    } else {
+        us_fn(dest, mask, base, cpu_env, desc);
+    }
+    if (is_load) {
+        mark_vs_dirty(ctx);
+    }
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free(base);
+    tcg_temp_free_i32(desc);
+    return true;
+}
+
+#define GEN_VEXT_LDST_US_TRANS(NAME, EEW, IS_LOAD, HELPER)              \
+static bool trans_##NAME(DisasContext *ctx, arg_##NAME *a)              \
+{                                                                       \
+    arg_rnfvm r = { .vm = a->vm, .rd = a->rd, .rs1 = a->rs1,            \
+                    .nf = a->nf };                                      \
+    return do_ldst_stride(ctx, &r, EEW, IS_LOAD, gen_helper_##HELPER,   \
+                          NULL);                                        \
+}
+
+GEN_VEXT_LDST_US_TRANS(vle8_v, MO_8, true, vle_v)
+GEN_VEXT_LDST_US_TRANS(vle16_v, MO_16, true, vle_v)
+GEN_VEXT_LDST_US_TRANS(vle32_v, MO_32, true, vle_v)
+GEN_VEXT_LDST_US_TRANS(vle64_v, MO_64, true, vle_v)
+GEN_VEXT_LDST_US_TRANS(vse8_v, MO_8, false, vse_v)
+GEN_VEXT_LDST_US_TRANS(vse16_v, MO_16, false, vse_v)
+GEN_VEXT_LDST_US_TRANS(vse32_v, MO_32, false, vse_v)
+GEN_VEXT_LDST_US_TRANS(vse64_v, MO_64, false, vse_v)
+
+#define GEN_VEXT_LDST_STRIDE_TRANS(NAME, EEW, IS_LOAD, HELPER)          \
+static bool trans_##NAME(DisasContext *ctx, arg_##NAME *a)              \
+{                                                                       \
+    return do_ldst_stride(ctx, a, EEW, IS_LOAD, NULL,                   \
+                          gen_helper_##HELPER);                         \
+}
+
+GEN_VEXT_LDST_STRIDE_TRANS(vlse8_v, MO_8, true, vlse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse16_v, MO_16, true, vlse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse32_v, MO_32, true, vlse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse64_v, MO_64, true, vlse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse8_v, MO_8, false, vsse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse16_v, MO_16, false, vsse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse32_v, MO_32, false, vsse_v)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse64_v, MO_64, false, vsse_v)
+
+/*
+ * Indexed accesses: the data elements are SEW wide with EMUL = LMUL,
+ * and the index elements in vs2 are 2^@eew bytes.
+ */
+static bool do_ldst_index(DisasContext *ctx, arg_rnfvm *a, int eew,
+                          bool is_load, gen_helper_ldst_index *fn)
+{
+    int emul = eew - ctx->sew + ctx->lmul;
+    TCGv_ptr dest, mask, index;
+    TCGv base;
+    TCGv_i32 desc;
+
+    if (!require_vtype(ctx) || (is_load && !require_vm(a->vm, a->rd)) ||
+        !vext_check_segment(a->rd, a->nf, ctx->lmul) ||
+        !vext_check_segment(a->rs2, 1, emul)) {
+        return false;
+    }
+    /* A load cannot overwrite its indices */
+    if (is_load && a->rs2 < a->rd + (a->nf << MAX(ctx->lmul, 0)) &&
+        a->rd < a->rs2 + (1 << MAX(emul, 0))) {
+        return false;
+    }
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    index = tcg_temp_new_ptr();
+    base = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(ctx, vext_ldst_data(a->vm, a->nf, eew)));
+
+    gen_get_gpr(base, a->rs1);
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, a->rd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    tcg_gen_addi_ptr(index, cpu_env, vreg_ofs(ctx, a->rs2));
+    fn(dest, mask, base, index, cpu_env, desc);
+    if (is_load) {
+        mark_vs_dirty(ctx);
+    }
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_ptr(index);
+    tcg_temp_free(base);
+    tcg_temp_free_i32(desc);
+    return true;
+}
+
+#define GEN_VEXT_LDST_INDEX_TRANS(NAME, EEW, IS_LOAD, HELPER)           \
+static bool trans_##NAME(DisasContext *ctx, arg_##NAME *a)              \
+{                                                                       \
+    return do_ldst_index(ctx, a, EEW, IS_LOAD, gen_helper_##HELPER);    \
+}
+
+GEN_VEXT_LDST_INDEX_TRANS(vlxei8_v, MO_8, true, vlxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vlxei16_v, MO_16, true, vlxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vlxei32_v, MO_32, true, vlxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vlxei64_v, MO_64, true, vlxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vsxei8_v, MO_8, false, vsxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vsxei16_v, MO_16, false, vsxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vsxei32_v, MO_32, false, vsxei_v)
+GEN_VEXT_LDST_INDEX_TRANS(vsxei64_v, MO_64, false, vsxei_v)
+
+/* Mask and whole register accesses, which do not depend on a mask */
+static bool do_ldst_whole(DisasContext *ctx, int vd, int rs1, int nf,
+                          int eew, bool is_load, gen_helper_ldst_whole *fn)
+{
+    TCGv_ptr dest;
+    TCGv base;
+    TCGv_i32 desc;
+
+    dest = tcg_temp_new_ptr();
+    base = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(ctx, vext_ldst_data(1, nf, eew)));
+
+    gen_get_gpr(base, rs1);
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, vd));
+    fn(dest, base, cpu_env, desc);
+    if (is_load) {
+        mark_vs_dirty(ctx);
+    }
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free(base);
+    tcg_temp_free_i32(desc);
+    return true;
+}
+
+static bool trans_vlm_v(DisasContext *ctx, arg_vlm_v *a)
+{
+    if (!require_vtype(ctx)) {
+        return false;
+    }
+    return do_ldst_whole(ctx, a->rd, a->rs1, 1, MO_8, true,
+                         gen_helper_vlm_v);
+}
+
+static bool trans_vsm_v(DisasContext *ctx, arg_vsm_v *a)
+{
+    if (!require_vtype(ctx)) {
+        return false;
+    }
+    return do_ldst_whole(ctx, a->rd, a->rs1, 1, MO_8, false,
+                         gen_helper_vsm_v);
+}
+
+/* nf is the number of registers, one of 1, 2, 4 and 8 */
+static bool vext_check_whole(DisasContext *ctx, int vd, int nf)
+{
+    return require_rvv(ctx) && is_power_of_2(nf) && vd % nf == 0;
+}
+
+#define GEN_VEXT_LD_WHOLE_TRANS(NAME, EEW)                              \
+static bool trans_##NAME(DisasContext *ctx, arg_##NAME *a)              \
+{                                                                       \
+    if (!vext_check_whole(ctx, a->rd, a->nf)) {                         \
+        return false;                                                   \
+    }                                                                   \
+    return do_ldst_whole(ctx, a->rd, a->rs1, a->nf, EEW, true,          \
+                         gen_helper_vlre_v);                            \
+}
+
+GEN_VEXT_LD_WHOLE_TRANS(vlre8_v, MO_8)
+GEN_VEXT_LD_WHOLE_TRANS(vlre16_v, MO_16)
+GEN_VEXT_LD_WHOLE_TRANS(vlre32_v, MO_32)
+GEN_VEXT_LD_WHOLE_TRANS(vlre64_v, MO_64)
+
+static bool trans_vsr_v(DisasContext *ctx, arg_vsr_v *a)
+{
+    if (!vext_check_whole(ctx, a->rd, a->nf)) {
+        return false;
+    }
+    return do_ldst_whole(ctx, a->rd, a->rs1, a->nf, MO_8, false,
+                         gen_helper_vsr_v);
+}
+
+/*
+ *** Integer arithmetic
+ */
+
+/* All operands are groups of SEW elements */
+static bool opivv_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return require_vtype(ctx) && require_vm(a->vm, a->rd) &&
+           require_align(a->rd, ctx->lmul) &&
+           require_align(a->rs2, ctx->lmul) &&
+           require_align(a->rs1, ctx->lmul);
+}
+
+static bool opivx_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return require_vtype(ctx) && require_vm(a->vm, a->rd) &&
+           require_align(a->rd, ctx->lmul) &&
+           require_align(a->rs2, ctx->lmul);
+}
+
+/* vd is a mask register, and so may be v0 */
+static bool opivv_cmp_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return require_vtype(ctx) && require_align(a->rs2, ctx->lmul) &&
+           require_align(a->rs1, ctx->lmul);
+}
+
+static bool opivx_cmp_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return require_vtype(ctx) && require_align(a->rs2, ctx->lmul);
+}
+
+static void do_opivv(DisasContext *ctx, arg_rmrr *a, GVecGen3Fn *gvec_fn,
+                     gen_helper_gvec_4_ptr *fn)
+{
+    if (gvec_fn && vext_use_gvec(ctx, a->vm)) {
+        uint32_t sz = vext_group_size(ctx);
+
+        gvec_fn(ctx->sew, vreg_ofs(ctx, a->rd), vreg_ofs(ctx, a->rs2),
+                vreg_ofs(ctx, a->rs1), sz, sz);
+    } else {
+        tcg_gen_gvec_4_ptr(vreg_ofs(ctx, a->rd), vreg_ofs(ctx, 0),
+                           vreg_ofs(ctx, a->rs1), vreg_ofs(ctx, a->rs2),
+                           cpu_env, ctx->vlenb, ctx->vlenb,
+                           a->vm << VDATA_VM_SHIFT, fn);
+    }
+    mark_vs_dirty(ctx);
+}
+
+#define GEN_OPIVV_TRANS(NAME, CHECK, GVEC)                              \
+static bool trans_##NAME(DisasContext *ctx, arg_rmrr *a)                \
+{                                                                       \
+    if (!CHECK(ctx, a)) {                                               \
+        return false;                                                   \
+    }                                                                   \
+    do_opivv(ctx, a, GVEC, gen_helper_##NAME);                          \
+    return true;                                                        \
+}
+
+static void do_opivx_helper(DisasContext *ctx, int vd, int vs2, TCGv s1,
+                            int vm, gen_helper_opivx *fn)
+{
+    TCGv_ptr dest = tcg_temp_new_ptr();
+    TCGv_ptr mask = tcg_temp_new_ptr();
+    TCGv_ptr src2 = tcg_temp_new_ptr();
+    TCGv_i32 desc = tcg_const_i32(vext_desc(ctx, vm << VDATA_VM_SHIFT));
+
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, vd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    tcg_gen_addi_ptr(src2, cpu_env, vreg_ofs(ctx, vs2));
+    fn(dest, mask, s1, src2, cpu_env, desc);
+    mark_vs_dirty(ctx);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_ptr(src2);
+    tcg_temp_free_i32(desc);
+}
+
+static void do_opivx(DisasContext *ctx, arg_rmrr *a, GVecGen2sFn *gvec_fn,
+                     gen_helper_opivx *fn)
+{
+    TCGv s1 = tcg_temp_new();
+
+    gen_get_gpr(s1, a->rs1);
+    if (gvec_fn && vext_use_gvec(ctx, a->vm)) {
+        uint32_t sz = vext_group_size(ctx);
+        TCGv_i64 t1 = tcg_temp_new_i64();
+
+        tcg_gen_ext_tl_i64(t1, s1);
+        gvec_fn(ctx->sew, vreg_ofs(ctx, a->rd), vreg_ofs(ctx, a->rs2),
+                t1, sz, sz);
+        tcg_temp_free_i64(t1);
+        mark_vs_dirty(ctx);
+    } else {
+        do_opivx_helper(ctx, a->rd, a->rs2, s1, a->vm, fn);
+    }
+    tcg_temp_free(s1);
+}
+
+#define GEN_OPIVX_TRANS(NAME, CHECK, GVEC)                              \
+static bool trans_##NAME(DisasContext *ctx, arg_rmrr *a)                \
+{                                                                       \
+    if (!CHECK(ctx, a)) {                                               \
+        return false;                                                   \
+    }                                                                   \
+    do_opivx(ctx, a, GVEC, gen_helper_##NAME);                          \
+    return true;                                                        \
+}
+
+/*
+ * The immediate of the .vi forms is in the rs1 field, sign-extended
+ * except for the shifts and the slides.
+ */
+static void do_opivi(DisasContext *ctx, arg_rmrr *a, bool zext,
+                     GVecGen2iFn *gvec_fn, gen_helper_opivx *fn)
+{
+    int64_t imm = zext ? a->rs1 : sextract32(a->rs1, 0, 5);
+
+    if (gvec_fn && vext_use_gvec(ctx, a->vm)) {
+        uint32_t sz = vext_group_size(ctx);
+
+        gvec_fn(ctx->sew, vreg_ofs(ctx, a->rd), vreg_ofs(ctx, a->rs2),
+                imm, sz, sz);
+        mark_vs_dirty(ctx);
+    } else {
+        TCGv s1 = tcg_const_tl(imm);
+
+        do_opivx_helper(ctx, a->rd, a->rs2, s1, a->vm, fn);
+        tcg_temp_free(s1);
+    }
+}
+
+#define GEN_OPIVI_TRANS(NAME, CHECK, ZEXT, GVEC, HELPER)                \
+static bool trans_##NAME(DisasContext *ctx, arg_rmrr *a)                \
+{                                                                       \
+    if (!CHECK(ctx, a)) {                                               \
+        return false;                                                   \
+    }                                                                   \
+    do_opivi(ctx, a, ZEXT, GVEC, gen_helper_##HELPER);                  \
+    return true;                                                        \
+}
+
+/* Only the low log2(SEW) bits of a shift amount are used */
+static void gen_vec_shli(unsigned vece, uint32_t dofs, uint32_t aofs,
+                         int64_t c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_shli(vece, dofs, aofs, c & ((8 << vece) - 1), oprsz, maxsz);
+}
+
+static void gen_vec_shri(unsigned vece, uint32_t dofs, uint32_t aofs,
+                         int64_t c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_shri(vece, dofs, aofs, c & ((8 << vece) - 1), oprsz, maxsz);
+}
+
+static void gen_vec_sari(unsigned vece, uint32_t dofs, uint32_t aofs,
+                         int64_t c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_sari(vece, dofs, aofs, c & ((8 << vece) - 1), oprsz, maxsz);
+}
+
+#define GEN_VEC_SHIFTS(NAME, GVEC)                                      \
+static void NAME(unsigned vece, uint32_t dofs, uint32_t aofs,           \
+                 TCGv_i64 c, uint32_t oprsz, uint32_t maxsz)            \
+{                                                                       \
+    TCGv_i32 t = tcg_temp_new_i32();                                    \
+                                                                        \
+    tcg_gen_extrl_i64_i32(t, c);                                        \
+    tcg_gen_andi_i32(t, t, (8 << vece) - 1);                            \
+    GVEC(vece, dofs, aofs, t, oprsz, maxsz);                            \
+    tcg_temp_free_i32(t);                                               \
+}
+
+GEN_VEC_SHIFTS(gen_vec_shls, tcg_gen_gvec_shls)
+GEN_VEC_SHIFTS(gen_vec_shrs, tcg_gen_gvec_shrs)
+GEN_VEC_SHIFTS(gen_vec_sars, tcg_gen_gvec_sars)
+
+/* vd = s1 - vs2 */
+static void gen_vec_rsubs(unsigned vece, uint32_t dofs, uint32_t aofs,
+                          TCGv_i64 c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_neg(vece, dofs, aofs, oprsz, maxsz);
+    tcg_gen_gvec_adds(vece, dofs, dofs, c, oprsz, maxsz);
+}
+
+static void gen_vec_rsubi(unsigned vece, uint32_t dofs, uint32_t aofs,
+                          int64_t c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_neg(vece, dofs, aofs, oprsz, maxsz);
+    tcg_gen_gvec_addi(vece, dofs, dofs, c, oprsz, maxsz);
+}
+
+GEN_OPIVV_TRANS(vadd_vv, opivv_check, tcg_gen_gvec_add)
+GEN_OPIVX_TRANS(vadd_vx, opivx_check, tcg_gen_gvec_adds)
+GEN_OPIVI_TRANS(vadd_vi, opivx_check, false, tcg_gen_gvec_addi, vadd_vx)
+GEN_OPIVV_TRANS(vsub_vv, opivv_check, tcg_gen_gvec_sub)
+GEN_OPIVX_TRANS(vsub_vx, opivx_check, tcg_gen_gvec_subs)
+GEN_OPIVX_TRANS(vrsub_vx, opivx_check, gen_vec_rsubs)
+GEN_OPIVI_TRANS(vrsub_vi, opivx_check, false, gen_vec_rsubi, vrsub_vx)
+GEN_OPIVV_TRANS(vminu_vv, opivv_check, tcg_gen_gvec_umin)
+GEN_OPIVX_TRANS(vminu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmin_vv, opivv_check, tcg_gen_gvec_smin)
+GEN_OPIVX_TRANS(vmin_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmaxu_vv, opivv_check, tcg_gen_gvec_umax)
+GEN_OPIVX_TRANS(vmaxu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmax_vv, opivv_check, tcg_gen_gvec_smax)
+GEN_OPIVX_TRANS(vmax_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vand_vv, opivv_check, tcg_gen_gvec_and)
+GEN_OPIVX_TRANS(vand_vx, opivx_check, tcg_gen_gvec_ands)
+GEN_OPIVI_TRANS(vand_vi, opivx_check, false, tcg_gen_gvec_andi, vand_vx)
+GEN_OPIVV_TRANS(vor_vv, opivv_check, tcg_gen_gvec_or)
+GEN_OPIVX_TRANS(vor_vx, opivx_check, tcg_gen_gvec_ors)
+GEN_OPIVI_TRANS(vor_vi, opivx_check, false, tcg_gen_gvec_ori, vor_vx)
+GEN_OPIVV_TRANS(vxor_vv, opivv_check, tcg_gen_gvec_xor)
+GEN_OPIVX_TRANS(vxor_vx, opivx_check, tcg_gen_gvec_xors)
+GEN_OPIVI_TRANS(vxor_vi, opivx_check, false, tcg_gen_gvec_xori, vxor_vx)
+GEN_OPIVV_TRANS(vsll_vv, opivv_check, tcg_gen_gvec_shlv)
+GEN_OPIVX_TRANS(vsll_vx, opivx_check, gen_vec_shls)
+GEN_OPIVI_TRANS(vsll_vi, opivx_check, true, gen_vec_shli, vsll_vx)
+GEN_OPIVV_TRANS(vsrl_vv, opivv_check, tcg_gen_gvec_shrv)
+GEN_OPIVX_TRANS(vsrl_vx, opivx_check, gen_vec_shrs)
+GEN_OPIVI_TRANS(vsrl_vi, opivx_check, true, gen_vec_shri, vsrl_vx)
+GEN_OPIVV_TRANS(vsra_vv, opivv_check, tcg_gen_gvec_sarv)
+GEN_OPIVX_TRANS(vsra_vx, opivx_check, gen_vec_sars)
+GEN_OPIVI_TRANS(vsra_vi, opivx_check, true, gen_vec_sari, vsra_vx)
+
+GEN_OPIVV_TRANS(vmul_vv, opivv_check, tcg_gen_gvec_mul)
+GEN_OPIVX_TRANS(vmul_vx, opivx_check, tcg_gen_gvec_muls)
+GEN_OPIVV_TRANS(vmulh_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmulh_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmulhu_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmulhu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmulhsu_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmulhsu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vdivu_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vdivu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vdiv_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vdiv_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vremu_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vremu_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vrem_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vrem_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmacc_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmacc_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vnmsac_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vnmsac_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vmadd_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmadd_vx, opivx_check, NULL)
+GEN_OPIVV_TRANS(vnmsub_vv, opivv_check, NULL)
+GEN_OPIVX_TRANS(vnmsub_vx, opivx_check, NULL)
+
+GEN_OPIVV_TRANS(vmseq_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmseq_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmseq_vi, opivx_cmp_check, false, NULL, vmseq_vx)
+GEN_OPIVV_TRANS(vmsne_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmsne_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmsne_vi, opivx_cmp_check, false, NULL, vmsne_vx)
+GEN_OPIVV_TRANS(vmsltu_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmsltu_vx, opivx_cmp_check, NULL)
+GEN_OPIVV_TRANS(vmslt_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmslt_vx, opivx_cmp_check, NULL)
+GEN_OPIVV_TRANS(vmsleu_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmsleu_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmsleu_vi, opivx_cmp_check, false, NULL, vmsleu_vx)
+GEN_OPIVV_TRANS(vmsle_vv, opivv_cmp_check, NULL)
+GEN_OPIVX_TRANS(vmsle_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmsle_vi, opivx_cmp_check, false, NULL, vmsle_vx)
+GEN_OPIVX_TRANS(vmsgtu_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmsgtu_vi, opivx_cmp_check, false, NULL, vmsgtu_vx)
+GEN_OPIVX_TRANS(vmsgt_vx, opivx_cmp_check, NULL)
+GEN_OPIVI_TRANS(vmsgt_vi, opivx_cmp_check, false, NULL, vmsgt_vx)
+
+/* vd cannot overlap the source of an up slide */
+static bool slideup_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return opivx_check(ctx, a) && a->rd != a->rs2;
+}
+
+GEN_OPIVX_TRANS(vslideup_vx, slideup_check, NULL)
+GEN_OPIVI_TRANS(vslideup_vi, slideup_check, true, NULL, vslideup_vx)
+GEN_OPIVX_TRANS(vslide1up_vx, slideup_check, NULL)
+GEN_OPIVX_TRANS(vslidedown_vx, opivx_check, NULL)
+GEN_OPIVI_TRANS(vslidedown_vi, opivx_check, true, NULL, vslidedown_vx)
+GEN_OPIVX_TRANS(vslide1down_vx, opivx_check, NULL)
+
+/* vmerge is always masked, and vmv.v is vmerge without the mask */
+GEN_OPIVV_TRANS(vmerge_vvm, opivv_check, NULL)
+GEN_OPIVX_TRANS(vmerge_vxm, opivx_check, NULL)
+GEN_OPIVI_TRANS(vmerge_vim, opivx_check, false, NULL, vmerge_vxm)
+
+static bool trans_vmv_v_v(DisasContext *ctx, arg_vmv_v_v *a)
+{
+    arg_rmrr r = { .vm = 1, .rd = a->rd, .rs1 = a->rs1, .rs2 = a->rs1 };
+
+    if (!require_vtype(ctx) || !require_align(a->rd, ctx->lmul) ||
+        !require_align(a->rs1, ctx->lmul)) {
+        return false;
+    }
+    if (vext_use_gvec(ctx, 1)) {
+        uint32_t sz = vext_group_size(ctx);
+
+        tcg_gen_gvec_mov(ctx->sew, vreg_ofs(ctx, a->rd),
+                         vreg_ofs(ctx, a->rs1), sz, sz);
+        mark_vs_dirty(ctx);
+    } else {
+        do_opivv(ctx, &r, NULL, gen_helper_vmerge_vvm);
+    }
+    return true;
+}
+
+static bool do_vmv_v_x(DisasContext *ctx, int vd, TCGv s1)
+{
+    if (!require_vtype(ctx) || !require_align(vd, ctx->lmul)) {
+        return false;
+    }
+    if (vext_use_gvec(ctx, 1)) {
+        uint32_t sz = vext_group_size(ctx);
+        TCGv_i64 t1 = tcg_temp_new_i64();
+
+        tcg_gen_ext_tl_i64(t1, s1);
+        tcg_gen_gvec_dup_i64(ctx->sew, vreg_ofs(ctx, vd), sz, sz, t1);
+        tcg_temp_free_i64(t1);
+        mark_vs_dirty(ctx);
+    } else {
+        do_opivx_helper(ctx, vd, vd, s1, 1, gen_helper_vmerge_vxm);
+    }
+    return true;
+}
+
+static bool trans_vmv_v_x(DisasContext *ctx, arg_vmv_v_x *a)
+{
+    TCGv s1 = tcg_temp_new();
+    bool ret;
+
+    gen_get_gpr(s1, a->rs1);
+    ret = do_vmv_v_x(ctx, a->rd, s1);
+    tcg_temp_free(s1);
+    return ret;
+}
+
+static bool trans_vmv_v_i(DisasContext *ctx, arg_vmv_v_i *a)
+{
+    TCGv s1 = tcg_const_tl(sextract32(a->rs1, 0, 5));
+    bool ret = do_vmv_v_x(ctx, a->rd, s1);
+
+    tcg_temp_free(s1);
+    return ret;
+}
+
+/*
+ *** Reductions
+ */
+
+/* vd and vs1 are single registers holding the scalar in element 0 */
+static bool reduction_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return require_vtype(ctx) && require_align(a->rs2, ctx->lmul);
+}
+
+GEN_OPIVV_TRANS(vredsum_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredand_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredor_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredxor_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredminu_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredmin_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredmaxu_vs, reduction_check, NULL)
+GEN_OPIVV_TRANS(vredmax_vs, reduction_check, NULL)
+
+/*
+ *** Mask operations
+ */
+
+#define GEN_MM_TRANS(NAME)                                              \
+static bool trans_##NAME(DisasContext *ctx, arg_r *a)                   \
+{                                                                       \
+    if (!require_vtype(ctx)) {                                          \
+        return false;                                                   \
+    }                                                                   \
+    tcg_gen_gvec_4_ptr(vreg_ofs(ctx, a->rd), vreg_ofs(ctx, 0),          \
+                       vreg_ofs(ctx, a->rs1), vreg_ofs(ctx, a->rs2),    \
+                       cpu_env, ctx->vlenb, ctx->vlenb, 0,              \
+                       gen_helper_##NAME);                              \
+    mark_vs_dirty(ctx);                                                 \
+    return true;                                                        \
+}
+
+GEN_MM_TRANS(vmand_mm)
+GEN_MM_TRANS(vmnand_mm)
+GEN_MM_TRANS(vmandn_mm)
+GEN_MM_TRANS(vmxor_mm)
+GEN_MM_TRANS(vmor_mm)
+GEN_MM_TRANS(vmnor_mm)
+GEN_MM_TRANS(vmorn_mm)
+GEN_MM_TRANS(vmxnor_mm)
+
+typedef void gen_helper_vmask_gpr(TCGv, TCGv_ptr, TCGv_ptr, TCGv_env,
+                                  TCGv_i32);
+
+static bool do_vmask_gpr(DisasContext *ctx, arg_rmr *a,
+                         gen_helper_vmask_gpr *fn)
+{
+    TCGv_ptr mask, src2;
+    TCGv_i32 desc;
+    TCGv dst;
+
+    if (!require_vtype(ctx)) {
+        return false;
+    }
+
+    mask = tcg_temp_new_ptr();
+    src2 = tcg_temp_new_ptr();
+    dst = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(ctx, a->vm << VDATA_VM_SHIFT));
+
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    tcg_gen_addi_ptr(src2, cpu_env, vreg_ofs(ctx, a->rs2));
+    fn(dst, mask, src2, cpu_env, desc);
+    gen_set_gpr(a->rd, dst);
+
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_ptr(src2);
+    tcg_temp_free(dst);
+    tcg_temp_free_i32(desc);
+    return true;
+}
+
+static bool trans_vcpop_m(DisasContext *ctx, arg_vcpop_m *a)
+{
+    return do_vmask_gpr(ctx, a, gen_helper_vcpop_m);
+}
+
+static bool trans_vfirst_m(DisasContext *ctx, arg_vfirst_m *a)
+{
+    return do_vmask_gpr(ctx, a, gen_helper_vfirst_m);
+}
+
+static bool trans_vid_v(DisasContext *ctx, arg_vid_v *a)
+{
+    TCGv_ptr dest, mask;
+    TCGv_i32 desc;
+
+    if (!require_vtype(ctx) || !require_vm(a->vm, a->rd) ||
+        !require_align(a->rd, ctx->lmul)) {
+        return false;
+    }
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    desc = tcg_const_i32(vext_desc(ctx, a->vm << VDATA_VM_SHIFT));
+
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, a->rd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    gen_helper_vid_v(dest, mask, cpu_env, desc);
+    mark_vs_dirty(ctx);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_i32(desc);
+    return true;
+}
+
+/*
+ *** Scalar moves
+ *
+ * These only touch element 0, which is simple enough to do inline.
+ */
+
+static void gen_ld_elem0(DisasContext *ctx, TCGv_i64 dst, int reg, bool sign)
+{
+    uint32_t ofs = vreg_elem0_ofs(ctx, reg);
+
+    switch (ctx->sew) {
+    case MO_8:
+        if (sign) {
+            tcg_gen_ld8s_i64(dst, cpu_env, ofs);
+        } else {
+            tcg_gen_ld8u_i64(dst, cpu_env, ofs);
+        }
+        break;
+    case MO_16:
+        if (sign) {
+            tcg_gen_ld16s_i64(dst, cpu_env, ofs);
+        } else {
+            tcg_gen_ld16u_i64(dst, cpu_env, ofs);
+        }
+        break;
+    case MO_32:
+        if (sign) {
+            tcg_gen_ld32s_i64(dst, cpu_env, ofs);
+        } else {
+            tcg_gen_ld32u_i64(dst, cpu_env, ofs);
+        }
+        break;
+    default:
+        tcg_gen_ld_i64(dst, cpu_env, ofs);
+        break;
+    }
+}
+
+/* Store @val to element 0 of @reg, unless vstart >= vl */
+static void gen_st_elem0(DisasContext *ctx, int reg, TCGv_i64 val)
+{
+    uint32_t ofs = vreg_elem0_ofs(ctx, reg);
+    TCGLabel *over = gen_new_label();
+    TCGv vl = tcg_temp_new();
+    TCGv vstart = tcg_temp_new();
+
+    tcg_gen_ld_tl(vl, cpu_env, offsetof(CPURISCVState, vl));
+    tcg_gen_ld_tl(vstart, cpu_env, offsetof(CPURISCVState, vstart));
+    tcg_gen_brcond_tl(TCG_COND_GEU, vstart, vl, over);
+
+    switch (ctx->sew) {
+    case MO_8:
+        tcg_gen_st8_i64(val, cpu_env, ofs);
+        break;
+    case MO_16:
+        tcg_gen_st16_i64(val, cpu_env, ofs);
+        break;
+    case MO_32:
+        tcg_gen_st32_i64(val, cpu_env, ofs);
+        break;
+    default:
+        tcg_gen_st_i64(val, cpu_env, ofs);
+        break;
+    }
+
+    gen_set_label(over);
+    tcg_gen_movi_tl(vstart, 0);
+    tcg_gen_st_tl(vstart, cpu_env, offsetof(CPURISCVState, vstart));
+    mark_vs_dirty(ctx);
+
+    tcg_temp_free(vl);
+    tcg_temp_free(vstart);
+}
+
+static bool trans_vmv_x_s(DisasContext *ctx, arg_vmv_x_s *a)
+{
+    TCGv_i64 t1;
+    TCGv dst;
+
+    if (!require_vtype(ctx)) {
+        return false;
+    }
+
+    t1 = tcg_temp_new_i64();
+    dst = tcg_temp_new();
+    gen_ld_elem0(ctx, t1, a->rs2, true);
+    tcg_gen_trunc_i64_tl(dst, t1);
+    gen_set_gpr(a->rd, dst);
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free(dst);
+    return true;
+}
+
+static bool trans_vmv_s_x(DisasContext *ctx, arg_vmv_s_x *a)
+{
+    TCGv_i64 t1;
+    TCGv s1;
+
+    if (!require_vtype(ctx)) {
+        return false;
+    }
+
+    t1 = tcg_temp_new_i64();
+    s1 = tcg_temp_new();
+    gen_get_gpr(s1, a->rs1);
+    tcg_gen_ext_tl_i64(t1, s1);
+    gen_st_elem0(ctx, a->rd, t1);
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free(s1);
+    return true;
+}
+
+static bool trans_vfmv_f_s(DisasContext *ctx, arg_vfmv_f_s *a)
+{
+    if (!require_vtype(ctx) || !require_rvf(ctx)) {
+        return false;
+    }
+
+    gen_ld_elem0(ctx, cpu_fpr[a->rd], a->rs2, false);
+    if (ctx->sew == MO_32) {
+        /* RISC-V requires NaN-boxing of narrower width floating point values */
+        tcg_gen_ori_i64(cpu_fpr[a->rd], cpu_fpr[a->rd],
+                        0xffffffff00000000ULL);
+    }
+    mark_fs_dirty(ctx);
+    return true;
+}
+
+static bool trans_vfmv_s_f(DisasContext *ctx, arg_vfmv_s_f *a)
+{
+    if (!require_vtype(ctx) || !require_rvf(ctx)) {
+        return false;
+    }
+
+    gen_st_elem0(ctx, a->rd, cpu_fpr[a->rs1]);
+    return true;
+}
+
+/*
+ *** Floating point
+ *
+ * All of these use the dynamic rounding mode, except for the
+ * conversions that round towards zero.
+ */
+
+static bool opfvv_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return opivv_check(ctx, a) && require_rvf(ctx);
+}
+
+static bool opfvf_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return opivx_check(ctx, a) && require_rvf(ctx);
+}
+
+static bool opfvv_cmp_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return opivv_cmp_check(ctx, a) && require_rvf(ctx);
+}
+
+static bool opfvf_cmp_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return opivx_cmp_check(ctx, a) && require_rvf(ctx);
+}
+
+static bool freduction_check(DisasContext *ctx, arg_rmrr *a)
+{
+    return reduction_check(ctx, a) && require_rvf(ctx);
+}
+
+#define GEN_OPFVV_TRANS(NAME, CHECK)                                    \
+static bool trans_##NAME(DisasContext *ctx, arg_rmrr *a)                \
+{                                                                       \
+    if (!CHECK(ctx, a)) {                                               \
+        return false;                                                   \
+    }                                                                   \
+    gen_set_rm(ctx, 7);                                                 \
+    do_opivv(ctx, a, NULL, gen_helper_##NAME);                          \
+    mark_fs_dirty(ctx);                                                 \
+    return true;                                                        \
+}
+
+static void do_opfvf(DisasContext *ctx, int vd, int vs2, TCGv_i64 s1,
+                     int vm, gen_helper_opfvf *fn)
+{
+    TCGv_ptr dest = tcg_temp_new_ptr();
+    TCGv_ptr mask = tcg_temp_new_ptr();
+    TCGv_ptr src2 = tcg_temp_new_ptr();
+    TCGv_i32 desc = tcg_const_i32(vext_desc(ctx, vm << VDATA_VM_SHIFT));
+
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(ctx, vd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(ctx, 0));
+    tcg_gen_addi_ptr(src2, cpu_env, vreg_ofs(ctx, vs2));
+    fn(dest, mask, s1, src2, cpu_env, desc);
+    mark_vs_dirty(ctx);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_ptr(src2);
+    tcg_temp_free_i32(desc);
+}
+
+#define GEN_OPFVF_TRANS(NAME, CHECK)                                    \
+static bool trans_##NAME(DisasContext *ctx, arg_rmrr *a)                \
+{                                                                       \
+    if (!CHECK(ctx, a)) {                                               \
+        return false;                                                   \
+    }                                                                   \
+    gen_set_rm(ctx, 7);                                                 \
+    do_opfvf(ctx, a->rd, a->rs2, cpu_fpr[a->rs1], a->vm,                \
+             gen_helper_##NAME);                                        \
+    mark_fs_dirty(ctx);                                                 \
+    return true;                                                        \
+}
+
+#define GEN_OPFVV_OPFVF_TRANS(NAME)                                     \
+GEN_OPFVV_TRANS(NAME##_vv, opfvv_check)                                 \
+GEN_OPFVF_TRANS(NAME##_vf, opfvf_check)
+
+GEN_OPFVV_OPFVF_TRANS(vfadd)
+GEN_OPFVV_OPFVF_TRANS(vfsub)
+GEN_OPFVF_TRANS(vfrsub_vf, opfvf_check)
+GEN_OPFVV_OPFVF_TRANS(vfmul)
+GEN_OPFVV_OPFVF_TRANS(vfdiv)
+GEN_OPFVF_TRANS(vfrdiv_vf, opfvf_check)
+GEN_OPFVV_OPFVF_TRANS(vfmin)
+GEN_OPFVV_OPFVF_TRANS(vfmax)
+GEN_OPFVV_OPFVF_TRANS(vfsgnj)
+GEN_OPFVV_OPFVF_TRANS(vfsgnjn)
+GEN_OPFVV_OPFVF_TRANS(vfsgnjx)
+GEN_OPFVV_OPFVF_TRANS(vfmacc)
+GEN_OPFVV_OPFVF_TRANS(vfnmacc)
+GEN_OPFVV_OPFVF_TRANS(vfmsac)
+GEN_OPFVV_OPFVF_TRANS(vfnmsac)
+GEN_OPFVV_OPFVF_TRANS(vfmadd)
+GEN_OPFVV_OPFVF_TRANS(vfnmadd)
+GEN_OPFVV_OPFVF_TRANS(vfmsub)
+GEN_OPFVV_OPFVF_TRANS(vfnmsub)
+
+GEN_OPFVV_TRANS(vmfeq_vv, opfvv_cmp_check)
+GEN_OPFVF_TRANS(vmfeq_vf, opfvf_cmp_check)
+GEN_OPFVV_TRANS(vmfne_vv, opfvv_cmp_check)
+GEN_OPFVF_TRANS(vmfne_vf, opfvf_cmp_check)
+GEN_OPFVV_TRANS(vmflt_vv, opfvv_cmp_check)
+GEN_OPFVF_TRANS(vmflt_vf, opfvf_cmp_check)
+GEN_OPFVV_TRANS(vmfle_vv, opfvv_cmp_check)
+GEN_OPFVF_TRANS(vmfle_vf, opfvf_cmp_check)
+GEN_OPFVF_TRANS(vmfgt_vf, opfvf_cmp_check)
+GEN_OPFVF_TRANS(vmfge_vf, opfvf_cmp_check)
+
+GEN_OPFVV_TRANS(vfredusum_vs, freduction_check)
+GEN_OPFVV_TRANS(vfredosum_vs, freduction_check)
+GEN_OPFVV_TRANS(vfredmin_vs, freduction_check)
+GEN_OPFVV_TRANS(vfredmax_vs, freduction_check)
+
+GEN_OPFVF_TRANS(vfmerge_vfm, opfvf_check)
+
+static bool trans_vfmv_v_f(DisasContext *ctx, arg_vfmv_v_f *a)
+{
+    if (!require_vtype(ctx) || !require_rvf(ctx) ||
+        !require_align(a->rd, ctx->lmul)) {
+        return false;
+    }
+    if (vext_use_gvec(ctx, 1)) {
+        uint32_t sz = vext_group_size(ctx);
+
+        tcg_gen_gvec_dup_i64(ctx->sew, vreg_ofs(ctx, a->rd), sz, sz,
+                             cpu_fpr[a->rs1]);
+        mark_vs_dirty(ctx);
+    } else {
+        do_opfvf(ctx, a->rd, a->rd, cpu_fpr[a->rs1], 1,
+                 gen_helper_vfmerge_vfm);
+    }
+    return true;
+}
+
+static bool opfv_check(DisasContext *ctx, arg_rmr *a)
+{
+    return require_vtype(ctx) && require_rvf(ctx) &&
+           require_vm(a->vm, a->rd) && require_align(a->rd, ctx->lmul) &&
+           require_align(a->rs2, ctx->lmul);
+}
+
+#define GEN_OPFV_TRANS(NAME, DYN_RM)                                    \
+static bool trans_##NAME(DisasContext *ctx, arg_rmr *a)                 \
+{                                                                       \
+    if (!opfv_check(ctx, a)) {                                          \
+        return false;                                                   \
+    }                                                                   \
+    if (DYN_RM) {                                                       \
+        gen_set_rm(ctx, 7);                                             \
+    }                                                                   \
+    tcg_gen_gvec_3_ptr(vreg_ofs(ctx, a->rd), vreg_ofs(ctx, 0),          \
+                       vreg_ofs(ctx, a->rs2), cpu_env,                  \
+                       ctx->vlenb, ctx->vlenb,                          \
+                       a->vm << VDATA_VM_SHIFT, gen_helper_##NAME);     \
+    mark_vs_dirty(ctx);                                                 \
+    mark_fs_dirty(ctx);                                                 \
+    return true;                                                        \
+}
+
+GEN_OPFV_TRANS(vfsqrt_v, true)
+GEN_OPFV_TRANS(vfcvt_xu_f_v, true)
+GEN_OPFV_TRANS(vfcvt_x_f_v, true)
+GEN_OPFV_TRANS(vfcvt_f_xu_v, true)
+GEN_OPFV_TRANS(vfcvt_f_x_v, true)
+/* These helpers round towards zero whatever frm says */
+GEN_OPFV_TRANS(vfcvt_rtz_xu_f_v, false)
+GEN_OPFV_TRANS(vfcvt_rtz_x_f_v, false)
@@ -0,0 +1,31 @@
+/*
+ * QEMU RISC-V CPU -- internal functions and types
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RISCV_CPU_INTERNALS_H
+#define RISCV_CPU_INTERNALS_H
+
+/*
+ * The simd_data() of the descriptor passed to the vector helpers:
+ * the vm bit of the instruction, the number of fields minus one of a
+ * segment access and the log2 of the memory element size.
+ */
+#define VDATA_VM_SHIFT      0
+#define VDATA_NF_SHIFT      1
+#define VDATA_NF_LENGTH     3
+#define VDATA_ESZ_SHIFT     4
+#define VDATA_ESZ_LENGTH    2
+
+#endif
@@ -151,6 +151,7 @@ void helper_tlb_flush(CPURISCVState *env)
         riscv_raise_exception(env, RISCV_EXCP_ILLEGAL_INST, GETPC());
     } else {
         tlb_flush(cs);
+        riscv_cpu_flush_pwc(env);
     }
 }
 
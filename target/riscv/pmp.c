@@ -42,6 +42,8 @@ static void pmp_write_cfg(CPURISCVState *env, uint32_t addr_index,
     uint8_t val);
 static uint8_t pmp_read_cfg(CPURISCVState *env, uint32_t addr_index);
 static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index);
+static int pmp_is_in_range(CPURISCVState *env, int pmp_index,
+    target_ulong addr);
 
 /*
  * Accessor method to extract address matching type 'a field' from cfg reg
@@ -146,6 +148,84 @@ static void pmp_decode_napot(target_ulong a, target_ulong *sa, target_ulong *ea)
 }
 
 
+static int pmp_cmp_ulong(const void *a, const void *b)
+{
+    target_ulong x = *(const target_ulong *)a;
+    target_ulong y = *(const target_ulong *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Split the address space at the start and one past the end of every
+ * entry, so that each entry either covers a region entirely or not at
+ * all, and record which active rule has priority in each region.
+ * Entries that are off still split regions: pmp_hart_has_privs() rejects
+ * accesses that straddle them, and leaves those to the full scan.
+ */
+static void pmp_compile_regions(CPURISCVState *env)
+{
+    pmp_regions_t *r = &env->pmp_state.regions;
+    target_ulong bound[MAX_RISCV_PMP_REGIONS];
+    int n = 0;
+    int i, j;
+
+    bound[n++] = 0;
+    for (i = 0; i < MAX_RISCV_PMPS; i++) {
+        target_ulong sa = env->pmp_state.addr[i].sa;
+        target_ulong ea = env->pmp_state.addr[i].ea;
+
+        if (sa > ea) {
+            continue;
+        }
+        bound[n++] = sa;
+        if (ea != (target_ulong)-1) {
+            bound[n++] = ea + 1;
+        }
+    }
+    qsort(bound, n, sizeof(bound[0]), pmp_cmp_ulong);
+
+    r->num = 0;
+    for (i = 0; i < n; i++) {
+        int rule = -1;
+
+        if (i > 0 && bound[i] == bound[i - 1]) {
+            continue;
+        }
+        for (j = 0; j < MAX_RISCV_PMPS; j++) {
+            if (pmp_get_a_field(env->pmp_state.pmp[j].cfg_reg) !=
+                PMP_AMATCH_OFF && pmp_is_in_range(env, j, bound[i])) {
+                rule = j;
+                break;
+            }
+        }
+        r->sa[r->num] = bound[i];
+        r->rule[r->num] = rule;
+        r->num++;
+    }
+}
+
+/*
+ * Return the index of the region containing addr.
+ */
+static int pmp_find_region(CPURISCVState *env, target_ulong addr)
+{
+    const pmp_regions_t *r = &env->pmp_state.regions;
+    int lo = 0, hi = r->num - 1;
+
+    /* r->sa[0] is 0, so the region always exists */
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+
+        if (r->sa[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
 /* Convert cfg/addr reg values here into simple 'sa' --> start address and 'ea'
  *   end address values.
  *   This function is called relatively infrequently whereas the check that
@@ -203,6 +283,11 @@ static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index)
             env->pmp_state.num_rules++;
         }
     }
+
+    pmp_compile_regions(env);
+
+    /* Cached non-leaf PTEs skip the PMP check of the page table walk */
+    riscv_cpu_flush_pwc(env);
 }
 
 static int pmp_is_in_range(CPURISCVState *env, int pmp_index, target_ulong addr)
@@ -241,6 +326,28 @@ bool pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
         return true;
     }
 
+    /*
+     * Fast path: if the access lies within one region, at most one rule
+     * can be the first to match it and none can match it partially.
+     */
+    if (addr + size - 1 >= addr) {
+        const pmp_regions_t *r = &env->pmp_state.regions;
+        int k = pmp_find_region(env, addr);
+
+        if (k + 1 == r->num || addr + size - 1 < r->sa[k + 1]) {
+            i = r->rule[k];
+            if (i < 0) {
+                /* No rule matched, see below */
+                return mode == PRV_M;
+            }
+            allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
+            if ((mode != PRV_M) || pmp_is_locked(env, i)) {
+                allowed_privs &= env->pmp_state.pmp[i].cfg_reg;
+            }
+            return (privs & allowed_privs) == privs;
+        }
+    }
+
     /* 1.10 draft priv spec states there is an implicit order
          from low to high */
     for (i = 0; i < MAX_RISCV_PMPS; i++) {
@@ -46,10 +46,23 @@ typedef struct {
     target_ulong ea;
 } pmp_addr_t;
 
+/*
+ * The address space split at every rule boundary: region i covers
+ * [sa[i], sa[i + 1]) and is matched by rule[i] (-1 if no rule matches).
+ */
+#define MAX_RISCV_PMP_REGIONS (2 * MAX_RISCV_PMPS + 1)
+
+typedef struct {
+    target_ulong sa[MAX_RISCV_PMP_REGIONS];
+    int8_t rule[MAX_RISCV_PMP_REGIONS];
+    uint32_t num;
+} pmp_regions_t;
+
 typedef struct {
     pmp_entry_t pmp[MAX_RISCV_PMPS];
     pmp_addr_t  addr[MAX_RISCV_PMPS];
     uint32_t num_rules;
+    pmp_regions_t regions;
 } pmp_table_t;
 
 void pmpcfg_csr_write(CPURISCVState *env, uint32_t reg_index,
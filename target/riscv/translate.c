@@ -20,6 +20,8 @@
 #include "qemu/log.h"
 #include "cpu.h"
 #include "tcg-op.h"
+#include "tcg-op-gvec.h"
+#include "tcg-gvec-desc.h"
 #include "disas/disas.h"
 #include "exec/cpu_ldst.h"
 #include "exec/exec-all.h"
@@ -30,6 +32,7 @@
 #include "exec/log.h"
 
 #include "instmap.h"
+#include "internals.h"
 
 /* global register indices */
 static TCGv cpu_gpr[32], cpu_pc;
@@ -39,6 +42,9 @@ static TCGv load_val;
 
 #include "exec/gen-icount.h"
 
+/* Taken conditional branches a superblock can leave through */
+#define MAX_SIDE_EXITS 8
+
 typedef struct DisasContext {
     DisasContextBase base;
     /* pc_succ_insn points to the instruction following base.pc_next */
@@ -54,7 +60,24 @@ typedef struct DisasContext {
        to any system register, which includes CSR_FRM, so we do not have
        to reset this known value.  */
     int frm;
+    /* The value of CSR_FRM, which the dynamic rounding mode stands for */
+    int dyn_frm;
     bool ext_ifencei;
+    /* The vector state the TB was translated for, see TB_FLAGS_VILL */
+    uint32_t mstatus_vs;
+    bool vill;
+    uint8_t sew;
+    int8_t lmul;
+    bool vl_eq_vlmax;
+    uint16_t vlenb;
+    /* The TB is a superblock (CF_SUPERBLOCK); see gen_branch().  */
+    bool superblock;
+    int next_jmp_slot;
+    int nb_side_exits;
+    struct {
+        TCGLabel *label;
+        target_ulong dest;
+    } side_exit[MAX_SIDE_EXITS];
 } DisasContext;
 
 #ifdef TARGET_RISCV64
@@ -155,7 +178,14 @@ static inline bool use_goto_tb(DisasContext *ctx, target_ulong dest)
 
 static void gen_goto_tb(DisasContext *ctx, int n, target_ulong dest)
 {
-    if (use_goto_tb(ctx, dest)) {
+    bool chain = use_goto_tb(ctx, dest);
+
+    if (chain && ctx->superblock) {
+        /* a superblock can have more exits than there are jump slots */
+        chain = ctx->next_jmp_slot < 2;
+        n = ctx->next_jmp_slot++;
+    }
+    if (chain) {
         /* chaining is only allowed when the jump is to the same page */
         tcg_gen_goto_tb(n);
         tcg_gen_movi_tl(cpu_pc, dest);
@@ -170,6 +200,19 @@ static void gen_goto_tb(DisasContext *ctx, int n, target_ulong dest)
     }
 }
 
+/*
+ * Whether a superblock can continue translation at @dest instead of
+ * leaving the TB.  Only forward targets on the first page are followed,
+ * so that [tb->pc, tb->pc + tb->size) still covers all the guest code
+ * the TB depends on.
+ */
+static bool superblock_follow(DisasContext *ctx, target_ulong dest)
+{
+    return ctx->superblock && dest >= ctx->pc_succ_insn &&
+           (dest & TARGET_PAGE_MASK) ==
+           (ctx->base.pc_first & TARGET_PAGE_MASK);
+}
+
 /* Wrapper for getting reg values - need to check of reg is zero since
  * cpu_gpr[0] is not actually allocated
  */
@@ -333,6 +376,10 @@ static void gen_jal(DisasContext *ctx, int rd, target_ulong imm)
         tcg_gen_movi_tl(cpu_gpr[rd], ctx->pc_succ_insn);
     }
 
+    if (superblock_follow(ctx, next_pc)) {
+        ctx->pc_succ_insn = next_pc;
+        return;
+    }
     gen_goto_tb(ctx, 0, ctx->base.pc_next + imm); /* must use this for safety */
     ctx->base.is_jmp = DISAS_NORETURN;
 }
@@ -400,8 +447,25 @@ static void mark_fs_dirty(DisasContext *ctx)
     tcg_gen_st_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus));
     tcg_temp_free(tmp);
 }
+
+/* Likewise for mstatus_vs */
+static void mark_vs_dirty(DisasContext *ctx)
+{
+    TCGv tmp;
+    if (ctx->mstatus_vs == MSTATUS_VS) {
+        return;
+    }
+    ctx->mstatus_vs = MSTATUS_VS;
+
+    tmp = tcg_temp_new();
+    tcg_gen_ld_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus));
+    tcg_gen_ori_tl(tmp, tmp, MSTATUS_VS);
+    tcg_gen_st_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus));
+    tcg_temp_free(tmp);
+}
 #else
 static inline void mark_fs_dirty(DisasContext *ctx) { }
+static inline void mark_vs_dirty(DisasContext *ctx) { }
 #endif
 
 #if !defined(TARGET_RISCV64)
@@ -481,16 +545,36 @@ static void gen_fp_store(DisasContext *ctx, uint32_t opc, int rs1,
 }
 #endif
 
+/*
+ * CSR_FRM is part of the TB flags, so the rounding mode is known at
+ * translation time even when the instruction asks for the dynamic one,
+ * and installing it is a plain store rather than a helper call.
+ */
 static void gen_set_rm(DisasContext *ctx, int rm)
 {
+    static const int8_t softrm[] = {
+        float_round_nearest_even,
+        float_round_to_zero,
+        float_round_down,
+        float_round_up,
+        float_round_ties_away,
+    };
     TCGv_i32 t0;
 
+    if (rm == 7) {
+        rm = ctx->dyn_frm;
+    }
     if (ctx->frm == rm) {
         return;
     }
+    if (rm >= ARRAY_SIZE(softrm)) {
+        gen_exception_illegal(ctx);
+        return;
+    }
     ctx->frm = rm;
-    t0 = tcg_const_i32(rm);
-    gen_helper_set_rounding_mode(cpu_env, t0);
+    t0 = tcg_const_i32(softrm[rm]);
+    tcg_gen_st8_i32(t0, cpu_env,
+                    offsetof(CPURISCVState, fp_status.float_rounding_mode));
     tcg_temp_free_i32(t0);
 }
 
@@ -559,6 +643,11 @@ static int ex_rvc_register(DisasContext *ctx, int reg)
     return 8 + reg;
 }
 
+static int ex_plus_1(DisasContext *ctx, int nf)
+{
+    return nf + 1;
+}
+
 static int ex_rvc_shifti(DisasContext *ctx, int imm)
 {
     /* For RV128 a shamt of 0 means a shift by 64. */
@@ -706,6 +795,7 @@ static bool gen_shift(DisasContext *ctx, arg_r *a,
 #include "insn_trans/trans_rva.inc.c"
 #include "insn_trans/trans_rvf.inc.c"
 #include "insn_trans/trans_rvd.inc.c"
+#include "insn_trans/trans_rvv.inc.c"
 #include "insn_trans/trans_privileged.inc.c"
 
 /*
@@ -761,7 +851,19 @@ static void riscv_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     ctx->priv_ver = env->priv_ver;
     ctx->misa = env->misa;
     ctx->frm = -1;  /* unknown rounding mode */
+    ctx->dyn_frm = (ctx->base.tb->flags & TB_FLAGS_FRM_MASK) >>
+                   TB_FLAGS_FRM_SHIFT;
     ctx->ext_ifencei = cpu->cfg.ext_ifencei;
+    ctx->mstatus_vs = ctx->base.tb->flags & TB_FLAGS_MSTATUS_VS;
+    ctx->vill = ctx->base.tb->flags & TB_FLAGS_VILL;
+    ctx->sew = (ctx->base.tb->flags & TB_FLAGS_SEW_MASK) >>
+               TB_FLAGS_SEW_SHIFT;
+    ctx->lmul = sextract32(ctx->base.tb->flags, TB_FLAGS_LMUL_SHIFT, 3);
+    ctx->vl_eq_vlmax = ctx->base.tb->flags & TB_FLAGS_VL_EQ_VLMAX;
+    ctx->vlenb = cpu->cfg.vlen / 8;
+    ctx->superblock = tb_cflags(ctx->base.tb) & CF_SUPERBLOCK;
+    ctx->next_jmp_slot = 0;
+    ctx->nb_side_exits = 0;
 }
 
 static void riscv_tr_tb_start(DisasContextBase *db, CPUState *cpu)
@@ -813,6 +915,7 @@ static void riscv_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
 static void riscv_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
 {
     DisasContext *ctx = container_of(dcbase, DisasContext, base);
+    int i;
 
     switch (ctx->base.is_jmp) {
     case DISAS_TOO_MANY:
@@ -823,6 +926,12 @@ static void riscv_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
     default:
         g_assert_not_reached();
     }
+
+    /* Taken branches out of a superblock, kept out of the hot path */
+    for (i = 0; i < ctx->nb_side_exits; i++) {
+        gen_set_label(ctx->side_exit[i].label);
+        gen_goto_tb(ctx, 0, ctx->side_exit[i].dest);
+    }
 }
 
 static void riscv_tr_disas_log(const DisasContextBase *dcbase, CPUState *cpu)
@@ -0,0 +1,1283 @@
+/*
+ * RISC-V Vector Extension Helpers for QEMU.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/cpu_ldst.h"
+#include "exec/helper-proto.h"
+#include "fpu/softfloat.h"
+#include "tcg/tcg-gvec-desc.h"
+#include "internals.h"
+
+/*
+ * The helpers only get here for what the translator cannot hand to the
+ * generic vector expanders: masked operations, vl < VLMAX, a non-zero
+ * vstart, and everything that is not a plain element-wise integer op.
+ * Inactive and tail elements are left undisturbed, which is a valid
+ * implementation of both the undisturbed and the agnostic policies.
+ */
+
+/*
+ * The vector registers are arrays of host-endian uint64_t, so that the
+ * generic vector expanders can operate on them.  Hx() turns the index
+ * of an x-byte element into its index in memory.
+ */
+#ifdef HOST_WORDS_BIGENDIAN
+#define H1(x)   ((x) ^ 7)
+#define H2(x)   ((x) ^ 3)
+#define H4(x)   ((x) ^ 1)
+#else
+#define H1(x)   (x)
+#define H2(x)   (x)
+#define H4(x)   (x)
+#endif
+#define H8(x)   (x)
+
+target_ulong HELPER(vsetvl)(CPURISCVState *env, target_ulong s1,
+                            target_ulong s2)
+{
+    int sew = get_field(s2, VTYPE_VSEW);
+    int lmul = sextract32(get_field(s2, VTYPE_VLMUL), 0, 3);
+    target_ulong reserved = s2 & ~(target_ulong)(VTYPE_VLMUL | VTYPE_VSEW |
+                                                 VTYPE_VTA | VTYPE_VMA);
+
+    /*
+     * ELEN is 64, and fractional LMUL needs SEW <= LMUL * ELEN;
+     * vlmul 4 is reserved.
+     */
+    if (reserved || sew > 3 || lmul == -4 || sew > 3 + lmul) {
+        env->vtype = VTYPE_VILL;
+        env->vl = 0;
+    } else {
+        env->vtype = s2;
+        env->vl = MIN(s1, riscv_cpu_vlmax(env_archcpu(env), s2));
+    }
+    env->vstart = 0;
+    return env->vl;
+}
+
+static inline uint32_t vext_vm(uint32_t desc)
+{
+    return extract32(simd_data(desc), VDATA_VM_SHIFT, 1);
+}
+
+static inline uint32_t vext_nf(uint32_t desc)
+{
+    return extract32(simd_data(desc), VDATA_NF_SHIFT, VDATA_NF_LENGTH) + 1;
+}
+
+static inline int vext_esz(uint32_t desc)
+{
+    return extract32(simd_data(desc), VDATA_ESZ_SHIFT, VDATA_ESZ_LENGTH);
+}
+
+/* log2 of SEW in bytes */
+static inline int vext_sew(CPURISCVState *env)
+{
+    return get_field(env->vtype, VTYPE_VSEW);
+}
+
+static inline uint32_t vext_vlmax(CPURISCVState *env)
+{
+    return riscv_cpu_vlmax(env_archcpu(env), env->vtype);
+}
+
+static inline bool vext_elem_mask(void *v0, uint32_t i)
+{
+    return (((uint64_t *)v0)[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void vext_set_elem_mask(void *vd, uint32_t i, bool val)
+{
+    uint64_t *p = (uint64_t *)vd + i / 64;
+
+    *p = deposit64(*p, i % 64, 1, val);
+}
+
+/* The bits of 64-bit mask word @w that fall in [@start, @end) */
+static inline uint64_t vext_word_mask(uint32_t w, uint32_t start,
+                                      uint32_t end)
+{
+    uint32_t lo = MAX(start, w * 64);
+    uint32_t hi = MIN(end, w * 64 + 64);
+
+    return lo < hi ? MAKE_64BIT_MASK(lo - w * 64, hi - lo) : 0;
+}
+
+/* Element @i of a group of (1 << @esz)-byte elements, zero-extended */
+static uint64_t vext_elem(void *vreg, int esz, uint32_t i)
+{
+    switch (esz) {
+    case 0:
+        return *((uint8_t *)vreg + H1(i));
+    case 1:
+        return *((uint16_t *)vreg + H2(i));
+    case 2:
+        return *((uint32_t *)vreg + H4(i));
+    default:
+        return *((uint64_t *)vreg + H8(i));
+    }
+}
+
+static void vext_set_elem(void *vreg, int esz, uint32_t i, uint64_t val)
+{
+    switch (esz) {
+    case 0:
+        *((uint8_t *)vreg + H1(i)) = val;
+        break;
+    case 1:
+        *((uint16_t *)vreg + H2(i)) = val;
+        break;
+    case 2:
+        *((uint32_t *)vreg + H4(i)) = val;
+        break;
+    default:
+        *((uint64_t *)vreg + H8(i)) = val;
+        break;
+    }
+}
+
+/*
+ * Loads and stores.
+ *
+ * Elements are accessed in order and vstart is kept up to date, so
+ * that a fault leaves it at the faulting element and the access
+ * resumes from there once the trap handler returns.
+ */
+
+static uint64_t vext_ld_elem(CPURISCVState *env, target_ulong addr, int esz,
+                             uintptr_t ra)
+{
+    switch (esz) {
+    case 0:
+        return cpu_ldub_data_ra(env, addr, ra);
+    case 1:
+        return cpu_lduw_data_ra(env, addr, ra);
+    case 2:
+        return cpu_ldl_data_ra(env, addr, ra);
+    default:
+        return cpu_ldq_data_ra(env, addr, ra);
+    }
+}
+
+static void vext_st_elem(CPURISCVState *env, target_ulong addr, int esz,
+                         uint64_t val, uintptr_t ra)
+{
+    switch (esz) {
+    case 0:
+        cpu_stb_data_ra(env, addr, val, ra);
+        break;
+    case 1:
+        cpu_stw_data_ra(env, addr, val, ra);
+        break;
+    case 2:
+        cpu_stl_data_ra(env, addr, val, ra);
+        break;
+    default:
+        cpu_stq_data_ra(env, addr, val, ra);
+        break;
+    }
+}
+
+/*
+ * Unmasked unit-stride accesses that stay within one page of RAM are
+ * copied straight from or to the host page.  This fails if the page is
+ * not in the TLB, is not RAM or is watched, and the caller then falls
+ * back to one softmmu access per element, which also takes any fault.
+ */
+static bool vext_ldst_us_host(CPURISCVState *env, void *vd,
+                              target_ulong base, int esz, uint32_t start,
+                              uint32_t evl, bool is_load, uintptr_t ra)
+{
+    target_ulong addr = base + ((target_ulong)start << esz);
+    target_ulong len = (target_ulong)(evl - start) << esz;
+    uint8_t *host;
+    uint32_t i;
+
+    if (start >= evl || ((addr ^ (addr + len - 1)) & TARGET_PAGE_MASK)) {
+        return false;
+    }
+    host = tlb_vaddr_to_host(env, addr,
+                             is_load ? MMU_DATA_LOAD : MMU_DATA_STORE,
+                             cpu_mmu_index(env, false));
+#ifdef CONFIG_USER_ONLY
+    set_helper_retaddr(ra);
+#else
+    if (!host) {
+        return false;
+    }
+#endif
+    for (i = start; i < evl; i++, host += 1 << esz) {
+        if (is_load) {
+            uint64_t val;
+
+            switch (esz) {
+            case 0:
+                val = ldub_p(host);
+                break;
+            case 1:
+                val = lduw_le_p(host);
+                break;
+            case 2:
+                val = ldl_le_p(host);
+                break;
+            default:
+                val = ldq_le_p(host);
+                break;
+            }
+            vext_set_elem(vd, esz, i, val);
+        } else {
+            uint64_t val = vext_elem(vd, esz, i);
+
+            switch (esz) {
+            case 0:
+                stb_p(host, val);
+                break;
+            case 1:
+                stw_le_p(host, val);
+                break;
+            case 2:
+                stl_le_p(host, val);
+                break;
+            default:
+                stq_le_p(host, val);
+                break;
+            }
+        }
+    }
+#ifdef CONFIG_USER_ONLY
+    clear_helper_retaddr();
+#endif
+    return true;
+}
+
+/*
+ * The number of elements between the fields of a segment, that is the
+ * size of a register group of EMUL = EEW / SEW * LMUL registers.
+ */
+static uint32_t vext_field_elems(CPURISCVState *env, uint32_t desc, int esz)
+{
+    int lmul = sextract32(get_field(env->vtype, VTYPE_VLMUL), 0, 3);
+    int emul = MAX(esz - vext_sew(env) + lmul, 0);
+
+    return (simd_maxsz(desc) << emul) >> esz;
+}
+
+/*
+ * Field k of element i of a strided segment access is at
+ * base + i * stride + k * EEW; unit-stride is stride = nf * EEW.
+ */
+static void vext_ldst_stride(void *vd, void *v0, target_ulong base,
+                             target_ulong stride, CPURISCVState *env,
+                             uint32_t vm, uint32_t nf, int esz,
+                             uint32_t field, uint32_t evl, bool is_load,
+                             uintptr_t ra)
+{
+    uint32_t i, k;
+
+    if (vm && nf == 1 && stride == 1 << esz &&
+        vext_ldst_us_host(env, vd, base, esz, env->vstart, evl,
+                          is_load, ra)) {
+        env->vstart = 0;
+        return;
+    }
+
+    for (i = env->vstart; i < evl; env->vstart = ++i) {
+        if (!vm && !vext_elem_mask(v0, i)) {
+            continue;
+        }
+        for (k = 0; k < nf; k++) {
+            target_ulong addr = base + stride * i + (k << esz);
+
+            if (is_load) {
+                vext_set_elem(vd, esz, i + k * field,
+                              vext_ld_elem(env, addr, esz, ra));
+            } else {
+                vext_st_elem(env, addr, esz,
+                             vext_elem(vd, esz, i + k * field), ra);
+            }
+        }
+    }
+    env->vstart = 0;
+}
+
+static void vext_ldst_seg(void *vd, void *v0, target_ulong base,
+                          target_ulong stride, CPURISCVState *env,
+                          uint32_t desc, bool is_load, uintptr_t ra)
+{
+    int esz = vext_esz(desc);
+
+    vext_ldst_stride(vd, v0, base, stride, env, vext_vm(desc),
+                     vext_nf(desc), esz, vext_field_elems(env, desc, esz),
+                     env->vl, is_load, ra);
+}
+
+void HELPER(vle_v)(void *vd, void *v0, target_ulong base,
+                   CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_seg(vd, v0, base, vext_nf(desc) << vext_esz(desc), env,
+                  desc, true, GETPC());
+}
+
+void HELPER(vse_v)(void *vd, void *v0, target_ulong base,
+                   CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_seg(vd, v0, base, vext_nf(desc) << vext_esz(desc), env,
+                  desc, false, GETPC());
+}
+
+void HELPER(vlse_v)(void *vd, void *v0, target_ulong base,
+                    target_ulong stride, CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_seg(vd, v0, base, stride, env, desc, true, GETPC());
+}
+
+void HELPER(vsse_v)(void *vd, void *v0, target_ulong base,
+                    target_ulong stride, CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_seg(vd, v0, base, stride, env, desc, false, GETPC());
+}
+
+/* The mask accesses move ceil(vl / 8) bytes */
+void HELPER(vlm_v)(void *vd, target_ulong base, CPURISCVState *env,
+                   uint32_t desc)
+{
+    vext_ldst_stride(vd, NULL, base, 1, env, 1, 1, 0, 0,
+                     DIV_ROUND_UP(env->vl, 8), true, GETPC());
+}
+
+void HELPER(vsm_v)(void *vd, target_ulong base, CPURISCVState *env,
+                   uint32_t desc)
+{
+    vext_ldst_stride(vd, NULL, base, 1, env, 1, 1, 0, 0,
+                     DIV_ROUND_UP(env->vl, 8), false, GETPC());
+}
+
+/*
+ * The whole register accesses ignore vl and vtype, and move nf
+ * registers as one unit-stride group.
+ */
+void HELPER(vlre_v)(void *vd, target_ulong base, CPURISCVState *env,
+                    uint32_t desc)
+{
+    int esz = vext_esz(desc);
+
+    vext_ldst_stride(vd, NULL, base, 1 << esz, env, 1, 1, esz, 0,
+                     (vext_nf(desc) * simd_maxsz(desc)) >> esz, true,
+                     GETPC());
+}
+
+void HELPER(vsr_v)(void *vd, target_ulong base, CPURISCVState *env,
+                   uint32_t desc)
+{
+    vext_ldst_stride(vd, NULL, base, 1, env, 1, 1, 0, 0,
+                     vext_nf(desc) * simd_maxsz(desc), false, GETPC());
+}
+
+/*
+ * Indexed accesses: the memory element size esz is SEW, the offsets
+ * are unsigned elements of vs2 whose size comes with the instruction.
+ * Ordered and unordered accesses are both done in element order.
+ */
+static void vext_ldst_index(void *vd, void *v0, target_ulong base,
+                            void *vs2, CPURISCVState *env, uint32_t desc,
+                            bool is_load, uintptr_t ra)
+{
+    uint32_t vm = vext_vm(desc);
+    uint32_t nf = vext_nf(desc);
+    int isz = vext_esz(desc);
+    int esz = vext_sew(env);
+    /* the data has EEW = SEW, so its EMUL is LMUL */
+    uint32_t field = vext_field_elems(env, desc, esz);
+    uint32_t i, k;
+
+    for (i = env->vstart; i < env->vl; env->vstart = ++i) {
+        target_ulong offset;
+
+        if (!vm && !vext_elem_mask(v0, i)) {
+            continue;
+        }
+        offset = vext_elem(vs2, isz, i);
+        for (k = 0; k < nf; k++) {
+            target_ulong addr = base + offset + (k << esz);
+
+            if (is_load) {
+                vext_set_elem(vd, esz, i + k * field,
+                              vext_ld_elem(env, addr, esz, ra));
+            } else {
+                vext_st_elem(env, addr, esz,
+                             vext_elem(vd, esz, i + k * field), ra);
+            }
+        }
+    }
+    env->vstart = 0;
+}
+
+void HELPER(vlxei_v)(void *vd, void *v0, target_ulong base, void *vs2,
+                     CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_index(vd, v0, base, vs2, env, desc, true, GETPC());
+}
+
+void HELPER(vsxei_v)(void *vd, void *v0, target_ulong base, void *vs2,
+                     CPURISCVState *env, uint32_t desc)
+{
+    vext_ldst_index(vd, v0, base, vs2, env, desc, false, GETPC());
+}
+
+/*
+ * Integer arithmetic.
+ *
+ * Each helper dispatches on SEW to a loop specialized for the element
+ * type.  The OP macros get the vs2 element first, then the vs1 element
+ * or the scalar, and for the multiply-add forms the vd element.
+ */
+
+typedef void vext_vv_fn(void *vd, void *v0, void *vs1, void *vs2,
+                        uint32_t vm, uint32_t vstart, uint32_t vl);
+typedef void vext_vx_fn(void *vd, void *v0, uint64_t s1, void *vs2,
+                        uint32_t vm, uint32_t vstart, uint32_t vl);
+
+#define DO_OPIVV(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            *((TYPE *)vd + H(i)) = OP(s2, s1);                          \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPIVX(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            *((TYPE *)vd + H(i)) = OP(s2, s1);                          \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPIVV3(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            TYPE d = *((TYPE *)vd + H(i));                              \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, d);                       \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPIVX3(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            TYPE d = *((TYPE *)vd + H(i));                              \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, d);                       \
+        }                                                               \
+    }                                                                   \
+}
+
+/* Comparisons write one bit of the mask register vd per element */
+#define DO_CMPVV(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            vext_set_elem_mask(vd, i, OP(s2, s1));                      \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_CMPVX(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            vext_set_elem_mask(vd, i, OP(s2, s1));                      \
+        }                                                               \
+    }                                                                   \
+}
+
+/* vd[0] = OP(... OP(OP(vs1[0], vs2[0]), vs2[1]) ..., vs2[vl - 1]) */
+#define DO_REDVV(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    TYPE s1 = *((TYPE *)vs1 + H(0));                                    \
+    uint32_t i;                                                         \
+                                                                        \
+    if (vl == 0) {                                                      \
+        return;                                                         \
+    }                                                                   \
+    for (i = 0; i < vl; i++) {                                          \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            s1 = OP(s1, *((TYPE *)vs2 + H(i)));                         \
+        }                                                               \
+    }                                                                   \
+    *((TYPE *)vd + H(0)) = s1;                                          \
+}
+
+/* vd[i] = v0.mask[i] ? vs1[i] : vs2[i], vd[i] = vs1[i] for vmv.v.v */
+#define DO_MERGEVV(NAME, TYPE, H, OP)                                   \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        void *src = vm || vext_elem_mask(v0, i) ? vs1 : vs2;            \
+        *((TYPE *)vd + H(i)) = *((TYPE *)src + H(i));                   \
+    }                                                                   \
+}
+
+#define DO_MERGEVX(NAME, TYPE, H, OP)                                   \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl)             \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        *((TYPE *)vd + H(i)) = vm || vext_elem_mask(v0, i) ?            \
+                               (TYPE)x : *((TYPE *)vs2 + H(i));         \
+    }                                                                   \
+}
+
+#define GEN_VEXT_VV(NAME, DO, OP, T8, T16, T32, T64)                    \
+DO(do_##NAME##_b, T8, H1, OP)                                           \
+DO(do_##NAME##_h, T16, H2, OP)                                          \
+DO(do_##NAME##_w, T32, H4, OP)                                          \
+DO(do_##NAME##_d, T64, H8, OP)                                          \
+void HELPER(NAME)(void *vd, void *v0, void *vs1, void *vs2,             \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    static vext_vv_fn * const fns[4] = {                                \
+        do_##NAME##_b, do_##NAME##_h, do_##NAME##_w, do_##NAME##_d,     \
+    };                                                                  \
+                                                                        \
+    fns[vext_sew(env)](vd, v0, vs1, vs2, vext_vm(desc),                 \
+                       env->vstart, env->vl);                           \
+    env->vstart = 0;                                                    \
+}
+
+/* The scalar is sign-extended from XLEN, then truncated to SEW */
+#define GEN_VEXT_VX(NAME, DO, OP, T8, T16, T32, T64)                    \
+DO(do_##NAME##_b, T8, H1, OP)                                           \
+DO(do_##NAME##_h, T16, H2, OP)                                          \
+DO(do_##NAME##_w, T32, H4, OP)                                          \
+DO(do_##NAME##_d, T64, H8, OP)                                          \
+void HELPER(NAME)(void *vd, void *v0, target_ulong s1, void *vs2,       \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    static vext_vx_fn * const fns[4] = {                                \
+        do_##NAME##_b, do_##NAME##_h, do_##NAME##_w, do_##NAME##_d,     \
+    };                                                                  \
+                                                                        \
+    fns[vext_sew(env)](vd, v0, (target_long)s1, vs2, vext_vm(desc),     \
+                       env->vstart, env->vl);                           \
+    env->vstart = 0;                                                    \
+}
+
+#define GEN_VEXT_VV_U(NAME, DO, OP) \
+    GEN_VEXT_VV(NAME, DO, OP, uint8_t, uint16_t, uint32_t, uint64_t)
+#define GEN_VEXT_VV_S(NAME, DO, OP) \
+    GEN_VEXT_VV(NAME, DO, OP, int8_t, int16_t, int32_t, int64_t)
+#define GEN_VEXT_VX_U(NAME, DO, OP) \
+    GEN_VEXT_VX(NAME, DO, OP, uint8_t, uint16_t, uint32_t, uint64_t)
+#define GEN_VEXT_VX_S(NAME, DO, OP) \
+    GEN_VEXT_VX(NAME, DO, OP, int8_t, int16_t, int32_t, int64_t)
+
+#define GEN_VEXT_VV_VX_U(NAME, DOVV, DOVX, OP)   \
+    GEN_VEXT_VV_U(NAME##_vv, DOVV, OP)          \
+    GEN_VEXT_VX_U(NAME##_vx, DOVX, OP)
+#define GEN_VEXT_VV_VX_S(NAME, DOVV, DOVX, OP)   \
+    GEN_VEXT_VV_S(NAME##_vv, DOVV, OP)          \
+    GEN_VEXT_VX_S(NAME##_vx, DOVX, OP)
+
+#define DO_ADD(N, M)    ((N) + (M))
+#define DO_SUB(N, M)    ((N) - (M))
+#define DO_RSUB(N, M)   ((M) - (N))
+#define DO_MIN(N, M)    ((N) < (M) ? (N) : (M))
+#define DO_MAX(N, M)    ((N) > (M) ? (N) : (M))
+#define DO_AND(N, M)    ((N) & (M))
+#define DO_OR(N, M)     ((N) | (M))
+#define DO_XOR(N, M)    ((N) ^ (M))
+#define DO_SLL(N, M)    ((N) << ((M) & (sizeof(N) * 8 - 1)))
+#define DO_SRL(N, M)    ((N) >> ((M) & (sizeof(N) * 8 - 1)))
+#define DO_MUL(N, M)    ((N) * (M))
+#define DO_MULH(N, M)   do_mulh(N, M, sizeof(N) * 8)
+#define DO_MULHU(N, M)  do_mulhu(N, M, sizeof(N) * 8)
+#define DO_MULHSU(N, M) \
+    do_mulhsu(N, (M) & MAKE_64BIT_MASK(0, sizeof(M) * 8), sizeof(N) * 8)
+
+/* Division by zero and overflow give the results of the scalar ops */
+#define DO_DIVU(N, M)   (unlikely((M) == 0) ? (__typeof(N))-1 : (N) / (M))
+#define DO_REMU(N, M)   (unlikely((M) == 0) ? (N) : (N) % (M))
+#define DO_DIV(N, M)                                                    \
+    (unlikely((M) == 0) ? (__typeof(N))-1 :                             \
+     unlikely((M) == -1) ? (__typeof(N))(0 - (uint64_t)(N)) : (N) / (M))
+#define DO_REM(N, M)                                                    \
+    (unlikely((M) == 0) ? (N) : unlikely((M) == -1) ? 0 : (N) % (M))
+
+#define DO_MACC(N, M, D)    ((M) * (N) + (D))
+#define DO_NMSAC(N, M, D)   (-((M) * (N)) + (D))
+#define DO_MADD(N, M, D)    ((M) * (D) + (N))
+#define DO_NMSUB(N, M, D)   (-((M) * (D)) + (N))
+
+#define DO_EQ(N, M)     ((N) == (M))
+#define DO_NE(N, M)     ((N) != (M))
+#define DO_LT(N, M)     ((N) < (M))
+#define DO_LE(N, M)     ((N) <= (M))
+#define DO_GT(N, M)     ((N) > (M))
+
+static inline int64_t do_mulh(int64_t n, int64_t m, int bits)
+{
+    uint64_t lo, hi;
+
+    if (bits < 64) {
+        return (n * m) >> bits;
+    }
+    muls64(&lo, &hi, n, m);
+    return hi;
+}
+
+static inline uint64_t do_mulhu(uint64_t n, uint64_t m, int bits)
+{
+    uint64_t lo, hi;
+
+    if (bits < 64) {
+        return (n * m) >> bits;
+    }
+    mulu64(&lo, &hi, n, m);
+    return hi;
+}
+
+static inline int64_t do_mulhsu(int64_t n, uint64_t m, int bits)
+{
+    uint64_t lo, hi;
+
+    if (bits < 64) {
+        return (n * (int64_t)m) >> bits;
+    }
+    mulu64(&lo, &hi, n, m);
+    /* fix up for a negative n, as gen_mulhsu() does */
+    return hi - (n < 0 ? m : 0);
+}
+
+GEN_VEXT_VV_VX_U(vadd, DO_OPIVV, DO_OPIVX, DO_ADD)
+GEN_VEXT_VV_VX_U(vsub, DO_OPIVV, DO_OPIVX, DO_SUB)
+GEN_VEXT_VX_U(vrsub_vx, DO_OPIVX, DO_RSUB)
+GEN_VEXT_VV_VX_U(vminu, DO_OPIVV, DO_OPIVX, DO_MIN)
+GEN_VEXT_VV_VX_S(vmin, DO_OPIVV, DO_OPIVX, DO_MIN)
+GEN_VEXT_VV_VX_U(vmaxu, DO_OPIVV, DO_OPIVX, DO_MAX)
+GEN_VEXT_VV_VX_S(vmax, DO_OPIVV, DO_OPIVX, DO_MAX)
+GEN_VEXT_VV_VX_U(vand, DO_OPIVV, DO_OPIVX, DO_AND)
+GEN_VEXT_VV_VX_U(vor, DO_OPIVV, DO_OPIVX, DO_OR)
+GEN_VEXT_VV_VX_U(vxor, DO_OPIVV, DO_OPIVX, DO_XOR)
+GEN_VEXT_VV_VX_U(vsll, DO_OPIVV, DO_OPIVX, DO_SLL)
+GEN_VEXT_VV_VX_U(vsrl, DO_OPIVV, DO_OPIVX, DO_SRL)
+/* vsra shifts a signed element by the unsigned low bits of the amount */
+GEN_VEXT_VV_VX_S(vsra, DO_OPIVV, DO_OPIVX, DO_SRL)
+GEN_VEXT_VV_VX_U(vmul, DO_OPIVV, DO_OPIVX, DO_MUL)
+GEN_VEXT_VV_VX_S(vmulh, DO_OPIVV, DO_OPIVX, DO_MULH)
+GEN_VEXT_VV_VX_U(vmulhu, DO_OPIVV, DO_OPIVX, DO_MULHU)
+GEN_VEXT_VV_VX_S(vmulhsu, DO_OPIVV, DO_OPIVX, DO_MULHSU)
+GEN_VEXT_VV_VX_U(vdivu, DO_OPIVV, DO_OPIVX, DO_DIVU)
+GEN_VEXT_VV_VX_S(vdiv, DO_OPIVV, DO_OPIVX, DO_DIV)
+GEN_VEXT_VV_VX_U(vremu, DO_OPIVV, DO_OPIVX, DO_REMU)
+GEN_VEXT_VV_VX_S(vrem, DO_OPIVV, DO_OPIVX, DO_REM)
+GEN_VEXT_VV_VX_U(vmacc, DO_OPIVV3, DO_OPIVX3, DO_MACC)
+GEN_VEXT_VV_VX_U(vnmsac, DO_OPIVV3, DO_OPIVX3, DO_NMSAC)
+GEN_VEXT_VV_VX_U(vmadd, DO_OPIVV3, DO_OPIVX3, DO_MADD)
+GEN_VEXT_VV_VX_U(vnmsub, DO_OPIVV3, DO_OPIVX3, DO_NMSUB)
+GEN_VEXT_VV_VX_U(vmseq, DO_CMPVV, DO_CMPVX, DO_EQ)
+GEN_VEXT_VV_VX_U(vmsne, DO_CMPVV, DO_CMPVX, DO_NE)
+GEN_VEXT_VV_VX_U(vmsltu, DO_CMPVV, DO_CMPVX, DO_LT)
+GEN_VEXT_VV_VX_S(vmslt, DO_CMPVV, DO_CMPVX, DO_LT)
+GEN_VEXT_VV_VX_U(vmsleu, DO_CMPVV, DO_CMPVX, DO_LE)
+GEN_VEXT_VV_VX_S(vmsle, DO_CMPVV, DO_CMPVX, DO_LE)
+GEN_VEXT_VX_U(vmsgtu_vx, DO_CMPVX, DO_GT)
+GEN_VEXT_VX_S(vmsgt_vx, DO_CMPVX, DO_GT)
+GEN_VEXT_VV_U(vmerge_vvm, DO_MERGEVV, NULL)
+GEN_VEXT_VX_U(vmerge_vxm, DO_MERGEVX, NULL)
+
+GEN_VEXT_VV_U(vredsum_vs, DO_REDVV, DO_ADD)
+GEN_VEXT_VV_U(vredand_vs, DO_REDVV, DO_AND)
+GEN_VEXT_VV_U(vredor_vs, DO_REDVV, DO_OR)
+GEN_VEXT_VV_U(vredxor_vs, DO_REDVV, DO_XOR)
+GEN_VEXT_VV_U(vredminu_vs, DO_REDVV, DO_MIN)
+GEN_VEXT_VV_S(vredmin_vs, DO_REDVV, DO_MIN)
+GEN_VEXT_VV_U(vredmaxu_vs, DO_REDVV, DO_MAX)
+GEN_VEXT_VV_S(vredmax_vs, DO_REDVV, DO_MAX)
+
+/*
+ * Mask operations.  Mask registers hold one bit per element, so these
+ * work on 64 elements at a time.
+ */
+
+#define DO_ANDN(N, M)   ((N) & ~(M))
+#define DO_NAND(N, M)   (~((N) & (M)))
+#define DO_ORN(N, M)    ((N) | ~(M))
+#define DO_NOR(N, M)    (~((N) | (M)))
+#define DO_XNOR(N, M)   (~((N) ^ (M)))
+
+#define GEN_VEXT_MASK_VV(NAME, OP)                                      \
+void HELPER(NAME)(void *vd, void *v0, void *vs1, void *vs2,             \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    uint64_t *d = vd, *s1 = vs1, *s2 = vs2;                             \
+    uint32_t w;                                                         \
+                                                                        \
+    for (w = env->vstart / 64; w < DIV_ROUND_UP(env->vl, 64); w++) {    \
+        uint64_t m = vext_word_mask(w, env->vstart, env->vl);           \
+        d[w] = (d[w] & ~m) | (OP(s2[w], s1[w]) & m);                    \
+    }                                                                   \
+    env->vstart = 0;                                                    \
+}
+
+GEN_VEXT_MASK_VV(vmand_mm, DO_AND)
+GEN_VEXT_MASK_VV(vmnand_mm, DO_NAND)
+GEN_VEXT_MASK_VV(vmandn_mm, DO_ANDN)
+GEN_VEXT_MASK_VV(vmxor_mm, DO_XOR)
+GEN_VEXT_MASK_VV(vmor_mm, DO_OR)
+GEN_VEXT_MASK_VV(vmnor_mm, DO_NOR)
+GEN_VEXT_MASK_VV(vmorn_mm, DO_ORN)
+GEN_VEXT_MASK_VV(vmxnor_mm, DO_XNOR)
+
+target_ulong HELPER(vcpop_m)(void *v0, void *vs2, CPURISCVState *env,
+                             uint32_t desc)
+{
+    uint64_t *s2 = vs2, *m0 = v0;
+    target_ulong cnt = 0;
+    uint32_t w;
+
+    for (w = env->vstart / 64; w < DIV_ROUND_UP(env->vl, 64); w++) {
+        uint64_t m = vext_word_mask(w, env->vstart, env->vl);
+
+        if (!vext_vm(desc)) {
+            m &= m0[w];
+        }
+        cnt += ctpop64(s2[w] & m);
+    }
+    env->vstart = 0;
+    return cnt;
+}
+
+target_ulong HELPER(vfirst_m)(void *v0, void *vs2, CPURISCVState *env,
+                              uint32_t desc)
+{
+    uint64_t *s2 = vs2, *m0 = v0;
+    uint32_t w;
+
+    for (w = env->vstart / 64; w < DIV_ROUND_UP(env->vl, 64); w++) {
+        uint64_t m = vext_word_mask(w, env->vstart, env->vl);
+
+        if (!vext_vm(desc)) {
+            m &= m0[w];
+        }
+        if (s2[w] & m) {
+            env->vstart = 0;
+            return w * 64 + ctz64(s2[w] & m);
+        }
+    }
+    env->vstart = 0;
+    return -1;
+}
+
+void HELPER(vid_v)(void *vd, void *v0, CPURISCVState *env, uint32_t desc)
+{
+    uint32_t vm = vext_vm(desc);
+    int esz = vext_sew(env);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (vm || vext_elem_mask(v0, i)) {
+            vext_set_elem(vd, esz, i, i);
+        }
+    }
+    env->vstart = 0;
+}
+
+/*
+ * Slides.  vd cannot overlap vs2 for the up slides, and for the down
+ * slides it is only read at or above the element being written.
+ */
+
+void HELPER(vslideup_vx)(void *vd, void *v0, target_ulong s1, void *vs2,
+                         CPURISCVState *env, uint32_t desc)
+{
+    uint32_t vm = vext_vm(desc);
+    int esz = vext_sew(env);
+    uint32_t i = MAX(env->vstart, MIN(s1, env->vl));
+
+    for (; i < env->vl; i++) {
+        if (vm || vext_elem_mask(v0, i)) {
+            vext_set_elem(vd, esz, i, vext_elem(vs2, esz, i - s1));
+        }
+    }
+    env->vstart = 0;
+}
+
+void HELPER(vslidedown_vx)(void *vd, void *v0, target_ulong s1, void *vs2,
+                           CPURISCVState *env, uint32_t desc)
+{
+    uint32_t vm = vext_vm(desc);
+    int esz = vext_sew(env);
+    uint32_t vlmax = vext_vlmax(env);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (vm || vext_elem_mask(v0, i)) {
+            uint64_t val = 0;
+
+            if (s1 < vlmax - i) {
+                val = vext_elem(vs2, esz, i + s1);
+            }
+            vext_set_elem(vd, esz, i, val);
+        }
+    }
+    env->vstart = 0;
+}
+
+void HELPER(vslide1up_vx)(void *vd, void *v0, target_ulong s1, void *vs2,
+                          CPURISCVState *env, uint32_t desc)
+{
+    uint32_t vm = vext_vm(desc);
+    int esz = vext_sew(env);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (vm || vext_elem_mask(v0, i)) {
+            vext_set_elem(vd, esz, i, i ? vext_elem(vs2, esz, i - 1)
+                                        : (target_long)s1);
+        }
+    }
+    env->vstart = 0;
+}
+
+void HELPER(vslide1down_vx)(void *vd, void *v0, target_ulong s1, void *vs2,
+                            CPURISCVState *env, uint32_t desc)
+{
+    uint32_t vm = vext_vm(desc);
+    int esz = vext_sew(env);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (vm || vext_elem_mask(v0, i)) {
+            vext_set_elem(vd, esz, i, i + 1 < env->vl ?
+                          vext_elem(vs2, esz, i + 1) : (target_long)s1);
+        }
+    }
+    env->vstart = 0;
+}
+
+/*
+ * Floating point.
+ *
+ * SEW is 32 or 64, the translator has checked that.  The scalar of
+ * the .vf forms comes straight from the FP register, of which a
+ * single precision value only uses the low half.
+ */
+
+typedef void vext_fvv_fn(void *vd, void *v0, void *vs1, void *vs2,
+                         uint32_t vm, uint32_t vstart, uint32_t vl,
+                         float_status *s);
+typedef void vext_fvf_fn(void *vd, void *v0, uint64_t s1, void *vs2,
+                         uint32_t vm, uint32_t vstart, uint32_t vl,
+                         float_status *s);
+typedef void vext_fv_fn(void *vd, void *v0, void *vs2,
+                        uint32_t vm, uint32_t vstart, uint32_t vl,
+                        float_status *s);
+
+#define DO_OPFVV(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, s);                       \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPFVF(NAME, TYPE, H, OP)                                     \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, s);                       \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPFVV3(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            TYPE d = *((TYPE *)vd + H(i));                              \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, d, s);                    \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_OPFVF3(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            TYPE d = *((TYPE *)vd + H(i));                              \
+            *((TYPE *)vd + H(i)) = OP(s2, s1, d, s);                    \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_CMPFVV(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s1 = *((TYPE *)vs1 + H(i));                            \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            vext_set_elem_mask(vd, i, OP(s2, s1, s));                   \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_CMPFVF(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    TYPE s1 = x;                                                        \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            TYPE s2 = *((TYPE *)vs2 + H(i));                            \
+            vext_set_elem_mask(vd, i, OP(s2, s1, s));                   \
+        }                                                               \
+    }                                                                   \
+}
+
+#define DO_REDFVV(NAME, TYPE, H, OP)                                    \
+static void NAME(void *vd, void *v0, void *vs1, void *vs2,              \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    TYPE s1 = *((TYPE *)vs1 + H(0));                                    \
+    uint32_t i;                                                         \
+                                                                        \
+    if (vl == 0) {                                                      \
+        return;                                                         \
+    }                                                                   \
+    for (i = 0; i < vl; i++) {                                          \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            s1 = OP(s1, *((TYPE *)vs2 + H(i)), s);                      \
+        }                                                               \
+    }                                                                   \
+    *((TYPE *)vd + H(0)) = s1;                                          \
+}
+
+#define DO_MERGEFVF(NAME, TYPE, H, OP)                                  \
+static void NAME(void *vd, void *v0, uint64_t x, void *vs2,             \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        *((TYPE *)vd + H(i)) = vm || vext_elem_mask(v0, i) ?            \
+                               (TYPE)x : *((TYPE *)vs2 + H(i));         \
+    }                                                                   \
+}
+
+#define DO_OPFV(NAME, TYPE, H, OP)                                      \
+static void NAME(void *vd, void *v0, void *vs2,                         \
+                 uint32_t vm, uint32_t vstart, uint32_t vl,             \
+                 float_status *s)                                       \
+{                                                                       \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = vstart; i < vl; i++) {                                     \
+        if (vm || vext_elem_mask(v0, i)) {                              \
+            *((TYPE *)vd + H(i)) = OP(*((TYPE *)vs2 + H(i)), s);        \
+        }                                                               \
+    }                                                                   \
+}
+
+#define GEN_VEXT_FVV(NAME, DO, OP32, OP64)                              \
+DO(do_##NAME##_w, uint32_t, H4, OP32)                                   \
+DO(do_##NAME##_d, uint64_t, H8, OP64)                                   \
+void HELPER(NAME)(void *vd, void *v0, void *vs1, void *vs2,             \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    vext_fvv_fn *fn = vext_sew(env) == 2 ? do_##NAME##_w : do_##NAME##_d; \
+                                                                        \
+    fn(vd, v0, vs1, vs2, vext_vm(desc), env->vstart, env->vl,           \
+       &env->fp_status);                                                \
+    env->vstart = 0;                                                    \
+}
+
+#define GEN_VEXT_FVF(NAME, DO, OP32, OP64)                              \
+DO(do_##NAME##_w, uint32_t, H4, OP32)                                   \
+DO(do_##NAME##_d, uint64_t, H8, OP64)                                   \
+void HELPER(NAME)(void *vd, void *v0, uint64_t s1, void *vs2,           \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    vext_fvf_fn *fn = vext_sew(env) == 2 ? do_##NAME##_w : do_##NAME##_d; \
+                                                                        \
+    fn(vd, v0, s1, vs2, vext_vm(desc), env->vstart, env->vl,            \
+       &env->fp_status);                                                \
+    env->vstart = 0;                                                    \
+}
+
+#define GEN_VEXT_FV(NAME, OP32, OP64)                                   \
+DO_OPFV(do_##NAME##_w, uint32_t, H4, OP32)                              \
+DO_OPFV(do_##NAME##_d, uint64_t, H8, OP64)                              \
+void HELPER(NAME)(void *vd, void *v0, void *vs2,                        \
+                  CPURISCVState *env, uint32_t desc)                    \
+{                                                                       \
+    vext_fv_fn *fn = vext_sew(env) == 2 ? do_##NAME##_w : do_##NAME##_d; \
+                                                                        \
+    fn(vd, v0, vs2, vext_vm(desc), env->vstart, env->vl,                \
+       &env->fp_status);                                                \
+    env->vstart = 0;                                                    \
+}
+
+#define GEN_VEXT_FVV_FVF(NAME, DOVV, DOVF, OP32, OP64)  \
+    GEN_VEXT_FVV(NAME##_vv, DOVV, OP32, OP64)           \
+    GEN_VEXT_FVF(NAME##_vf, DOVF, OP32, OP64)
+
+static float32 float32_rsub(float32 a, float32 b, float_status *s)
+{
+    return float32_sub(b, a, s);
+}
+
+static float64 float64_rsub(float64 a, float64 b, float_status *s)
+{
+    return float64_sub(b, a, s);
+}
+
+static float32 float32_rdiv(float32 a, float32 b, float_status *s)
+{
+    return float32_div(b, a, s);
+}
+
+static float64 float64_rdiv(float64 a, float64 b, float_status *s)
+{
+    return float64_div(b, a, s);
+}
+
+static uint32_t fsgnj32(uint32_t a, uint32_t b, float_status *s)
+{
+    return deposit32(b, 0, 31, a);
+}
+
+static uint64_t fsgnj64(uint64_t a, uint64_t b, float_status *s)
+{
+    return deposit64(b, 0, 63, a);
+}
+
+static uint32_t fsgnjn32(uint32_t a, uint32_t b, float_status *s)
+{
+    return deposit32(~b, 0, 31, a);
+}
+
+static uint64_t fsgnjn64(uint64_t a, uint64_t b, float_status *s)
+{
+    return deposit64(~b, 0, 63, a);
+}
+
+static uint32_t fsgnjx32(uint32_t a, uint32_t b, float_status *s)
+{
+    return a ^ (b & INT32_MIN);
+}
+
+static uint64_t fsgnjx64(uint64_t a, uint64_t b, float_status *s)
+{
+    return a ^ (b & INT64_MIN);
+}
+
+/*
+ * The multiply-adds get (vs2, vs1, vd): the .vv?acc forms multiply
+ * vs1 by vs2 and add vd, the .vv?add/?sub forms multiply vs1 by vd
+ * and add vs2.
+ */
+#define GEN_FMACC(NAME, FLAGS)                                          \
+static float32 NAME##32(float32 a, float32 b, float32 d, float_status *s) \
+{                                                                       \
+    return float32_muladd(b, a, d, FLAGS, s);                           \
+}                                                                       \
+static float64 NAME##64(float64 a, float64 b, float64 d, float_status *s) \
+{                                                                       \
+    return float64_muladd(b, a, d, FLAGS, s);                           \
+}
+
+#define GEN_FMADD(NAME, FLAGS)                                          \
+static float32 NAME##32(float32 a, float32 b, float32 d, float_status *s) \
+{                                                                       \
+    return float32_muladd(b, d, a, FLAGS, s);                           \
+}                                                                       \
+static float64 NAME##64(float64 a, float64 b, float64 d, float_status *s) \
+{                                                                       \
+    return float64_muladd(b, d, a, FLAGS, s);                           \
+}
+
+GEN_FMACC(fmacc, 0)
+GEN_FMACC(fnmacc, float_muladd_negate_product | float_muladd_negate_c)
+GEN_FMACC(fmsac, float_muladd_negate_c)
+GEN_FMACC(fnmsac, float_muladd_negate_product)
+GEN_FMADD(fmadd, 0)
+GEN_FMADD(fnmadd, float_muladd_negate_product | float_muladd_negate_c)
+GEN_FMADD(fmsub, float_muladd_negate_c)
+GEN_FMADD(fnmsub, float_muladd_negate_product)
+
+static bool float32_ne_quiet(float32 a, float32 b, float_status *s)
+{
+    return !float32_eq_quiet(a, b, s);
+}
+
+static bool float64_ne_quiet(float64 a, float64 b, float_status *s)
+{
+    return !float64_eq_quiet(a, b, s);
+}
+
+static bool float32_gt(float32 a, float32 b, float_status *s)
+{
+    return float32_lt(b, a, s);
+}
+
+static bool float64_gt(float64 a, float64 b, float_status *s)
+{
+    return float64_lt(b, a, s);
+}
+
+static bool float32_ge(float32 a, float32 b, float_status *s)
+{
+    return float32_le(b, a, s);
+}
+
+static bool float64_ge(float64 a, float64 b, float_status *s)
+{
+    return float64_le(b, a, s);
+}
+
+GEN_VEXT_FVV_FVF(vfadd, DO_OPFVV, DO_OPFVF, float32_add, float64_add)
+GEN_VEXT_FVV_FVF(vfsub, DO_OPFVV, DO_OPFVF, float32_sub, float64_sub)
+GEN_VEXT_FVF(vfrsub_vf, DO_OPFVF, float32_rsub, float64_rsub)
+GEN_VEXT_FVV_FVF(vfmul, DO_OPFVV, DO_OPFVF, float32_mul, float64_mul)
+GEN_VEXT_FVV_FVF(vfdiv, DO_OPFVV, DO_OPFVF, float32_div, float64_div)
+GEN_VEXT_FVF(vfrdiv_vf, DO_OPFVF, float32_rdiv, float64_rdiv)
+GEN_VEXT_FVV_FVF(vfmin, DO_OPFVV, DO_OPFVF, float32_minnum, float64_minnum)
+GEN_VEXT_FVV_FVF(vfmax, DO_OPFVV, DO_OPFVF, float32_maxnum, float64_maxnum)
+GEN_VEXT_FVV_FVF(vfsgnj, DO_OPFVV, DO_OPFVF, fsgnj32, fsgnj64)
+GEN_VEXT_FVV_FVF(vfsgnjn, DO_OPFVV, DO_OPFVF, fsgnjn32, fsgnjn64)
+GEN_VEXT_FVV_FVF(vfsgnjx, DO_OPFVV, DO_OPFVF, fsgnjx32, fsgnjx64)
+GEN_VEXT_FVV_FVF(vfmacc, DO_OPFVV3, DO_OPFVF3, fmacc32, fmacc64)
+GEN_VEXT_FVV_FVF(vfnmacc, DO_OPFVV3, DO_OPFVF3, fnmacc32, fnmacc64)
+GEN_VEXT_FVV_FVF(vfmsac, DO_OPFVV3, DO_OPFVF3, fmsac32, fmsac64)
+GEN_VEXT_FVV_FVF(vfnmsac, DO_OPFVV3, DO_OPFVF3, fnmsac32, fnmsac64)
+GEN_VEXT_FVV_FVF(vfmadd, DO_OPFVV3, DO_OPFVF3, fmadd32, fmadd64)
+GEN_VEXT_FVV_FVF(vfnmadd, DO_OPFVV3, DO_OPFVF3, fnmadd32, fnmadd64)
+GEN_VEXT_FVV_FVF(vfmsub, DO_OPFVV3, DO_OPFVF3, fmsub32, fmsub64)
+GEN_VEXT_FVV_FVF(vfnmsub, DO_OPFVV3, DO_OPFVF3, fnmsub32, fnmsub64)
+GEN_VEXT_FVV_FVF(vmfeq, DO_CMPFVV, DO_CMPFVF, float32_eq_quiet,
+                 float64_eq_quiet)
+GEN_VEXT_FVV_FVF(vmfne, DO_CMPFVV, DO_CMPFVF, float32_ne_quiet,
+                 float64_ne_quiet)
+GEN_VEXT_FVV_FVF(vmflt, DO_CMPFVV, DO_CMPFVF, float32_lt, float64_lt)
+GEN_VEXT_FVV_FVF(vmfle, DO_CMPFVV, DO_CMPFVF, float32_le, float64_le)
+GEN_VEXT_FVF(vmfgt_vf, DO_CMPFVF, float32_gt, float64_gt)
+GEN_VEXT_FVF(vmfge_vf, DO_CMPFVF, float32_ge, float64_ge)
+GEN_VEXT_FVF(vfmerge_vfm, DO_MERGEFVF, NULL, NULL)
+
+/* Both sums are done in element order, which the ordered one requires */
+GEN_VEXT_FVV(vfredusum_vs, DO_REDFVV, float32_add, float64_add)
+GEN_VEXT_FVV(vfredosum_vs, DO_REDFVV, float32_add, float64_add)
+GEN_VEXT_FVV(vfredmin_vs, DO_REDFVV, float32_minnum, float64_minnum)
+GEN_VEXT_FVV(vfredmax_vs, DO_REDFVV, float32_maxnum, float64_maxnum)
+
+GEN_VEXT_FV(vfsqrt_v, float32_sqrt, float64_sqrt)
+GEN_VEXT_FV(vfcvt_xu_f_v, float32_to_uint32, float64_to_uint64)
+GEN_VEXT_FV(vfcvt_x_f_v, float32_to_int32, float64_to_int64)
+GEN_VEXT_FV(vfcvt_f_xu_v, uint32_to_float32, uint64_to_float64)
+GEN_VEXT_FV(vfcvt_f_x_v, int32_to_float32, int64_to_float64)
+GEN_VEXT_FV(vfcvt_rtz_xu_f_v, float32_to_uint32_round_to_zero,
+            float64_to_uint64_round_to_zero)
+GEN_VEXT_FV(vfcvt_rtz_x_f_v, float32_to_int32_round_to_zero,
+            float64_to_int64_round_to_zero)
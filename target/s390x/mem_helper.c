@@ -1983,9 +1983,10 @@ void HELPER(ipte)(CPUS390XState *env, uint64_t pto, uint64_t vaddr,
         }
     } else {
         if (vaddr & ~VADDR_PX) {
-            tlb_flush_page_all_cpus_synced(cs, page);
             /* XXX 31-bit hack */
-            tlb_flush_page_all_cpus_synced(cs, page ^ 0x80000000);
+            const target_ulong pages[2] = { page, page ^ 0x80000000 };
+
+            tlb_flush_pages_all_cpus_synced(cs, pages, ARRAY_SIZE(pages));
         } else {
             /* looks like we don't have a valid virtual address */
             tlb_flush_all_cpus_synced(cs);
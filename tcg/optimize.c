@@ -1534,3 +1534,529 @@ void tcg_optimize(TCGContext *s)
         }
     }
 }
+
+/*
+ * Global value numbering, env load forwarding and dead store elimination.
+ *
+ * The op stream is walked once, in order.  Every value written to a temp
+ * gets a value number; a pure operation whose opcode, constant arguments
+ * and input value numbers have been seen before is replaced by a copy of
+ * the temp that still holds the earlier result.  Loads and stores with
+ * cpu_env as the base are tracked by offset, so that a load can reuse the
+ * value last stored to or loaded from the same field, and a store that is
+ * overwritten before anything could read it can be dropped.
+ *
+ * Facts survive conditional branches, so extended basic blocks (see
+ * TCG_OPF_COND_BRANCH) are handled as a whole; they are dropped at labels.
+ * Ordinary temps are dead after a branch, so they are only reused within
+ * the basic block in which they were written.
+ *
+ * Guest memory accesses and helpers without side effects are assumed not
+ * to modify env fields that the translator accesses directly.
+ */
+
+#define GVN_MAX_ARGS  6
+#define GVN_PROBES    8
+#define GVN_MEM_SLOTS 32
+
+struct gvn_temp {
+    uint32_t gen;       /* value number is valid if gen is current */
+    uint32_t vn;
+    bool is_const;
+    tcg_target_ulong val;
+};
+
+struct gvn_expr {
+    uint32_t gen;
+    TCGOpcode opc;
+    uint32_t const_mask;
+    uint64_t args[GVN_MAX_ARGS];
+    TCGTemp *result;
+    uint32_t vn;
+    uint32_t bb;
+};
+
+struct gvn_mem {
+    bool valid;
+    intptr_t ofs;
+    int size;
+    TCGOpcode opc;      /* the access that put @result in memory */
+    TCGTemp *result;
+    uint32_t vn;
+    uint32_t bb;
+    TCGOp *store;       /* not yet read, may be removed */
+};
+
+struct gvn_state {
+    TCGContext *s;
+    struct gvn_temp *temps;
+    struct gvn_expr *exprs;
+    size_t exprs_mask;
+    struct gvn_mem mem[GVN_MEM_SLOTS];
+    TCGTemp *env;
+    uint32_t gen;
+    uint32_t bb;
+    uint32_t next_vn;
+};
+
+static struct gvn_temp *gvn_temp(struct gvn_state *g, TCGTemp *ts)
+{
+    struct gvn_temp *gt = &g->temps[temp_idx(ts)];
+
+    /* Values that reach a label may come from another path */
+    if (gt->gen != g->gen) {
+        gt->gen = g->gen;
+        gt->vn = g->next_vn++;
+        gt->is_const = false;
+    }
+    return gt;
+}
+
+static void gvn_write(struct gvn_state *g, TCGTemp *ts)
+{
+    struct gvn_temp *gt = &g->temps[temp_idx(ts)];
+
+    gt->gen = g->gen;
+    gt->vn = g->next_vn++;
+    gt->is_const = false;
+}
+
+static void gvn_copy(struct gvn_state *g, TCGTemp *dst, TCGTemp *src)
+{
+    struct gvn_temp *st = gvn_temp(g, src);
+    struct gvn_temp *dt = &g->temps[temp_idx(dst)];
+
+    dt->gen = g->gen;
+    dt->vn = st->vn;
+    dt->is_const = st->is_const;
+    dt->val = st->val;
+}
+
+/* Can @ts, written in basic block @bb with value number @vn, be read?  */
+static bool gvn_available(struct gvn_state *g, TCGTemp *ts,
+                          uint32_t vn, uint32_t bb)
+{
+    if (gvn_temp(g, ts)->vn != vn) {
+        return false;
+    }
+    return ts->temp_global || ts->temp_local || bb == g->bb;
+}
+
+/* Turn @op into "mov dst, src", or remove it if it is a no-op.  */
+static void gvn_gen_mov(struct gvn_state *g, TCGOp *op, TCGTemp *dst,
+                        TCGTemp *src)
+{
+    gvn_copy(g, dst, src);
+    if (dst == src) {
+        tcg_op_remove(g->s, op);
+        return;
+    }
+    op->opc = dst->type == TCG_TYPE_I64 ? INDEX_op_mov_i64 : INDEX_op_mov_i32;
+    op->args[0] = temp_arg(dst);
+    op->args[1] = temp_arg(src);
+}
+
+static void gvn_clobber_globals(struct gvn_state *g)
+{
+    int i;
+
+    for (i = 0; i < g->s->nb_globals; i++) {
+        gvn_write(g, &g->s->temps[i]);
+    }
+}
+
+/* Something may read env: pending stores must stay.  */
+static void gvn_mem_read_all(struct gvn_state *g)
+{
+    int i;
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        g->mem[i].store = NULL;
+    }
+}
+
+/* Something may write env: forget its contents.  */
+static void gvn_mem_clobber_all(struct gvn_state *g)
+{
+    int i;
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        g->mem[i].valid = false;
+    }
+}
+
+static bool gvn_mem_overlaps(struct gvn_mem *m, intptr_t ofs, int size)
+{
+    return m->valid && m->ofs < ofs + size && ofs < m->ofs + m->size;
+}
+
+static struct gvn_mem *gvn_mem_alloc(struct gvn_state *g)
+{
+    struct gvn_mem *m;
+    int i;
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        if (!g->mem[i].valid) {
+            return &g->mem[i];
+        }
+    }
+    /* Evict a slot, cheaply: the one with the lowest offset.  */
+    m = &g->mem[0];
+    for (i = 1; i < GVN_MEM_SLOTS; i++) {
+        if (g->mem[i].ofs < m->ofs) {
+            m = &g->mem[i];
+        }
+    }
+    return m;
+}
+
+static int gvn_access_size(TCGOpcode opc)
+{
+    switch (opc) {
+    case INDEX_op_ld8u_i32:
+    case INDEX_op_ld8s_i32:
+    case INDEX_op_st8_i32:
+    case INDEX_op_ld8u_i64:
+    case INDEX_op_ld8s_i64:
+    case INDEX_op_st8_i64:
+        return 1;
+    case INDEX_op_ld16u_i32:
+    case INDEX_op_ld16s_i32:
+    case INDEX_op_st16_i32:
+    case INDEX_op_ld16u_i64:
+    case INDEX_op_ld16s_i64:
+    case INDEX_op_st16_i64:
+        return 2;
+    case INDEX_op_ld_i32:
+    case INDEX_op_st_i32:
+    case INDEX_op_ld32u_i64:
+    case INDEX_op_ld32s_i64:
+    case INDEX_op_st32_i64:
+        return 4;
+    case INDEX_op_ld_i64:
+    case INDEX_op_st_i64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+static bool gvn_is_store(TCGOpcode opc)
+{
+    switch (opc) {
+    case INDEX_op_st8_i32:
+    case INDEX_op_st16_i32:
+    case INDEX_op_st_i32:
+    case INDEX_op_st8_i64:
+    case INDEX_op_st16_i64:
+    case INDEX_op_st32_i64:
+    case INDEX_op_st_i64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Does memory written or read by @prev hold the value that @opc
+ * would load or store?  Only full-width accesses need no extension.
+ */
+static bool gvn_mem_match(TCGOpcode prev, TCGOpcode opc)
+{
+    if (prev == opc) {
+        return true;
+    }
+    switch (opc) {
+    case INDEX_op_ld_i32:
+    case INDEX_op_st_i32:
+        return prev == INDEX_op_ld_i32 || prev == INDEX_op_st_i32;
+    case INDEX_op_ld_i64:
+    case INDEX_op_st_i64:
+        return prev == INDEX_op_ld_i64 || prev == INDEX_op_st_i64;
+    default:
+        return false;
+    }
+}
+
+static void gvn_load(struct gvn_state *g, TCGOp *op, int size)
+{
+    TCGTemp *dst = arg_temp(op->args[0]);
+    intptr_t ofs = op->args[2];
+    struct gvn_mem *hit = NULL;
+    int i;
+
+    if (arg_temp(op->args[1]) != g->env) {
+        gvn_mem_read_all(g);
+        gvn_write(g, dst);
+        return;
+    }
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        struct gvn_mem *m = &g->mem[i];
+
+        if (!gvn_mem_overlaps(m, ofs, size)) {
+            continue;
+        }
+        m->store = NULL;
+        if (m->ofs == ofs && m->size == size && gvn_mem_match(m->opc, op->opc)
+            && gvn_available(g, m->result, m->vn, m->bb)) {
+            hit = m;
+        }
+    }
+
+    if (hit) {
+        gvn_gen_mov(g, op, dst, hit->result);
+        atomic_set(&g->s->opt_stats.gvn_loads,
+                   g->s->opt_stats.gvn_loads + 1);
+        return;
+    }
+
+    gvn_write(g, dst);
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        struct gvn_mem *m = &g->mem[i];
+
+        if (m->valid && m->ofs == ofs && m->size == size) {
+            /* A stale copy of the same field */
+            hit = m;
+            break;
+        }
+    }
+    if (!hit) {
+        hit = gvn_mem_alloc(g);
+    }
+    hit->valid = true;
+    hit->ofs = ofs;
+    hit->size = size;
+    hit->opc = op->opc;
+    hit->result = dst;
+    hit->vn = gvn_temp(g, dst)->vn;
+    hit->bb = g->bb;
+    hit->store = NULL;
+}
+
+static void gvn_store(struct gvn_state *g, TCGOp *op, int size)
+{
+    TCGTemp *val = arg_temp(op->args[0]);
+    intptr_t ofs = op->args[2];
+    uint32_t vn = gvn_temp(g, val)->vn;
+    struct gvn_mem *m;
+    int i;
+
+    if (arg_temp(op->args[1]) != g->env) {
+        gvn_mem_clobber_all(g);
+        return;
+    }
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        m = &g->mem[i];
+        if (m->valid && m->ofs == ofs && m->size == size && m->vn == vn
+            && gvn_mem_match(m->opc, op->opc)) {
+            /* The field already holds this value */
+            tcg_op_remove(g->s, op);
+            atomic_set(&g->s->opt_stats.gvn_stores,
+                       g->s->opt_stats.gvn_stores + 1);
+            return;
+        }
+    }
+
+    for (i = 0; i < GVN_MEM_SLOTS; i++) {
+        m = &g->mem[i];
+        if (!gvn_mem_overlaps(m, ofs, size)) {
+            continue;
+        }
+        if (m->store && m->ofs >= ofs && m->ofs + m->size <= ofs + size) {
+            /* Overwritten before anything could read it */
+            tcg_op_remove(g->s, m->store);
+            atomic_set(&g->s->opt_stats.gvn_stores,
+                       g->s->opt_stats.gvn_stores + 1);
+        }
+        m->valid = false;
+    }
+
+    m = gvn_mem_alloc(g);
+    m->valid = true;
+    m->ofs = ofs;
+    m->size = size;
+    m->opc = op->opc;
+    m->result = val;
+    m->vn = vn;
+    m->bb = g->bb;
+    m->store = op;
+}
+
+/* Replace @op with a copy of an earlier result, or remember it.  */
+static void gvn_expr(struct gvn_state *g, TCGOp *op, const TCGOpDef *def)
+{
+    TCGTemp *dst = arg_temp(op->args[0]);
+    struct gvn_expr key, *e, *victim = NULL;
+    int nb_args = def->nb_iargs + def->nb_cargs;
+    uint32_t h;
+    int i;
+
+    memset(&key, 0, sizeof(key));
+    key.opc = op->opc;
+    h = op->opc;
+    for (i = 0; i < nb_args; i++) {
+        TCGArg arg = op->args[def->nb_oargs + i];
+
+        if (i < def->nb_iargs) {
+            struct gvn_temp *gt = gvn_temp(g, arg_temp(arg));
+            if (gt->is_const) {
+                key.const_mask |= 1u << i;
+                key.args[i] = gt->val;
+            } else {
+                key.args[i] = gt->vn;
+            }
+        } else {
+            key.args[i] = arg;
+        }
+        h = h * 31 + (uint32_t)(key.args[i] ^ (key.args[i] >> 32));
+    }
+
+    for (i = 0; i < GVN_PROBES; i++) {
+        e = &g->exprs[(h + i) & g->exprs_mask];
+        if (e->gen != g->gen
+            || !gvn_available(g, e->result, e->vn, e->bb)) {
+            if (!victim) {
+                victim = e;
+            }
+            continue;
+        }
+        if (e->opc == key.opc && e->const_mask == key.const_mask
+            && !memcmp(e->args, key.args, sizeof(key.args))) {
+            gvn_gen_mov(g, op, dst, e->result);
+            atomic_set(&g->s->opt_stats.gvn_cse,
+                       g->s->opt_stats.gvn_cse + 1);
+            return;
+        }
+    }
+
+    gvn_write(g, dst);
+    if (!victim) {
+        victim = &g->exprs[h & g->exprs_mask];
+    }
+    *victim = key;
+    victim->gen = g->gen;
+    victim->result = dst;
+    victim->vn = gvn_temp(g, dst)->vn;
+    victim->bb = g->bb;
+}
+
+void tcg_optimize_gvn(TCGContext *s)
+{
+    struct gvn_state g = { .s = s };
+    TCGOp *op, *op_next;
+    size_t n;
+    int i;
+
+    g.env = tcgv_ptr_temp(cpu_env);
+    g.gen = 1;
+    g.next_vn = 1;
+    g.temps = tcg_malloc(sizeof(*g.temps) * s->nb_temps);
+    memset(g.temps, 0, sizeof(*g.temps) * s->nb_temps);
+    /* The table is a cache, entries are simply overwritten when full */
+    n = pow2ceil(MIN(MAX(s->nb_ops / 2, 64), 1024));
+    g.exprs = tcg_malloc(sizeof(*g.exprs) * n);
+    memset(g.exprs, 0, sizeof(*g.exprs) * n);
+    g.exprs_mask = n - 1;
+
+    QTAILQ_FOREACH_SAFE(op, &s->ops, link, op_next) {
+        TCGOpcode opc = op->opc;
+        const TCGOpDef *def = &tcg_op_defs[opc];
+        int nb_oargs, size;
+
+        switch (opc) {
+        case INDEX_op_set_label:
+            /* Forget everything: there may be several predecessors.  */
+            g.gen++;
+            g.bb++;
+            gvn_mem_clobber_all(&g);
+            continue;
+
+        case INDEX_op_insn_start:
+            continue;
+
+        case INDEX_op_movi_i32:
+        case INDEX_op_movi_i64:
+            {
+                TCGTemp *dst = arg_temp(op->args[0]);
+                struct gvn_temp *gt;
+
+                gvn_write(&g, dst);
+                gt = &g.temps[temp_idx(dst)];
+                gt->is_const = true;
+                gt->val = op->args[1];
+            }
+            continue;
+
+        case INDEX_op_mov_i32:
+        case INDEX_op_mov_i64:
+            gvn_copy(&g, arg_temp(op->args[0]), arg_temp(op->args[1]));
+            continue;
+
+        case INDEX_op_call:
+            {
+                int flags;
+
+                nb_oargs = TCGOP_CALLO(op);
+                flags = op->args[nb_oargs + TCGOP_CALLI(op) + 1];
+                if (!(flags & TCG_CALL_NO_WRITE_GLOBALS)) {
+                    gvn_clobber_globals(&g);
+                }
+                if (!(flags & TCG_CALL_NO_SIDE_EFFECTS)) {
+                    gvn_mem_clobber_all(&g);
+                }
+                gvn_mem_read_all(&g);
+                for (i = 0; i < nb_oargs; i++) {
+                    gvn_write(&g, arg_temp(op->args[i]));
+                }
+            }
+            continue;
+
+        case INDEX_op_ld_vec:
+        case INDEX_op_dupm_vec:
+            gvn_mem_read_all(&g);
+            gvn_write(&g, arg_temp(op->args[0]));
+            continue;
+
+        case INDEX_op_st_vec:
+            gvn_mem_clobber_all(&g);
+            continue;
+
+        default:
+            break;
+        }
+
+        size = gvn_access_size(opc);
+        if (size) {
+            if (gvn_is_store(opc)) {
+                gvn_store(&g, op, size);
+            } else {
+                gvn_load(&g, op, size);
+            }
+            continue;
+        }
+
+        if (def->flags & TCG_OPF_BB_END) {
+            /* Only non-local temps die at a conditional branch */
+            gvn_mem_read_all(&g);
+            g.bb++;
+            continue;
+        }
+
+        if (def->flags & TCG_OPF_SIDE_EFFECTS) {
+            /* e.g. guest memory accesses, which may raise exceptions */
+            gvn_mem_read_all(&g);
+        } else if (def->nb_oargs == 1
+                   && def->nb_iargs + def->nb_cargs <= GVN_MAX_ARGS
+                   && !(def->flags & (TCG_OPF_VECTOR | TCG_OPF_NOT_PRESENT |
+                                      TCG_OPF_CALL_CLOBBER))) {
+            gvn_expr(&g, op, def);
+            continue;
+        }
+
+        for (i = 0; i < def->nb_oargs; i++) {
+            gvn_write(&g, arg_temp(op->args[i]));
+        }
+    }
+}
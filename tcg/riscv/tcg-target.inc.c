@@ -1280,6 +1280,29 @@ static void tcg_out_qemu_st(TCGContext *s, const TCGArg *args, bool is_64)
 
 static tcg_insn_unit *tb_ret_addr;
 
+void tb_target_set_jmp_target(uintptr_t tc_ptr, uintptr_t jmp_addr,
+                              uintptr_t addr)
+{
+    uint32_t *p = (uint32_t *)jmp_addr;
+    ptrdiff_t offset = addr - jmp_addr;
+    uintptr_t entry;
+    uint32_t insn;
+
+    /* Find the pool entry from the AUIPC+LD pair that follows the JAL.  */
+    entry = (uintptr_t)&p[1] + (int32_t)(p[1] & 0xfffff000)
+            + ((int32_t)p[2] >> 20);
+    atomic_set((tcg_target_ulong *)entry, addr);
+    smp_wmb();
+
+    if (offset == sextreg(offset, 1, 20) << 1) {
+        insn = encode_uj(OPC_JAL, TCG_REG_ZERO, offset);
+    } else {
+        insn = encode_uj(OPC_JAL, TCG_REG_ZERO, 4);
+    }
+    atomic_set(p, insn);
+    flush_icache_range(jmp_addr, jmp_addr + 4);
+}
+
 static void tcg_out_op(TCGContext *s, TCGOpcode opc,
                        const TCGArg *args, const int *const_args)
 {
@@ -1300,10 +1323,21 @@ static void tcg_out_op(TCGContext *s, TCGOpcode opc,
         break;
 
     case INDEX_op_goto_tb:
-        assert(s->tb_jmp_insn_offset == 0);
-        /* indirect jump method */
-        tcg_out_ld(s, TCG_TYPE_PTR, TCG_REG_TMP0, TCG_REG_ZERO,
-                   (uintptr_t)(s->tb_jmp_target_addr + a0));
+        tcg_debug_assert(s->tb_jmp_insn_offset != NULL);
+        /*
+         * The JAL is patched by tb_target_set_jmp_target to branch to the
+         * destination when it is within reach, and to fall through to an
+         * indirect jump otherwise.  The destination is always stored in
+         * the constant pool entry; start it out with a unique value so
+         * that the pool does not merge the entries of the two exits.
+         */
+        s->tb_jmp_insn_offset[a0] = tcg_current_code_size(s);
+        tcg_out_opc_jump(s, OPC_JAL, TCG_REG_ZERO, 4);
+        new_pool_label(s, (uintptr_t)s->code_ptr, R_RISCV_CALL,
+                       s->code_ptr, 0);
+        tcg_out_opc_upper(s, OPC_AUIPC, TCG_REG_TMP0, 0);
+        tcg_out_opc_imm(s, TCG_TARGET_REG_BITS == 64 ? OPC_LD : OPC_LW,
+                        TCG_REG_TMP0, TCG_REG_TMP0, 0);
         tcg_out_opc_imm(s, OPC_JALR, TCG_REG_ZERO, TCG_REG_TMP0, 0);
         set_jmp_reset_offset(s, a0);
         break;
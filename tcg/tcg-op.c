@@ -25,6 +25,7 @@
 #include "qemu/osdep.h"
 #include "cpu.h"
 #include "exec/exec-all.h"
+#include "exec/tb-hash.h"
 #include "tcg.h"
 #include "tcg-op.h"
 #include "tcg-mo.h"
@@ -2680,8 +2681,8 @@ void tcg_gen_exit_tb(TranslationBlock *tb, unsigned idx)
             val = 0;
         }
     } else {
-        /* This is an exit via the exitreq label.  */
-        tcg_debug_assert(idx == TB_EXIT_REQUESTED);
+        /* This is an exit via the exitreq or hot label.  */
+        tcg_debug_assert(idx == TB_EXIT_REQUESTED || idx == TB_EXIT_HOT);
     }
 
     tcg_gen_op1i(INDEX_op_exit_tb, val);
@@ -2702,11 +2703,17 @@ void tcg_gen_goto_tb(unsigned idx)
     }
 }
 
+/* The next indirect branch target cache slot to hand out */
+static unsigned int tcg_ibtc_next_site;
+
 void tcg_gen_lookup_and_goto_ptr(void)
 {
     if (TCG_TARGET_HAS_goto_ptr && !qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
         TCGv_ptr ptr = tcg_temp_new_ptr();
-        gen_helper_lookup_tb_ptr(ptr, cpu_env);
+        TCGv_i32 site = tcg_const_i32(atomic_fetch_inc(&tcg_ibtc_next_site) &
+                                      (TB_IBTC_SIZE - 1));
+        gen_helper_lookup_tb_ptr(ptr, cpu_env, site);
+        tcg_temp_free_i32(site);
         tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
         tcg_temp_free_ptr(ptr);
     } else {
@@ -35,6 +35,7 @@
 #include "qemu/host-utils.h"
 #include "qemu/qemu-print.h"
 #include "qemu/timer.h"
+#include "qemu/units.h"
 
 /* Note: the long term plan is to reduce the dependencies on the QEMU
    CPU definitions. Currently they are used for qemu_ld/st
@@ -161,6 +162,8 @@ static int tcg_out_ldst_finalize(TCGContext *s);
 static TCGContext **tcg_ctxs;
 static unsigned int n_tcg_ctxs;
 TCGv_env cpu_env = 0;
+bool tcg_gvn_enabled = true;
+unsigned int tcg_translation_threads;
 
 struct tcg_region_tree {
     QemuMutex lock;
@@ -185,11 +188,28 @@ struct tcg_region_state {
     size_t size; /* size of one region */
     size_t stride; /* .size + guard size */
 
+    size_t n_trees; /* n, plus one for the hot code area */
+
+    /* hot code area, see tcg_code_select(); set at init time */
+    void *hot_start;
+    void *hot_end;
+
     /* fields protected by the lock */
     size_t current; /* current region index */
     size_t agg_size_full; /* aggregate size of full regions */
+    void *reserved_end; /* end of code placed by tcg_region_reserve() */
+    void *hot_ptr; /* next free chunk of the hot code area */
+    size_t hot_agg_size_full; /* aggregate size of full hot chunks */
 };
 
+/*
+ * The hot code area is handed out in chunks, which must fit the largest
+ * TB that tcg_gen_code() can generate.
+ */
+#define TCG_HOT_CHUNK_SIZE (256 * KiB)
+
+size_t tcg_hot_area_size;
+
 static struct tcg_region_state region;
 /*
  * This is an array of struct tcg_region_tree's, with padding.
@@ -391,8 +411,9 @@ static void tcg_region_trees_init(void)
     size_t i;
 
     tree_size = ROUND_UP(sizeof(struct tcg_region_tree), qemu_dcache_linesize);
-    region_trees = qemu_memalign(qemu_dcache_linesize, region.n * tree_size);
-    for (i = 0; i < region.n; i++) {
+    region_trees = qemu_memalign(qemu_dcache_linesize,
+                                 region.n_trees * tree_size);
+    for (i = 0; i < region.n_trees; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
         qemu_mutex_init(&rt->lock);
@@ -404,7 +425,9 @@ static struct tcg_region_tree *tc_ptr_to_region_tree(void *p)
 {
     size_t region_idx;
 
-    if (p < region.start_aligned) {
+    if (p >= region.hot_start && p < region.hot_end) {
+        region_idx = region.n;
+    } else if (p < region.start_aligned) {
         region_idx = 0;
     } else {
         ptrdiff_t offset = p - region.start_aligned;
@@ -457,7 +480,7 @@ static void tcg_region_tree_lock_all(void)
 {
     size_t i;
 
-    for (i = 0; i < region.n; i++) {
+    for (i = 0; i < region.n_trees; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
         qemu_mutex_lock(&rt->lock);
@@ -468,7 +491,7 @@ static void tcg_region_tree_unlock_all(void)
 {
     size_t i;
 
-    for (i = 0; i < region.n; i++) {
+    for (i = 0; i < region.n_trees; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
         qemu_mutex_unlock(&rt->lock);
@@ -480,7 +503,7 @@ void tcg_tb_foreach(GTraverseFunc func, gpointer user_data)
     size_t i;
 
     tcg_region_tree_lock_all();
-    for (i = 0; i < region.n; i++) {
+    for (i = 0; i < region.n_trees; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
         g_tree_foreach(rt->tree, func, user_data);
@@ -494,7 +517,7 @@ size_t tcg_nb_tbs(void)
     size_t i;
 
     tcg_region_tree_lock_all();
-    for (i = 0; i < region.n; i++) {
+    for (i = 0; i < region.n_trees; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
         nb_tbs += g_tree_nnodes(rt->tree);
@@ -546,10 +569,26 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
     s->code_gen_ptr = start;
     s->code_gen_buffer_size = end - start;
     s->code_gen_highwater = end - TCG_HIGHWATER;
+
+    /* do not hand out the part of the region that is already in use */
+    if (region.reserved_end > start) {
+        s->code_gen_ptr = region.reserved_end;
+    }
 }
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
+    void *start, *end;
+
+    /* skip the regions that have been filled by tcg_region_reserve() */
+    while (region.current < region.n) {
+        tcg_region_bounds(region.current, &start, &end);
+        if (region.reserved_end < end - TCG_HIGHWATER) {
+            break;
+        }
+        region.agg_size_full += end - start - TCG_HIGHWATER;
+        region.current++;
+    }
     if (region.current == region.n) {
         return true;
     }
@@ -577,6 +616,66 @@ static bool tcg_region_alloc(TCGContext *s)
     return err;
 }
 
+/*
+ * Request a new chunk of the hot code area once the one in use has filled
+ * up.  Returns true on error.
+ */
+static bool tcg_hot_alloc(TCGContext *s)
+{
+    bool err = true;
+
+    qemu_mutex_lock(&region.lock);
+    if (region.hot_ptr + TCG_HOT_CHUNK_SIZE <= region.hot_end) {
+        if (s->code_gen_buffer) {
+            region.hot_agg_size_full += s->code_gen_ptr - s->code_gen_buffer;
+        }
+        s->code_gen_buffer = region.hot_ptr;
+        s->code_gen_ptr = region.hot_ptr;
+        s->code_gen_buffer_size = TCG_HOT_CHUNK_SIZE;
+        s->code_gen_highwater = region.hot_ptr + TCG_HOT_CHUNK_SIZE -
+                                TCG_HIGHWATER;
+        region.hot_ptr += TCG_HOT_CHUNK_SIZE;
+        err = false;
+    }
+    qemu_mutex_unlock(&region.lock);
+    return err;
+}
+
+static void tcg_code_swap__locked(TCGContext *s)
+{
+    void *buffer = s->code_gen_buffer;
+    size_t size = s->code_gen_buffer_size;
+    void *ptr = s->code_gen_ptr;
+    void *highwater = s->code_gen_highwater;
+
+    s->code_gen_buffer = s->code_alt_buffer;
+    s->code_gen_buffer_size = s->code_alt_buffer_size;
+    atomic_set(&s->code_gen_ptr, s->code_alt_ptr);
+    s->code_gen_highwater = s->code_alt_highwater;
+    s->code_alt_buffer = buffer;
+    s->code_alt_buffer_size = size;
+    s->code_alt_ptr = ptr;
+    s->code_alt_highwater = highwater;
+    s->code_hot = !s->code_hot;
+}
+
+/*
+ * Choose whether @s generates code into its region of code_gen_buffer, or
+ * into the hot code area.  The latter packs together the code that has
+ * been found hot, and is kept by tcg_region_reset_all() so that the hot
+ * code survives a full code_gen_buffer.  If there is no hot code area,
+ * all code goes to the regions.
+ */
+void tcg_code_select(TCGContext *s, bool hot)
+{
+    if (s->code_hot == hot || (hot && !region.hot_start)) {
+        return;
+    }
+    qemu_mutex_lock(&region.lock);
+    tcg_code_swap__locked(s);
+    qemu_mutex_unlock(&region.lock);
+}
+
 /*
  * Perform a context's first region allocation.
  * This function does _not_ increment region.agg_size_full.
@@ -595,11 +694,16 @@ void tcg_region_reset_all(void)
     qemu_mutex_lock(&region.lock);
     region.current = 0;
     region.agg_size_full = 0;
+    region.reserved_end = NULL;
 
     for (i = 0; i < n_ctxs; i++) {
         TCGContext *s = atomic_read(&tcg_ctxs[i]);
-        bool err = tcg_region_initial_alloc__locked(s);
+        bool err;
 
+        if (s->code_hot) {
+            tcg_code_swap__locked(s);
+        }
+        err = tcg_region_initial_alloc__locked(s);
         g_assert(!err);
     }
     qemu_mutex_unlock(&region.lock);
@@ -607,6 +711,84 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+/* Call from a safe-work context, after tcg_region_reset_all() */
+void tcg_hot_reset(void)
+{
+    struct tcg_region_tree *rt = region_trees + region.n * tree_size;
+    unsigned int n_ctxs = atomic_read(&n_tcg_ctxs);
+    unsigned int i;
+
+    if (!region.hot_start) {
+        return;
+    }
+
+    qemu_mutex_lock(&region.lock);
+    region.hot_ptr = region.hot_start;
+    region.hot_agg_size_full = 0;
+    for (i = 0; i < n_ctxs; i++) {
+        TCGContext *s = atomic_read(&tcg_ctxs[i]);
+
+        g_assert(!s->code_hot);
+        s->code_alt_buffer = NULL;
+        s->code_alt_buffer_size = 0;
+        s->code_alt_ptr = NULL;
+        s->code_alt_highwater = NULL;
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    qemu_mutex_lock(&rt->lock);
+    g_tree_ref(rt->tree);
+    g_tree_destroy(rt->tree);
+    qemu_mutex_unlock(&rt->lock);
+}
+
+/*
+ * Whether the hot code area is too full to be worth keeping across
+ * tcg_region_reset_all(), i.e. less than a quarter of it is left.
+ */
+bool tcg_hot_full(void)
+{
+    bool ret;
+
+    qemu_mutex_lock(&region.lock);
+    ret = (region.hot_end - region.hot_ptr) * 4 <
+          region.hot_end - region.hot_start;
+    qemu_mutex_unlock(&region.lock);
+    return ret;
+}
+
+void tcg_hot_tb_foreach(GTraverseFunc func, gpointer user_data)
+{
+    struct tcg_region_tree *rt = region_trees + region.n * tree_size;
+
+    qemu_mutex_lock(&rt->lock);
+    g_tree_foreach(rt->tree, func, user_data);
+    qemu_mutex_unlock(&rt->lock);
+}
+
+bool tcg_hot_contains(const void *p)
+{
+    return p >= region.hot_start && p < region.hot_end;
+}
+
+/*
+ * Mark code_gen_buffer as in use up to @end, e.g. because it has been
+ * populated with code that was not generated by a TCG context (see
+ * accel/tcg/tb-cache.c).  Regions below @end are not handed out, and the
+ * region containing @end is handed out starting at @end.
+ *
+ * Must be called before any TCG thread performs its initial region
+ * allocation; the reservation is dropped by tcg_region_reset_all().
+ */
+void tcg_region_reserve(void *end)
+{
+    qemu_mutex_lock(&region.lock);
+    g_assert(region.current == 0);
+    g_assert(end >= region.start && end <= region.end);
+    region.reserved_end = end;
+    qemu_mutex_unlock(&region.lock);
+}
+
 #ifdef CONFIG_USER_ONLY
 static size_t tcg_n_regions(void)
 {
@@ -628,24 +810,26 @@ static size_t tcg_n_regions(void)
     MachineState *ms = MACHINE(qdev_get_machine());
     unsigned int max_cpus = ms->smp.max_cpus;
 #endif
-    if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
+    unsigned int n_threads = max_cpus + tcg_translation_threads;
+
+    if (n_threads == 1 || !qemu_tcg_mttcg_enabled()) {
         return 1;
     }
 
-    /* Try to have more regions than max_cpus, with each region being >= 2 MB */
+    /* Try to have more regions than threads, with each region being >= 2 MB */
     for (i = 8; i > 0; i--) {
         size_t regions_per_thread = i;
         size_t region_size;
 
         region_size = tcg_init_ctx.code_gen_buffer_size;
-        region_size /= max_cpus * regions_per_thread;
+        region_size /= n_threads * regions_per_thread;
 
         if (region_size >= 2 * 1024u * 1024) {
-            return max_cpus * regions_per_thread;
+            return n_threads * regions_per_thread;
         }
     }
-    /* If we can't, then just allocate one region per vCPU thread */
-    return max_cpus;
+    /* If we can't, then just allocate one region per TCG thread */
+    return n_threads;
 }
 #endif
 
@@ -659,8 +843,9 @@ static size_t tcg_n_regions(void)
  * and then assigning regions to TCG threads so that the threads can translate
  * code in parallel without synchronization.
  *
- * In softmmu the number of TCG threads is bounded by max_cpus, so we use at
- * least max_cpus regions in MTTCG. In !MTTCG we use a single region.
+ * In softmmu the number of TCG threads is bounded by max_cpus plus the
+ * background translation threads, so we use at least that many regions in
+ * MTTCG. In !MTTCG we use a single region.
  * Note that the TCG options from the command-line (i.e. -accel accel=tcg,[...])
  * must have been parsed before calling this function, since it calls
  * qemu_tcg_mttcg_enabled().
@@ -689,6 +874,26 @@ void tcg_region_init(void)
 
     n_regions = tcg_n_regions();
 
+    /*
+     * Carve the hot code area out of the end of the buffer, followed by
+     * a guard page of its own.
+     */
+    if (tcg_hot_area_size) {
+        size_t hot_size = MIN(tcg_hot_area_size, size / 2);
+        int rc;
+
+        hot_size = QEMU_ALIGN_DOWN(hot_size, TCG_HOT_CHUNK_SIZE);
+        if (hot_size) {
+            region.hot_end = QEMU_ALIGN_PTR_DOWN(buf + size, page_size);
+            region.hot_end -= page_size;
+            region.hot_start = region.hot_end - hot_size;
+            region.hot_ptr = region.hot_start;
+            rc = qemu_mprotect_none(region.hot_end, page_size);
+            g_assert(!rc);
+            size = region.hot_start - buf;
+        }
+    }
+
     /* The first region will be 'aligned - buf' bytes larger than the others */
     aligned = QEMU_ALIGN_PTR_UP(buf, page_size);
     g_assert(aligned < tcg_init_ctx.code_gen_buffer + size);
@@ -706,6 +911,7 @@ void tcg_region_init(void)
     /* init the region struct */
     qemu_mutex_init(&region.lock);
     region.n = n_regions;
+    region.n_trees = n_regions + 1;
     region.size = region_size - page_size;
     region.stride = region_size;
     region.start = buf;
@@ -778,7 +984,7 @@ void tcg_register_thread(void)
 
     /* Claim an entry in tcg_ctxs */
     n = atomic_fetch_inc(&n_tcg_ctxs);
-    g_assert(n < ms->smp.max_cpus);
+    g_assert(n < ms->smp.max_cpus + tcg_translation_threads);
     atomic_set(&tcg_ctxs[n], s);
 
     tcg_ctx = s;
@@ -803,7 +1009,7 @@ size_t tcg_code_size(void)
     size_t total;
 
     qemu_mutex_lock(&region.lock);
-    total = region.agg_size_full;
+    total = region.agg_size_full + region.hot_agg_size_full;
     for (i = 0; i < n_ctxs; i++) {
         const TCGContext *s = atomic_read(&tcg_ctxs[i]);
         size_t size;
@@ -811,11 +1017,36 @@ size_t tcg_code_size(void)
         size = atomic_read(&s->code_gen_ptr) - s->code_gen_buffer;
         g_assert(size <= s->code_gen_buffer_size);
         total += size;
+        total += s->code_alt_ptr - s->code_alt_buffer;
     }
     qemu_mutex_unlock(&region.lock);
     return total;
 }
 
+/*
+ * Returns the size (in bytes) of the code in the hot code area, and the
+ * size of the area.
+ */
+void tcg_hot_usage(size_t *used, size_t *capacity)
+{
+    unsigned int n_ctxs = atomic_read(&n_tcg_ctxs);
+    unsigned int i;
+
+    qemu_mutex_lock(&region.lock);
+    *used = region.hot_agg_size_full;
+    for (i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = atomic_read(&tcg_ctxs[i]);
+
+        if (s->code_hot) {
+            *used += atomic_read(&s->code_gen_ptr) - s->code_gen_buffer;
+        } else {
+            *used += s->code_alt_ptr - s->code_alt_buffer;
+        }
+    }
+    *capacity = region.hot_end - region.hot_start;
+    qemu_mutex_unlock(&region.lock);
+}
+
 /*
  * Returns the code capacity (in bytes) of the entire cache, i.e. including all
  * regions.
@@ -829,6 +1060,7 @@ size_t tcg_code_capacity(void)
     guard_size = region.stride - region.size;
     capacity = region.end + guard_size - region.start;
     capacity -= region.n * (guard_size + TCG_HIGHWATER);
+    capacity += region.hot_end - region.hot_start;
     return capacity;
 }
 
@@ -846,6 +1078,26 @@ size_t tcg_tb_phys_invalidate_count(void)
     return total;
 }
 
+void tcg_opt_stats(TCGOptStats *stats)
+{
+    unsigned int n_ctxs = atomic_read(&n_tcg_ctxs);
+    unsigned int i;
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = atomic_read(&tcg_ctxs[i]);
+        const TCGOptStats *orig = &s->opt_stats;
+
+        stats->ops_in += atomic_read(&orig->ops_in);
+        stats->ops_optimize += atomic_read(&orig->ops_optimize);
+        stats->ops_gvn += atomic_read(&orig->ops_gvn);
+        stats->ops_liveness += atomic_read(&orig->ops_liveness);
+        stats->gvn_cse += atomic_read(&orig->gvn_cse);
+        stats->gvn_loads += atomic_read(&orig->gvn_loads);
+        stats->gvn_stores += atomic_read(&orig->gvn_stores);
+    }
+}
+
 /* pool based memory allocation */
 void *tcg_malloc_internal(TCGContext *s, int size)
 {
@@ -982,7 +1234,8 @@ void tcg_context_init(TCGContext *s)
      * In user-mode we simply share the init context among threads, since we
      * use a single region. See the documentation tcg_region_init() for the
      * reasoning behind this.
-     * In softmmu we will have at most max_cpus TCG threads.
+     * In softmmu we will have at most max_cpus TCG threads, plus the
+     * background translation threads.
      */
 #ifdef CONFIG_USER_ONLY
     tcg_ctxs = &tcg_ctx;
@@ -990,7 +1243,7 @@ void tcg_context_init(TCGContext *s)
 #else
     MachineState *ms = MACHINE(qdev_get_machine());
     unsigned int max_cpus = ms->smp.max_cpus;
-    tcg_ctxs = g_new(TCGContext *, max_cpus);
+    tcg_ctxs = g_new(TCGContext *, max_cpus + TCG_MAX_TRANSLATION_THREADS);
 #endif
 
     tcg_debug_assert(!tcg_regset_test_reg(s->reserved_regs, TCG_AREG0));
@@ -1013,7 +1266,7 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s)
     next = (void *)ROUND_UP((uintptr_t)(tb + 1), align);
 
     if (unlikely(next > s->code_gen_highwater)) {
-        if (tcg_region_alloc(s)) {
+        if (s->code_hot ? tcg_hot_alloc(s) : tcg_region_alloc(s)) {
             return NULL;
         }
         goto retry;
@@ -1117,6 +1370,8 @@ void tcg_func_start(TCGContext *s)
     s->nb_ops = 0;
     s->nb_labels = 0;
     s->current_frame_offset = s->frame_start;
+    s->tb_host_ptr = false;
+    s->tb_hot_label = NULL;
 
 #ifdef CONFIG_DEBUG_TCG
     s->goto_tb_issue_mask = 0;
@@ -1127,6 +1382,101 @@ void tcg_func_start(TCGContext *s)
     QSIMPLEQ_INIT(&s->labels);
 }
 
+/*
+ * Move the ops and labels generated so far in @s to @st, along with the
+ * pool memory that holds them.  @s is left ready for tcg_func_start().
+ */
+void tcg_ops_detach(TCGContext *s, TCGOpStream *st)
+{
+    TCGOp *op, *next;
+
+    st->ctx = s;
+    st->pool = s->pool_first;
+    st->pool_large = s->pool_first_large;
+    s->pool_first = s->pool_first_large = NULL;
+    s->pool_current = NULL;
+    s->pool_cur = s->pool_end = NULL;
+
+    st->temps = g_memdup(&s->temps[s->nb_globals],
+                         (s->nb_temps - s->nb_globals) * sizeof(TCGTemp));
+    st->nb_temps = s->nb_temps;
+    st->nb_ops = s->nb_ops;
+    st->nb_labels = s->nb_labels;
+    st->tb_host_ptr = s->tb_host_ptr;
+
+    QTAILQ_INIT(&st->ops);
+    QTAILQ_FOREACH_SAFE(op, &s->ops, link, next) {
+        QTAILQ_REMOVE(&s->ops, op, link);
+        QTAILQ_INSERT_TAIL(&st->ops, op, link);
+    }
+    /* The free ops live in the pool we just took, too.  */
+    QTAILQ_INIT(&s->free_ops);
+    QSIMPLEQ_INIT(&st->labels);
+    QSIMPLEQ_CONCAT(&st->labels, &s->labels);
+}
+
+/*
+ * Give @s, which must have just been through tcg_func_start(), the ops
+ * detached into @st.  Temp arguments are rebased onto @s, and exit_tb
+ * arguments that refer to @old_tb are redirected to @new_tb.
+ * The memory backing the ops still belongs to @st, so tcg_ops_release()
+ * must not be called until @s is done with them.
+ */
+void tcg_ops_attach(TCGContext *s, TCGOpStream *st,
+                    const void *old_tb, const void *new_tb)
+{
+    ptrdiff_t delta = (const char *)s - (const char *)st->ctx;
+    TCGOp *op, *next;
+
+    tcg_debug_assert(s->nb_temps == s->nb_globals);
+    memcpy(&s->temps[s->nb_globals], st->temps,
+           (st->nb_temps - s->nb_globals) * sizeof(TCGTemp));
+    s->nb_temps = st->nb_temps;
+    s->nb_ops = st->nb_ops;
+    s->nb_labels = st->nb_labels;
+    s->tb_host_ptr = st->tb_host_ptr;
+
+    QTAILQ_FOREACH_SAFE(op, &st->ops, link, next) {
+        TCGOpcode opc = op->opc;
+        int i, nb_args;
+
+        if (opc == INDEX_op_call) {
+            nb_args = TCGOP_CALLO(op) + TCGOP_CALLI(op);
+        } else {
+            nb_args = tcg_op_defs[opc].nb_oargs + tcg_op_defs[opc].nb_iargs;
+        }
+        for (i = 0; i < nb_args; i++) {
+            if (op->args[i] != TCG_CALL_DUMMY_ARG) {
+                op->args[i] += delta;
+            }
+        }
+        if (opc == INDEX_op_exit_tb &&
+            (op->args[0] & ~TB_EXIT_MASK) == (uintptr_t)old_tb) {
+            op->args[0] = (uintptr_t)new_tb | (op->args[0] & TB_EXIT_MASK);
+        }
+        QTAILQ_REMOVE(&st->ops, op, link);
+        QTAILQ_INSERT_TAIL(&s->ops, op, link);
+    }
+    QSIMPLEQ_CONCAT(&s->labels, &st->labels);
+}
+
+void tcg_ops_release(TCGOpStream *st)
+{
+    TCGPool *p, *t;
+
+    for (p = st->pool; p; p = t) {
+        t = p->next;
+        g_free(p);
+    }
+    for (p = st->pool_large; p; p = t) {
+        t = p->next;
+        g_free(p);
+    }
+    st->pool = st->pool_large = NULL;
+    g_free(st->temps);
+    st->temps = NULL;
+}
+
 static inline TCGTemp *tcg_temp_alloc(TCGContext *s)
 {
     int n = s->nb_temps++;
@@ -2484,6 +2834,39 @@ static void la_global_sync(TCGContext *s, int ng)
     }
 }
 
+/*
+ * Whether @def is a conditional branch that keeps globals live in host
+ * registers.  Only superblocks get this; elsewhere a conditional branch
+ * ends the basic block like any other.
+ */
+static inline bool tcg_op_cond_branch(TCGContext *s, const TCGOpDef *def)
+{
+    return (def->flags & TCG_OPF_COND_BRANCH) &&
+           (s->tb_cflags & CF_SUPERBLOCK);
+}
+
+/* liveness analysis: conditional branch: all temps are dead,
+   globals and local temps should be synced.  */
+static void la_bb_sync(TCGContext *s, int ng, int nt)
+{
+    int i;
+
+    la_global_sync(s, ng);
+
+    for (i = ng; i < nt; ++i) {
+        if (s->temps[i].temp_local) {
+            int state = s->temps[i].state;
+            s->temps[i].state = state | TS_MEM;
+            if (state != TS_DEAD) {
+                continue;
+            }
+        } else {
+            s->temps[i].state = TS_DEAD;
+        }
+        la_reset_pref(&s->temps[i]);
+    }
+}
+
 /* liveness analysis: sync globals back to memory and kill.  */
 static void la_global_kill(TCGContext *s, int ng)
 {
@@ -2760,6 +3143,8 @@ static void liveness_pass_1(TCGContext *s)
             /* If end of basic block, update.  */
             if (def->flags & TCG_OPF_BB_EXIT) {
                 la_func_end(s, nb_globals, nb_temps);
+            } else if (tcg_op_cond_branch(s, def)) {
+                la_bb_sync(s, nb_globals, nb_temps);
             } else if (def->flags & TCG_OPF_BB_END) {
                 la_bb_end(s, nb_globals, nb_temps);
             } else if (def->flags & TCG_OPF_SIDE_EFFECTS) {
@@ -2872,7 +3257,10 @@ static bool liveness_pass_2(TCGContext *s)
             nb_oargs = def->nb_oargs;
 
             /* Set flags similar to how calls require.  */
-            if (def->flags & TCG_OPF_BB_END) {
+            if (tcg_op_cond_branch(s, def)) {
+                /* Like reading globals: sync_globals */
+                call_flags = TCG_CALL_NO_WRITE_GLOBALS;
+            } else if (def->flags & TCG_OPF_BB_END) {
                 /* Like writing globals: save_globals */
                 call_flags = 0;
             } else if (def->flags & TCG_OPF_SIDE_EFFECTS) {
@@ -3310,6 +3698,27 @@ static void tcg_reg_alloc_bb_end(TCGContext *s, TCGRegSet allocated_regs)
     save_globals(s, allocated_regs);
 }
 
+/* at a conditional branch, we assume all temporaries are dead and
+   all globals and local temps are synced to their location. */
+static void tcg_reg_alloc_cbranch(TCGContext *s, TCGRegSet allocated_regs)
+{
+    int i;
+
+    sync_globals(s, allocated_regs);
+
+    for (i = s->nb_globals; i < s->nb_temps; i++) {
+        TCGTemp *ts = &s->temps[i];
+        /* The liveness analysis already ensures that temps are dead.
+           Keep tcg_debug_asserts for safety. */
+        if (ts->temp_local) {
+            tcg_debug_assert(ts->val_type != TEMP_VAL_REG
+                             || ts->mem_coherent);
+        } else {
+            tcg_debug_assert(ts->val_type == TEMP_VAL_DEAD);
+        }
+    }
+}
+
 /*
  * Specialized code generation for INDEX_op_movi_*.
  */
@@ -3662,7 +4071,9 @@ static void tcg_reg_alloc_op(TCGContext *s, const TCGOp *op)
         }
     }
 
-    if (def->flags & TCG_OPF_BB_END) {
+    if (tcg_op_cond_branch(s, def)) {
+        tcg_reg_alloc_cbranch(s, i_allocated_regs);
+    } else if (def->flags & TCG_OPF_BB_END) {
         tcg_reg_alloc_bb_end(s, i_allocated_regs);
     } else {
         if (def->flags & TCG_OPF_CALL_CLOBBER) {
@@ -4049,8 +4460,18 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
     atomic_set(&prof->opt_time, prof->opt_time - profile_getclock());
 #endif
 
+    s->gen_ops_in = s->nb_ops;
+    atomic_set(&s->opt_stats.ops_in, s->opt_stats.ops_in + s->nb_ops);
 #ifdef USE_TCG_OPTIMIZATIONS
     tcg_optimize(s);
+    atomic_set(&s->opt_stats.ops_optimize,
+               s->opt_stats.ops_optimize + s->nb_ops);
+    /* With background translation, leave it to the second tier.  */
+    if (tcg_gvn_enabled &&
+        (!tcg_translation_threads || (tb_cflags(tb) & CF_SUPERBLOCK))) {
+        tcg_optimize_gvn(s);
+    }
+    atomic_set(&s->opt_stats.ops_gvn, s->opt_stats.ops_gvn + s->nb_ops);
 #endif
 
 #ifdef CONFIG_PROFILER
@@ -4079,6 +4500,10 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
         }
     }
 
+    s->gen_ops_out = s->nb_ops;
+    atomic_set(&s->opt_stats.ops_liveness,
+               s->opt_stats.ops_liveness + s->nb_ops);
+
 #ifdef CONFIG_PROFILER
     atomic_set(&prof->la_time, prof->la_time + profile_getclock());
 #endif
@@ -642,6 +642,17 @@ typedef struct TCGOp {
 /* Make sure operands fit in the bitfields above.  */
 QEMU_BUILD_BUG_ON(NB_OPS > (1 << 8));
 
+/* Op counts after each optimization pass, summed over all TBs */
+typedef struct TCGOptStats {
+    size_t ops_in;          /* emitted by the front end */
+    size_t ops_optimize;    /* after tcg_optimize */
+    size_t ops_gvn;         /* after tcg_optimize_gvn */
+    size_t ops_liveness;    /* after liveness analysis */
+    size_t gvn_cse;         /* redundant expressions replaced with a copy */
+    size_t gvn_loads;       /* env loads forwarded from an earlier access */
+    size_t gvn_stores;      /* dead or redundant env stores removed */
+} TCGOptStats;
+
 typedef struct TCGProfile {
     int64_t cpu_exec_time;
     int64_t tb_count1;
@@ -680,6 +691,11 @@ struct TCGContext {
 
     TCGRegSet reserved_regs;
     uint32_t tb_cflags; /* cflags of the current TB */
+    target_ulong gen_tb_pc; /* guest PC of the current TB */
+    bool tb_host_ptr; /* the current TB embeds a host pointer constant */
+    struct TBProfile *tb_profile; /* where the current TB counts executions */
+    int gen_ops_in; /* ops of the current TB before optimization */
+    int gen_ops_out; /* ops of the current TB after liveness analysis */
     intptr_t current_frame_offset;
     intptr_t frame_start;
     intptr_t frame_end;
@@ -711,7 +727,15 @@ struct TCGContext {
     /* Threshold to flush the translated code buffer.  */
     void *code_gen_highwater;
 
+    /* The code area not in use, see tcg_code_select().  */
+    bool code_hot;
+    void *code_alt_buffer;
+    size_t code_alt_buffer_size;
+    void *code_alt_ptr;
+    void *code_alt_highwater;
+
     size_t tb_phys_invalidate_count;
+    TCGOptStats opt_stats;
 
     /* Track which vCPU triggers events */
     CPUState *cpu;                      /* *_trans */
@@ -725,6 +749,8 @@ struct TCGContext {
 #endif
 
     TCGLabel *exitreq_label;
+    /* Exit taken once the TB is hot, NULL if the TB does not count */
+    TCGLabel *tb_hot_label;
 
     TCGTempSet free_temps[TCG_TYPE_COUNT * 2];
     TCGTemp temps[TCG_MAX_TEMPS]; /* globals first, temps after */
@@ -740,6 +766,23 @@ struct TCGContext {
     target_ulong gen_insn_data[TCG_MAX_INSNS][TARGET_INSN_START_WORDS];
 };
 
+/*
+ * The ops of a function taken out of the context that generated them,
+ * so that they can be compiled by another thread's context.
+ * See tcg_ops_detach() and tcg_ops_attach().
+ */
+typedef struct TCGOpStream {
+    const TCGContext *ctx; /* where the ops' temps point to */
+    TCGPool *pool, *pool_large; /* memory backing the ops and labels */
+    TCGTemp *temps; /* copy of ctx->temps[nb_globals..nb_temps-1] */
+    int nb_temps;
+    int nb_ops;
+    int nb_labels;
+    bool tb_host_ptr;
+    QTAILQ_HEAD(, TCGOp) ops;
+    QSIMPLEQ_HEAD(, TCGLabel) labels;
+} TCGOpStream;
+
 extern TCGContext tcg_init_ctx;
 extern __thread TCGContext *tcg_ctx;
 extern TCGv_env cpu_env;
@@ -882,14 +925,26 @@ void tcg_pool_reset(TCGContext *s);
 TranslationBlock *tcg_tb_alloc(TCGContext *s);
 
 void tcg_region_init(void);
+void tcg_region_reserve(void *end);
 void tcg_region_reset_all(void);
 
+/* Size of the hot code area, see "-accel tcg,hot-code-size" */
+extern size_t tcg_hot_area_size;
+
+void tcg_code_select(TCGContext *s, bool hot);
+void tcg_hot_reset(void);
+bool tcg_hot_full(void);
+void tcg_hot_tb_foreach(GTraverseFunc func, gpointer user_data);
+bool tcg_hot_contains(const void *p);
+void tcg_hot_usage(size_t *used, size_t *capacity);
+
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
 
 void tcg_tb_insert(TranslationBlock *tb);
 void tcg_tb_remove(TranslationBlock *tb);
 size_t tcg_tb_phys_invalidate_count(void);
+void tcg_opt_stats(TCGOptStats *stats);
 TranslationBlock *tcg_tb_lookup(uintptr_t tc_ptr);
 void tcg_tb_foreach(GTraverseFunc func, gpointer user_data);
 size_t tcg_nb_tbs(void);
@@ -1057,6 +1112,9 @@ enum {
     TCG_OPF_NOT_PRESENT  = 0x20,
     /* Instruction operands are vectors.  */
     TCG_OPF_VECTOR       = 0x40,
+    /* Instruction is a conditional branch; in superblocks, globals stay
+       in host registers across it.  */
+    TCG_OPF_COND_BRANCH  = 0x80
 };
 
 typedef struct TCGOpDef {
@@ -1094,6 +1152,20 @@ TCGOp *tcg_op_insert_before(TCGContext *s, TCGOp *op, TCGOpcode opc);
 TCGOp *tcg_op_insert_after(TCGContext *s, TCGOp *op, TCGOpcode opc);
 
 void tcg_optimize(TCGContext *s);
+void tcg_optimize_gvn(TCGContext *s);
+
+/* Whether tcg_optimize_gvn() runs, see "-accel tcg,gvn=off" */
+extern bool tcg_gvn_enabled;
+
+#define TCG_MAX_TRANSLATION_THREADS 16
+
+/* Background translation threads, see "-accel tcg,translation-threads" */
+extern unsigned int tcg_translation_threads;
+
+void tcg_ops_detach(TCGContext *s, TCGOpStream *st);
+void tcg_ops_attach(TCGContext *s, TCGOpStream *st,
+                    const void *old_tb, const void *new_tb);
+void tcg_ops_release(TCGOpStream *st);
 
 TCGv_i32 tcg_const_i32(int32_t val);
 TCGv_i64 tcg_const_i64(int64_t val);
@@ -1104,12 +1176,22 @@ TCGv_vec tcg_const_ones_vec(TCGType);
 TCGv_vec tcg_const_zeros_vec_matching(TCGv_vec);
 TCGv_vec tcg_const_ones_vec_matching(TCGv_vec);
 
+/*
+ * Pointer constants are host addresses that are only meaningful within
+ * this process, so note their use: such TBs must not be persisted.
+ */
 #if UINTPTR_MAX == UINT32_MAX
-# define tcg_const_ptr(x)        ((TCGv_ptr)tcg_const_i32((intptr_t)(x)))
-# define tcg_const_local_ptr(x)  ((TCGv_ptr)tcg_const_local_i32((intptr_t)(x)))
+# define tcg_const_ptr(x)                                               \
+    (tcg_ctx->tb_host_ptr = true, (TCGv_ptr)tcg_const_i32((intptr_t)(x)))
+# define tcg_const_local_ptr(x)                                         \
+    (tcg_ctx->tb_host_ptr = true,                                       \
+     (TCGv_ptr)tcg_const_local_i32((intptr_t)(x)))
 #else
-# define tcg_const_ptr(x)        ((TCGv_ptr)tcg_const_i64((intptr_t)(x)))
-# define tcg_const_local_ptr(x)  ((TCGv_ptr)tcg_const_local_i64((intptr_t)(x)))
+# define tcg_const_ptr(x)                                               \
+    (tcg_ctx->tb_host_ptr = true, (TCGv_ptr)tcg_const_i64((intptr_t)(x)))
+# define tcg_const_local_ptr(x)                                         \
+    (tcg_ctx->tb_host_ptr = true,                                       \
+     (TCGv_ptr)tcg_const_local_i64((intptr_t)(x)))
 #endif
 
 TCGLabel *gen_new_label(void);
@@ -1244,11 +1326,10 @@ static inline unsigned get_mmuidx(TCGMemOpIdx oi)
  *        TB index (0 or 1). That is, we left the TB via (the equivalent
  *        of) "goto_tb <index>". The main loop uses this to determine
  *        how to link the TB just executed to the next.
- *  2:    we are using instruction counting code generation, and we
- *        did not start executing this TB because the instruction counter
- *        would hit zero midway through it. In this case the pointer
- *        returned is the TB we were about to execute, and the caller must
- *        arrange to execute the remaining count of instructions.
+ *  2:    we did not start executing this TB because it has run
+ *        tb_hot_threshold times and should be retranslated as a
+ *        superblock. The pointer returned is the TB we were about to
+ *        execute.
  *  3:    we stopped because the CPU's exit_request flag was set
  *        (usually meaning that there is an interrupt that needs to be
  *        handled). The pointer returned is the TB we were about to execute
@@ -1271,6 +1352,7 @@ static inline unsigned get_mmuidx(TCGMemOpIdx oi)
 #define TB_EXIT_IDX0      0
 #define TB_EXIT_IDX1      1
 #define TB_EXIT_IDXMAX    1
+#define TB_EXIT_HOT       2
 #define TB_EXIT_REQUESTED 3
 
 #ifdef HAVE_TCG_QEMU_TB_EXEC
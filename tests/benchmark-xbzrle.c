@@ -0,0 +1,126 @@
+/*
+ * Xor Based Zero Run Length Encoding speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "../migration/xbzrle.h"
+
+#define PAGE_SIZE 4096
+
+typedef struct {
+    const char *name;
+    /* number of changed runs in the page */
+    int nr_runs;
+    /* length of each changed run */
+    int run_len;
+} XbzrlePattern;
+
+static const XbzrlePattern patterns[] = {
+    { "unchanged", 0, 0 },
+    { "one byte", 1, 1 },
+    { "sparse", 8, 4 },
+    { "scattered", 64, 8 },
+    { "dense", 16, 128 },
+};
+
+static void prepare_page(const XbzrlePattern *pattern,
+                         uint8_t *old_buf, uint8_t *new_buf)
+{
+    int stride = pattern->nr_runs ? PAGE_SIZE / pattern->nr_runs : 0;
+    int i, j;
+
+    for (i = 0; i < PAGE_SIZE; i++) {
+        old_buf[i] = g_test_rand_int();
+    }
+    memcpy(new_buf, old_buf, PAGE_SIZE);
+
+    for (i = 0; i < pattern->nr_runs; i++) {
+        for (j = 0; j < pattern->run_len; j++) {
+            new_buf[i * stride + j] ^= 0xff;
+        }
+    }
+}
+
+static void test_encode_speed(void)
+{
+    uint8_t *old_buf = g_malloc(PAGE_SIZE);
+    uint8_t *new_buf = g_malloc(PAGE_SIZE);
+    uint8_t *compressed = g_malloc(PAGE_SIZE);
+    int accel = 0;
+    size_t i;
+
+    do {
+        for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+            double total = 0.0;
+
+            prepare_page(&patterns[i], old_buf, new_buf);
+
+            g_test_timer_start();
+            do {
+                int dlen = xbzrle_encode_buffer(old_buf, new_buf, PAGE_SIZE,
+                                                compressed, PAGE_SIZE);
+                g_assert(dlen >= 0);
+
+                total += PAGE_SIZE;
+            } while (g_test_timer_elapsed() < 1.0);
+
+            total /= MiB;
+            g_print("xbzrle encoder %d: %-10s ", accel, patterns[i].name);
+            g_print("done: %.2f MB in %.2f secs: ", total, g_test_timer_last());
+            g_print("%.2f MB/sec\n", total / g_test_timer_last());
+        }
+        accel++;
+    } while (xbzrle_encode_next_accel());
+
+    g_free(old_buf);
+    g_free(new_buf);
+    g_free(compressed);
+}
+
+static void test_decode_speed(void)
+{
+    uint8_t *old_buf = g_malloc(PAGE_SIZE);
+    uint8_t *new_buf = g_malloc(PAGE_SIZE);
+    uint8_t *compressed = g_malloc(PAGE_SIZE);
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+        double total = 0.0;
+        int dlen;
+
+        prepare_page(&patterns[i], old_buf, new_buf);
+        dlen = xbzrle_encode_buffer(old_buf, new_buf, PAGE_SIZE,
+                                    compressed, PAGE_SIZE);
+        g_assert(dlen >= 0);
+
+        g_test_timer_start();
+        do {
+            g_assert(xbzrle_decode_buffer(compressed, dlen, old_buf,
+                                          PAGE_SIZE) >= 0);
+
+            total += PAGE_SIZE;
+        } while (g_test_timer_elapsed() < 1.0);
+
+        total /= MiB;
+        g_print("xbzrle decoder: %-10s ", patterns[i].name);
+        g_print("done: %.2f MB in %.2f secs: ", total, g_test_timer_last());
+        g_print("%.2f MB/sec\n", total / g_test_timer_last());
+    }
+
+    g_free(old_buf);
+    g_free(new_buf);
+    g_free(compressed);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/xbzrle/decode/speed", test_decode_speed);
+    /* This one disables the accelerators as it goes, keep it last */
+    g_test_add_func("/xbzrle/encode/speed", test_encode_speed);
+
+    return g_test_run();
+}
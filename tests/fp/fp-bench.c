@@ -33,6 +33,12 @@ enum op {
     OP_FMA,
     OP_SQRT,
     OP_CMP,
+    OP_CVT,
+    OP_TOINT,
+    OP_FROMINT,
+    OP_ROUND,
+    OP_MIN,
+    OP_MAX,
     OP_MAX_NR,
 };
 
@@ -44,12 +50,19 @@ static const char * const op_names[] = {
     [OP_FMA] = "mulAdd",
     [OP_SQRT] = "sqrt",
     [OP_CMP] = "cmp",
+    [OP_CVT] = "cvt",
+    [OP_TOINT] = "toint",
+    [OP_FROMINT] = "fromint",
+    [OP_ROUND] = "round",
+    [OP_MIN] = "min",
+    [OP_MAX] = "max",
     [OP_MAX_NR] = NULL,
 };
 
 enum precision {
     PREC_SINGLE,
     PREC_DOUBLE,
+    PREC_FLOAT16,
     PREC_FLOAT32,
     PREC_FLOAT64,
     PREC_MAX_NR,
@@ -87,6 +100,7 @@ static const char * const tester_names[] = {
 union fp {
     float f;
     double d;
+    float16 f16;
     float32 f32;
     float64 f64;
     uint64_t u64;
@@ -144,6 +158,11 @@ static void update_random_ops(int n_ops, enum precision prec)
         uint64_t r = random_ops[i];
 
         switch (prec) {
+        case PREC_FLOAT16:
+            do {
+                r = xorshift64star(r);
+            } while (!float16_is_normal(r));
+            break;
         case PREC_SINGLE:
         case PREC_FLOAT32:
             do {
@@ -163,23 +182,46 @@ static void update_random_ops(int n_ops, enum precision prec)
     }
 }
 
+/*
+ * Conversions to integer and rounding are only interesting for inputs
+ * that are not integers already and do not overflow, so @small limits
+ * the magnitude of the operands to [2^-8, 2^8) in that case.
+ */
 static void fill_random(union fp *ops, int n_ops, enum precision prec,
-                        bool no_neg)
+                        bool no_neg, bool small)
 {
     int i;
 
     for (i = 0; i < n_ops; i++) {
+        uint64_t r = random_ops[i];
+
         switch (prec) {
+        case PREC_FLOAT16:
+            if (small) {
+                r = (r & 0x83ff) | ((15 - 8 + (r >> 10) % 16) << 10);
+            }
+            ops[i].f16 = make_float16(r);
+            if (no_neg && float16_is_neg(ops[i].f16)) {
+                ops[i].f16 = float16_chs(ops[i].f16);
+            }
+            break;
         case PREC_SINGLE:
         case PREC_FLOAT32:
-            ops[i].f32 = make_float32(random_ops[i]);
+            if (small) {
+                r = (r & 0x807fffff) | ((127 - 8 + (r >> 23) % 16) << 23);
+            }
+            ops[i].f32 = make_float32(r);
             if (no_neg && float32_is_neg(ops[i].f32)) {
                 ops[i].f32 = float32_chs(ops[i].f32);
             }
             break;
         case PREC_DOUBLE:
         case PREC_FLOAT64:
-            ops[i].f64 = make_float64(random_ops[i]);
+            if (small) {
+                r = (r & 0x800fffffffffffffULL) |
+                    ((1023 - 8 + (r >> 52) % 16) << 52);
+            }
+            ops[i].f64 = make_float64(r);
             if (no_neg && float64_is_neg(ops[i].f64)) {
                 ops[i].f64 = float64_chs(ops[i].f64);
             }
@@ -197,6 +239,7 @@ static void fill_random(union fp *ops, int n_ops, enum precision prec,
 static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
 {
     int64_t tf = get_clock() + duration * 1000000000LL;
+    bool small = op == OP_TOINT || op == OP_ROUND;
 
     while (get_clock() < tf) {
         union fp ops[MAX_OPERANDS];
@@ -206,7 +249,7 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
         update_random_ops(n_ops, prec);
         switch (prec) {
         case PREC_SINGLE:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, small);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float a = ops[0].f;
@@ -235,13 +278,31 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_CVT:
+                    res.d = a;
+                    break;
+                case OP_TOINT:
+                    res.u64 = llrintf(a);
+                    break;
+                case OP_FROMINT:
+                    res.f = (int64_t)random_ops[0];
+                    break;
+                case OP_ROUND:
+                    res.f = rintf(a);
+                    break;
+                case OP_MIN:
+                    res.f = fminf(a, b);
+                    break;
+                case OP_MAX:
+                    res.f = fmaxf(a, b);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_DOUBLE:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, small);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 double a = ops[0].d;
@@ -270,13 +331,84 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_CVT:
+                    res.f = a;
+                    break;
+                case OP_TOINT:
+                    res.u64 = llrint(a);
+                    break;
+                case OP_FROMINT:
+                    res.d = (int64_t)random_ops[0];
+                    break;
+                case OP_ROUND:
+                    res.d = rint(a);
+                    break;
+                case OP_MIN:
+                    res.d = fmin(a, b);
+                    break;
+                case OP_MAX:
+                    res.d = fmax(a, b);
+                    break;
+                default:
+                    g_assert_not_reached();
+                }
+            }
+            break;
+        case PREC_FLOAT16:
+            fill_random(ops, n_ops, prec, no_neg, small);
+            t0 = get_clock();
+            for (i = 0; i < OPS_PER_ITER; i++) {
+                float16 a = ops[0].f16;
+                float16 b = ops[1].f16;
+                float16 c = ops[2].f16;
+
+                switch (op) {
+                case OP_ADD:
+                    res.f16 = float16_add(a, b, &soft_status);
+                    break;
+                case OP_SUB:
+                    res.f16 = float16_sub(a, b, &soft_status);
+                    break;
+                case OP_MUL:
+                    res.f16 = float16_mul(a, b, &soft_status);
+                    break;
+                case OP_DIV:
+                    res.f16 = float16_div(a, b, &soft_status);
+                    break;
+                case OP_FMA:
+                    res.f16 = float16_muladd(a, b, c, 0, &soft_status);
+                    break;
+                case OP_SQRT:
+                    res.f16 = float16_sqrt(a, &soft_status);
+                    break;
+                case OP_CMP:
+                    res.u64 = float16_compare_quiet(a, b, &soft_status);
+                    break;
+                case OP_CVT:
+                    res.f32 = float16_to_float32(a, true, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float16_to_int64(a, &soft_status);
+                    break;
+                case OP_FROMINT:
+                    res.f16 = int64_to_float16(random_ops[0], &soft_status);
+                    break;
+                case OP_ROUND:
+                    res.f16 = float16_round_to_int(a, &soft_status);
+                    break;
+                case OP_MIN:
+                    res.f16 = float16_minnum(a, b, &soft_status);
+                    break;
+                case OP_MAX:
+                    res.f16 = float16_maxnum(a, b, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT32:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, small);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float32 a = ops[0].f32;
@@ -305,13 +437,31 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float32_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_CVT:
+                    res.f64 = float32_to_float64(a, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float32_to_int64(a, &soft_status);
+                    break;
+                case OP_FROMINT:
+                    res.f32 = int64_to_float32(random_ops[0], &soft_status);
+                    break;
+                case OP_ROUND:
+                    res.f32 = float32_round_to_int(a, &soft_status);
+                    break;
+                case OP_MIN:
+                    res.f32 = float32_minnum(a, b, &soft_status);
+                    break;
+                case OP_MAX:
+                    res.f32 = float32_maxnum(a, b, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT64:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, small);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float64 a = ops[0].f64;
@@ -340,6 +490,24 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float64_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_CVT:
+                    res.f32 = float64_to_float32(a, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float64_to_int64(a, &soft_status);
+                    break;
+                case OP_FROMINT:
+                    res.f64 = int64_to_float64(random_ops[0], &soft_status);
+                    break;
+                case OP_ROUND:
+                    res.f64 = float64_round_to_int(a, &soft_status);
+                    break;
+                case OP_MIN:
+                    res.f64 = float64_minnum(a, b, &soft_status);
+                    break;
+                case OP_MAX:
+                    res.f64 = float64_maxnum(a, b, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -368,6 +536,7 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
 #define GEN_BENCH_ALL_TYPES(opname, op, n_ops)                          \
     GEN_BENCH(bench_ ## opname ## _float, float, PREC_SINGLE, op, n_ops) \
     GEN_BENCH(bench_ ## opname ## _double, double, PREC_DOUBLE, op, n_ops) \
+    GEN_BENCH(bench_ ## opname ## _float16, float16, PREC_FLOAT16, op, n_ops) \
     GEN_BENCH(bench_ ## opname ## _float32, float32, PREC_FLOAT32, op, n_ops) \
     GEN_BENCH(bench_ ## opname ## _float64, float64, PREC_FLOAT64, op, n_ops)
 
@@ -377,11 +546,18 @@ GEN_BENCH_ALL_TYPES(mul, OP_MUL, 2)
 GEN_BENCH_ALL_TYPES(div, OP_DIV, 2)
 GEN_BENCH_ALL_TYPES(fma, OP_FMA, 3)
 GEN_BENCH_ALL_TYPES(cmp, OP_CMP, 2)
+GEN_BENCH_ALL_TYPES(cvt, OP_CVT, 1)
+GEN_BENCH_ALL_TYPES(toint, OP_TOINT, 1)
+GEN_BENCH_ALL_TYPES(fromint, OP_FROMINT, 1)
+GEN_BENCH_ALL_TYPES(round, OP_ROUND, 1)
+GEN_BENCH_ALL_TYPES(min, OP_MIN, 2)
+GEN_BENCH_ALL_TYPES(max, OP_MAX, 2)
 #undef GEN_BENCH_ALL_TYPES
 
 #define GEN_BENCH_ALL_TYPES_NO_NEG(name, op, n)                         \
     GEN_BENCH_NO_NEG(bench_ ## name ## _float, float, PREC_SINGLE, op, n) \
     GEN_BENCH_NO_NEG(bench_ ## name ## _double, double, PREC_DOUBLE, op, n) \
+    GEN_BENCH_NO_NEG(bench_ ## name ## _float16, float16, PREC_FLOAT16, op, n) \
     GEN_BENCH_NO_NEG(bench_ ## name ## _float32, float32, PREC_FLOAT32, op, n) \
     GEN_BENCH_NO_NEG(bench_ ## name ## _float64, float64, PREC_FLOAT64, op, n)
 
@@ -395,6 +571,7 @@ GEN_BENCH_ALL_TYPES_NO_NEG(sqrt, OP_SQRT, 1)
     [op] = {                                                    \
         [PREC_SINGLE]    = bench_ ## opname ## _float,          \
         [PREC_DOUBLE]    = bench_ ## opname ## _double,         \
+        [PREC_FLOAT16]   = bench_ ## opname ## _float16,        \
         [PREC_FLOAT32]   = bench_ ## opname ## _float32,        \
         [PREC_FLOAT64]   = bench_ ## opname ## _float64,        \
     }
@@ -407,6 +584,12 @@ static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
     GEN_BENCH_FUNCS(fma, OP_FMA),
     GEN_BENCH_FUNCS(sqrt, OP_SQRT),
     GEN_BENCH_FUNCS(cmp, OP_CMP),
+    GEN_BENCH_FUNCS(cvt, OP_CVT),
+    GEN_BENCH_FUNCS(toint, OP_TOINT),
+    GEN_BENCH_FUNCS(fromint, OP_FROMINT),
+    GEN_BENCH_FUNCS(round, OP_ROUND),
+    GEN_BENCH_FUNCS(min, OP_MIN),
+    GEN_BENCH_FUNCS(max, OP_MAX),
 };
 
 #undef GEN_BENCH_FUNCS
@@ -445,7 +628,7 @@ static void usage_complete(int argc, char *argv[])
     fprintf(stderr, " -h = show this help message.\n");
     fprintf(stderr, " -o = floating point operation (%s). Default: %s\n",
             op_list, op_names[0]);
-    fprintf(stderr, " -p = floating point precision (single, double). "
+    fprintf(stderr, " -p = floating point precision (half, single, double). "
             "Default: single\n");
     fprintf(stderr, " -r = rounding mode (even, zero, down, up, tieaway). "
             "Default: even\n");
@@ -561,7 +744,9 @@ static void parse_args(int argc, char *argv[])
             operation = val;
             break;
         case 'p':
-            if (!strcmp(optarg, "single")) {
+            if (!strcmp(optarg, "half")) {
+                precision = PREC_FLOAT16;
+            } else if (!strcmp(optarg, "single")) {
                 precision = PREC_SINGLE;
             } else if (!strcmp(optarg, "double")) {
                 precision = PREC_DOUBLE;
@@ -597,6 +782,10 @@ static void parse_args(int argc, char *argv[])
     /* set precision and rounding mode based on the tester */
     switch (tester) {
     case TESTER_HOST:
+        if (precision == PREC_FLOAT16) {
+            fprintf(stderr, "fatal: half precision needs the soft tester\n");
+            exit(EXIT_FAILURE);
+        }
         set_host_precision(rounding);
         break;
     case TESTER_SOFT:
@@ -608,6 +797,8 @@ static void parse_args(int argc, char *argv[])
         case PREC_DOUBLE:
             precision = PREC_FLOAT64;
             break;
+        case PREC_FLOAT16:
+            break;
         default:
             g_assert_not_reached();
         }
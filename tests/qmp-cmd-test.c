@@ -213,6 +213,42 @@ static void test_object_add_without_props(void)
     qtest_quit(qts);
 }
 
+#ifdef CONFIG_TCG
+static void test_tcg_profile(void)
+{
+    QTestState *qts;
+    QDict *resp;
+
+    /* Profiling needs TCG */
+    qts = qtest_init(common_args);
+    resp = qtest_qmp(qts, "{'execute': 'tcg-profile-set',"
+                     " 'arguments': {'enable': true } }");
+    qmp_assert_error_class(resp, "GenericError");
+    qtest_quit(qts);
+
+    qts = qtest_initf("%s,accel=tcg", common_args);
+    resp = qtest_qmp(qts, "{'execute': 'tcg-profile-set',"
+                     " 'arguments': {'enable': true } }");
+    g_assert(qdict_haskey(resp, "return"));
+    qobject_unref(resp);
+
+    resp = qtest_qmp(qts, "{'execute': 'query-tcg-profile',"
+                     " 'arguments': {'limit': 1 } }");
+    g_assert(qdict_get_qlist(resp, "return"));
+    qobject_unref(resp);
+
+    resp = qtest_qmp(qts, "{'execute': 'query-tcg-profile',"
+                     " 'arguments': {'limit': -1 } }");
+    qmp_assert_error_class(resp, "GenericError");
+
+    resp = qtest_qmp(qts, "{'execute': 'tcg-profile-set',"
+                     " 'arguments': {'enable': false } }");
+    g_assert(qdict_haskey(resp, "return"));
+    qobject_unref(resp);
+    qtest_quit(qts);
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     QmpSchema schema;
@@ -226,6 +262,9 @@ int main(int argc, char *argv[])
     qtest_add_func("qmp/object-add-without-props",
                    test_object_add_without_props);
     /* TODO: add coverage of generic object-add failure modes */
+#ifdef CONFIG_TCG
+    qtest_add_func("qmp/tcg-profile", test_tcg_profile);
+#endif
 
     ret = g_test_run();
 
@@ -0,0 +1,138 @@
+/*
+ * Check TB-to-TB transitions.
+ *
+ * The first loop is made of many short basic blocks linked by direct
+ * branches, so under TCG it runs through chained goto_tb jumps that are
+ * patched while the loop runs.  The second loop calls through a table of
+ * function pointers, which exercises the indirect lookup_and_goto_ptr
+ * path.  Both are checked against a branch-free computation of the same
+ * result.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define ITERS 100000
+
+/* The empty asm keeps the compiler from turning the branches into selects. */
+#define STEP(bit, a, b)                         \
+    do {                                        \
+        if (n & (1u << (bit))) {                \
+            __asm__ __volatile__("");           \
+            x += (a);                           \
+        } else {                                \
+            __asm__ __volatile__("");           \
+            x ^= (b);                           \
+        }                                       \
+    } while (0)
+
+#define REF_STEP(bit, a, b)                             \
+    do {                                                \
+        uint32_t m = -((n >> (bit)) & 1);               \
+        x = (m & (x + (a))) | (~m & (x ^ (b)));         \
+    } while (0)
+
+static uint32_t __attribute__((noinline)) run_direct(uint32_t n)
+{
+    uint32_t x = 0;
+
+    while (n--) {
+        STEP(0, 3, 5);
+        STEP(1, 7, 11);
+        STEP(2, 13, 17);
+        STEP(3, 19, 23);
+        STEP(4, 29, 31);
+        STEP(5, 37, 41);
+        STEP(6, 43, 47);
+        STEP(7, 53, 59);
+    }
+    return x;
+}
+
+static uint32_t ref_direct(uint32_t n)
+{
+    uint32_t x = 0;
+
+    while (n--) {
+        REF_STEP(0, 3, 5);
+        REF_STEP(1, 7, 11);
+        REF_STEP(2, 13, 17);
+        REF_STEP(3, 19, 23);
+        REF_STEP(4, 29, 31);
+        REF_STEP(5, 37, 41);
+        REF_STEP(6, 43, 47);
+        REF_STEP(7, 53, 59);
+    }
+    return x;
+}
+
+static uint32_t __attribute__((noinline)) f0(uint32_t x)
+{
+    return x + 1;
+}
+
+static uint32_t __attribute__((noinline)) f1(uint32_t x)
+{
+    return x ^ 0x55;
+}
+
+static uint32_t __attribute__((noinline)) f2(uint32_t x)
+{
+    return x * 3;
+}
+
+static uint32_t __attribute__((noinline)) f3(uint32_t x)
+{
+    return x >> 1;
+}
+
+static uint32_t (* volatile fns[4])(uint32_t) = { f0, f1, f2, f3 };
+
+static uint32_t __attribute__((noinline)) run_indirect(uint32_t n)
+{
+    uint32_t x = 0;
+
+    while (n--) {
+        x = fns[n & 3](x);
+    }
+    return x;
+}
+
+static uint32_t ref_indirect(uint32_t n)
+{
+    static const uint32_t mul[4] = { 1, 1, 3, 1 };
+    static const uint32_t add[4] = { 1, 0, 0, 0 };
+    static const uint32_t eor[4] = { 0, 0x55, 0, 0 };
+    static const int shift[4] = { 0, 0, 0, 1 };
+    uint32_t x = 0;
+
+    while (n--) {
+        x = (((x * mul[n & 3]) + add[n & 3]) ^ eor[n & 3]) >> shift[n & 3];
+    }
+    return x;
+}
+
+int main(void)
+{
+    uint32_t got, expected;
+    int ret = 0;
+
+    got = run_direct(ITERS);
+    expected = ref_direct(ITERS);
+    if (got != expected) {
+        printf("direct: got %#x, expected %#x\n", got, expected);
+        ret = 1;
+    }
+
+    got = run_indirect(ITERS);
+    expected = ref_indirect(ITERS);
+    if (got != expected) {
+        printf("indirect: got %#x, expected %#x\n", got, expected);
+        ret = 1;
+    }
+
+    return ret;
+}
@@ -174,6 +174,71 @@ static void test_encode_decode(void)
     }
 }
 
+/*
+ * All encoders must produce the same output.  Encode random changes with
+ * the preferred one, then check the others against it.  This disables
+ * the accelerators, so it must run last.
+ */
+static void test_encode_accel(void)
+{
+    const int nr_pages = 256;
+    uint8_t *old_buf = g_malloc(nr_pages * PAGE_SIZE);
+    uint8_t *new_buf = g_malloc(nr_pages * PAGE_SIZE);
+    uint8_t *ref = g_malloc(nr_pages * PAGE_SIZE);
+    uint8_t *compressed = g_malloc(PAGE_SIZE);
+    int *ref_len = g_new(int, nr_pages);
+    bool first = true;
+    int i, j;
+
+    for (i = 0; i < nr_pages * PAGE_SIZE; i++) {
+        old_buf[i] = g_test_rand_int();
+    }
+    memcpy(new_buf, old_buf, nr_pages * PAGE_SIZE);
+
+    /* Runs of various lengths, including some that overflow */
+    for (i = 0; i < nr_pages; i++) {
+        int nr_runs = g_test_rand_int_range(0, 1 + i * 4);
+
+        for (j = 0; j < nr_runs; j++) {
+            int start = g_test_rand_int_range(0, PAGE_SIZE);
+            int len = g_test_rand_int_range(1, 2 + 4 * (i % 64));
+
+            while (len-- && start < PAGE_SIZE) {
+                new_buf[i * PAGE_SIZE + start++] ^=
+                    g_test_rand_int_range(1, 256);
+            }
+        }
+    }
+
+    do {
+        for (i = 0; i < nr_pages; i++) {
+            int dlen = xbzrle_encode_buffer(old_buf + i * PAGE_SIZE,
+                                            new_buf + i * PAGE_SIZE,
+                                            PAGE_SIZE, compressed, PAGE_SIZE);
+
+            if (first) {
+                ref_len[i] = dlen;
+                if (dlen > 0) {
+                    memcpy(ref + i * PAGE_SIZE, compressed, dlen);
+                }
+            } else {
+                g_assert_cmpint(dlen, ==, ref_len[i]);
+                if (dlen > 0) {
+                    g_assert(memcmp(ref + i * PAGE_SIZE, compressed,
+                                    dlen) == 0);
+                }
+            }
+        }
+        first = false;
+    } while (xbzrle_encode_next_accel());
+
+    g_free(old_buf);
+    g_free(new_buf);
+    g_free(ref);
+    g_free(compressed);
+    g_free(ref_len);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -186,6 +251,7 @@ int main(int argc, char **argv)
     g_test_add_func("/xbzrle/encode_decode_overflow",
                     test_encode_decode_overflow);
     g_test_add_func("/xbzrle/encode_decode", test_encode_decode);
+    g_test_add_func("/xbzrle/encode_accel", test_encode_accel);
 
     return g_test_run();
 }
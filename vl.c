@@ -304,6 +304,51 @@ static QemuOptsList qemu_accel_opts = {
             .type = QEMU_OPT_STRING,
             .help = "Enable/disable multi-threaded TCG",
         },
+        {
+            .name = "tb-cache",
+            .type = QEMU_OPT_STRING,
+            .help = "File used to keep translated code across runs",
+        },
+        {
+            .name = "superblock-threshold",
+            .type = QEMU_OPT_NUMBER,
+            .help = "Executions before a TB is retranslated as a superblock",
+        },
+        {
+            .name = "gvn",
+            .type = QEMU_OPT_BOOL,
+            .help = "Remove redundant operations and env accesses",
+        },
+        {
+            .name = "translation-threads",
+            .type = QEMU_OPT_NUMBER,
+            .help = "Threads that retranslate hot code in the background",
+        },
+        {
+            .name = "hot-code-size",
+            .type = QEMU_OPT_SIZE,
+            .help = "Part of the code buffer kept for hot code across flushes",
+        },
+        {
+            .name = "jmp-cache-bits",
+            .type = QEMU_OPT_NUMBER,
+            .help = "log2 of the number of sets in the TB jump cache",
+        },
+        {
+            .name = "victim-tlb-bits",
+            .type = QEMU_OPT_NUMBER,
+            .help = "log2 of the number of sets in the victim TLB",
+        },
+        {
+            .name = "profile",
+            .type = QEMU_OPT_BOOL,
+            .help = "Profile translation and execution per guest PC",
+        },
+        {
+            .name = "perf-map",
+            .type = QEMU_OPT_BOOL,
+            .help = "Describe translated code in /tmp/perf-<pid>.map",
+        },
         { /* end of list */ }
     },
 };